@@ -0,0 +1,644 @@
+/** @file bench.c
+ ** @brief Benchmarks of the library's hot paths against an emulated xbee
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program starts an xbee emulator, opens its pseudo terminal
+ *				with the library and measures:
+ *					read_port		Lines received, injected by another thread
+ *					write_port		Lines sent
+ *					get_ip			Round trip of ATMY in an open session
+ *					command_mode	+++ followed by ATCN, guard times included
+ *					frame_encode	Escaped API frames built
+ *					frame_decode	Escaped API frames parsed
+ *					compress		Telemetry messages compressed with a
+ *									dictionary trained on similar ones
+ *					decompress		The same messages decompressed
+ *				Every operation is timed on its own. The results are printed as
+ *				JSON with operations per second and the 50th, 99th and 99.9th
+ *				percentile latencies in microseconds, so runs can be compared by
+ *				scripts. The emulator is not throttled and the data is always the
+ *				same, so differences between runs come from the library and the
+ *				machine, not the radio. The compression ratio of the
+ *				telemetry messages is printed with the results.
+ *
+ *				Usage: bench [-n operations] [-g guard time ms] [-o file]
+ *					-n	Operations of the data benchmarks, get_ip runs a tenth
+ *						and command_mode a hundredth as many
+ *					-g	ATGT of the emulated xbee, paid twice per command_mode
+ *					-o	Write the JSON to file instead of stdout
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "libxbee.h"
+#include "xbee_frame.h"
+#include "xbee_compress.h"
+#include "xbee_emulator.h"
+
+//Operations of the data benchmarks when -n is not given
+#define BENCH_OPERATIONS 10000
+
+//Guard time of the emulated xbee when -g is not given
+#define BENCH_GUARD_MS 20
+
+//Length of the lines received and sent, '\r' included
+#define BENCH_LINE_LENGTH 64
+
+//Bytes of payload in the frames encoded and decoded
+#define BENCH_FRAME_PAYLOAD 100
+
+//Telemetry messages the dictionary is trained on, and as many are compressed
+#define BENCH_MESSAGES 64
+#define BENCH_MESSAGE_LENGTH 160
+#define BENCH_DICTIONARY 1024
+
+//The measurements of one benchmark
+struct bench_result
+{
+	const char * name;
+	int operations;					//Operations that succeeded
+	unsigned long bytes;			//Payload bytes moved, 0 when it does not apply
+	double seconds;					//Time from the first operation to the last
+	uint64_t * samples;				//Latency of every operation in nanoseconds
+};
+
+//What the receive benchmark's injecting thread needs
+struct bench_injector
+{
+	struct xbee_emulator * emulator;
+	const char * line;
+	int count;
+};
+
+/* @breif Reads the monotonic clock in nanoseconds
+ *
+ * @return :		Nanoseconds since an unspecified point
+ */
+uint64_t now_ns( void )
+{
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* @breif Orders latency samples for qsort
+ */
+int compare_samples( const void * a, const void * b )
+{
+	uint64_t first = *(const uint64_t *)a;
+	uint64_t second = *(const uint64_t *)b;
+
+	return ( first > second ) - ( first < second );
+}
+
+/* @breif Gives a percentile of sorted samples in microseconds, by nearest rank
+ *
+ * @param const uint64_t * samples: Sorted latencies in nanoseconds
+ * @param int count: Number of samples
+ * @param double percentile: e.g. 99.9
+ *
+ * @return :		The latency in microseconds, 0 without samples
+ */
+double percentile_us( const uint64_t * samples, int count, double percentile )
+{
+	int rank;
+
+	if( count == 0 )
+		return 0;
+
+	rank = (int)( percentile / 100.0 * count + 0.999999 );
+
+	if( rank < 1 )
+		rank = 1;
+
+	if( rank > count )
+		rank = count;
+
+	return samples[rank - 1] / 1000.0;
+}
+
+/* @breif Prepares a result to hold count samples
+ *
+ * @param struct bench_result * result: The result
+ * @param const char * name: Name of the benchmark
+ * @param int count: Operations that will be run
+ */
+void result_init( struct bench_result * result, const char * name, int count )
+{
+	memset( result, 0, sizeof(*result) );
+	result->name = name;
+	result->samples = calloc( count > 0 ? count : 1, sizeof(uint64_t) );
+
+	if( result->samples == NULL )
+	{
+		fprintf( stderr, "\nOut of memory for %d samples\n", count );
+		exit( 1 );
+	}
+}
+
+/* @breif Prints a result as a JSON object and frees its samples
+ *
+ * @param FILE * output: Where the JSON goes
+ * @param struct bench_result * result: The result
+ * @param int last: TRUE for the last benchmark, which is not followed by a comma
+ */
+void result_print( FILE * output, struct bench_result * result, int last )
+{
+	double rate = result->seconds > 0 ? result->operations / result->seconds : 0;
+
+	qsort( result->samples, result->operations, sizeof(uint64_t), compare_samples );
+
+	fprintf( output,
+			 "    {\"name\": \"%s\", \"operations\": %d, \"bytes\": %lu, \"seconds\": %.6f, "
+			 "\"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+			 "\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f}%s\n",
+			 result->name,
+			 result->operations,
+			 result->bytes,
+			 result->seconds,
+			 rate,
+			 result->seconds > 0 ? result->bytes / result->seconds : 0,
+			 percentile_us( result->samples, result->operations, 50 ),
+			 percentile_us( result->samples, result->operations, 99 ),
+			 percentile_us( result->samples, result->operations, 99.9 ),
+			 percentile_us( result->samples, result->operations, 100 ),
+			 last ? "" : "," );
+
+	free( result->samples );
+	result->samples = NULL;
+}
+
+/* @breif Injects the receive benchmark's lines as fast as the port takes them
+ *
+ * @param void * arg: The struct bench_injector
+ */
+void * inject_lines( void * arg )
+{
+	struct bench_injector * injector = arg;
+	int i;
+
+	for( i = 0; i < injector->count; i++ )
+	{
+		if( xbee_emulator_inject( injector->emulator, injector->line, BENCH_LINE_LENGTH ) != 0 )
+			break;
+	}
+
+	return NULL;
+}
+
+/* @breif Measures read_port on lines arriving as fast as the emulator sends them
+ *
+ * @param struct bench_result * result: Where the measurements go
+ * @param struct xbee * xbee: The xbee to use
+ * @param struct xbee_emulator * emulator: The emulator behind the xbee's port
+ * @param const char * line: The line to receive
+ * @param int count: Number of lines
+ */
+void bench_read_port( struct bench_result * result, struct xbee * xbee,
+					  struct xbee_emulator * emulator, const char * line, int count )
+{
+	struct bench_injector injector = { emulator, line, count };
+	char buffer[MAX_BUFFER_SIZE];
+	pthread_t thread;
+	uint64_t start;
+	uint64_t before;
+	uint64_t after;
+	int i;
+
+	result_init( result, "read_port", count );
+
+	start = now_ns( );
+
+	if( pthread_create( &thread, NULL, inject_lines, &injector ) != 0 )
+	{
+		fprintf( stderr, "\nStarting the injecting thread failed\n" );
+		return;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		before = now_ns( );
+
+		if( read_port( xbee, buffer ) != 0 )
+			break;
+
+		after = now_ns( );
+
+		result->samples[result->operations++] = after - before;
+		result->bytes += strlen( buffer ) + 1;
+	}
+
+	result->seconds = ( now_ns( ) - start ) / 1e9;
+
+	pthread_join( thread, NULL );
+}
+
+/* @breif Measures write_port, the emulator reads and drops the lines
+ *
+ * @param struct bench_result * result: Where the measurements go
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * line: The line to send
+ * @param int count: Number of lines
+ */
+void bench_write_port( struct bench_result * result, struct xbee * xbee, char * line, int count )
+{
+	uint64_t start;
+	uint64_t before;
+	int i;
+
+	result_init( result, "write_port", count );
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		before = now_ns( );
+
+		if( write_port( xbee, line ) != 0 )
+			break;
+
+		result->samples[result->operations++] = now_ns( ) - before;
+		result->bytes += BENCH_LINE_LENGTH;
+	}
+
+	result->seconds = ( now_ns( ) - start ) / 1e9;
+}
+
+/* @breif Measures the round trip of ATMY, bypassing the AT parameter cache
+ *
+ * The session is opened before the clock starts, so only the command and its
+ * answer are timed.
+ *
+ * @param struct bench_result * result: Where the measurements go
+ * @param struct xbee * xbee: The xbee to use
+ * @param int count: Number of round trips
+ */
+void bench_get_ip( struct bench_result * result, struct xbee * xbee, int count )
+{
+	char address[MAX_BUFFER_SIZE];
+	uint64_t start;
+	uint64_t before;
+	int i;
+
+	result_init( result, "get_ip", count );
+
+	if( at_session_open( xbee ) != 0 )
+	{
+		fprintf( stderr, "\nEntering command mode failed\n" );
+		return;
+	}
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		invalidate_at_cache( xbee, "MY" );
+
+		before = now_ns( );
+
+		if( get_ip( xbee, address ) != 0 )
+			break;
+
+		result->samples[result->operations++] = now_ns( ) - before;
+	}
+
+	result->seconds = ( now_ns( ) - start ) / 1e9;
+
+	at_session_close( xbee );
+}
+
+/* @breif Measures entering and leaving command mode
+ *
+ * The guard time of silence the xbee needs before "+++" is waited out
+ * between operations and not timed, the guard time after it is.
+ *
+ * @param struct bench_result * result: Where the measurements go
+ * @param struct xbee * xbee: The xbee to use
+ * @param int count: Number of times command mode is entered and left
+ * @param int guard_time_ms: The emulated xbee's ATGT
+ */
+void bench_command_mode( struct bench_result * result, struct xbee * xbee, int count,
+						 int guard_time_ms )
+{
+	uint64_t timed = 0;
+	uint64_t before;
+	uint64_t elapsed;
+	int i;
+
+	result_init( result, "command_mode", count );
+
+	for( i = 0; i < count; i++ )
+	{
+		usleep( ( guard_time_ms + guard_time_ms / 2 + 1 ) * 1000 );
+
+		before = now_ns( );
+
+		if( enter_command_mode( xbee ) != 0 || exit_command_mode( xbee ) != 0 )
+			break;
+
+		elapsed = now_ns( ) - before;
+		timed += elapsed;
+		result->samples[result->operations++] = elapsed;
+	}
+
+	//The silence before each "+++" is not the library's cost, leave it out
+	result->seconds = timed / 1e9;
+}
+
+/* @breif Counts the frames decoded by bench_frames
+ */
+void count_frame( const uint8_t * data, int length, void * arg )
+{
+	( *(unsigned long *)arg ) += length;
+}
+
+/* @breif Measures building and parsing escaped transmit request frames
+ *
+ * The payload is full of bytes that must be escaped, which is the slow path.
+ *
+ * @param struct bench_result * encoded: Where the encoding measurements go
+ * @param struct bench_result * decoded: Where the decoding measurements go
+ * @param int count: Number of frames
+ */
+void bench_frames( struct bench_result * encoded, struct bench_result * decoded, int count )
+{
+	static struct xbee_frame_decoder decoder;
+	uint8_t data[14 + BENCH_FRAME_PAYLOAD];
+	uint8_t frame[XBEE_FRAME_MAX_ENCODED];
+	unsigned long received = 0;
+	uint64_t start;
+	uint64_t before;
+	int length = 0;
+	int i;
+
+	data[0] = XBEE_API_TX_REQUEST;
+
+	for( i = 1; i < (int)sizeof(data); i++ )
+		data[i] = ( i % 4 == 0 ) ? XBEE_FRAME_DELIMITER : (uint8_t)i;
+
+	result_init( encoded, "frame_encode", count );
+	result_init( decoded, "frame_decode", count );
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		before = now_ns( );
+		length = xbee_frame_encode( data, sizeof(data), XBEE_API_ESCAPED_MODE, frame, sizeof(frame) );
+		encoded->samples[encoded->operations++] = now_ns( ) - before;
+		encoded->bytes += sizeof(data);
+	}
+
+	encoded->seconds = ( now_ns( ) - start ) / 1e9;
+
+	xbee_frame_decoder_init( &decoder, XBEE_API_ESCAPED_MODE );
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		before = now_ns( );
+
+		if( xbee_frame_decode( &decoder, frame, length, count_frame, &received ) != 1 )
+			break;
+
+		decoded->samples[decoded->operations++] = now_ns( ) - before;
+	}
+
+	decoded->seconds = ( now_ns( ) - start ) / 1e9;
+	decoded->bytes = received;
+}
+
+/* @breif Writes the telemetry message a sensor sends the index-th time
+ *
+ * @param char * message: The message is stored here, BENCH_MESSAGE_LENGTH bytes
+ * @param int index: Which message
+ *
+ * @return :		Bytes of the message
+ */
+int telemetry_message( char * message, int index )
+{
+	return snprintf( message, BENCH_MESSAGE_LENGTH,
+					 "{\"node\":\"sensor-%02d\",\"seq\":%d,\"temperature\":%d.%02d,"
+					 "\"humidity\":%d.%d,\"battery_mv\":%d,\"status\":\"%s\"}",
+					 index % 17,
+					 index * 13,
+					 18 + index * 7 % 9,
+					 index * 37 % 100,
+					 35 + index * 11 % 30,
+					 index % 10,
+					 3000 + index * 53 % 700,
+					 ( index % 5 != 0 ) ? "ok" : "low_battery" );
+}
+
+/* @breif Measures compressing and decompressing telemetry messages with a
+ * dictionary trained on other messages of the same sensors
+ *
+ * @param struct bench_result * compressed: Where the compression measurements go
+ * @param struct bench_result * decompressed: Where the decompression measurements go
+ * @param int count: Number of messages
+ *
+ * @return :		Bytes of the messages divided by bytes sent for them
+ */
+double bench_compress( struct bench_result * compressed, struct bench_result * decompressed, int count )
+{
+	static struct xbee_compress compress;
+	static char samples[BENCH_MESSAGES][BENCH_MESSAGE_LENGTH];
+	static char messages[BENCH_MESSAGES][BENCH_MESSAGE_LENGTH];
+	static uint8_t packed[BENCH_MESSAGES][BENCH_MESSAGE_LENGTH];
+	const uint8_t * pointers[BENCH_MESSAGES];
+	int sample_lengths[BENCH_MESSAGES];
+	int message_lengths[BENCH_MESSAGES];
+	int packed_lengths[BENCH_MESSAGES];
+	uint8_t dictionary[BENCH_DICTIONARY];
+	uint8_t message[BENCH_MESSAGE_LENGTH];
+	unsigned long sent = 0;
+	unsigned long original = 0;
+	uint64_t start;
+	uint64_t before;
+	int length;
+	int i;
+
+	for( i = 0; i < BENCH_MESSAGES; i++ )
+	{
+		sample_lengths[i] = telemetry_message( samples[i], i );
+		pointers[i] = (const uint8_t *)samples[i];
+		message_lengths[i] = telemetry_message( messages[i], BENCH_MESSAGES + i );
+	}
+
+	length = xbee_compress_train( pointers, sample_lengths, BENCH_MESSAGES, dictionary, sizeof(dictionary) );
+	xbee_compress_init( &compress, dictionary, length );
+
+	result_init( compressed, "compress", count );
+	result_init( decompressed, "decompress", count );
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		before = now_ns( );
+		length = xbee_compress_encode( &compress, (const uint8_t *)messages[i % BENCH_MESSAGES],
+									   message_lengths[i % BENCH_MESSAGES],
+									   packed[i % BENCH_MESSAGES], BENCH_MESSAGE_LENGTH );
+		compressed->samples[compressed->operations++] = now_ns( ) - before;
+		compressed->bytes += message_lengths[i % BENCH_MESSAGES];
+
+		if( i < BENCH_MESSAGES )
+		{
+			packed_lengths[i] = length;
+			original += message_lengths[i];
+			sent += ( length > 0 ) ? length : message_lengths[i];
+		}
+	}
+
+	compressed->seconds = ( now_ns( ) - start ) / 1e9;
+
+	start = now_ns( );
+
+	for( i = 0; i < count; i++ )
+	{
+		//Messages that did not get shorter are sent raw, there is nothing to do
+		if( packed_lengths[i % BENCH_MESSAGES] == 0 )
+			continue;
+
+		before = now_ns( );
+
+		if( xbee_compress_decode( &compress, packed[i % BENCH_MESSAGES], packed_lengths[i % BENCH_MESSAGES],
+								  message, sizeof(message) ) != message_lengths[i % BENCH_MESSAGES] )
+			break;
+
+		decompressed->samples[decompressed->operations++] = now_ns( ) - before;
+		decompressed->bytes += message_lengths[i % BENCH_MESSAGES];
+	}
+
+	decompressed->seconds = ( now_ns( ) - start ) / 1e9;
+
+	return ( sent > 0 ) ? (double)original / sent : 0;
+}
+
+int main( int argc, char * argv[] )
+{
+	struct xbee_emulator emulator;
+	struct bench_result results[8];
+	double compression_ratio;
+	struct xbee * xbee;
+	FILE * output = NULL;
+	char line[BENCH_LINE_LENGTH + 1];
+	int operations = BENCH_OPERATIONS;
+	int guard_time_ms = BENCH_GUARD_MS;
+	int option;
+	int result;
+	int i;
+
+	while( ( option = getopt( argc, argv, "n:g:o:" ) ) != -1 )
+	{
+		switch( option )
+		{
+			case 'n':
+				operations = atoi( optarg );
+				break;
+
+			case 'g':
+				guard_time_ms = atoi( optarg );
+				break;
+
+			case 'o':
+				output = fopen( optarg, "w" );
+
+				if( output == NULL )
+				{
+					fprintf( stderr, "Opening %s failed\n", optarg );
+					exit( 1 );
+				}
+				break;
+
+			default:
+				fprintf( stderr, "Usage: %s [-n operations] [-g guard time ms] [-o file]\n", argv[0] );
+				exit( 1 );
+		}
+	}
+
+	//The library reports on stdout, keep it apart from the JSON
+	if( output == NULL )
+	{
+		output = fdopen( dup( STDOUT_FILENO ), "w" );
+		dup2( STDERR_FILENO, STDOUT_FILENO );
+	}
+
+	if( operations < 100 || guard_time_ms < 1 )
+	{
+		fprintf( stderr, "Run at least 100 operations with a guard time of at least 1 ms\n" );
+		exit( 1 );
+	}
+
+	result = xbee_emulator_start( &emulator, guard_time_ms, 0 );
+
+	if( result != 0 )
+	{
+		fprintf( stderr, "\nStarting the emulator failed with error[%d]\n", result );
+		exit( 1 );
+	}
+
+	xbee = xbee_create( NULL );
+
+	if( xbee == NULL || init_port( xbee, emulator.port_name ) != 0 )
+	{
+		fprintf( stderr, "\nOpening the emulator's port %s failed\n", emulator.port_name );
+		xbee_emulator_stop( &emulator );
+		exit( 1 );
+	}
+
+	//The same printable line every run, without '+' so it is never taken for "+++"
+	for( i = 0; i < BENCH_LINE_LENGTH - 1; i++ )
+		line[i] = 'a' + i % 26;
+
+	line[BENCH_LINE_LENGTH - 1] = '\r';
+	line[BENCH_LINE_LENGTH] = '\0';
+
+	fprintf( stderr, "Benchmarking against the emulated xbee on %s\n", emulator.port_name );
+
+	bench_read_port( &results[0], xbee, &emulator, line, operations );
+	bench_write_port( &results[1], xbee, line, operations );
+
+	//The data just sent must be followed by a guard time of silence before "+++"
+	usleep( 2 * guard_time_ms * 1000 );
+
+	bench_get_ip( &results[2], xbee, operations / 10 );
+	bench_command_mode( &results[3], xbee, operations / 100, guard_time_ms );
+	bench_frames( &results[4], &results[5], operations * 10 );
+	compression_ratio = bench_compress( &results[6], &results[7], operations * 10 );
+
+	fprintf( output, "{\n  \"device\": \"%s\",\n  \"guard_time_ms\": %d,\n"
+			 "  \"compression_ratio\": %.2f,\n  \"benchmarks\": [\n",
+			 emulator.port_name,
+			 guard_time_ms,
+			 compression_ratio );
+
+	for( i = 0; i < 8; i++ )
+		result_print( output, &results[i], i == 7 );
+
+	fprintf( output, "  ]\n}\n" );
+
+	fclose( output );
+
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return 0;
+}
@@ -0,0 +1,888 @@
+/** @file check_test.c
+ ** @brief Round trips of the library against emulated xbees, run by make check
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program checks the library without a radio. Every check
+ *				starts its own xbee emulator(see xbee_emulator.h) that echoes
+ *				what is sent to the air, and runs one round trip through it:
+ *					at			ATID set and read back, data echoed in
+ *								transparent mode
+ *					pipeline	API mode switched on, AT commands answered
+ *								through the pipeline
+ *					coalesce	Messages packed into packets and unpacked from
+ *								the echo
+ *					arq			Messages sent and received in order by one
+ *								layer that talks to itself
+ *					txq			A chunked payload written by the loop thread
+ *								and read back whole
+ *					txq preemption
+ *								A 100 KB chunked bulk payload that fills the
+ *								port's buffers, interrupted by a control
+ *								message, with either scheduling
+ *				The transfer check needs two ends, so it links two pseudo
+ *				terminals with a thread of its own instead of an emulator:
+ *					transfer	A file sent from one end and stored by the other
+ *
+ *				Every check prints ok or FAILED with the reason. The program
+ *				exits with 1 if any check failed.
+ *
+ *				Usage: check_test
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#define _GNU_SOURCE			//ptsname_r
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "libxbee.h"
+#include "xbee_frame.h"
+#include "xbee_pipeline.h"
+#include "xbee_coalesce.h"
+#include "xbee_arq.h"
+#include "xbee_loop.h"
+#include "xbee_txq.h"
+#include "xbee_transfer.h"
+#include "xbee_emulator.h"
+
+//ATGT of the emulated xbees, short so the checks run quickly
+#define CHECK_GUARD_MS 20
+
+//How long a check waits for an answer before it fails
+#define CHECK_TIMEOUT_MS 5000
+
+//Messages of the coalesce and arq checks
+#define CHECK_MESSAGES 100
+
+//Bytes of the txq and transfer payloads, and of the txq chunks
+#define CHECK_PAYLOAD 20000
+#define CHECK_CHUNK 128
+
+//Bytes of the payload the txq preemption check interrupts, more than the
+//port's buffers hold
+#define CHECK_BULK 100000
+
+//How long the txq preemption check lets the payload fill the port's buffers
+#define CHECK_FILL_US 100000
+
+//A check, returns 0 when it passed
+struct check
+{
+	const char * name;
+	int (*run)( void );
+};
+
+//Two pseudo terminals whose bytes are copied to each other
+struct check_air
+{
+	char port_name[2][MAX_BUFFER_SIZE];
+	int master_descriptor[2];
+	int slave_descriptor[2];			//Kept open so the ports never hang up
+	atomic_int running;
+	pthread_t thread;
+};
+
+//What the receiving thread of the transfer check needs
+struct check_receiver
+{
+	struct xbee * xbee;
+	const char * directory;
+	int result;
+};
+
+/* @breif Starts an emulator that echoes the air and opens its port
+ *
+ * @param struct xbee_emulator * emulator: The emulator to start
+ *
+ * @return :		 NULL - The emulator or the port failed, already reported
+ *			 Not NULL - The xbee on the emulator's port
+ */
+struct xbee * open_emulator( struct xbee_emulator * emulator )
+{
+	struct xbee * xbee;
+	int result;
+
+	result = xbee_emulator_start( emulator, CHECK_GUARD_MS, XBEE_EMULATOR_LOOPBACK );
+
+	if( result != 0 )
+	{
+		printf( "Starting the emulator failed with error[%d]\n", result );
+		return NULL;
+	}
+
+	xbee = xbee_create( NULL );
+
+	if( xbee == NULL || init_port( xbee, emulator->port_name ) != 0 )
+	{
+		printf( "Opening %s failed\n", emulator->port_name );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( emulator );
+		return NULL;
+	}
+
+	return xbee;
+}
+
+/* @breif Fills a payload with bytes that differ from chunk to chunk
+ *
+ * @param uint8_t * data: The payload
+ * @param int size: Bytes in data
+ */
+void fill_payload( uint8_t * data, int size )
+{
+	int i;
+
+	for( i = 0; i < size; i++ )
+		data[i] = (uint8_t)( i * 7 + i / CHECK_CHUNK );
+}
+
+/* @breif Sets ATID, reads it back and echoes a line in transparent mode
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_at( void )
+{
+	struct xbee_emulator emulator;
+	struct xbee * xbee;
+	char value[MAX_BUFFER_SIZE];
+	char line[] = "check\r";
+	int failed = 1;
+	int result;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	if( ( result = set_at( xbee, "ID", "checknet" ) ) != 0 )
+		printf( "set_at ID failed with error[%d]\n", result );
+	else if( ( result = get_at( xbee, "ID", value, AT_CACHE_REFRESH ) ) != 0 )
+		printf( "get_at ID failed with error[%d]\n", result );
+	else if( strcmp( value, "checknet" ) != 0 )
+		printf( "ATID read back as '%s'\n", value );
+	else if( ( result = write_data( xbee, line ) ) != 0 )
+		printf( "write_data failed with error[%d]\n", result );
+	else if( ( result = read_port( xbee, value ) ) != 0 )
+		printf( "read_port failed with error[%d]\n", result );
+	else if( strcmp( value, "check" ) != 0 )
+		printf( "The echo was '%s'\n", value );
+	else
+		failed = 0;
+
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return failed;
+}
+
+/* @breif Switches to API mode and sends AT commands through a pipeline
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_pipeline( void )
+{
+	static struct xbee_pipeline pipeline;
+	const struct xbee_at_request * request;
+	struct xbee_emulator emulator;
+	struct timespec deadline;
+	struct xbee * xbee;
+	int frame_id[2];
+	int failed = 1;
+	int result;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	if( ( result = set_api_mode( xbee, XBEE_API_MODE ) ) != 0 )
+	{
+		printf( "set_api_mode failed with error[%d]\n", result );
+	}
+	else
+	{
+		xbee_pipeline_init( &pipeline, xbee, XBEE_API_MODE );
+
+		frame_id[0] = xbee_pipeline_submit( &pipeline, "MY", NULL, 0, NULL, NULL );
+		frame_id[1] = xbee_pipeline_submit( &pipeline, "NP", NULL, 0, NULL, NULL );
+
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		if( frame_id[0] < 0 || frame_id[1] < 0 )
+			printf( "xbee_pipeline_submit failed with error[%d]\n", ( frame_id[0] < 0 ) ? frame_id[0] : frame_id[1] );
+		else if( ( result = xbee_pipeline_wait_all( &pipeline, &deadline ) ) != 0 )
+			printf( "xbee_pipeline_wait_all failed with error[%d]\n", result );
+		else if( ( request = xbee_pipeline_result( &pipeline, frame_id[0] ) ) == NULL ||
+				 request->status != XBEE_AT_STATUS_OK || request->value_length != 4 )
+			printf( "ATMY was not answered with an address\n" );
+		else if( ( request = xbee_pipeline_result( &pipeline, frame_id[1] ) ) == NULL ||
+				 request->status != XBEE_AT_STATUS_OK || request->value_length == 0 )
+			printf( "ATNP was not answered with a value\n" );
+		else
+			failed = 0;
+	}
+
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return failed;
+}
+
+/* @breif Builds the message of the coalesce and arq checks
+ *
+ * @param char * message: The message is stored here, at least 64 bytes
+ * @param int index: Which message
+ *
+ * @return :		Bytes in the message
+ */
+int check_message( char * message, int index )
+{
+	return sprintf( message, "reading %d t=%d.%d", index, 20 + index % 9, index % 10 );
+}
+
+/* @breif Packs messages with a coalescer and reads them back from the echo
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_coalesce( void )
+{
+	static struct xbee_coalesce coalesce;
+	static struct xbee_coalesce_reader reader;
+	struct xbee_emulator emulator;
+	struct timespec deadline;
+	struct xbee * xbee;
+	char message[64];
+	char expected[64];
+	int length;
+	int result;
+	int i;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	if( ( result = xbee_coalesce_start( &coalesce, xbee, 0, 0 ) ) != 0 )
+	{
+		printf( "xbee_coalesce_start failed with error[%d]\n", result );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	for( i = 0; i < CHECK_MESSAGES && result == 0; i++ )
+	{
+		length = check_message( message, i );
+		result = xbee_coalesce_send( &coalesce, message, length );
+	}
+
+	xbee_coalesce_stop( &coalesce );
+
+	if( result != 0 )
+		printf( "xbee_coalesce_send failed with error[%d]\n", result );
+	else if( coalesce.packets >= CHECK_MESSAGES )
+		printf( "%d messages went out in %lu packets\n", CHECK_MESSAGES, coalesce.packets );
+
+	xbee_coalesce_reader_init( &reader, xbee );
+
+	for( i = 0; i < CHECK_MESSAGES && result == 0; i++ )
+	{
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		length = xbee_coalesce_read( &reader, message, sizeof(message), &deadline );
+
+		if( length != check_message( expected, i ) || memcmp( message, expected, length ) != 0 )
+		{
+			printf( "Message %d came back as %d bytes\n", i, length );
+			result = 1;
+		}
+	}
+
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return result != 0 || coalesce.packets >= CHECK_MESSAGES;
+}
+
+/* @breif Sends messages with one arq layer and receives them back on the same one
+ *
+ * The echo makes the layer its own peer: it acknowledges the data it
+ * receives and takes the echoed acknowledgements for the data it sent.
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_arq( void )
+{
+	struct xbee_emulator emulator;
+	struct xbee_arq arq;
+	struct timespec deadline;
+	struct xbee * xbee;
+	char message[64];
+	char expected[64];
+	int failed = 1;
+	int length;
+	int result;
+	int i;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	if( ( result = xbee_arq_init( &arq, xbee, 0 ) ) != 0 )
+	{
+		printf( "xbee_arq_init failed with error[%d]\n", result );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	for( i = 0; i < CHECK_MESSAGES; i++ )
+	{
+		length = check_message( message, i );
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		if( ( result = xbee_arq_send( &arq, message, length, &deadline ) ) != 0 )
+		{
+			printf( "xbee_arq_send of message %d failed with error[%d]\n", i, result );
+			break;
+		}
+
+		length = xbee_arq_receive( &arq, message, sizeof(message), &deadline );
+
+		if( length != check_message( expected, i ) || memcmp( message, expected, length ) != 0 )
+		{
+			printf( "Message %d came back as %d bytes\n", i, length );
+			break;
+		}
+	}
+
+	if( i == CHECK_MESSAGES )
+	{
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		if( ( result = xbee_arq_flush( &arq, &deadline ) ) != 0 )
+			printf( "xbee_arq_flush failed with error[%d]\n", result );
+		else
+			failed = 0;
+	}
+
+	xbee_arq_close( &arq );
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return failed;
+}
+
+/* @breif Runs a loop until it is stopped
+ *
+ * @param void * arg: The struct xbee_loop
+ */
+void * run_loop( void * arg )
+{
+	xbee_loop_run( arg );
+
+	return NULL;
+}
+
+/* @breif Queues a chunked payload and reads it back from the echo
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_txq( void )
+{
+	static uint8_t payload[CHECK_PAYLOAD];
+	static uint8_t echo[CHECK_PAYLOAD];
+	static struct xbee_txq queue;
+	struct xbee_emulator emulator;
+	struct xbee_loop loop;
+	struct timespec deadline;
+	struct xbee * xbee;
+	pthread_t thread;
+	int received = 0;
+	int failed = 1;
+	int result;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	fill_payload( payload, CHECK_PAYLOAD );
+
+	if( xbee_loop_init( &loop ) != 0 )
+	{
+		printf( "xbee_loop_init failed\n" );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	if( ( result = xbee_txq_init( &queue, &loop, xbee, CHECK_PAYLOAD ) ) != 0 )
+	{
+		printf( "xbee_txq_init failed with error[%d]\n", result );
+		xbee_loop_close( &loop );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	if( pthread_create( &thread, NULL, run_loop, &loop ) != 0 )
+	{
+		printf( "Starting the loop thread failed\n" );
+		xbee_txq_close( &queue );
+		xbee_loop_close( &loop );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	result = xbee_txq_enqueue_chunks( &queue, XBEE_TXQ_BULK, payload, CHECK_PAYLOAD, CHECK_CHUNK );
+
+	if( result != XBEE_TXQ_OK )
+		printf( "xbee_txq_enqueue_chunks failed with error[%d]\n", result );
+
+	while( result == XBEE_TXQ_OK && received < CHECK_PAYLOAD )
+	{
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		result = read_port_raw( xbee, echo + received, CHECK_PAYLOAD - received, &deadline );
+
+		if( result <= 0 )
+		{
+			printf( "Only %d of %d bytes came back\n", received, CHECK_PAYLOAD );
+			break;
+		}
+
+		received += result;
+		result = XBEE_TXQ_OK;
+	}
+
+	if( received == CHECK_PAYLOAD )
+	{
+		if( memcmp( echo, payload, CHECK_PAYLOAD ) != 0 )
+			printf( "The payload came back changed\n" );
+		else
+			failed = 0;
+	}
+
+	xbee_loop_stop( &loop );
+	pthread_join( thread, NULL );
+
+	xbee_txq_close( &queue );
+	xbee_loop_close( &loop );
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return failed;
+}
+
+/* @breif Sends an alarm while a large bulk payload is being written
+ *
+ * The echo is not read until the alarm is queued, so the port's buffers fill
+ * up and the loop thread waits with most of the payload still queued. The
+ * alarm must then come back behind the bytes already written and at most
+ * one batch of XBEE_TXQ_BACKLOG bytes, not behind the whole payload.
+ *
+ * @param int scheduling: XBEE_TXQ_STRICT or XBEE_TXQ_WEIGHTED
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int preempt_bulk( int scheduling )
+{
+	static uint8_t payload[CHECK_BULK];
+	static struct xbee_txq queue;
+	struct xbee_emulator emulator;
+	struct xbee_loop loop;
+	struct timespec deadline;
+	struct xbee * xbee;
+	pthread_t thread;
+	uint8_t buffer[512];
+	unsigned long long written;
+	long received = 0;
+	long alarm = -1;
+	int failed = 1;
+	int result;
+	int i;
+
+	xbee = open_emulator( &emulator );
+
+	if( xbee == NULL )
+		return 1;
+
+	memset( payload, 'b', CHECK_BULK );
+
+	if( xbee_loop_init( &loop ) != 0 )
+	{
+		printf( "xbee_loop_init failed\n" );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	if( ( result = xbee_txq_init( &queue, &loop, xbee, 2 * CHECK_BULK ) ) != 0 ||
+		( result = xbee_txq_set_scheduling( &queue, scheduling, NULL ) ) != 0 )
+	{
+		printf( "Preparing the queue failed with error[%d]\n", result );
+		xbee_txq_close( &queue );
+		xbee_loop_close( &loop );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	if( pthread_create( &thread, NULL, run_loop, &loop ) != 0 )
+	{
+		printf( "Starting the loop thread failed\n" );
+		xbee_txq_close( &queue );
+		xbee_loop_close( &loop );
+		xbee_destroy( xbee );
+		xbee_emulator_stop( &emulator );
+		return 1;
+	}
+
+	result = xbee_txq_enqueue_chunks( &queue, XBEE_TXQ_BULK, payload, CHECK_BULK, CHECK_CHUNK );
+
+	//Let the payload fill the port's buffers
+	usleep( CHECK_FILL_US );
+
+	pthread_mutex_lock( &queue.lock );
+	written = queue.classes[XBEE_TXQ_BULK].bytes_written;
+	pthread_mutex_unlock( &queue.lock );
+
+	if( result != XBEE_TXQ_OK )
+		printf( "xbee_txq_enqueue_chunks failed with error[%d]\n", result );
+	else if( written >= CHECK_BULK )
+		printf( "The whole payload was written before the alarm, nothing to preempt\n" );
+	else if( ( result = xbee_txq_enqueue_class( &queue, XBEE_TXQ_CONTROL, "ALARM", 5 ) ) != XBEE_TXQ_OK )
+		printf( "xbee_txq_enqueue_class failed with error[%d]\n", result );
+
+	while( result == XBEE_TXQ_OK && written < CHECK_BULK && received < CHECK_BULK + 5 )
+	{
+		deadline_after( &deadline, CHECK_TIMEOUT_MS );
+
+		result = read_port_raw( xbee, buffer, sizeof(buffer), &deadline );
+
+		if( result <= 0 )
+		{
+			printf( "Only %ld of %d bytes came back\n", received, CHECK_BULK + 5 );
+			break;
+		}
+
+		for( i = 0; i < result && alarm < 0; i++ )
+		{
+			if( buffer[i] == 'A' )
+				alarm = received + i;
+		}
+
+		received += result;
+		result = XBEE_TXQ_OK;
+	}
+
+	if( received == CHECK_BULK + 5 )
+	{
+		if( alarm < 0 || alarm > (long)written + XBEE_TXQ_BACKLOG + CHECK_CHUNK )
+			printf( "The alarm came back at byte %ld, %llu bytes were written before it\n", alarm, written );
+		else
+			failed = 0;
+	}
+
+	xbee_loop_stop( &loop );
+	pthread_join( thread, NULL );
+
+	xbee_txq_close( &queue );
+	xbee_loop_close( &loop );
+	xbee_destroy( xbee );
+	xbee_emulator_stop( &emulator );
+
+	return failed;
+}
+
+/* @breif Preempts a bulk payload with an alarm under both schedulings
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_txq_preemption( void )
+{
+	return preempt_bulk( XBEE_TXQ_STRICT ) || preempt_bulk( XBEE_TXQ_WEIGHTED );
+}
+
+/* @breif Copies the bytes written on either pseudo terminal to the other one
+ *
+ * @param void * arg: The struct check_air
+ */
+void * carry_air( void * arg )
+{
+	struct check_air * air = arg;
+	struct pollfd ports[2];
+	uint8_t buffer[4096];
+	ssize_t length;
+	ssize_t written;
+	ssize_t result;
+	int i;
+
+	for( i = 0; i < 2; i++ )
+	{
+		ports[i].fd = air->master_descriptor[i];
+		ports[i].events = POLLIN;
+	}
+
+	while( atomic_load( &air->running ) )
+	{
+		if( poll( ports, 2, 50 ) <= 0 )
+			continue;
+
+		for( i = 0; i < 2; i++ )
+		{
+			if( ( ports[i].revents & POLLIN ) == 0 )
+				continue;
+
+			length = read( ports[i].fd, buffer, sizeof(buffer) );
+
+			for( written = 0; written < length; written += result )
+			{
+				result = write( ports[1 - i].fd, buffer + written, length - written );
+
+				if( result < 0 )
+				{
+					result = 0;
+					usleep( 1000 );
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* @breif Creates the two linked pseudo terminals and starts copying between them
+ *
+ * @param struct check_air * air: The link to start
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Failed, already reported
+ */
+int air_start( struct check_air * air )
+{
+	int i;
+
+	for( i = 0; i < 2; i++ )
+	{
+		air->master_descriptor[i] = posix_openpt( O_RDWR | O_NOCTTY );
+
+		if( air->master_descriptor[i] < 0 || grantpt( air->master_descriptor[i] ) != 0 ||
+			unlockpt( air->master_descriptor[i] ) != 0 ||
+			ptsname_r( air->master_descriptor[i], air->port_name[i], MAX_BUFFER_SIZE ) != 0 )
+		{
+			printf( "Creating a pseudo terminal failed\n" );
+			return 1;
+		}
+
+		air->slave_descriptor[i] = open( air->port_name[i], O_RDWR | O_NOCTTY );
+
+		if( air->slave_descriptor[i] < 0 )
+		{
+			printf( "Opening %s failed\n", air->port_name[i] );
+			return 1;
+		}
+	}
+
+	atomic_store( &air->running, 1 );
+
+	if( pthread_create( &air->thread, NULL, carry_air, air ) != 0 )
+	{
+		printf( "Starting the air thread failed\n" );
+		return 1;
+	}
+
+	return 0;
+}
+
+/* @breif Stops copying and closes the pseudo terminals
+ *
+ * @param struct check_air * air: The link to stop
+ */
+void air_stop( struct check_air * air )
+{
+	atomic_store( &air->running, 0 );
+	pthread_join( air->thread, NULL );
+
+	close( air->slave_descriptor[0] );
+	close( air->slave_descriptor[1] );
+	close( air->master_descriptor[0] );
+	close( air->master_descriptor[1] );
+}
+
+/* @breif Receives one file for the transfer check
+ *
+ * @param void * arg: The struct check_receiver
+ */
+void * receive_file( void * arg )
+{
+	struct check_receiver * receiver = arg;
+
+	receiver->result = xbee_transfer_receive( receiver->xbee, receiver->directory, CHECK_TIMEOUT_MS, NULL );
+
+	return NULL;
+}
+
+/* @breif Sends a file from one xbee and compares what the other one stored
+ *
+ * @param struct xbee * sender: The sending end
+ * @param struct xbee * receiver_xbee: The receiving end, run in a thread of its own
+ *
+ * @return :		0 - The file arrived whole
+ *			 Not Zero - Failed, already reported
+ */
+int transfer_file( struct xbee * sender, struct xbee * receiver_xbee )
+{
+	static uint8_t payload[CHECK_PAYLOAD];
+	static uint8_t stored[CHECK_PAYLOAD + 1];
+	struct check_receiver receiver;
+	char directory[] = "/tmp/check_test.XXXXXX";
+	char path[MAX_BUFFER_SIZE];
+	pthread_t thread;
+	FILE * file;
+	size_t length = 0;
+	int failed = 1;
+	int result;
+
+	if( mkdtemp( directory ) == NULL )
+	{
+		printf( "Creating a directory for the file failed\n" );
+		return 1;
+	}
+
+	fill_payload( payload, CHECK_PAYLOAD );
+
+	receiver.xbee = receiver_xbee;
+	receiver.directory = directory;
+	receiver.result = -1;
+
+	if( pthread_create( &thread, NULL, receive_file, &receiver ) != 0 )
+	{
+		printf( "Starting the receiving thread failed\n" );
+		rmdir( directory );
+		return 1;
+	}
+
+	result = xbee_transfer_send( sender, payload, CHECK_PAYLOAD, "check.bin", CHECK_CHUNK, 0, NULL );
+
+	pthread_join( thread, NULL );
+
+	snprintf( path, sizeof(path), "%s/check.bin", directory );
+	file = fopen( path, "rb" );
+
+	if( file != NULL )
+	{
+		length = fread( stored, 1, sizeof(stored), file );
+		fclose( file );
+		unlink( path );
+	}
+
+	rmdir( directory );
+
+	if( result != 0 )
+		printf( "xbee_transfer_send failed with error[%d]\n", result );
+	else if( receiver.result != 0 )
+		printf( "xbee_transfer_receive failed with error[%d]\n", receiver.result );
+	else if( length != CHECK_PAYLOAD || memcmp( stored, payload, CHECK_PAYLOAD ) != 0 )
+		printf( "The stored file has %zu bytes and differs from the one sent\n", length );
+	else
+		failed = 0;
+
+	return failed;
+}
+
+/* @breif Transfers a file between the two ends of a link
+ *
+ * @return :		0 - Passed
+ *			 Not Zero - Failed
+ */
+int check_transfer( void )
+{
+	struct check_air air;
+	struct xbee * xbee[2] = { NULL, NULL };
+	int failed = 0;
+	int i;
+
+	if( air_start( &air ) != 0 )
+		return 1;
+
+	for( i = 0; i < 2 && failed == 0; i++ )
+	{
+		xbee[i] = xbee_create( NULL );
+
+		if( xbee[i] == NULL || init_port( xbee[i], air.port_name[i] ) != 0 )
+		{
+			printf( "Opening %s failed\n", air.port_name[i] );
+			failed = 1;
+		}
+	}
+
+	if( failed == 0 )
+		failed = transfer_file( xbee[0], xbee[1] );
+
+	xbee_destroy( xbee[0] );
+	xbee_destroy( xbee[1] );
+	air_stop( &air );
+
+	return failed;
+}
+
+int main( void )
+{
+	const struct check checks[] =
+	{
+		{ "at", check_at },
+		{ "pipeline", check_pipeline },
+		{ "coalesce", check_coalesce },
+		{ "arq", check_arq },
+		{ "txq", check_txq },
+		{ "txq preemption", check_txq_preemption },
+		{ "transfer", check_transfer },
+	};
+	int count = sizeof(checks) / sizeof(checks[0]);
+	int failures = 0;
+	int i;
+
+	setvbuf( stdout, NULL, _IONBF, 0 );
+
+	for( i = 0; i < count; i++ )
+	{
+		if( checks[i].run( ) != 0 )
+		{
+			printf( "%s: FAILED\n", checks[i].name );
+			failures++;
+		}
+		else
+		{
+			printf( "%s: ok\n", checks[i].name );
+		}
+	}
+
+	printf( "%d of %d checks passed\n", count - failures, count );
+
+	return ( failures == 0 ) ? 0 : 1;
+}
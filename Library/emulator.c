@@ -0,0 +1,106 @@
+/** @file emulator.c
+ ** @brief Stand alone xbee emulator on a pseudo terminal
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program starts an emulated xbee and prints the pseudo
+ *				terminal it answers on, which app, gateway or the proof of
+ *				concept can open in place of /dev/ttyUSB0. Every line typed on
+ *				stdin arrives at the port as if the xbee had received it over
+ *				the air. The emulator stops at the end of stdin.
+ *
+ *				Usage: emulator [-g guard time ms] [-l] [-t] [-s link]
+ *					-l	Echo transmitted data back, as if a peer answered
+ *					-t	Throttle to the emulated baud rate
+ *					-s	Also make the port available as link, e.g. /tmp/ttyXBEE
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libxbee.h"
+#include "xbee_emulator.h"
+
+int main( int argc, char * argv[] )
+{
+	struct xbee_emulator emulator;
+	char buffer[MAX_BUFFER_SIZE];
+	char * link = NULL;
+	int guard_time_ms = XBEE_EMULATOR_DEFAULT_GUARD;
+	int options = 0;
+	int option;
+	int result;
+
+	while( ( option = getopt( argc, argv, "g:lts:" ) ) != -1 )
+	{
+		switch( option )
+		{
+			case 'g':
+				guard_time_ms = atoi( optarg );
+				break;
+
+			case 'l':
+				options |= XBEE_EMULATOR_LOOPBACK;
+				break;
+
+			case 't':
+				options |= XBEE_EMULATOR_THROTTLE;
+				break;
+
+			case 's':
+				link = optarg;
+				break;
+
+			default:
+				printf( "Usage: %s [-g guard time ms] [-l] [-t] [-s link]\n", argv[0] );
+				exit( 1 );
+		}
+	}
+
+	result = xbee_emulator_start( &emulator, guard_time_ms, options );
+
+	if( result != 0 )
+	{
+		printf( "\nStarting the emulator failed with error[%d]\n", result );
+		exit( 1 );
+	}
+
+	if( link != NULL )
+	{
+		unlink( link );
+
+		if( symlink( emulator.port_name, link ) != 0 )
+			printf( "\nLinking %s to %s failed\n", link, emulator.port_name );
+	}
+
+	printf( "Emulated xbee on %s\n", emulator.port_name );
+	fflush( stdout );
+
+	while( fgets( buffer, sizeof(buffer) - 1, stdin ) != NULL )
+	{
+		buffer[strcspn( buffer, "\r\n" )] = '\0';
+		strcat( buffer, "\r" );
+		xbee_emulator_inject( &emulator, buffer, strlen( buffer ) );
+	}
+
+	printf( "\nReceived %lu bytes, sent %lu bytes, answered %lu AT commands\n",
+			atomic_load( &emulator.bytes_received ),
+			atomic_load( &emulator.bytes_sent ),
+			atomic_load( &emulator.commands ) );
+
+	xbee_emulator_stop( &emulator );
+
+	if( link != NULL )
+		unlink( link );
+
+	return 0;
+}
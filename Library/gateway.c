@@ -0,0 +1,209 @@
+/** @file gateway.c
+ ** @brief Gateway daemon serving every xbee on the matching serial ports
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program opens every port matching a pattern, /dev/ttyUSB*
+ *				by default, and spreads them over a pool of worker threads.
+ *				Lines received from any xbee are printed prefixed with the
+ *				port's name. Lines typed on stdin are sent out:
+ *
+ *					<port> <text>	Sends text to one port, e.g. ttyUSB0 hello
+ *					* <text>		Sends text to every port
+ *					ports			Shows which worker serves which port
+ *					stats			Shows the counters and latencies of every port
+ *					quit			Stops the gateway
+ *
+ *				Usage: gateway [-w workers] [-b baud rate] [-p pattern] [-t trace file]
+ *					-t	Records a trace of the traffic, see trace_decode
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libxbee.h"
+#include "xbee_loop.h"
+#include "xbee_gateway.h"
+#include "xbee_trace.h"
+
+/* @breif Prints a line received by the gateway
+ *
+ * @param const char * port: Name of the port the line came from
+ * @param const char * line: The line
+ * @param void * arg: Unused
+ */
+void print_line( const char * port, const char * line, void * arg )
+{
+	printf( "[%s] %s\n", port, line );
+	fflush( stdout );
+}
+
+/* @breif Carries out one command typed on stdin
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ * @param char * command: The command, without its newline
+ */
+void run_command( struct xbee_gateway * gateway, char * command )
+{
+	char * text;
+	int result;
+
+	if( strcmp( command, "quit" ) == 0 )
+	{
+		xbee_loop_stop( gateway->loop );
+		return;
+	}
+
+	if( strcmp( command, "ports" ) == 0 )
+	{
+		xbee_gateway_print( gateway );
+		return;
+	}
+
+	if( strcmp( command, "stats" ) == 0 )
+	{
+		xbee_gateway_print_stats( gateway );
+		return;
+	}
+
+	text = strchr( command, ' ' );
+
+	if( text == NULL )
+	{
+		printf( "Usage: <port> <text>, * <text>, ports, stats or quit\n" );
+		return;
+	}
+
+	*text++ = '\0';
+	strcat( text, "\r" );
+
+	result = xbee_gateway_send( gateway, command, text, strlen( text ) );
+
+	if( result == 2 )
+		printf( "No open port is called %s\n", command );
+	else if( result != 0 )
+		printf( "Sending to %s failed\n", command );
+}
+
+/* @breif Reads stdin and runs every complete line
+ *
+ * stdin is read directly rather than through stdio, whose buffer could hide a
+ * second line from the event loop.
+ *
+ * @param int fd: stdin
+ * @param uint32_t events: Unused
+ * @param void * arg: The gateway
+ */
+void input_ready( int fd, uint32_t events, void * arg )
+{
+	static char buffer[MAX_BUFFER_SIZE];
+	static int length = 0;
+	struct xbee_gateway * gateway = arg;
+	char line[MAX_BUFFER_SIZE];		//run_command appends to the line, keep the rest intact
+	char * end;
+	int count;
+
+	count = read( fd, buffer + length, MAX_BUFFER_SIZE - 2 - length );
+
+	if( count <= 0 )
+	{
+		xbee_loop_stop( gateway->loop );
+		return;
+	}
+
+	length += count;
+	buffer[length] = '\0';
+
+	while( ( end = strchr( buffer, '\n' ) ) != NULL )
+	{
+		*end = '\0';
+		strcpy( line, buffer );
+		run_command( gateway, line );
+
+		length -= end + 1 - buffer;
+		memmove( buffer, end + 1, length + 1 );
+	}
+
+	//A line longer than the buffer is run in pieces
+	if( length >= MAX_BUFFER_SIZE - 2 )
+	{
+		strcpy( line, buffer );
+		run_command( gateway, line );
+		length = 0;
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	struct xbee_gateway gateway;
+	struct xbee_loop loop;
+	char * pattern = NULL;
+	char * trace = NULL;
+	int workers = 0;
+	int baud_rate = DEFAULT_BAUD_RATE;
+	int option;
+	int result;
+
+	while( ( option = getopt( argc, argv, "w:b:p:t:" ) ) != -1 )
+	{
+		switch( option )
+		{
+			case 'w':
+				workers = atoi( optarg );
+				break;
+
+			case 'b':
+				baud_rate = atoi( optarg );
+				break;
+
+			case 'p':
+				pattern = optarg;
+				break;
+
+			case 't':
+				trace = optarg;
+				break;
+
+			default:
+				printf( "Usage: %s [-w workers] [-b baud rate] [-p pattern] [-t trace file]\n", argv[0] );
+				exit( 1 );
+		}
+	}
+
+	if( trace != NULL && xbee_trace_start( trace ) != 0 )
+		exit( 1 );
+
+	if( xbee_loop_init( &loop ) != 0 )
+		exit( 1 );
+
+	result = xbee_gateway_start( &gateway, &loop, pattern, workers, baud_rate, print_line, NULL );
+
+	if( result != 0 )
+	{
+		printf( "\nStarting the gateway failed with error[%d]\n", result );
+		xbee_loop_close( &loop );
+		exit( 1 );
+	}
+
+	printf( "\nGateway serving %s with %d worker(s)\n",
+			gateway.pattern,
+			gateway.worker_count );
+
+	xbee_loop_add( &loop, STDIN_FILENO, XBEE_LOOP_READ, input_ready, &gateway );
+	xbee_loop_run( &loop );
+
+	xbee_gateway_stop( &gateway );
+	xbee_loop_close( &loop );
+	xbee_trace_stop( );
+
+	return 0;
+}
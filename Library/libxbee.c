@@ -19,16 +19,157 @@
 #include <sys/signal.h>
 #include <termios.h>
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
 #include "libxbee.h"
+#include "xbee_at.h"
+#include "xbee_loop.h"
+#include "xbee_private.h"
+#include "xbee_trace.h"
 
+//Baud rates the xbee supports, indexed by their ATBD code
+static const struct baud_rate
+{
+	int bits_per_second;
+	speed_t speed;				//The termios constant for the rate
+} baud_rates[BAUD_RATE_COUNT] = {
+	{ 1200, B1200 },
+	{ 2400, B2400 },
+	{ 4800, B4800 },
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 }
+};
+
+static void port_readable( int, uint32_t, void * );
+static void at_cache_store( struct xbee *, char *, char * );
+static int at_cache_default_ttl( const char * );
+static int milliseconds_until( const struct timespec * );
+static int baud_rate_code( int );
+static void set_profile_characters( struct termios *, int );
+static int set_low_latency( struct xbee *, int );
+static void wait_for_input( struct xbee *, int );
+
+//Parameters that change on their own and are never cached unless asked to
+static const char * volatile_parameters[] = { "DB", "AI", "TP", "%V", "EA", "EC" };
+
+
+/* @breif Creates a context for one xbee, without opening its port yet
+ *
+ * Header files needed: stdlib.h
+ *
+ * @param struct xbee_loop * loop: Loop the port is registered with, shared
+ *								   with other ports or descriptors. NULL gives
+ *								   the xbee a loop of its own.
+ *
+ * @return :		 NULL - Out of memory or the loop could not be created
+ *			 Not NULL - The new context, freed with xbee_destroy
+ */
+struct xbee * xbee_create( struct xbee_loop * loop )
+{
+	struct xbee * xbee = calloc( 1, sizeof(*xbee) );
+
+	if( xbee == NULL )
+		return NULL;
+
+	xbee->port_descriptor = -1;
+	xbee->baud_rate = DEFAULT_BAUD_RATE;
+	xbee->profile = PORT_LOW_LATENCY;
+	xbee->api_mode = XBEE_TRANSPARENT_MODE;
+	xbee->session.active = FALSE;
+	xbee->session.command_timeout_ms = DEFAULT_COMMAND_TIMEOUT_MS;
+	xbee->loop = loop;
+
+	if( loop == NULL )
+	{
+		if( xbee_loop_init( &xbee->own_loop ) != 0 )
+		{
+			free( xbee );
+			return NULL;
+		}//End ----- if( xbee_loop_init != 0 ) --------------------------
+
+		xbee->loop = &xbee->own_loop;
+	}//End ----- if( loop == NULL ) ---------------------------------
+
+	return xbee;
+}//----- End ----- xbee_create( struct xbee_loop * )---------------------
+
+
+/* @breif Closes the xbee's port and frees the context
+ *
+ * @param struct xbee * xbee: The context returned by xbee_create
+ */
+void xbee_destroy( struct xbee * xbee )
+{
+	if( xbee == NULL )
+		return;
+
+	if( xbee->port_descriptor >= 0 )
+	{
+		xbee_loop_remove( xbee->loop, xbee->port_descriptor );
+		close( xbee->port_descriptor );
+	}//End ----- if( xbee->port_descriptor >= 0 ) -------------------
+
+	if( xbee->loop == &xbee->own_loop )
+		xbee_loop_close( &xbee->own_loop );
+
+	free( xbee );
+}//----- End ----- xbee_destroy( struct xbee * )-------------------------
+
+
+/* @breif Gives the descriptor of the xbee's open port
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :	   -1 - The port is not open
+ *			 Not Negative - The port descriptor
+ */
+int get_port_descriptor( struct xbee * xbee )
+{
+	return xbee->port_descriptor;
+}//----- End ----- get_port_descriptor( struct xbee * )------------------
+
+
+/* @breif Gives the counters and latency histograms of the xbee
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		The xbee's statistics, valid until xbee_destroy
+ */
+struct xbee_stats * get_xbee_stats( struct xbee * xbee )
+{
+	return &xbee->stats;
+}//----- End ----- get_xbee_stats( struct xbee * )-----------------------
+
+
+/* @breif Initializes and opens the provided serial port at DEFAULT_BAUD_RATE
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * port: The complete name of the port to be opened
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by init_port_baud
+ */
+int init_port( struct xbee * xbee, char * port )
+{
+	return init_port_baud( xbee, port, DEFAULT_BAUD_RATE );
+}//----- End ----- init_port( struct xbee *, char * )---------------------
 
-/* @breif Initializes and opens the provided serial port
+
+/* @breif Initializes and opens the provided serial port at the given baud rate
  *
  * Header files needed: signal.h
  *						termios.h
@@ -40,7 +181,9 @@
  *						termios.h
  *						sys/time.h
  *
+ * @param struct xbee * xbee: The xbee to use
  * @param char * port: The complete name of the port to be opened
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
  *
  * @return :		0 - Success
  *					1 - Incoming port variable is too long
@@ -49,12 +192,21 @@
  *					4 - Failed to clear termios struct
  *					5 - Error while flushing read data
  *					6 - Failed to activate the port 
+ *					7 - Failed to register the port with the event loop
+ *					8 - The baud rate is not supported
  *			 Not Zero - Error
  */
-int init_port(char * port)
+int init_port_baud( struct xbee * xbee, char * port, int baud_rate )
 {
 	int ret_value;
 	int length = strlen( port );
+	int code = baud_rate_code( baud_rate );
+
+	if( code < 0 )
+	{
+		printf( "\nThe baud rate[%d] is not supported by the xbee.\n", baud_rate );
+		return 8;
+	}//End ----- if( code < 0 ) -------------------------------------
 
 	if( length > 255)
 	{
@@ -68,338 +220,1888 @@ int init_port(char * port)
 	if( length == 0 )
 	{
 		//Set the default name of the port_name
-		strcpy( port_name, "/dev/ttyUSB0" );
+		strcpy( xbee->port_name, "/dev/ttyUSB0" );
 	}
 	else
 	{
-		//Copy the the provided port name into the global variable port_name to be used in other functions
-        strncpy( port_name, port, MAX_BUFFER_SIZE );
+		//Copy the the provided port name into the context to be used in other functions
+        strncpy( xbee->port_name, port, MAX_BUFFER_SIZE );
 	}//End ----- if( length == 0 ) ----------------------------------
 
+	//A context opened again lets go of its previous port first
+	if( xbee->port_descriptor >= 0 )
+	{
+		xbee_loop_remove( xbee->loop, xbee->port_descriptor );
+		close( xbee->port_descriptor );
+		xbee->port_descriptor = -1;
+	}//End ----- if( xbee->port_descriptor >= 0 ) -------------------
+
 	// SIGIO is used for interrupt-driven input
 	// We are ignoring SIGIO because we are using the select function instead
 	signal( SIGIO, SIG_IGN );
 
-	port_descriptor = open( port_name,		//Name of the port
+	xbee->port_descriptor = open( xbee->port_name,		//Name of the port
 							O_RDWR |		//Open port for reading and writing
 			        		O_NOCTTY |		//The device is not the controlling terminal for the process
 							O_NONBLOCK );		//The port read will return immediately
 
-	if( port_descriptor <= 0 )
+	if( xbee->port_descriptor < 0 )
 	{
 		printf( "\nSerial port[%s] failed to open with error[%d].\n",
-				port_name,
+				xbee->port_name,
 				errno );
 
 		return 2;
-	}//End ----- if( port_descriptor <= 0 ) -------------------------
+	}//End ----- if( port_descriptor < 0 ) --------------------------
 
 	//Set the serial port(or the open file descriptor port_descriptor) up for asynchronous input/output.
-	ret_value = fcntl( port_descriptor,
+	//F_SETFL replaces all flags, so O_NONBLOCK has to be given again or writes would block.
+	ret_value = fcntl( xbee->port_descriptor,
 			   		   F_SETFL,		//Set the file status flags to the value specified by O_ASYNC
-			   		   O_ASYNC );	//Enable the port_descriptor for asynchronous communication
+			   		   O_ASYNC |	//Enable the port_descriptor for asynchronous communication
+					   O_NONBLOCK );	//Keep reads and writes from blocking
 
 	if( ret_value != 0 )
 	{
 		printf( "\nfcntl F_SETFL O_ASYNC on new port[%s] failed with error[%d].\n",
-				port_name,
+				xbee->port_name,
 				errno );
 
 		return 3;
 	}//End ----- if( ret_value != 0 ) -------------------------------
 
-	//Set timeout values
-	timeout.tv_sec = TIMEOUT_SEC;	//seconds
-	timeout.tv_usec = TIMEOUT_USEC; //microseconds
-
-	//Set max file descriptor(maxfd) value
-	maxfd = port_descriptor + 3;
-
 	//clear up struct for new port
-	if( memset( &newtio, 0, sizeof(newtio) ) < (void *)1 )
+	if( memset( &xbee->newtio, 0, sizeof(xbee->newtio) ) < (void *)1 )
 	{
 		printf( "\nClearing up new port[%s] failed with error[%d].\n",
-				port_name,
+				xbee->port_name,
 				errno );
 		
 		return 4;
 	}//End ----- if( memset < 1 ) -------------------------------
 
 	//Set Control modes
-	newtio.c_cflag = ( BAUDRATE |	//Set the Baud rate
-			   		   CS8 |	//Set character size mask to 8 bits
+	xbee->newtio.c_cflag = ( CS8 |	//Set character size mask to 8 bits
 					   CLOCAL |	//Ignore modem control lines
 					   CREAD );	//Enable Receiver
 
-	//Set input modes
-	newtio.c_iflag = ( IGNPAR |	//Ignore framing and parity errors
-					   ICRNL );	//Translate carriage return('\r') to newline('\n') on input
+	//Set the Baud rate
+	cfsetispeed( &xbee->newtio, baud_rates[code].speed );
+	cfsetospeed( &xbee->newtio, baud_rates[code].speed );
+
+	//Set input modes. Nothing is translated, '\r' and API frame bytes like
+	//0x11 and 0x13 must reach the library untouched.
+	xbee->newtio.c_iflag = IGNPAR;	//Ignore framing and parity errors
 
 	//Set output modes
-	newtio.c_oflag = 0;		//Turn off output processing
+	xbee->newtio.c_oflag = 0;		//Turn off output processing
 
-	//Set local modes
-	newtio.c_lflag = ~( ICANON |	//Enable canonical mode
-			 			ECHO |		//Echo input characters
-			 			ECHOE |		//ERASE character erases the preceding input character, and WERASE erases the preceding word
-						ISIG );		//When any of the characters INTR, QUIT, SUSP, or DSUSP are received, generate the corresponding signal
+	//Set local modes. No canonical mode, echo, erase or signal characters.
+	xbee->newtio.c_lflag = 0;
 
 	//Set special charaters
-	newtio.c_cc[VMIN] = 0;		//return as soon as there is at least 1-byte
-	newtio.c_cc[VTIME] = 1;		//otherwise it returns in 0.1 s regardless.
+	set_profile_characters( &xbee->newtio, xbee->profile );
 
 	//Flush data received but not read
-	ret_value = tcflush( port_descriptor, TCIFLUSH );
+	ret_value = tcflush( xbee->port_descriptor, TCIFLUSH );
 
 	if( ret_value != 0 )
 	{
 		printf( "\nSetting up, flushing Input data to port[%s] "\
 				"if not read, failed with error[%d].\n",
-				port_name,
+				xbee->port_name,
 				errno );
 		return 5;
 	}//End ----- if( ret_value != 0 ) -------------------------------
 
+	//Anything left over from a previously opened port is stale now
+	xbee->rx_ring.head = 0;
+	xbee->rx_ring.tail = 0;
+	xbee->session.active = FALSE;
+	invalidate_at_cache( xbee, NULL );	//A different port may be a different xbee
+
+	//Register the port once, read_port only has to wait on the loop afterwards
+	if( xbee_loop_add( xbee->loop, xbee->port_descriptor, XBEE_LOOP_READ, port_readable, xbee ) != 0 )
+	{
+		printf( "\nWatching port[%s] for input failed with error[%d].\n",
+				xbee->port_name,
+				errno );
+
+		return 7;
+	}//End ----- if( xbee_loop_add != 0 ) ---------------------------
+
 	//Write the attributes to the descriptor
-	ret_value = tcsetattr( port_descriptor,	
+	ret_value = tcsetattr( xbee->port_descriptor,	
 		        	       TCSANOW,			//Chanegs take place immediatley
-		        	       &newtio );
+		        	       &xbee->newtio );
 
 	if( ret_value != 0 )
 	{
 		printf( "\nActivating port[%s] settings failed with error[%d].\n",
-				port_name,
+				xbee->port_name,
 				errno );
 
 		return 6;
 	}//End ----- if( ret_value != 0 ) -------------------------------
 
-	printf( "\nSuccessfully established communication with device at port[%s].\n",
-			port_name );
+	xbee->baud_rate = baud_rate;
+	set_low_latency( xbee, xbee->profile == PORT_LOW_LATENCY );
+
+	//The end of the name tells ports apart, /dev/ttyUSB0 from /dev/ttyUSB1
+	xbee_trace( XBEE_TRACE_PORT_OPEN, xbee->port_descriptor, baud_rate,
+				port + ( ( length > XBEE_TRACE_DATA ) ? length - XBEE_TRACE_DATA : 0 ), length );
+
+	printf( "\nSuccessfully established communication with device at port[%s] "\
+			"at %d baud.\n",
+			xbee->port_name,
+			baud_rate );
 
 	return 0;
-}//----- End ----- init_port(char * port)---------------------------------
+}//----- End ----- init_port_baud( struct xbee *, char *, int )-----------
 
 
-/* @breif Writes the given data to the initialized port
+/* @breif Sets VMIN and VTIME for a latency profile
  *
- * Header files needed: unistd.h
+ * The port is read without blocking, so VMIN only decides how many bytes
+ * must be waiting before the port is reported readable.
+ *
+ * @param struct termios * settings: The settings to change
+ * @param int profile: PORT_LOW_LATENCY or PORT_THROUGHPUT
+ */
+static void set_profile_characters( struct termios * settings, int profile )
+{
+	if( profile == PORT_THROUGHPUT )
+	{
+		settings->c_cc[VMIN] = THROUGHPUT_VMIN;		//Readable once a batch is waiting
+		settings->c_cc[VTIME] = 0;
+	}
+	else
+	{
+		settings->c_cc[VMIN] = 1;		//Readable as soon as one byte arrives
+		settings->c_cc[VTIME] = 0;
+	}//End ----- if( profile == PORT_THROUGHPUT ) -------------------
+}//----- End ----- set_profile_characters( struct termios *, int )------
+
+
+/* @breif Turns the driver's ASYNC_LOW_LATENCY flag on or off
  *
- * @param char * buffer: The data to write to the port
+ * Without it many USB serial adapters hold received bytes for several
+ * milliseconds. Ports that do not support the flag, like ptys, are left alone.
  *
- * @return :		0 - success
- *					1 - Error occured when writing to the port
+ * Header files needed: sys/ioctl.h
+ *						linux/serial.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int enable: TRUE to turn the flag on
+ *
+ * @return :		0 - Success
+ *					1 - The port does not support the flag
  *			 Not Zero - Error
  */
-int write_port( char * buffer )
+static int set_low_latency( struct xbee * xbee, int enable )
 {
-	int result = 0;
+#ifdef TIOCGSERIAL
+	struct serial_struct serial;
+
+	if( ioctl( xbee->port_descriptor, TIOCGSERIAL, &serial ) != 0 )
+		return 1;
+
+	if( enable )
+		serial.flags |= ASYNC_LOW_LATENCY;
+	else
+		serial.flags &= ~ASYNC_LOW_LATENCY;
+
+	if( ioctl( xbee->port_descriptor, TIOCSSERIAL, &serial ) != 0 )
+		return 1;
+
+	return 0;
+#else
+	return 1;
+#endif
+}//----- End ----- set_low_latency( struct xbee *, int )------------------
+
+
+/* @breif Chooses between low latency and high throughput when reading
+ *
+ * PORT_LOW_LATENCY wakes the library for every byte. PORT_THROUGHPUT waits
+ * until THROUGHPUT_VMIN bytes are waiting, or THROUGHPUT_WAIT_MS have passed,
+ * so bursts of data cost fewer wakeups and reads.
+ *
+ * Header files needed: termios.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int profile: PORT_LOW_LATENCY or PORT_THROUGHPUT
+ *
+ * @return :		0 - Success
+ *					1 - Unknown profile
+ *					2 - Failed to apply the new settings
+ *			 Not Zero - Error
+ */
+int set_port_profile( struct xbee * xbee, int profile )
+{
+	if( profile != PORT_LOW_LATENCY && profile != PORT_THROUGHPUT )
+		return 1;
 
-	int write_count = write( port_descriptor,
-							 buffer,		//Data to write to the port
-							 strlen(buffer) );	//Count of characters to write
+	set_profile_characters( &xbee->newtio, profile );
 
-	if( write_count < 0 )
+	if( tcsetattr( xbee->port_descriptor, TCSANOW, &xbee->newtio ) != 0 )
 	{
-		printf( "Writing [%s] to serial port[%s] failed with errno(%d)!\n",
-				buffer,
-				port_name,
+		printf( "\nChanging the profile of port[%s] failed with error[%d].\n",
+				xbee->port_name,
 				errno );
 
-		result = 1;
-	}//End -----  while( write_count < 0 ) --------------------------
+		return 2;
+	}//End ----- if( tcsetattr != 0 ) -------------------------------
 
-	return result;
+	set_low_latency( xbee, profile == PORT_LOW_LATENCY );
+	xbee->profile = profile;
 
-}//----- End ----- write_port(char * buffer)------------------------------
+	return 0;
+}//----- End ----- set_port_profile( struct xbee *, int )-----------------
 
 
-/* @breif Reads the initialized port one char at a time
+/* @breif Waits on the event loop for input, at most wait_ms
  *
- * Header files needed: unistd.h
+ * In PORT_THROUGHPUT the port is only reported readable once a whole batch
+ * is waiting, so the wait is cut short and whatever did arrive is read.
  *
- * @param char buffer: Data read from the port will be stored here
+ * @param struct xbee * xbee: The xbee to use
+ * @param int wait_ms: Longest time to wait in milliseconds
+ */
+static void wait_for_input( struct xbee * xbee, int wait_ms )
+{
+	xbee_stats_count( &xbee->stats, XBEE_STAT_WAITS, 1 );
+
+	if( xbee->profile != PORT_THROUGHPUT )
+	{
+		//port_readable fills the ring when the port is ready
+		xbee_loop_run_once( xbee->loop, wait_ms );
+		return;
+	}//End ----- if( port_profile != PORT_THROUGHPUT ) --------------
+
+	if( wait_ms > THROUGHPUT_WAIT_MS )
+		wait_ms = THROUGHPUT_WAIT_MS;
+
+	if( xbee_loop_run_once( xbee->loop, wait_ms ) == 0 )
+		port_readable( xbee->port_descriptor, 0, xbee );	//Take the rest of the batch
+}//----- End ----- wait_for_input( struct xbee *, int )-------------------
+
+
+/* @breif Finds the ATBD code of a baud rate
+ *
+ * @param int baud_rate: Bits per second
+ *
+ * @return :	   -1 - The xbee does not support the rate
+ *			 Not Negative - The ATBD code, also the index into baud_rates
+ */
+static int baud_rate_code( int baud_rate )
+{
+	int code;
+
+	for( code = 0; code < BAUD_RATE_COUNT; code++ )
+	{
+		if( baud_rates[code].bits_per_second == baud_rate )
+			return code;
+	}//End ----- for( code < BAUD_RATE_COUNT ) ----------------------
+
+	return -1;
+}//----- End ----- baud_rate_code( int )----------------------------------
+
+
+/* @breif Changes the baud rate of the open port, not of the xbee
+ *
+ * Waits for pending output to be sent first and drops unread input, which was
+ * received at the old rate.
+ *
+ * Header files needed: termios.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
  *
  * @return :		0 - Success
+ *					1 - The baud rate is not supported
+ *					2 - Failed to apply the new settings
  *			 Not Zero - Error
- *
  */
-int read_port( int fds[], char * buffer )
+int set_port_baud_rate( struct xbee * xbee, int baud_rate )
 {
-	char rx_char;
-	int index = 0;
+	int code = baud_rate_code( baud_rate );
+
+	if( code < 0 )
+		return 1;
+
+	cfsetispeed( &xbee->newtio, baud_rates[code].speed );
+	cfsetospeed( &xbee->newtio, baud_rates[code].speed );
 
-	while(rx_char != '\r' )
+	//TCSADRAIN lets the bytes already written go out at the old rate
+	if( tcsetattr( xbee->port_descriptor, TCSADRAIN, &xbee->newtio ) != 0 )
 	{
-		if( check_descriptors( 1, fds ) > 0 ) //If true, the port is ready
-		{
-			if( read( port_descriptor, &rx_char, 1 ) )
-			{
-				//XBee responses are terminated by carriage return=<cr>='\r'=13=0x0d
-				if( rx_char == '\r' )
-				{
-					buffer[index] = '\0';	//Add the null char to finish the string
-				}
-				else
-				{
-					buffer[index] = rx_char;
-				}//End ----- if( rx_char == '\r' ) ------------------
-
-				index++;
-			}//End ----- read ( ) -----------------------------------
-		}//End ----- check_descriptors ( ) --------------------------
-	}//End ----- while( result == 0 ) -------------------------------
+		printf( "\nSetting port[%s] to %d baud failed with error[%d].\n",
+				xbee->port_name,
+				baud_rate,
+				errno );
+
+		return 2;
+	}//End ----- if( tcsetattr != 0 ) -------------------------------
+
+	tcflush( xbee->port_descriptor, TCIFLUSH );
+	xbee->rx_ring.head = 0;
+	xbee->rx_ring.tail = 0;
+
+	xbee->baud_rate = baud_rate;
+	xbee_trace( XBEE_TRACE_BAUD_RATE, xbee->port_descriptor, baud_rate, NULL, 0 );
 
 	return 0;
+}//----- End ----- set_port_baud_rate( struct xbee *, int )---------------
+
 
-}//----- End ----- read_port(char * buffer)-------------------------------
+/* @breif Reads the baud rate the port is set to
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		Bits per second
+ */
+int get_port_baud_rate( struct xbee * xbee )
+{
+	return xbee->baud_rate;
+}//----- End ----- get_port_baud_rate( struct xbee * )--------------
 
 
-/* @breif Use the system call select to check each port for readiness to be read
+/* @breif Checks that the xbee answers and runs at the expected ATBD code
  *
- * Header files needed: sys/time.h
- *						sys/types.h
- *						unistd.h
- *							or
- *						sys/select.h
+ * @param struct xbee * xbee: The xbee to use
+ * @param int code: The ATBD code the xbee should report
  *
- * @param count: The number of file descriptors provided
- * @param fds: An array of file descriptors to be monitored
+ * @return :		0 - The xbee answered with code
+ *			 Not Zero - It did not answer or answered something else
+ */
+static int check_baud_rate( struct xbee * xbee, int code )
+{
+	char value[MAX_BUFFER_SIZE];
+	uint64_t answer;
+
+	if( get_at( xbee, "BD", value, AT_CACHE_REFRESH ) != 0 )
+		return 1;
+
+	if( xbee_at_parse( XBEE_AT_BD, value, strlen( value ), &answer ) != 0 || answer != (uint64_t)code )
+		return 1;
+
+	return 0;
+}//----- End ----- check_baud_rate( struct xbee *, int )------------------
+
+
+/* @breif Moves the xbee and the port to a new baud rate
  *
- * @return :		0 - No file descriptor is ready
- *			 Not Zero - The file descriptor that is ready for communication
+ * The xbee is told the new rate with ATBD, which it starts using on ATAC, then
+ * the port follows and the link is checked by reading ATBD back. When the xbee
+ * does not answer at the new rate the port goes back to the old rate and, if
+ * the xbee answers there, ATBD is restored too. The rate is not written to
+ * the xbee's flash, use ATWR for that.
+ *
+ * Only works in transparent mode.
+ *
+ * @AT Command: +++, ATBD, ATAC, ATBD
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
+ *
+ * @return :		0 - Success, the xbee and the port run at baud_rate
+ *				   -7 - The baud rate is not supported
+ *				   -8 - The link did not work at the new rate, both sides are
+ *						back at the old rate
+ *				   -9 - The link did not work at either rate
+ *			 Not Zero - The error returned by set_at
  */
-int check_descriptors( int count, int fds[] )
+int negotiate_baud_rate( struct xbee * xbee, int baud_rate )
 {
-	int result; 
-	
-	count--; //This drecrement is start the index at the correct value
+	char value[2];
+	int old_rate = xbee->baud_rate;
+	int old_code = baud_rate_code( old_rate );
+	int code = baud_rate_code( baud_rate );
+	struct timespec settle;
+	int result;
 
-	FD_ZERO( &readfs );		//Initialize the readfs set to 0
+	if( code < 0 )
+		return -7;
 
-	while( count > -1)
-	{
-		FD_SET( fds[count], &readfs ); //Add each provided file descriptor to the set
-		count--;
-	}//END----- while( count > -1 ) ---------------------------------
+	if( baud_rate == old_rate )
+		return 0;
 
-	result = select( maxfd, &readfs, NULL, NULL, &timeout );
+	value[0] = '0' + code;
+	value[1] = '\0';
 
-	return result;
-}//----- End ----- check_descriptors( int fds[] )-------------------------
+	result = set_at( xbee, "BD", value );
 
+	if( result != 0 )
+		return result;
 
-/* @breif Communicates with the xbee and puts it into command mode
+	//The xbee answers ATAC at the old rate and switches right after
+	result = set_at( xbee, "AC", "" );
+
+	if( result != 0 )
+		return result;
+
+	if( set_port_baud_rate( xbee, baud_rate ) != 0 )
+		return -9;
+
+	settle.tv_sec = 0;
+	settle.tv_nsec = BAUD_SETTLE_MS * 1000000L;
+	nanosleep( &settle, NULL );
+
+	if( check_baud_rate( xbee, code ) == 0 )
+		return 0;
+
+	printf( "\nThe xbee did not answer at %d baud, going back to %d baud.\n",
+			baud_rate,
+			old_rate );
+
+	if( set_port_baud_rate( xbee, old_rate ) != 0 )
+		return -9;
+
+	//A garbled answer may have left the xbee out of command mode
+	xbee->session.active = FALSE;
+
+	if( check_baud_rate( xbee, code ) != 0 && check_baud_rate( xbee, old_code ) != 0 )
+		return -9;
+
+	value[0] = '0' + old_code;
+
+	if( set_at( xbee, "BD", value ) != 0 || set_at( xbee, "AC", "" ) != 0 )
+		return -9;
+
+	return -8;
+}//----- End ----- negotiate_baud_rate( struct xbee *, int )--------------
+
+
+/* @breif Writes the given string to the initialized port
  *
- * @AT Command: +++
+ * Header files needed: string.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The string to write to the port, without its '\0'
  *
  * @return :		0 - success
- *				   -1 - Error writing to the port
+ *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
  *			 Not Zero - Error
  */
-int enter_command_mode( void )
+int write_port( struct xbee * xbee, char * buffer )
 {
-	int fds[1];
-	int result = 0;
-	char rx[MAX_BUFFER_SIZE];
-	
-	//We only want to watch the descriptor associated with the hardware
-	fds[0] = port_descriptor;	
+	return write_port_length( xbee, buffer, strlen( buffer ) );
 
-	if( write_port( "+++\0" ) == 0 )
-	{
-		result = read_port( fds, rx );
+}//----- End ----- write_port( struct xbee *, char * buffer)---------------
 
-		if( result != 0 )
-		{
-			printf( "\nFailed to read port\n" );
-			return -2;
-		}
-	}
-	else
-	{
-		return -1;
-	}//End ----- write_port == 0 ------------------------------------
 
-	result = strncmp( rx, "OK", 2 );
+/* @breif Writes length bytes, which may include zero bytes, to the port
+ *
+ * Header files needed: sys/uio.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const void * data: The bytes to write
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - success
+ *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_port_length( struct xbee * xbee, const void * data, size_t length )
+{
+	struct iovec iov;
 
-	return result;
-}//----- End ----- enter_command_mode( void )-----------------------------
+	iov.iov_base = (void *)data;
+	iov.iov_len = length;
 
+	return write_port_vector( xbee, &iov, 1 );
 
-/* @breif Communicates with the xbee and takes it out of command mode
+}//----- End ----- write_port_length( struct xbee *, const void *, size_t )--------------
+
+
+/* @breif Writes several buffers to the port with as few system calls as possible
  *
- * @AT Command: ATCN
+ * The buffers go out back to back through writev, so a header and its payload
+ * do not have to be copied together first. A short write resumes where it
+ * stopped and EAGAIN waits for the port to become writable, until
+ * WRITE_TIMEOUT_MS has passed.
  *
- * @return :		0 - Success
- *				   -1 - Error writing to the port
- * 			 Not Zero - Error
+ * Header files needed: sys/uio.h
+ *						poll.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const struct iovec * iov: The buffers to write, not modified
+ * @param int count: Number of buffers, at most IOV_MAX
+ *
+ * @return :		0 - success
+ *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
  */
-int exit_command_mode( void )
+int write_port_vector( struct xbee * xbee, const struct iovec * iov, int count )
 {
-	int fds[1];
-	int result = 0;
-	char rx[MAX_BUFFER_SIZE];
+	struct iovec pending[count];		//What is left to write
+	struct iovec * next = pending;
+	struct pollfd writable;
+	struct timespec deadline;
+	ssize_t written;
+	int wait_ms;
 
-	//We only want to watch the descriptor associated with the hardware
-	fds[0] = port_descriptor;
+	memcpy( pending, iov, count * sizeof(*iov) );
+	deadline_after( &deadline, WRITE_TIMEOUT_MS );
 
-	if( write_port( "atcn\r" ) == 0 )
-	{
-		if ( read_port( fds, rx ) != 0 )
-			return -2;
-	}
-	else
+	writable.fd = xbee->port_descriptor;
+	writable.events = POLLOUT;
+
+	while( count > 0 )
 	{
-		return -1;
-	}//End ----- write_port == 0 ------------------------------------
+		//Skip buffers that are done, including empty ones
+		if( next->iov_len == 0 )
+		{
+			next++;
+			count--;
+			continue;
+		}//End ----- if( next->iov_len == 0 ) ---------------------------
 
-	return ( strncmp( rx, "OK", 2 ) == 0 );
+		written = writev( xbee->port_descriptor, next, count );
+		xbee_stats_count( &xbee->stats, XBEE_STAT_WRITES, 1 );
 
-	return result;
-}//----- End ----- exit_command_mode( void )------------------------------
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			if( errno != EAGAIN && errno != EWOULDBLOCK )
+			{
+				printf( "Writing to serial port[%s] failed with errno(%d)!\n",
+						xbee->port_name,
+						errno );
 
+				return 1;
+			}//End ----- if( errno is not EAGAIN ) --------------------------
 
-/* @breif Runs the an AT command that will return the xbees IP address
+			//The UART buffer is full, sleep until it drains
+			wait_ms = milliseconds_until( &deadline );
+			xbee_stats_count( &xbee->stats, XBEE_STAT_WAITS, 1 );
+
+			if( wait_ms == 0 || poll( &writable, 1, wait_ms ) == 0 )
+			{
+				xbee_stats_count( &xbee->stats, XBEE_STAT_TIMEOUTS, 1 );
+				xbee_trace( XBEE_TRACE_TIMEOUT, xbee->port_descriptor, WRITE_TIMEOUT, NULL, 0 );
+				return WRITE_TIMEOUT;
+			}//End ----- if( port stayed full ) -----------------------------
+
+			continue;
+		}//End ----- if( written < 0 ) ----------------------------------
+
+		xbee_stats_count( &xbee->stats, XBEE_STAT_BYTES_OUT, written );
+		xbee_trace( XBEE_TRACE_BYTES_OUT, xbee->port_descriptor, written, next->iov_base,
+					( written < (ssize_t)next->iov_len ) ? written : (ssize_t)next->iov_len );
+
+		//Move past what the port took, a short write continues mid buffer
+		while( count > 0 && written >= (ssize_t)next->iov_len )
+		{
+			written -= next->iov_len;
+			next++;
+			count--;
+		}//End ----- while( whole buffers written ) ---------------------
+
+		if( count > 0 )
+		{
+			next->iov_base = (char *)next->iov_base + written;
+			next->iov_len -= written;
+			xbee_stats_count( &xbee->stats, XBEE_STAT_PARTIAL_WRITES, 1 );
+		}//End ----- if( count > 0 ) ------------------------------------
+	}//End ----- while( count > 0 ) ---------------------------------
+
+	return 0;
+
+}//----- End ----- write_port_vector( struct xbee *, const struct iovec *, int )--------
+
+
+/* @breif Moves the next complete line out of the receive ring buffer
  *
- * @AT Command: ATMY
+ * The ring is scanned with memchr over at most two contiguous segments. A
+ * line that would not fit in MAX_BUFFER_SIZE is handed out in pieces.
  *
- * @param char * buffer: IP address will be stored here
+ * Header files needed: string.h
  *
- * @return :		0 - Success
- *				   -1 - Error when entering command mode
- *				   -2 - Error writing to the port
- * 			 Not Zero - Error
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The line, without its '\r', is stored here as a string
+ *
+ * @return :		0 - No complete line is buffered yet
+ *					1 - A line was stored in buffer
  */
-int get_ip( char * buffer )
+static int rx_ring_take_line( struct xbee * xbee, char * buffer )
 {
-	int fds[1];
-	int result;
-	
-	result = enter_command_mode( );
-	
-	if( result == 0 )
-	{
-		//We only want to watch the descriptor associated with the hardware
-		fds[0] = port_descriptor;
+	unsigned int count = xbee->rx_ring.tail - xbee->rx_ring.head;
+	unsigned int start = xbee->rx_ring.head & ( RX_RING_SIZE - 1 );
+	unsigned int first = RX_RING_SIZE - start;	//Bytes before the ring wraps
+	unsigned int length;
+	unsigned int skip = 1;						//Terminator to drop after the line
+	char * found;
 
-		if( write_port( "atmy\r" ) == 0 )
-		{
-			if( read_port( fds, buffer ) != 0 )
-				return -3;
-		}
-		else
-		{
-			return -2;
-		}//END ----- write_port == 0 --------------------------------
+	if( first > count )
+		first = count;
 
-		exit_command_mode( );
+	//XBee responses are terminated by carriage return=<cr>='\r'=13=0x0d
+	found = memchr( &xbee->rx_ring.data[start], '\r', first );
+
+	if( found != NULL )
+	{
+		length = found - &xbee->rx_ring.data[start];
 	}
 	else
 	{
-		return -1;
-	}//END ----- enter_command_mode == 0----------------------------------
+		found = memchr( xbee->rx_ring.data, '\r', count - first );
 
-	return result;
-}//----- End ----- get_ip( char * )---------------------------------------
+		if( found != NULL )
+			length = first + ( found - xbee->rx_ring.data );
+		else
+			length = count;
+	}//End ----- if( found != NULL ) --------------------------------
+
+	if( length > MAX_BUFFER_SIZE - 1 )
+	{
+		//The caller's buffer is full, hand out what fits and keep the rest
+		length = MAX_BUFFER_SIZE - 1;
+		skip = 0;
+	}
+	else if( found == NULL )
+	{
+		return 0;
+	}//End ----- if( length > MAX_BUFFER_SIZE - 1 ) -----------------
+
+	if( length <= first )
+	{
+		memcpy( buffer, &xbee->rx_ring.data[start], length );
+	}
+	else
+	{
+		memcpy( buffer, &xbee->rx_ring.data[start], first );
+		memcpy( buffer + first, xbee->rx_ring.data, length - first );
+	}//End ----- if( length <= first ) ------------------------------
+
+	buffer[length] = '\0';	//Add the null char to finish the string
+	xbee->rx_ring.head += length + skip;
+
+	xbee_trace( XBEE_TRACE_LINE, xbee->port_descriptor, length, buffer, length );
+
+	return 1;
+}//----- End ----- rx_ring_take_line( struct xbee *, char * buffer )--------------------
+
+
+/* @breif Moves up to size bytes out of the receive ring buffer
+ *
+ * Header files needed: string.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param uint8_t * buffer: The bytes are stored here
+ * @param int size: Size of buffer
+ *
+ * @return :		Number of bytes stored in buffer, 0 when size is not positive
+ */
+static int rx_ring_take( struct xbee * xbee, uint8_t * buffer, int size )
+{
+	unsigned int count = xbee->rx_ring.tail - xbee->rx_ring.head;
+	unsigned int start = xbee->rx_ring.head & ( RX_RING_SIZE - 1 );
+	unsigned int first = RX_RING_SIZE - start;	//Bytes before the ring wraps
+
+	if( size <= 0 )
+		return 0;
+
+	if( count > (unsigned int)size )
+		count = size;
+
+	if( count <= first )
+	{
+		memcpy( buffer, &xbee->rx_ring.data[start], count );
+	}
+	else
+	{
+		memcpy( buffer, &xbee->rx_ring.data[start], first );
+		memcpy( buffer + first, xbee->rx_ring.data, count - first );
+	}//End ----- if( count <= first ) -------------------------------
+
+	xbee->rx_ring.head += count;
+
+	return count;
+}//----- End ----- rx_ring_take( struct xbee *, uint8_t *, int )---------
+
+
+/* @breif Reads everything the port has available into the receive ring buffer
+ *
+ * Free space that wraps around the end of the ring is filled with a single
+ * readv so one system call drains as much as the ring can hold.
+ *
+ * Header files needed: sys/uio.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :	   -1 - Error occured when reading from the port
+ *			 Not Zero - The number of bytes added to the ring
+ */
+static int rx_ring_fill( struct xbee * xbee )
+{
+	struct iovec iov[2];
+	unsigned int free_space = RX_RING_SIZE - ( xbee->rx_ring.tail - xbee->rx_ring.head );
+	unsigned int start = xbee->rx_ring.tail & ( RX_RING_SIZE - 1 );
+	unsigned int first = RX_RING_SIZE - start;	//Free bytes before the ring wraps
+	int count;
+
+	if( first > free_space )
+		first = free_space;
+
+	iov[0].iov_base = &xbee->rx_ring.data[start];
+	iov[0].iov_len = first;
+	iov[1].iov_base = xbee->rx_ring.data;
+	iov[1].iov_len = free_space - first;
+
+	count = readv( xbee->port_descriptor, iov, ( iov[1].iov_len > 0 ) ? 2 : 1 );
+	xbee_stats_count( &xbee->stats, XBEE_STAT_READS, 1 );
+
+	if( count > 0 )
+	{
+		xbee->rx_ring.tail += count;
+		xbee_stats_count( &xbee->stats, XBEE_STAT_BYTES_IN, count );
+		xbee_trace( XBEE_TRACE_BYTES_IN, xbee->port_descriptor, count, iov[0].iov_base,
+					( count < (int)first ) ? count : (int)first );
+	}
+	else
+	{
+		xbee_stats_count( &xbee->stats, XBEE_STAT_EMPTY_WAKEUPS, 1 );
+	}//End ----- if( count > 0 ) ------------------------------------
+
+	return count;
+}//----- End ----- rx_ring_fill( struct xbee * )-------------------
+
+
+/* @breif Event loop callback that fills the receive ring when the port is ready
+ *
+ * @param int fd: The port descriptor
+ * @param uint32_t events: The events reported by the loop
+ * @param void * arg: The xbee whose port is ready
+ */
+static void port_readable( int fd, uint32_t events, void * arg )
+{
+	struct xbee * xbee = arg;
+
+	if( rx_ring_fill( xbee ) < 0 && errno != EAGAIN )
+		xbee->read_error = errno;
+}//----- End ----- port_readable( int, uint32_t, void * )-----------------
+
+
+/* @breif Computes a deadline the given number of milliseconds from now
+ *
+ * Deadlines are measured on CLOCK_MONOTONIC so changes to the wall clock do
+ * not shorten or extend them.
+ *
+ * Header files needed: time.h
+ *
+ * @param struct timespec * deadline: The deadline is stored here
+ * @param int milliseconds: How far in the future the deadline is
+ *
+ * @return :		0 - Success
+ *					1 - Failed to read the clock
+ *			 Not Zero - Error
+ */
+int deadline_after( struct timespec * deadline, int milliseconds )
+{
+	if( clock_gettime( CLOCK_MONOTONIC, deadline ) != 0 )
+		return 1;
+
+	deadline->tv_sec += milliseconds / 1000;
+	deadline->tv_nsec += ( milliseconds % 1000 ) * 1000000L;
+
+	if( deadline->tv_nsec >= 1000000000L )
+	{
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}//End ----- if( deadline->tv_nsec >= 1000000000L ) -------------
+
+	return 0;
+}//----- End ----- deadline_after( struct timespec *, int )---------------
+
+
+/* @breif Milliseconds left until a deadline, rounded up
+ *
+ * Header files needed: time.h
+ *
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC deadline
+ *
+ * @return :		0 - The deadline has passed
+ *			 Not Zero - Milliseconds left
+ */
+static int milliseconds_until( const struct timespec * deadline )
+{
+	struct timespec now;
+	long long left;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	left = ( deadline->tv_sec - now.tv_sec ) * 1000000000LL +
+		   ( deadline->tv_nsec - now.tv_nsec );
+
+	if( left <= 0 )
+		return 0;
+
+	return ( left + 999999 ) / 1000000;
+}//----- End ----- milliseconds_until( const struct timespec * )----------
+
+
+/* @breif Reads one '\r' terminated line, giving up at the deadline
+ *
+ * Sleeps in the kernel until the port has data or the deadline passes, it
+ * does not wake up periodically while the port is quiet.
+ *
+ * Header files needed: time.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The line, without its '\r', is stored here as a
+ *						 string. Must hold MAX_BUFFER_SIZE characters.
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a whole line arrived
+ *			 Not Zero - Error
+ */
+int read_port_until( struct xbee * xbee, char * buffer, const struct timespec * deadline )
+{
+	int wait_ms;
+
+	while( rx_ring_take_line( xbee, buffer ) == 0 )
+	{
+		wait_ms = milliseconds_until( deadline );
+
+		if( wait_ms == 0 )
+		{
+			xbee_stats_count( &xbee->stats, XBEE_STAT_TIMEOUTS, 1 );
+			xbee_trace( XBEE_TRACE_TIMEOUT, xbee->port_descriptor, READ_TIMEOUT, NULL, 0 );
+			return READ_TIMEOUT;
+		}//End ----- if( wait_ms == 0 ) ---------------------------------
+
+		wait_for_input( xbee, wait_ms );
+
+		if( xbee->read_error != 0 )
+		{
+			printf( "Reading from serial port[%s] failed with errno(%d)!\n",
+					xbee->port_name,
+					xbee->read_error );
+
+			xbee->read_error = 0;
+			return 1;
+		}//End ----- if( port_read_error != 0 ) -------------------------
+	}//End ----- while( rx_ring_take_line == 0 ) --------------------
+
+	return 0;
+
+}//----- End ----- read_port_until( struct xbee *, char *, const struct timespec * )----
+
+
+/* @breif Reads one '\r' terminated line from the initialized port
+ *
+ * Everything the port has available is pulled into the receive ring buffer
+ * with a single read, so bytes following the terminator are kept for the
+ * next call instead of being lost.
+ *
+ * Header files needed: unistd.h
+ *						sys/uio.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The line, without its '\r', is stored here as a
+ *						 string. Must hold MAX_BUFFER_SIZE characters; longer
+ *						 lines are split.
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - No line arrived within READ_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int read_port( struct xbee * xbee, char * buffer )
+{
+	struct timespec deadline;
+
+	deadline_after( &deadline, READ_TIMEOUT_MS );
+
+	return read_port_until( xbee, buffer, &deadline );
+
+}//----- End ----- read_port( struct xbee *, char * buffer)----------------
+
+
+/* @breif Use the system call poll to check each port for readiness to be read
+ *
+ * The library itself waits on the port through xbee_loop.h; this is kept for
+ * programs that want to check a set of descriptors once.
+ *
+ * Header files needed: poll.h
+ *
+ * @param count: The number of file descriptors provided
+ * @param fds: An array of file descriptors to be monitored
+ *
+ * @return :		0 - No file descriptor is ready
+ *			 Not Zero - The file descriptor that is ready for communication
+ */
+int check_descriptors( int count, int fds[] )
+{
+	struct pollfd watched[count];
+	int index;
+	int result;
+
+	for( index = 0; index < count; index++ )
+	{
+		watched[index].fd = fds[index];
+		watched[index].events = POLLIN;
+	}//END----- for( index < count ) ----------------------------------
+
+	result = poll( watched,
+				   count,
+				   TIMEOUT_SEC * 1000 + TIMEOUT_USEC / 1000 );
+
+	return result;
+}//----- End ----- check_descriptors( int fds[] )-------------------------
+
+
+/* @breif Communicates with the xbee and puts it into command mode
+ *
+ * @AT Command: +++
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - success
+ *				   -1 - Error writing to the port
+ *				   -2 - Error reading from the port
+ *				   -3 - The xbee did not answer within COMMAND_MODE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int enter_command_mode( struct xbee * xbee )
+{
+	int result = 0;
+	char rx[MAX_BUFFER_SIZE];
+	struct timespec deadline;
+	uint64_t start = xbee_stats_clock( );
+
+	if( write_port( xbee, "+++\0" ) == 0 )
+	{
+		//The answer only comes after the guard time, so wait longer than read_port
+		deadline_after( &deadline, COMMAND_MODE_TIMEOUT_MS );
+
+		result = read_port_until( xbee, rx, &deadline );
+
+		if( result == READ_TIMEOUT )
+		{
+			printf( "\nTimed out waiting for command mode\n" );
+			return -3;
+		}
+		else if( result != 0 )
+		{
+			printf( "\nFailed to read port\n" );
+			return -2;
+		}
+	}
+	else
+	{
+		return -1;
+	}//End ----- write_port == 0 ------------------------------------
+
+	result = strncmp( rx, "OK", 2 );
+
+	if( result == 0 )
+	{
+		xbee->session.active = TRUE;
+		deadline_after( &xbee->session.expires, xbee->session.command_timeout_ms );
+
+		xbee_stats_count( &xbee->stats, XBEE_STAT_COMMAND_MODE, 1 );
+		xbee_stats_record( &xbee->stats, XBEE_HISTOGRAM_COMMAND_MODE, xbee_stats_clock( ) - start );
+		xbee_trace( XBEE_TRACE_COMMAND_MODE, xbee->port_descriptor, TRUE, NULL, 0 );
+	}//End ----- if( result == 0 ) ----------------------------------
+
+	return result;
+}//----- End ----- enter_command_mode( struct xbee * )--------------
+
+
+/* @breif Communicates with the xbee and takes it out of command mode
+ *
+ * @AT Command: ATCN
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - Success
+ *				   -1 - Error writing to the port
+ *				   -2 - Error reading from the port
+ *				   -3 - The xbee did not answer within READ_TIMEOUT_MS
+ * 			 Not Zero - Error
+ */
+int exit_command_mode( struct xbee * xbee )
+{
+	int result = 0;
+	char rx[MAX_BUFFER_SIZE];
+
+	if( write_port( xbee, "atcn\r" ) == 0 )
+	{
+		//Even without an answer the session can not be trusted anymore
+		xbee->session.active = FALSE;
+		xbee_trace( XBEE_TRACE_COMMAND_MODE, xbee->port_descriptor, FALSE, NULL, 0 );
+
+		result = read_port( xbee, rx );
+
+		if( result == READ_TIMEOUT )
+			return -3;
+		else if( result != 0 )
+			return -2;
+	}
+	else
+	{
+		return -1;
+	}//End ----- write_port == 0 ------------------------------------
+
+	result = strncmp( rx, "OK", 2 );
+
+	return result;
+}//----- End ----- exit_command_mode( struct xbee * )---------------
+
+
+/* @breif Runs the an AT command that will return the xbees IP address
+ *
+ * The address is answered from the AT parameter cache while it is fresh.
+ *
+ * @AT Command: ATMY
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: IP address will be stored here
+ *
+ * @return :		0 - Success
+ *				   -1 - Error when entering command mode
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ * 			 Not Zero - Error
+ */
+int get_ip( struct xbee * xbee, char * buffer )
+{
+	return get_at( xbee, "MY", buffer, 0 );
+}//----- End ----- get_ip( struct xbee *, char * )------------------------
+
+
+/* @breif Reads the xbee's subnet mask
+ *
+ * @AT Command: ATMK (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The subnet mask is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_mask( struct xbee * xbee, char * buffer )
+{
+	return get_at( xbee, "MK", buffer, 0 );
+}//----- End ----- get_mask( struct xbee *, char * )----------------------
+
+
+/* @breif Reads the xbee's gateway address
+ *
+ * @AT Command: ATGW (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The gateway address is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_gateway( struct xbee * xbee, char * buffer )
+{
+	return get_at( xbee, "GW", buffer, 0 );
+}//----- End ----- get_gateway( struct xbee *, char * )-------------------
+
+
+/* @breif Reads the xbee's network ID(SSID or PAN ID depending on the module)
+ *
+ * @AT Command: ATID (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The network ID is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_network_id( struct xbee * xbee, char * buffer )
+{
+	return get_at( xbee, "ID", buffer, 0 );
+}//----- End ----- get_network_id( struct xbee *, char * )----------------
+
+
+/* @breif Sends one comma chained AT command and reads an answer per parameter
+ *
+ * Must be called in command mode.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * commands[]: The parameters to send without the "AT"
+ * @param int count: Number of parameters in the chain
+ * @param char results[][MAX_BUFFER_SIZE]: results[i] receives the answer to
+ *										   commands[i]
+ *
+ * @return :		0 - Success
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ * 			 Not Zero - Error
+ */
+static int send_at_chain( struct xbee * xbee, char * commands[], int count, char results[][MAX_BUFFER_SIZE] )
+{
+	char chain[MAX_BUFFER_SIZE];
+	uint64_t start;
+	int length = 2;
+	int index;
+	int result;
+	int id;
+
+	strcpy( chain, "AT" );
+
+	for( index = 0; index < count; index++ )
+	{
+		if( index > 0 )
+			chain[length++] = ',';
+
+		strcpy( chain + length, commands[index] );
+		length += strlen( commands[index] );
+	}//END ----- for( index < count ) ----------------------------------
+
+	chain[length++] = '\r';
+	chain[length] = '\0';
+
+	//Every command restarts the xbee's CT timer. Restart ours before writing so
+	//it never runs out later than the xbee's does.
+	deadline_after( &xbee->session.expires, xbee->session.command_timeout_ms );
+	start = xbee_stats_clock( );
+	xbee_trace( XBEE_TRACE_AT_SENT, xbee->port_descriptor, count, chain, length );
+
+	if( write_port( xbee, chain ) != 0 )
+	{
+		xbee_stats_count( &xbee->stats, XBEE_STAT_AT_ERRORS, count );
+		return -2;
+	}//End ----- if( write_port != 0 ) ------------------------------
+
+	//The xbee answers the chained parameters in order, one line each
+	for( index = 0; index < count; index++ )
+	{
+		result = read_port( xbee, results[index] );
+
+		if( result != 0 )
+		{
+			xbee_stats_count( &xbee->stats, XBEE_STAT_AT_ERRORS, count - index );
+			return ( result == READ_TIMEOUT ) ? -4 : -3;
+		}//End ----- if( result != 0 ) ----------------------------------
+
+		xbee_trace( XBEE_TRACE_AT_ANSWER, xbee->port_descriptor, index,
+					results[index], strlen( results[index] ) );
+
+		//Fresh answers are worth keeping, whoever asked for them, but only
+		//parameters answer with a value, executed commands just say "OK"
+		id = xbee_at_lookup( commands[index] );
+
+		if( strcmp( results[index], "ERROR" ) == 0 )
+			xbee_stats_count( &xbee->stats, XBEE_STAT_AT_ERRORS, 1 );
+		else if( id >= 0 && ( xbee_at_commands[id].access & XBEE_AT_READ ) )
+			at_cache_store( xbee, commands[index], results[index] );
+	}//END ----- for( index < count ) ----------------------------------
+
+	xbee_stats_record( &xbee->stats, XBEE_HISTOGRAM_AT_ROUND_TRIP, xbee_stats_clock( ) - start );
+
+	return 0;
+}//----- End ----- send_at_chain( struct xbee *, char * [], int, char [][] )------------
+
+
+/* @breif Reads several AT parameters in a single command mode session
+ *
+ * The parameters are chained with commas into as few commands as possible,
+ * e.g. "ATMY,MK,GW,ID\r", and the xbee answers each one on its own line. At
+ * most one "+++" is paid no matter how many parameters are read, none when a
+ * command mode session is still open(see at_session_open). The session is
+ * closed when reading fails, the xbee may have been left in any state.
+ *
+ * @AT Command: +++, AT<cmd>[,<cmd>...]
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * commands[]: The parameters to read without the "AT", e.g. "MY"
+ * @param int count: Number of parameters, at most MAX_AT_BATCH
+ * @param char results[][MAX_BUFFER_SIZE]: results[i] receives the answer to
+ *										   commands[i], "ERROR" if the xbee
+ *										   rejected it
+ *
+ * @return :		0 - Success
+ *				   -1 - Error when entering command mode
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -5 - Too many parameters or a parameter is too long
+ * 			 Not Zero - Error
+ */
+int query_at_batch( struct xbee * xbee, char * commands[], int count, char results[][MAX_BUFFER_SIZE] )
+{
+	int first = 0;			//First parameter of the chain being built
+	int length = 3;			//"AT" and the closing '\r'
+	int index;
+	int result = 0;
+
+	if( count < 1 || count > MAX_AT_BATCH )
+		return -5;
+
+	//"AT", one parameter, and '\r' must always fit in a single command
+	for( index = 0; index < count; index++ )
+	{
+		if( strlen( commands[index] ) + 3 >= MAX_BUFFER_SIZE )
+			return -5;
+	}//END ----- for( index < count ) ----------------------------------
+
+	if( at_session_open( xbee ) != 0 )
+		return -1;
+
+	for( index = 0; index < count; index++ )
+	{
+		//Start a new chain once the next parameter and its comma would not fit
+		if( index > first &&
+			length + 1 + strlen( commands[index] ) >= MAX_BUFFER_SIZE )
+		{
+			result = send_at_chain( xbee, &commands[first], index - first, &results[first] );
+
+			if( result != 0 )
+				break;
+
+			first = index;
+			length = 3;
+		}//END ----- if( length would overflow ) ---------------------------
+
+		length += strlen( commands[index] ) + ( ( index > first ) ? 1 : 0 );
+	}//END ----- for( index < count ) ----------------------------------
+
+	if( result == 0 )
+		result = send_at_chain( xbee, &commands[first], count - first, &results[first] );
+
+	if( result != 0 )
+	{
+		//The xbee may still be in command mode, the next data must not reach the AT parser
+		at_session_close( xbee );
+		return result;
+	}//End ----- if( result != 0 ) ----------------------------------
+
+	//The session is left open for the next AT operation, write_data closes it
+	return 0;
+}//----- End ----- query_at_batch( struct xbee *, char * [], int, char [][] )-----------
+
+
+/* @breif Makes sure the xbee is in command mode, reusing a live session
+ *
+ * "+++" and its guard times are only paid when the xbee has left command mode
+ * or is about to, according to its CT timer.
+ *
+ * @AT Command: +++ (only when the session has lapsed)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by enter_command_mode
+ */
+int at_session_open( struct xbee * xbee )
+{
+	if( xbee->session.active == TRUE &&
+		milliseconds_until( &xbee->session.expires ) > SESSION_MARGIN_MS )
+	{
+		return 0;
+	}//End ----- if( session is live ) ------------------------------
+
+	xbee->session.active = FALSE;
+
+	return enter_command_mode( xbee );
+}//----- End ----- at_session_open( struct xbee * )----------------
+
+
+/* @breif Takes the xbee out of command mode if a session is open
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - Success or no session was open
+ *			 Not Zero - The error returned by exit_command_mode
+ */
+int at_session_close( struct xbee * xbee )
+{
+	if( xbee->session.active == FALSE )
+		return 0;
+
+	if( milliseconds_until( &xbee->session.expires ) == 0 )
+	{
+		//The xbee already left command mode on its own
+		xbee->session.active = FALSE;
+		xbee_trace( XBEE_TRACE_COMMAND_MODE, xbee->port_descriptor, FALSE, NULL, 0 );
+		return 0;
+	}//End ----- if( session expired ) ------------------------------
+
+	return exit_command_mode( xbee );
+}//----- End ----- at_session_close( struct xbee * )---------------
+
+
+/* @breif Tells the library the xbee's command mode timeout
+ *
+ * Must match the xbee's ATCT value, which is in units of 100 ms.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int milliseconds: The command mode timeout in milliseconds
+ */
+void set_command_timeout( struct xbee * xbee, int milliseconds )
+{
+	xbee->session.command_timeout_ms = milliseconds;
+}//----- End ----- set_command_timeout( struct xbee *, int )-------------
+
+
+/* @breif Writes data to be sent over the radio
+ *
+ * Data written in command mode would be taken as AT commands, so an open
+ * session is closed with ATCN first.
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The data to send
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - Error when leaving command mode
+ *			 Not Zero - Error
+ */
+int write_data( struct xbee * xbee, char * buffer )
+{
+	return write_data_length( xbee, buffer, strlen( buffer ) );
+}//----- End ----- write_data( struct xbee *, char * )-------------------
+
+
+/* @breif Writes binary data, which may include zero bytes, to be sent over the radio
+ *
+ * An open command mode session is closed with ATCN first.
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const void * data: The bytes to send
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - Error when leaving command mode
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_data_length( struct xbee * xbee, const void * data, size_t length )
+{
+	if( at_session_close( xbee ) != 0 )
+		return 2;
+
+	return write_port_length( xbee, data, length );
+}//----- End ----- write_data_length( struct xbee *, const void *, size_t )-------------
+
+
+/* @breif Finds the cache entry of an AT parameter, creating it if needed
+ *
+ * When the cache is full an entry is reused in this order: one without a value
+ * and with the TTL it would get anyway, then the value with that TTL closest to
+ * expiring, and only then one that keeps a TTL set with set_at_cache_ttl,
+ * whether it holds a value or not.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "MY", in any case
+ * @param int create: TRUE to create a missing entry
+ *
+ * @return :		 NULL - The parameter has no entry and create is FALSE
+ *			 Not NULL - The entry of the parameter
+ */
+static struct at_cache_entry * at_cache_find( struct xbee * xbee, char * command, int create )
+{
+	struct at_cache_entry * entry = NULL;
+	struct at_cache_entry * candidate;
+	int entry_rank = 0;
+	int rank;
+	char key[3];
+	int index;
+
+	key[0] = toupper( command[0] );
+	key[1] = toupper( command[1] );
+	key[2] = '\0';
+
+	for( index = 0; index < AT_CACHE_SIZE; index++ )
+	{
+		candidate = &xbee->at_cache[index];
+
+		if( strcmp( candidate->command, key ) == 0 )
+			return candidate;
+
+		//0 - unused, 1 - nothing is lost, 2 - a value, 3 - a TTL of the caller
+		if( candidate->command[0] == '\0' )
+			rank = 0;
+		else if( candidate->ttl_ms != at_cache_default_ttl( candidate->command ) )
+			rank = 3;
+		else if( candidate->valid == FALSE )
+			rank = 1;
+		else
+			rank = 2;
+
+		//Within a rank the entry that expires first goes
+		if( entry == NULL || rank < entry_rank ||
+			( rank == entry_rank &&
+			  ( candidate->expires.tv_sec < entry->expires.tv_sec ||
+				( candidate->expires.tv_sec == entry->expires.tv_sec &&
+				  candidate->expires.tv_nsec < entry->expires.tv_nsec ) ) ) )
+		{
+			entry = candidate;
+			entry_rank = rank;
+		}//End ----- if( better slot to reuse ) -------------------------
+	}//End ----- for( index < AT_CACHE_SIZE ) -----------------------
+
+	if( create == FALSE )
+		return NULL;
+
+	memset( entry, 0, sizeof(*entry) );
+	strcpy( entry->command, key );
+	entry->ttl_ms = at_cache_default_ttl( key );
+
+	return entry;
+}//----- End ----- at_cache_find( struct xbee *, char *, int )-----------
+
+
+/* @breif Gives the TTL a new cache entry starts with
+ *
+ * @param const char * key: The two letter parameter in upper case
+ *
+ * @return :		0 - The parameter changes too often to be cached
+ *			 Not Zero - DEFAULT_AT_CACHE_TTL_MS
+ */
+static int at_cache_default_ttl( const char * key )
+{
+	int index;
+
+	for( index = 0; index < (int)( sizeof(volatile_parameters) / sizeof(volatile_parameters[0]) ); index++ )
+	{
+		if( strcmp( key, volatile_parameters[index] ) == 0 )
+			return 0;
+	}//End ----- for( each volatile parameter ) ---------------------
+
+	return DEFAULT_AT_CACHE_TTL_MS;
+}//----- End ----- at_cache_default_ttl( const char * )-------------
+
+
+/* @breif Remembers the xbee's answer for an AT parameter
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "MY"
+ * @param char * value: The xbee's answer
+ */
+static void at_cache_store( struct xbee * xbee, char * command, char * value )
+{
+	struct at_cache_entry * entry = at_cache_find( xbee, command, TRUE );
+
+	if( entry->ttl_ms == 0 )
+		return;
+
+	strncpy( entry->value, value, MAX_BUFFER_SIZE - 1 );
+	entry->value[MAX_BUFFER_SIZE - 1] = '\0';
+	entry->valid = TRUE;
+	deadline_after( &entry->expires, entry->ttl_ms );
+}//----- End ----- at_cache_store( struct xbee *, char *, char * )-------
+
+
+/* @breif Reads an AT parameter, answering from the cache when possible
+ *
+ * @AT Command: AT<command> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "MY"
+ * @param char * value: The parameter's value is stored here. Must hold
+ *						MAX_BUFFER_SIZE characters.
+ * @param int flags: AT_CACHE_REFRESH to ignore the cached value
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by query_at_batch
+ */
+int get_at( struct xbee * xbee, char * command, char * value, int flags )
+{
+	struct at_cache_entry * entry = at_cache_find( xbee, command, FALSE );
+
+	if( entry != NULL &&
+		entry->valid == TRUE &&
+		( flags & AT_CACHE_REFRESH ) == 0 &&
+		milliseconds_until( &entry->expires ) > 0 )
+	{
+		strcpy( value, entry->value );
+		return 0;
+	}//End ----- if( cached value is fresh ) ------------------------
+
+	return query_at_batch( xbee, &command, 1, (char (*)[MAX_BUFFER_SIZE])value );
+}//----- End ----- get_at( struct xbee *, char *, char *, int )----------
+
+
+/* @breif Sets an AT parameter and drops the cached values it affects
+ *
+ * @AT Command: AT<command><value>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "ID"
+ * @param char * value: The new value as the xbee expects it, e.g. "3332"
+ *
+ * @return :		0 - Success
+ *				   -1 - Error when entering command mode
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -5 - The command is too long
+ *				   -6 - The xbee rejected the value
+ * 			 Not Zero - Error
+ */
+int set_at( struct xbee * xbee, char * command, char * value )
+{
+	char request[MAX_BUFFER_SIZE];
+	char answer[1][MAX_BUFFER_SIZE];
+	char * requests[1] = { request };
+	uint64_t timeout;
+	int result;
+
+	if( strlen( command ) + strlen( value ) + 3 >= MAX_BUFFER_SIZE )
+		return -5;
 
+	strcpy( request, command );
+	strcat( request, value );
+
+	//Whatever happens the cached value can not be trusted anymore
+	if( strcasecmp( command, "RE" ) == 0 )
+		invalidate_at_cache( xbee, NULL );	//Restoring defaults changes everything
+	else
+		invalidate_at_cache( xbee, command );
+
+	result = query_at_batch( xbee, requests, 1, answer );
+
+	if( result != 0 )
+		return result;
+
+	if( strncmp( answer[0], "OK", 2 ) != 0 )
+		return -6;
+
+	if( strcasecmp( command, "CT" ) == 0 &&
+		xbee_at_parse( XBEE_AT_CT, value, strlen( value ), &timeout ) == 0 )
+	{
+		//ATCT is in units of 100 ms, keep the session manager in step with it
+		set_command_timeout( xbee, timeout * 100 );
+	}//End ----- if( command is CT ) --------------------------------
+
+	if( strcasecmp( command, "FR" ) == 0 )
+	{
+		//The xbee restarts in transparent mode with its saved values, the next
+		//AT command needs "+++" again and unsaved values are gone
+		xbee->session.active = FALSE;
+		xbee_trace( XBEE_TRACE_COMMAND_MODE, xbee->port_descriptor, FALSE, NULL, 0 );
+		invalidate_at_cache( xbee, NULL );
+	}//End ----- if( command is FR ) --------------------------------
+
+	return 0;
+}//----- End ----- set_at( struct xbee *, char *, char * )--------------
+
+
+/* @breif Sets how long the value of an AT parameter is cached
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "ID"
+ * @param int ttl_ms: Milliseconds the value is trusted, 0 disables caching
+ */
+void set_at_cache_ttl( struct xbee * xbee, char * command, int ttl_ms )
+{
+	struct at_cache_entry * entry = at_cache_find( xbee, command, TRUE );
+
+	entry->ttl_ms = ttl_ms;
+	entry->valid = FALSE;
+}//----- End ----- set_at_cache_ttl( struct xbee *, char *, int )--------
+
+
+/* @breif Drops cached AT parameter values
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter to drop, NULL drops all
+ */
+void invalidate_at_cache( struct xbee * xbee, char * command )
+{
+	struct at_cache_entry * entry;
+	int index;
+
+	if( command == NULL )
+	{
+		for( index = 0; index < AT_CACHE_SIZE; index++ )
+			xbee->at_cache[index].valid = FALSE;
+
+		return;
+	}//End ----- if( command == NULL ) ------------------------------
+
+	entry = at_cache_find( xbee, command, FALSE );
+
+	if( entry != NULL )
+		entry->valid = FALSE;
+}//----- End ----- invalidate_at_cache( struct xbee *, char * )----------
+
+
+/* @breif Frame callback that keeps the status of the ATAP response
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param void * arg: int receiving the XBEE_AT_STATUS_*
+ */
+static void keep_api_mode_status( const uint8_t * data, int length, void * arg )
+{
+	struct xbee_at_response response;
+	int * status = arg;
+
+	if( xbee_frame_parse_at_response( data, length, &response ) == 0 &&
+		response.frame_id == API_MODE_FRAME_ID && strcmp( response.command, "AP" ) == 0 )
+	{
+		*status = response.status;
+	}//End ----- if( the ATAP response ) ----------------------------
+}//----- End ----- keep_api_mode_status( const uint8_t *, int, void * )--
+
+
+/* @breif Sets ATAP with an API AT command frame, for an xbee in API mode
+ *
+ * "+++" is data to an xbee in API mode, it only takes AT commands as frames.
+ * The response comes in the old mode, the new one applies right after it.
+ *
+ * @param struct xbee * xbee: The xbee to use, xbee->api_mode is not
+ *							  XBEE_TRANSPARENT_MODE
+ * @param int mode: XBEE_TRANSPARENT_MODE, XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ *
+ * @return :		0 - Success
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -6 - The xbee rejected the value
+ */
+static int set_api_mode_frame( struct xbee * xbee, int mode )
+{
+	struct xbee_frame_decoder decoder;
+	struct timespec deadline;
+	uint8_t data[5];
+	uint8_t parameter = mode;
+	int status = -1;
+	int length;
+	int result;
+
+	length = xbee_frame_at_command( API_MODE_FRAME_ID, "AP", &parameter, 1, data );
+
+	if( write_frame( xbee, data, length ) != 0 )
+		return -2;
+
+	xbee_frame_decoder_init( &decoder, xbee->api_mode );
+	deadline_after( &deadline, READ_TIMEOUT_MS );
+
+	//Other frames may come first, e.g. data received meanwhile
+	while( status < 0 )
+	{
+		result = read_frames( xbee, &decoder, keep_api_mode_status, &status, &deadline );
+
+		if( result == READ_TIMEOUT )
+			return -4;
+		else if( result != 0 )
+			return -3;
+	}//End ----- while( no ATAP response ) --------------------------
+
+	return ( status == XBEE_AT_STATUS_OK ) ? 0 : -6;
+}//----- End ----- set_api_mode_frame( struct xbee *, int )--------------
+
+
+/* @breif Switches the xbee between transparent and API mode
+ *
+ * From transparent mode ATAP is set in command mode, and the new mode takes
+ * effect when command mode is left, so the session is closed before returning.
+ * From API mode ATAP is sent as an API AT command frame.
+ *
+ * @AT Command: ATAP, ATCN
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int mode: XBEE_TRANSPARENT_MODE, XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ *
+ * @return :		0 - Success
+ *				   -7 - Unknown mode
+ *			 Not Zero - The error returned by set_at, at_session_close or
+ *						set_api_mode_frame
+ */
+int set_api_mode( struct xbee * xbee, int mode )
+{
+	char value[2];
+	int result;
+
+	if( mode < XBEE_TRANSPARENT_MODE || mode > XBEE_API_ESCAPED_MODE )
+		return -7;
+
+	if( xbee->api_mode != XBEE_TRANSPARENT_MODE )
+	{
+		result = set_api_mode_frame( xbee, mode );
+
+		if( result != 0 )
+			return result;
+
+		invalidate_at_cache( xbee, "AP" );
+	}
+	else
+	{
+		value[0] = '0' + mode;
+		value[1] = '\0';
+
+		result = set_at( xbee, "AP", value );
+
+		if( result != 0 )
+			return result;
+
+		result = at_session_close( xbee );
+
+		if( result != 0 )
+			return result;
+	}//End ----- if( xbee->api_mode != XBEE_TRANSPARENT_MODE ) ------
+
+	xbee->api_mode = mode;
+	xbee_trace( XBEE_TRACE_API_MODE, xbee->port_descriptor, mode, NULL, 0 );
+
+	return 0;
+}//----- End ----- set_api_mode( struct xbee *, int )--------------------
+
+
+/* @breif Reads whatever bytes are available, giving up at the deadline
+ *
+ * Bytes already in the receive ring buffer are handed out first.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param uint8_t * buffer: The bytes are stored here
+ * @param int size: Size of buffer
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error occured when reading from the port
+ *					0 - The deadline passed before any byte arrived
+ *			 Not Zero - Number of bytes stored in buffer
+ */
+int read_port_raw( struct xbee * xbee, uint8_t * buffer, int size, const struct timespec * deadline )
+{
+	int wait_ms;
+
+	while( xbee->rx_ring.tail == xbee->rx_ring.head )
+	{
+		wait_ms = milliseconds_until( deadline );
+
+		if( wait_ms == 0 )
+		{
+			xbee_stats_count( &xbee->stats, XBEE_STAT_TIMEOUTS, 1 );
+			xbee_trace( XBEE_TRACE_TIMEOUT, xbee->port_descriptor, READ_TIMEOUT, NULL, 0 );
+			return 0;
+		}//End ----- if( wait_ms == 0 ) ---------------------------------
+
+		wait_for_input( xbee, wait_ms );
+
+		if( xbee->read_error != 0 )
+		{
+			printf( "Reading from serial port[%s] failed with errno(%d)!\n",
+					xbee->port_name,
+					xbee->read_error );
+
+			xbee->read_error = 0;
+			return -1;
+		}//End ----- if( port_read_error != 0 ) -------------------------
+	}//End ----- while( ring is empty ) -----------------------------
+
+	return rx_ring_take( xbee, buffer, size );
+}//----- End ----- read_port_raw( struct xbee *, uint8_t *, int, ... )------------------
+
+
+/* @breif Encodes frame data for the current API mode and writes it to the port
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const uint8_t * data: The frame data, data[0] is the API identifier
+ * @param int length: Number of bytes in data
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - The xbee is not in API mode or the data is too long
+ *			 Not Zero - Error
+ */
+int write_frame( struct xbee * xbee, const uint8_t * data, int length )
+{
+	uint8_t frame[XBEE_FRAME_MAX_ENCODED];
+	uint8_t header[3];
+	uint8_t checksum = 0;
+	struct iovec parts[3];
+	int frame_length;
+	int index;
+
+	if( xbee->api_mode == XBEE_TRANSPARENT_MODE || length < 1 || length > XBEE_FRAME_MAX_DATA )
+		return 2;
+
+	if( xbee->api_mode == XBEE_API_ESCAPED_MODE )
+	{
+		//Escaping changes the data, it has to be copied into the frame
+		frame_length = xbee_frame_encode( data, length, xbee->api_mode, frame, sizeof(frame) );
+
+		if( frame_length < 0 )
+			return 2;
+
+		return write_port_length( xbee, frame, frame_length ) == 0 ? 0 : 1;
+	}//End ----- if( api_mode == XBEE_API_ESCAPED_MODE ) ------------
+
+	//Without escaping the frame data goes out as is between header and checksum
+	for( index = 0; index < length; index++ )
+		checksum += data[index];
+
+	header[0] = XBEE_FRAME_DELIMITER;
+	header[1] = length >> 8;
+	header[2] = length & 0xFF;
+	checksum = 0xFF - checksum;
+
+	parts[0].iov_base = header;
+	parts[0].iov_len = sizeof(header);
+	parts[1].iov_base = (void *)data;
+	parts[1].iov_len = length;
+	parts[2].iov_base = &checksum;
+	parts[2].iov_len = 1;
+
+	return write_port_vector( xbee, parts, 3 ) == 0 ? 0 : 1;
+}//----- End ----- write_frame( struct xbee *, const uint8_t *, int )-------------------
+
+
+/* @breif Reads from the port until at least one whole frame has been decoded
+ *
+ * Bytes following the last complete frame stay in the decoder for the next
+ * call.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param struct xbee_frame_decoder * decoder: Decoder set up for the current
+ *											   API mode
+ * @param xbee_frame_callback callback: Called for every complete frame
+ * @param void * arg: Passed to callback
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a whole frame arrived
+ *			 Not Zero - Error
+ */
+int read_frames( struct xbee * xbee,
+				 struct xbee_frame_decoder * decoder,
+				 xbee_frame_callback callback,
+				 void * arg,
+				 const struct timespec * deadline )
+{
+	uint8_t bytes[RX_RING_SIZE];
+	int count;
+	int frames = 0;
+
+	while( frames == 0 )
+	{
+		count = read_port_raw( xbee, bytes, sizeof(bytes), deadline );
+
+		if( count < 0 )
+			return 1;
+		else if( count == 0 )
+			return READ_TIMEOUT;
+
+		frames = xbee_frame_decode( decoder, bytes, count, callback, arg );
+	}//End ----- while( frames == 0 ) -------------------------------
+
+	return 0;
+}//----- End ----- read_frames( struct xbee *, struct xbee_frame_decoder *, ... )-------
@@ -19,6 +19,9 @@
  *				AT commands. Each AT command has a get and set function that manages 
  *				entering and exiting command mode automatically.
  *
+ *				Every function works on an xbee context created with xbee_create,
+ *				so one process can drive several xbees, each from its own thread.
+ *
  * @author Steven Hatch - sthatch@asu.edu
  *
  * @bugs
@@ -28,33 +31,140 @@
 #ifndef LIBXBEE_H
 #define LIBXBEE_H
 
-#include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
 #include <termios.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include "xbee_frame.h"
+#include "xbee_stats.h"
 
 //-----------------Global Variable Definitions-------------------------------------
 #define TRUE 1
 #define FALSE 0
 
 #define MAX_BUFFER_SIZE 255
-#define BAUDRATE B9600
 
-//The following two constants define the length of time that the select system call
+//Baud rate init_port opens the port at, the xbee's factory setting(ATBD=3)
+#define DEFAULT_BAUD_RATE 9600
+
+//Number of baud rates the xbee can be set to, ATBD codes 0 to 8(1200 to 230400)
+#define BAUD_RATE_COUNT 9
+
+//Latency profiles of the port, see set_port_profile
+#define PORT_LOW_LATENCY 0
+#define PORT_THROUGHPUT 1
+
+//In PORT_THROUGHPUT the port is reported readable once THROUGHPUT_VMIN bytes
+//are waiting; a smaller tail is read after at most THROUGHPUT_WAIT_MS
+#define THROUGHPUT_VMIN 64
+#define THROUGHPUT_WAIT_MS 20
+
+//Longest time in milliseconds negotiate_baud_rate waits after ATAC before
+//checking the link at the new rate
+#define BAUD_SETTLE_MS 100
+
+//Size of the receive ring buffer that holds bytes read from the port but not yet
+//handed out as lines. Must be a power of two and larger than MAX_BUFFER_SIZE.
+#define RX_RING_SIZE 4096
+
+//The following two constants define the length of time that check_descriptors
 //will wait for input from the specified descriptors
-#define TIMEOUT_SEC 0;
-#define TIMEOUT_USEC 1000;
+#define TIMEOUT_SEC 0
+#define TIMEOUT_USEC 1000
+
+//Longest time in milliseconds read_port waits for a line before giving up
+#define READ_TIMEOUT_MS 1000
+
+//Longest time in milliseconds to wait for "OK" after "+++". The xbee only answers
+//once its guard time(ATGT, one second by default) of silence has passed.
+#define COMMAND_MODE_TIMEOUT_MS 3000
+
+//Returned by read_port and read_port_until when the deadline passed first
+#define READ_TIMEOUT 2
+
+//Longest time in milliseconds a write waits for the port to take all its data,
+//and the code returned when it does not
+#define WRITE_TIMEOUT_MS 5000
+#define WRITE_TIMEOUT 3
+
+//Default of the xbee's command mode timeout(ATCT=0x64, 100 ms units)
+#define DEFAULT_COMMAND_TIMEOUT_MS 10000
+
+//A session this close to its CT timeout is not reused, "+++" is sent again
+#define SESSION_MARGIN_MS 500
+
+//Most AT parameters query_at_batch reads in one call
+#define MAX_AT_BATCH 32
 
-int port_descriptor;				//Used to define the port associated with the device
-char port_name[MAX_BUFFER_SIZE];
-struct timeval timeout;				//Used to set timeout value for serial port
-struct termios newtio;				//Contains parameters for the serial port
-int maxfd;							//Used by the select function to define its search
-fd_set readfs;						//A set of files descriptors for the select system call to check for readiness
+//Number of AT parameters whose values are cached, and how long a value is
+//trusted unless set_at_cache_ttl says otherwise
+#define AT_CACHE_SIZE 32
+#define DEFAULT_AT_CACHE_TTL_MS 60000
+
+//Flag for get_at to ask the xbee even when a cached value is fresh
+#define AT_CACHE_REFRESH 1
+
+//Frame ID set_api_mode uses for ATAP when the xbee is in API mode
+#define API_MODE_FRAME_ID 1
+
+//Everything the library knows about one port and the xbee on it. The contents
+//are private, every function takes the handle returned by xbee_create. One
+//process can drive several xbees; each handle must be used by one thread at a
+//time.
+struct xbee;
+struct xbee_loop;
 
 //---------------End Global Variable Definitions-----------------------------------
 
 
 //-----------------Function Prototypes---------------------------------------------
 
+/* @breif Creates a context for one xbee, without opening its port yet
+ *
+ * Several xbees can share one loop, e.g. to wait on all of their ports from a
+ * single thread. Reading from one of them then also runs the callbacks of the
+ * others, so a shared loop must only be used from one thread.
+ *
+ * Header files needed: stdlib.h
+ *
+ * @param struct xbee_loop * loop: Loop the port is registered with, shared
+ *								   with other ports or descriptors. NULL gives
+ *								   the xbee a loop of its own.
+ *
+ * @return :		 NULL - Out of memory or the loop could not be created
+ *			 Not NULL - The new context, freed with xbee_destroy
+ */
+struct xbee * xbee_create( struct xbee_loop * );
+
+/* @breif Closes the xbee's port and frees the context
+ *
+ * @param struct xbee * xbee: The context returned by xbee_create
+ */
+void xbee_destroy( struct xbee * );
+
+/* @breif Gives the descriptor of the xbee's open port
+ *
+ * Useful to hand the port to other modules, like a transmit queue.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :	   -1 - The port is not open
+ *			 Not Negative - The port descriptor
+ */
+int get_port_descriptor( struct xbee * );
+
+/* @breif Gives the counters and latency histograms of the xbee
+ *
+ * They may be read with xbee_stats_snapshot from any thread, also while
+ * another thread uses the xbee. See xbee_stats.h.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		The xbee's statistics, valid until xbee_destroy
+ */
+struct xbee_stats * get_xbee_stats( struct xbee * );
+
 /* @breif Initializes and opens the provided serial port
  *
  * Header files needed: signal.h
@@ -67,6 +177,7 @@ fd_set readfs;						//A set of files descriptors for the select system call to c
  *						termios.h
  *						sys/time.h
  *
+ * @param struct xbee * xbee: The xbee to use
  * @param char * port: The complete name of the port to be opened
  *
  * @return :		0 - success
@@ -76,42 +187,207 @@ fd_set readfs;						//A set of files descriptors for the select system call to c
  *					4 - Failed to clear termios struct
  *					5 - Error while flushing read data
  *					6 - Failed to activate the port 
+ *					7 - Failed to register the port with the event loop
  *			 Not Zero - Error
  */
-int init_port( char * );
+int init_port( struct xbee *, char * );
 
-/* @breif Writes the given data to the initialized port
+/* @breif Initializes and opens the provided serial port at the given baud rate
  *
- * Header files needed: unistd.h
+ * Same as init_port, which opens the port at DEFAULT_BAUD_RATE.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * port: The complete name of the port to be opened
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
+ *						 from 1200 to 230400
+ *
+ * @return :		0 - success
+ *				  1-7 - See init_port
+ *					8 - The baud rate is not supported
+ *			 Not Zero - Error
+ */
+int init_port_baud( struct xbee *, char *, int );
+
+/* @breif Changes the baud rate of the open port, not of the xbee
+ *
+ * Waits for pending output to be sent first and drops unread input, which was
+ * received at the old rate.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
+ *
+ * @return :		0 - Success
+ *					1 - The baud rate is not supported
+ *					2 - Failed to apply the new settings
+ *			 Not Zero - Error
+ */
+int set_port_baud_rate( struct xbee *, int );
+
+/* @breif Chooses between low latency and high throughput when reading
+ *
+ * init_port starts in PORT_LOW_LATENCY, which wakes the library for every
+ * byte and sets the driver's ASYNC_LOW_LATENCY flag where supported.
+ * PORT_THROUGHPUT waits until THROUGHPUT_VMIN bytes are waiting, or
+ * THROUGHPUT_WAIT_MS have passed, so bursts of data cost fewer wakeups and
+ * reads at the price of up to THROUGHPUT_WAIT_MS of extra latency.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int profile: PORT_LOW_LATENCY or PORT_THROUGHPUT
+ *
+ * @return :		0 - Success
+ *					1 - Unknown profile
+ *					2 - Failed to apply the new settings
+ *			 Not Zero - Error
+ */
+int set_port_profile( struct xbee *, int );
+
+/* @breif Reads the baud rate the port is set to
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		Bits per second
+ */
+int get_port_baud_rate( struct xbee * );
+
+/* @breif Moves the xbee and the port to a new baud rate
+ *
+ * The xbee is told the new rate with ATBD, which it starts using on ATAC, then
+ * the port follows and the link is checked by reading ATBD back. When the xbee
+ * does not answer at the new rate the port goes back to the old rate and, if
+ * the xbee answers there, ATBD is restored too. The rate is not written to
+ * the xbee's flash, use ATWR for that.
+ *
+ * Only works in transparent mode.
+ *
+ * @AT Command: +++, ATBD, ATAC, ATBD
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int baud_rate: Bits per second, one of the rates the xbee supports
+ *
+ * @return :		0 - Success, the xbee and the port run at baud_rate
+ *				   -7 - The baud rate is not supported
+ *				   -8 - The link did not work at the new rate, both sides are
+ *						back at the old rate
+ *				   -9 - The link did not work at either rate
+ *			 Not Zero - The error returned by set_at
+ */
+int negotiate_baud_rate( struct xbee *, int );
+
+/* @breif Writes the given string to the initialized port
+ *
+ * Header files needed: string.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The string to write to the port, without its '\0'
+ *
+ * @return :		0 - success
+ *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_port( struct xbee *, char * );
+
+/* @breif Writes length bytes, which may include zero bytes, to the port
+ *
+ * Header files needed: sys/uio.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const void * data: The bytes to write
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - success
+ *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_port_length( struct xbee *, const void *, size_t );
+
+/* @breif Writes several buffers to the port with as few system calls as possible
+ *
+ * The buffers go out back to back through writev, so a header and its payload
+ * do not have to be copied together first. A short write resumes where it
+ * stopped and EAGAIN waits for the port to become writable, until
+ * WRITE_TIMEOUT_MS has passed.
  *
- * @param char * buffer: The data to write to the port
+ * Header files needed: sys/uio.h
+ *						poll.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const struct iovec * iov: The buffers to write, not modified
+ * @param int count: Number of buffers, at most IOV_MAX
  *
  * @return :		0 - success
  *					1 - Error occured when writing to the port
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_port_vector( struct xbee *, const struct iovec *, int );
+
+/* @breif Computes a deadline the given number of milliseconds from now
+ *
+ * Deadlines are measured on CLOCK_MONOTONIC so changes to the wall clock do
+ * not shorten or extend them.
+ *
+ * Header files needed: time.h
+ *
+ * @param struct timespec * deadline: The deadline is stored here
+ * @param int milliseconds: How far in the future the deadline is
+ *
+ * @return :		0 - Success
+ *					1 - Failed to read the clock
+ *			 Not Zero - Error
+ */
+int deadline_after( struct timespec *, int );
+
+/* @breif Reads one '\r' terminated line, giving up at the deadline
+ *
+ * Sleeps in the kernel until the port has data or the deadline passes, it
+ * does not wake up periodically while the port is quiet.
+ *
+ * Header files needed: time.h
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The line, without its '\r', is stored here as a
+ *						 string. Must hold MAX_BUFFER_SIZE characters.
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a whole line arrived
  *			 Not Zero - Error
  */
-int write_port( char * );
+int read_port_until( struct xbee *, char *, const struct timespec * );
 
-/* @breif Reads one byte from the initialized port and stores the byte
- *		  at the end of the buffer provided
+/* @breif Reads one '\r' terminated line from the initialized port
+ *
+ * Everything the port has available is pulled into the receive ring buffer
+ * with a single read, so bytes following the terminator are kept for the
+ * next call instead of being lost.
+ *
+ * The port is registered with the library's event loop by init_port, so
+ * waiting for data does not rebuild a descriptor set on every pass.
  *
  * Header files needed: unistd.h
+ *						sys/uio.h
  *
- * @param char rx : Character read from the port will be stored here
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The line, without its '\r', is stored here as a
+ *						 string. Must hold MAX_BUFFER_SIZE characters; longer
+ *						 lines are split.
  *
  * @return :		0 - Success
- *					1 - Successfully read all data from port
- *			 Not Zero - All data has been received
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - No line arrived within READ_TIMEOUT_MS
+ *			 Not Zero - Error
  */
-int read_port( int [], char * );
+int read_port( struct xbee *, char * );
 
-/* @breif Use the system call select to check each port for readiness to be read
+/* @breif Use the system call poll to check each port for readiness to be read
  *
- * Header files needed: sys/time.h
- *						sys/types.h
- *						unistd.h
- *							or
- *						sys/select.h
+ * The library itself waits on the port through xbee_loop.h; this is kept for
+ * programs that want to check a set of descriptors once.
+ *
+ * Header files needed: poll.h
  *
  * @param count: The number of file descriptors provided
  * @param fds: An array of file descriptors to be monitored
@@ -125,34 +401,307 @@ int check_descriptors( int, int [] );
  *
  * @AT Command: +++
  *
+ * @param struct xbee * xbee: The xbee to use
+ *
  * @return :		0 - success
  *				   -1 - Error writing to the port
+ *				   -2 - Error reading from the port
+ *				   -3 - The xbee did not answer within COMMAND_MODE_TIMEOUT_MS
  *			 Not Zero - Error
  */
-int enter_command_mode( void );
+int enter_command_mode( struct xbee * );
 
 /* @breif Communicates with the xbee and takes it out of command mode
  *
  * @AT Command: ATCN
  *
+ * @param struct xbee * xbee: The xbee to use
+ *
  * @return :		0 - Success
  *				   -1 - Error writing to the port
+ *				   -2 - Error reading from the port
+ *				   -3 - The xbee did not answer within READ_TIMEOUT_MS
  * 			 Not Zero - Error
  */
-int exit_command_mode( void );
+int exit_command_mode( struct xbee * );
 
 /* @breif Runs the an AT command that will return the xbees IP address
+ *
+ * The address is answered from the AT parameter cache while it is fresh.
  *
  * @AT Command: ATMY
  *
+ * @param struct xbee * xbee: The xbee to use
  * @param char * buffer: IP address will be stored here
  *
  * @return :		0 - Success
  *				   -1 - Error when entering command mode
  *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
  * 			 Not Zero - Error
  */
-int get_ip( char * );
-//int send_at( char *, char * );
+int get_ip( struct xbee *, char * );
+
+/* @breif Reads several AT parameters in a single command mode session
+ *
+ * The parameters are chained with commas into as few commands as possible,
+ * e.g. "ATMY,MK,GW,ID\r", and the xbee answers each one on its own line. At
+ * most one "+++" is paid no matter how many parameters are read, none when a
+ * command mode session is still open(see at_session_open). The session is
+ * closed when reading fails, the xbee may have been left in any state.
+ *
+ * @AT Command: +++, AT<cmd>[,<cmd>...]
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * commands[]: The parameters to read without the "AT", e.g. "MY"
+ * @param int count: Number of parameters, at most MAX_AT_BATCH
+ * @param char results[][MAX_BUFFER_SIZE]: results[i] receives the answer to
+ *										   commands[i], "ERROR" if the xbee
+ *										   rejected it
+ *
+ * @return :		0 - Success
+ *				   -1 - Error when entering command mode
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -5 - Too many parameters or a parameter is too long
+ * 			 Not Zero - Error
+ */
+int query_at_batch( struct xbee *, char * [], int, char [][MAX_BUFFER_SIZE] );
+
+/* @breif Makes sure the xbee is in command mode, reusing a live session
+ *
+ * The library keeps track of whether the xbee is in command mode and when its
+ * CT timer will drop it out again. "+++" and its guard times are only paid
+ * when the session has lapsed, so back to back AT operations share one.
+ *
+ * @AT Command: +++ (only when the session has lapsed)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by enter_command_mode
+ */
+int at_session_open( struct xbee * );
+
+/* @breif Takes the xbee out of command mode if a session is open
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		0 - Success or no session was open
+ *			 Not Zero - The error returned by exit_command_mode
+ */
+int at_session_close( struct xbee * );
+
+/* @breif Tells the library the xbee's command mode timeout
+ *
+ * Must match the xbee's ATCT value, which is in units of 100 ms. The default
+ * is DEFAULT_COMMAND_TIMEOUT_MS.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int milliseconds: The command mode timeout in milliseconds
+ */
+void set_command_timeout( struct xbee *, int );
+
+/* @breif Writes data to be sent over the radio
+ *
+ * AT operations leave the xbee in command mode. Data written in command mode
+ * would be taken as AT commands, so an open session is closed with ATCN first.
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The data to send
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - Error when leaving command mode
+ *			 Not Zero - Error
+ */
+int write_data( struct xbee *, char * );
+
+/* @breif Writes binary data, which may include zero bytes, to be sent over the radio
+ *
+ * An open command mode session is closed with ATCN first.
+ *
+ * @AT Command: ATCN (only when a session is open)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const void * data: The bytes to send
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - Error when leaving command mode
+ *	    WRITE_TIMEOUT - The port did not take the data within WRITE_TIMEOUT_MS
+ *			 Not Zero - Error
+ */
+int write_data_length( struct xbee *, const void *, size_t );
+
+/* @breif Reads an AT parameter, answering from the cache when possible
+ *
+ * Values read by get_at or query_at_batch are cached for the parameter's TTL.
+ * Parameters that change on their own(DB, AI, TP, %V, EA, EC) are not cached
+ * unless set_at_cache_ttl gives them a TTL.
+ *
+ * @AT Command: AT<command> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "MY"
+ * @param char * value: The parameter's value is stored here. Must hold
+ *						MAX_BUFFER_SIZE characters.
+ * @param int flags: AT_CACHE_REFRESH to ignore the cached value
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by query_at_batch
+ */
+int get_at( struct xbee *, char *, char *, int );
+
+/* @breif Sets an AT parameter and drops the cached values it affects
+ *
+ * Setting ATRE drops every cached value. Setting ATCT also updates the
+ * command mode timeout used by the session manager.
+ *
+ * @AT Command: AT<command><value>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "ID"
+ * @param char * value: The new value as the xbee expects it, e.g. "3332"
+ *
+ * @return :		0 - Success
+ *				   -1 - Error when entering command mode
+ *				   -2 - Error writing to the port
+ *				   -3 - Error reading from the port
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -5 - The command is too long
+ *				   -6 - The xbee rejected the value
+ * 			 Not Zero - Error
+ */
+int set_at( struct xbee *, char *, char * );
+
+/* @breif Sets how long the value of an AT parameter is cached
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter, e.g. "ID"
+ * @param int ttl_ms: Milliseconds the value is trusted, 0 disables caching
+ */
+void set_at_cache_ttl( struct xbee *, char *, int );
+
+/* @breif Drops cached AT parameter values
+ *
+ * Needed when something other than this library changes the xbee's settings.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * command: The two letter parameter to drop, NULL drops all
+ */
+void invalidate_at_cache( struct xbee *, char * );
+
+/* @breif Reads the xbee's subnet mask
+ *
+ * @AT Command: ATMK (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The subnet mask is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_mask( struct xbee *, char * );
+
+/* @breif Reads the xbee's gateway address
+ *
+ * @AT Command: ATGW (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The gateway address is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_gateway( struct xbee *, char * );
+
+/* @breif Reads the xbee's network ID(SSID or PAN ID depending on the module)
+ *
+ * @AT Command: ATID (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param char * buffer: The network ID is stored here
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error returned by get_at
+ */
+int get_network_id( struct xbee *, char * );
+/* @breif Switches the xbee between transparent and API mode
+ *
+ * From transparent mode ATAP is set in command mode, and the new mode takes
+ * effect when command mode is left, so the session is closed before returning.
+ * From API mode ATAP is sent as an API AT command frame.
+ *
+ * @AT Command: ATAP, ATCN
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int mode: XBEE_TRANSPARENT_MODE, XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ *
+ * @return :		0 - Success
+ *				   -2 - Error writing the API frame
+ *				   -3 - Error reading the API response
+ *				   -4 - The xbee did not answer within READ_TIMEOUT_MS
+ *				   -6 - The xbee rejected the mode
+ *				   -7 - Unknown mode
+ *			 Not Zero - The error returned by set_at or at_session_close
+ */
+int set_api_mode( struct xbee *, int );
+
+/* @breif Reads whatever bytes are available, giving up at the deadline
+ *
+ * Bytes already in the receive ring buffer are handed out first.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param uint8_t * buffer: The bytes are stored here
+ * @param int size: Size of buffer
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error occured when reading from the port
+ *					0 - The deadline passed before any byte arrived
+ *			 Not Zero - Number of bytes stored in buffer
+ */
+int read_port_raw( struct xbee *, uint8_t *, int, const struct timespec * );
+
+/* @breif Encodes frame data for the current API mode and writes it to the port
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param const uint8_t * data: The frame data, data[0] is the API identifier
+ * @param int length: Number of bytes in data
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when writing to the port
+ *					2 - The xbee is not in API mode or the data is too long
+ *			 Not Zero - Error
+ */
+int write_frame( struct xbee *, const uint8_t *, int );
+
+/* @breif Reads from the port until at least one whole frame has been decoded
+ *
+ * Bytes following the last complete frame stay in the decoder for the next
+ * call.
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param struct xbee_frame_decoder * decoder: Decoder set up for the current
+ *											   API mode
+ * @param xbee_frame_callback callback: Called for every complete frame
+ * @param void * arg: Passed to callback
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a whole frame arrived
+ *			 Not Zero - Error
+ */
+int read_frames( struct xbee *, struct xbee_frame_decoder *, xbee_frame_callback, void *,
+				 const struct timespec * );
+
 //---------------End Function Prototypes-------------------------------------------
 #endif //Include Gaurd End
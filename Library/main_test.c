@@ -27,6 +27,8 @@ void display( void )
 			"   2. Enter Command Mode\n"\
 			"   3. Exit Command Mode\n"\
 			"   4. Get IP Address\n"\
+			"   5. Get Node Status\n"\
+			"   6. Change Baud Rate\n"\
 			"   0. Exit program\n"\
 			"\nSelect a number: " );
 }
@@ -37,12 +39,20 @@ int main( int argc, char * argv[] )
 	int result;
 	char * port;
 	char * buffer;
+	struct xbee * xbee;
 
 	buffer = calloc( MAX_BUFFER_SIZE, sizeof(char) );
+	xbee = xbee_create( NULL );
+
+	if( xbee == NULL )
+	{
+		printf( "\nFailed to create the xbee context\n" );
+		exit( 1 );
+	}
 
 	printf( "\nTest program for libxbee library version 1.0\n" );
 
-	init_port( "" );
+	init_port( xbee, "" );
 	
 	display( );
 	
@@ -52,6 +62,7 @@ int main( int argc, char * argv[] )
 		{
 			case 0:
 				printf( "\nGoodbye\n\n" );
+				xbee_destroy( xbee );
 				exit( 0 );
 
 				break;
@@ -59,14 +70,14 @@ int main( int argc, char * argv[] )
 				printf( "\nEnter port name: " );
 				scanf( "%s", port );
 
-				result = init_port( port );
+				result = init_port( xbee, port );
 
 				if( result > 0 )
 					printf( "\nFailed to due Error: %d\n", result );
 
 				break;
 			case 2:				
-				result = enter_command_mode( );
+				result = enter_command_mode( xbee );
 
 				if( result == 0 )
 					printf( "\nSuccessfully entered command mode.\n" );
@@ -75,7 +86,7 @@ int main( int argc, char * argv[] )
 
 				break;
 			case 3:
-				result = exit_command_mode( );
+				result = exit_command_mode( xbee );
 
 				if( result == 0 )
 					printf( "\nSuccessfully exited command mode.\n" );
@@ -84,7 +95,7 @@ int main( int argc, char * argv[] )
 
 				break;
 			case 4:
-				result = get_ip( buffer );
+				result = get_ip( xbee, buffer );
 				
 				if( result == 0 )
 				{
@@ -95,6 +106,47 @@ int main( int argc, char * argv[] )
 					printf( "\nResult = %d\n", result );
 
 				break;
+			case 5:
+			{
+				char * status[] = { "MY", "MK", "GW", "ID", "DB" };
+				char results[5][MAX_BUFFER_SIZE];
+				int index;
+
+				result = query_at_batch( xbee, status, 5, results );
+
+				if( result == 0 )
+				{
+					for( index = 0; index < 5; index++ )
+						printf( "\nAT%s: %s", status[index], results[index] );
+
+					printf( "\n" );
+				}
+				else
+					printf( "\nResult = %d\n", result );
+
+				break;
+			}
+			case 6:
+			{
+				int rate;
+
+				printf( "\nEnter baud rate: " );
+
+				if( scanf( "%d", &rate ) != 1 )
+				{
+					printf( "\nNot a baud rate\n" );
+					break;
+				}
+
+				result = negotiate_baud_rate( xbee, rate );
+
+				if( result == 0 )
+					printf( "\nNow running at %d baud.\n", get_port_baud_rate( xbee ) );
+				else
+					printf( "\nResult = %d\n", result );
+
+				break;
+			}
 			default:
 				printf( "\nInvalid Choice. Please try again.\n" );
 
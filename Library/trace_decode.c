@@ -0,0 +1,222 @@
+/** @file trace_decode.c
+ ** @brief Prints a binary trace written by xbee_trace
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program reads a trace file and prints one event per line:
+ *				the time since the trace started in nanoseconds, the recording
+ *				thread, the port, the event, its value and the bytes it kept.
+ *				Events of all threads are merged by time.
+ *
+ *					+0.002341170  T1  fd 5   LINE          12 "192.168.1.10"
+ *
+ *				Usage: trace_decode [-r] file
+ *					-r	Print the records in file order, without sorting
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_trace.h"
+
+//A record and where it was in the file, so equal times keep their order
+struct decoded_record
+{
+	struct xbee_trace_record record;
+	unsigned long position;
+};
+
+/* @breif Orders records by time, then by position in the file
+ */
+int compare_records( const void * a, const void * b )
+{
+	const struct decoded_record * first = a;
+	const struct decoded_record * second = b;
+
+	if( first->record.time_ns != second->record.time_ns )
+		return ( first->record.time_ns > second->record.time_ns ) ? 1 : -1;
+
+	return ( first->position > second->position ) - ( first->position < second->position );
+}
+
+/* @breif Prints the bytes a record kept, escaping what is not printable
+ *
+ * @param const struct xbee_trace_record * record: The record
+ */
+void print_data( const struct xbee_trace_record * record )
+{
+	int index;
+	int length = record->length;
+
+	if( length > XBEE_TRACE_DATA )
+		length = XBEE_TRACE_DATA;
+
+	printf( " \"" );
+
+	for( index = 0; index < length; index++ )
+	{
+		if( record->data[index] == '\r' )
+			printf( "\\r" );
+		else if( record->data[index] == '\n' )
+			printf( "\\n" );
+		else if( record->data[index] == '"' || record->data[index] == '\\' )
+			printf( "\\%c", record->data[index] );
+		else if( record->data[index] >= 0x20 && record->data[index] < 0x7F )
+			printf( "%c", record->data[index] );
+		else
+			printf( "\\x%02X", record->data[index] );
+	}
+
+	printf( "\"" );
+
+	//Where value counts the bytes, show that the record only kept their start
+	if( ( record->event == XBEE_TRACE_BYTES_IN || record->event == XBEE_TRACE_BYTES_OUT ||
+		  record->event == XBEE_TRACE_LINE || record->event == XBEE_TRACE_FRAME ) &&
+		record->value > (uint32_t)length )
+	{
+		printf( "..." );
+	}
+}
+
+/* @breif Prints one record
+ *
+ * @param const struct xbee_trace_record * record: The record
+ * @param uint64_t start_ns: CLOCK_MONOTONIC when the trace started
+ */
+void print_record( const struct xbee_trace_record * record, uint64_t start_ns )
+{
+	int64_t offset = (int64_t)( record->time_ns - start_ns );
+	const char * sign = ( offset < 0 ) ? "-" : "+";
+
+	if( offset < 0 )
+		offset = -offset;
+
+	printf( "%s%lld.%09lld  T%-3u",
+			sign,
+			(long long)( offset / 1000000000LL ),
+			(long long)( offset % 1000000000LL ),
+			record->thread );
+
+	if( record->port >= 0 )
+		printf( " fd %-4d", record->port );
+	else
+		printf( "        " );
+
+	printf( " %-13s %u", xbee_trace_event_name( record->event ), record->value );
+
+	if( record->length > 0 )
+		print_data( record );
+
+	printf( "\n" );
+}
+
+int main( int argc, char * argv[] )
+{
+	struct xbee_trace_header header;
+	struct decoded_record * records = NULL;
+	unsigned long count = 0;
+	unsigned long size = 0;
+	unsigned long index;
+	char started[64];
+	time_t seconds;
+	FILE * file;
+	int sort = TRUE;
+	int option;
+
+	while( ( option = getopt( argc, argv, "r" ) ) != -1 )
+	{
+		switch( option )
+		{
+			case 'r':
+				sort = FALSE;
+				break;
+
+			default:
+				printf( "Usage: %s [-r] file\n", argv[0] );
+				exit( 1 );
+		}
+	}
+
+	if( optind >= argc )
+	{
+		printf( "Usage: %s [-r] file\n", argv[0] );
+		exit( 1 );
+	}
+
+	file = fopen( argv[optind], "rb" );
+
+	if( file == NULL )
+	{
+		printf( "Opening %s failed\n", argv[optind] );
+		exit( 1 );
+	}
+
+	if( fread( &header, sizeof(header), 1, file ) != 1 ||
+		memcmp( header.magic, XBEE_TRACE_MAGIC, sizeof(XBEE_TRACE_MAGIC) ) != 0 )
+	{
+		printf( "%s is not a trace file\n", argv[optind] );
+		exit( 1 );
+	}
+
+	if( header.version != XBEE_TRACE_VERSION || header.record_size != sizeof(struct xbee_trace_record) )
+	{
+		printf( "%s has version %u with %u byte records, this program reads version %d\n",
+				argv[optind],
+				header.version,
+				header.record_size,
+				XBEE_TRACE_VERSION );
+		exit( 1 );
+	}
+
+	for( ;; )
+	{
+		if( count == size )
+		{
+			size = ( size == 0 ) ? 4096 : size * 2;
+			records = realloc( records, size * sizeof(*records) );
+
+			if( records == NULL )
+			{
+				printf( "Out of memory after %lu records\n", count );
+				exit( 1 );
+			}
+		}
+
+		if( fread( &records[count].record, sizeof(struct xbee_trace_record), 1, file ) != 1 )
+			break;
+
+		records[count].position = count;
+		count++;
+	}
+
+	fclose( file );
+
+	if( sort )
+		qsort( records, count, sizeof(*records), compare_records );
+
+	seconds = header.realtime_ns / 1000000000ULL;
+	strftime( started, sizeof(started), "%Y-%m-%d %H:%M:%S", localtime( &seconds ) );
+
+	printf( "Trace started %s.%09llu, %lu records\n",
+			started,
+			(unsigned long long)( header.realtime_ns % 1000000000ULL ),
+			count );
+
+	for( index = 0; index < count; index++ )
+		print_record( &records[index].record, header.monotonic_ns );
+
+	free( records );
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+/** @file transfer.c
+ ** @brief Sends and receives files over a transparent xbee link
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This program moves files between two xbees in transparent mode,
+ *				one end sending and the other receiving(see xbee_transfer.h).
+ *				When a transfer is cut short, running the same send again
+ *				resumes it from the last chunk the receiver acknowledged.
+ *				Every transfer ends with a report of its throughput:
+ *
+ *					firmware.bin: 65536 bytes, 65536 sent in 71.3 s, 919 bytes/s,
+ *					chunk 1375, 48 chunks, 0 retransmissions, 0 timeouts
+ *
+ *				Usage: transfer [-b baud rate] [-c chunk] [-w window] [-t trace file] send port file...
+ *				       transfer [-b baud rate] [-k] [-t trace file] receive port directory
+ *					-c	Bytes per chunk, read from the xbee's ATNP by default
+ *					-w	Chunks in flight, 4 by default
+ *					-k	Keep receiving files until interrupted
+ *					-t	Records a trace of the traffic, see trace_decode
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libxbee.h"
+#include "xbee_trace.h"
+#include "xbee_transfer.h"
+
+/* @breif Prints the usage and exits
+ *
+ * @param const char * program: argv[0]
+ */
+void usage( const char * program )
+{
+	printf( "Usage: %s [-b baud rate] [-c chunk] [-w window] [-t trace file] send port file...\n", program );
+	printf( "       %s [-b baud rate] [-k] [-t trace file] receive port directory\n", program );
+	exit( 1 );
+}
+
+/* @breif Prints the report of a transfer
+ *
+ * @param const struct xbee_transfer_report * report: The report
+ */
+void print_report( const struct xbee_transfer_report * report )
+{
+	printf( "%s: %u bytes, %u %s in %.1f s, %.0f bytes/s, chunk %d, %lu chunks, %lu retransmissions, %lu timeouts\n",
+			report->name,
+			report->size,
+			report->transferred - report->resumed_at,
+			( report->resumed_at > 0 ) ? "resumed" : "moved",
+			report->elapsed_ns / 1e9,
+			report->bytes_per_second,
+			report->chunk,
+			report->chunks,
+			report->retransmissions,
+			report->timeouts );
+	fflush( stdout );
+}
+
+int main( int argc, char * argv[] )
+{
+	struct xbee_transfer_report report;
+	struct xbee * xbee;
+	char * trace = NULL;
+	int baud_rate = DEFAULT_BAUD_RATE;
+	int chunk = 0;
+	int window = 0;
+	int keep = FALSE;
+	int failures = 0;
+	int option;
+	int result;
+	int index;
+
+	while( ( option = getopt( argc, argv, "b:c:w:kt:" ) ) != -1 )
+	{
+		switch( option )
+		{
+			case 'b':
+				baud_rate = atoi( optarg );
+				break;
+
+			case 'c':
+				chunk = atoi( optarg );
+				break;
+
+			case 'w':
+				window = atoi( optarg );
+				break;
+
+			case 'k':
+				keep = TRUE;
+				break;
+
+			case 't':
+				trace = optarg;
+				break;
+
+			default:
+				usage( argv[0] );
+		}
+	}
+
+	if( argc - optind < 3 )
+		usage( argv[0] );
+
+	if( trace != NULL && xbee_trace_start( trace ) != 0 )
+		exit( 1 );
+
+	xbee = xbee_create( NULL );
+
+	if( xbee == NULL || init_port_baud( xbee, argv[optind + 1], baud_rate ) != 0 )
+	{
+		printf( "\nOpening %s failed\n", argv[optind + 1] );
+		exit( 1 );
+	}
+
+	if( strcmp( argv[optind], "send" ) == 0 )
+	{
+		for( index = optind + 2; index < argc; index++ )
+		{
+			result = xbee_transfer_send_file( xbee, argv[index], chunk, window, &report );
+
+			if( report.name[0] != '\0' )
+				print_report( &report );
+
+			if( result != 0 )
+			{
+				printf( "Sending %s failed with error[%d]\n", argv[index], result );
+				failures++;
+			}
+		}
+	}
+	else if( strcmp( argv[optind], "receive" ) == 0 )
+	{
+		do
+		{
+			result = xbee_transfer_receive( xbee, argv[optind + 2], -1, &report );
+
+			if( report.name[0] != '\0' )
+				print_report( &report );
+
+			if( result != 0 )
+			{
+				printf( "Receiving failed with error[%d]\n", result );
+				failures++;
+			}
+		} while( keep );
+	}
+	else
+	{
+		usage( argv[0] );
+	}
+
+	xbee_destroy( xbee );
+	xbee_trace_stop( );
+
+	return ( failures > 0 ) ? 1 : 0;
+}
@@ -0,0 +1,653 @@
+/** @file xbee_arq.c
+ ** @brief Implementation of the xbee_arq.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_arq.h file.
+ *
+ *				Sequence numbers wrap at 65536, which XBEE_ARQ_MAX_WINDOW
+ *				divides, so a message's slot is its sequence number modulo
+ *				XBEE_ARQ_MAX_WINDOW whatever the window.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "xbee_arq.h"
+#include "xbee_stats.h"
+
+#define NS_PER_MS 1000000ULL
+
+
+/* @breif Tells whether sequence number a comes before b, across the wrap
+ */
+static int before( uint16_t a, uint16_t b )
+{
+	return (int16_t)( a - b ) < 0;
+}//----- End ----- before( uint16_t, uint16_t )---------------------------
+
+
+/* @breif Stores a number most significant byte first
+ */
+static void put_u16( uint8_t * bytes, uint16_t value )
+{
+	bytes[0] = value >> 8;
+	bytes[1] = value;
+}//----- End ----- put_u16( uint8_t *, uint16_t )-------------------------
+
+
+/* @breif Reads a number stored most significant byte first
+ */
+static uint16_t get_u16( const uint8_t * bytes )
+{
+	return ( bytes[0] << 8 ) | bytes[1];
+}//----- End ----- get_u16( const uint8_t * )-----------------------------
+
+
+/* @breif Converts nanoseconds of CLOCK_MONOTONIC to a deadline
+ */
+static void deadline_from_ns( struct timespec * deadline, uint64_t nanoseconds )
+{
+	deadline->tv_sec = nanoseconds / 1000000000ULL;
+	deadline->tv_nsec = nanoseconds % 1000000000ULL;
+}//----- End ----- deadline_from_ns( struct timespec *, uint64_t )--------
+
+
+/* @breif Prepares a message layer on an xbee
+ *
+ * @param struct xbee_arq * arq: The layer to initialize
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param int window: Messages in flight, 0 for XBEE_ARQ_DEFAULT_WINDOW
+ *
+ * @return :		0 - Success
+ *					1 - The window is larger than XBEE_ARQ_MAX_WINDOW
+ *					2 - Out of memory
+ *			 Not Zero - Error
+ */
+int xbee_arq_init( struct xbee_arq * arq, struct xbee * xbee, int window )
+{
+	int index;
+
+	if( window == 0 )
+		window = XBEE_ARQ_DEFAULT_WINDOW;
+
+	if( window < 1 || window > XBEE_ARQ_MAX_WINDOW )
+		return 1;
+
+	memset( arq, 0, sizeof(*arq) );
+	arq->buffers = malloc( 2 * XBEE_ARQ_MAX_WINDOW * XBEE_ARQ_MAX_MESSAGE );
+
+	if( arq->buffers == NULL )
+		return 2;
+
+	for( index = 0; index < XBEE_ARQ_MAX_WINDOW; index++ )
+	{
+		arq->sending[index].data = arq->buffers + index * XBEE_ARQ_MAX_MESSAGE;
+		arq->receiving[index].data = arq->buffers + ( XBEE_ARQ_MAX_WINDOW + index ) * XBEE_ARQ_MAX_MESSAGE;
+	}//End ----- for( index < XBEE_ARQ_MAX_WINDOW ) ------------------
+
+	xbee_link_init( &arq->link, xbee );
+	arq->window = window;
+	arq->send_limit = window;		//The peer's window, until it says otherwise
+	arq->rto_ns = XBEE_ARQ_INITIAL_RTO_MS * NS_PER_MS;
+
+	return 0;
+}//----- End ----- xbee_arq_init( struct xbee_arq *, struct xbee *, int )--
+
+
+/* @breif Frees what xbee_arq_init allocated
+ *
+ * @param struct xbee_arq * arq: The layer
+ */
+void xbee_arq_close( struct xbee_arq * arq )
+{
+	free( arq->buffers );
+	arq->buffers = NULL;
+}//----- End ----- xbee_arq_close( struct xbee_arq * )-------------------
+
+
+/* @breif Writes the DATA or COMPRESSED packet of a message in flight
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param uint16_t sequence: The message's sequence number
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+static int transmit( struct xbee_arq * arq, uint16_t sequence )
+{
+	struct xbee_arq_slot * slot = &arq->sending[sequence % XBEE_ARQ_MAX_WINDOW];
+	uint8_t packet[XBEE_ARQ_DATA_HEADER + XBEE_ARQ_MAX_MESSAGE];
+
+	packet[0] = slot->compressed ? XBEE_ARQ_COMPRESSED : XBEE_ARQ_DATA;
+	put_u16( packet + 1, sequence );
+	memcpy( packet + XBEE_ARQ_DATA_HEADER, slot->data, slot->length );
+
+	return xbee_link_send( &arq->link, packet, XBEE_ARQ_DATA_HEADER + slot->length );
+}//----- End ----- transmit( struct xbee_arq *, uint16_t )---------------
+
+
+/* @breif Tells the peer what has been received and how much room is left
+ *
+ * @param struct xbee_arq * arq: The layer
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+static int send_ack( struct xbee_arq * arq )
+{
+	uint8_t packet[XBEE_ARQ_ACK_LENGTH];
+	uint16_t expected = arq->receive_base;
+	uint16_t sequence;
+	uint32_t held = 0;
+	int bit;
+
+	//Everything before expected is held or handed out
+	while( (uint16_t)( expected - arq->receive_base ) < arq->window &&
+		   arq->receiving[expected % XBEE_ARQ_MAX_WINDOW].used )
+	{
+		expected++;
+	}//End ----- while( held in order ) -----------------------------
+
+	for( bit = 0; bit < 32; bit++ )
+	{
+		sequence = expected + 1 + bit;
+
+		if( (uint16_t)( sequence - arq->receive_base ) < arq->window &&
+			arq->receiving[sequence % XBEE_ARQ_MAX_WINDOW].used )
+		{
+			held |= 1UL << bit;
+		}//End ----- if( held ) -----------------------------------------
+	}//End ----- for( bit < 32 ) ------------------------------------
+
+	packet[0] = XBEE_ARQ_ACK;
+	put_u16( packet + 1, expected );
+	packet[3] = held >> 24;
+	packet[4] = held >> 16;
+	packet[5] = held >> 8;
+	packet[6] = held;
+	put_u16( packet + 7, arq->receive_base + arq->window );
+
+	return xbee_link_send( &arq->link, packet, sizeof(packet) );
+}//----- End ----- send_ack( struct xbee_arq * )-------------------------
+
+
+/* @breif Updates SRTT, RTTVAR and the RTO with a round trip time(RFC 6298)
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param uint64_t sample: The round trip time in nanoseconds
+ */
+static void measure( struct xbee_arq * arq, uint64_t sample )
+{
+	uint64_t difference;
+
+	if( arq->measured == FALSE )
+	{
+		arq->srtt_ns = sample;
+		arq->rttvar_ns = sample / 2;
+		arq->measured = TRUE;
+	}
+	else
+	{
+		difference = ( arq->srtt_ns > sample ) ? arq->srtt_ns - sample : sample - arq->srtt_ns;
+		arq->rttvar_ns = ( 3 * arq->rttvar_ns + difference ) / 4;
+		arq->srtt_ns = ( 7 * arq->srtt_ns + sample ) / 8;
+	}//End ----- if( first measurement ) ----------------------------
+
+	arq->rto_ns = arq->srtt_ns + 4 * arq->rttvar_ns;
+
+	if( arq->rto_ns < XBEE_ARQ_MIN_RTO_MS * NS_PER_MS )
+		arq->rto_ns = XBEE_ARQ_MIN_RTO_MS * NS_PER_MS;
+
+	if( arq->rto_ns > XBEE_ARQ_MAX_RTO_MS * NS_PER_MS )
+		arq->rto_ns = XBEE_ARQ_MAX_RTO_MS * NS_PER_MS;
+}//----- End ----- measure( struct xbee_arq *, uint64_t )----------------
+
+
+/* @breif Retires acknowledged messages and resends those the SACKs skip
+ *
+ * Only messages acknowledged on their first transmission are measured, the
+ * ACK of a retransmitted one may answer either copy(Karn's algorithm).
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const uint8_t * packet: The ACK
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+static int handle_ack( struct xbee_arq * arq, const uint8_t * packet )
+{
+	struct xbee_arq_slot * slot;
+	uint64_t now = xbee_stats_clock( );
+	uint16_t expected = get_u16( packet + 1 );
+	uint32_t held = ( (uint32_t)packet[3] << 24 ) | ( packet[4] << 16 ) | ( packet[5] << 8 ) | packet[6];
+	uint16_t limit = get_u16( packet + 7 );
+	uint16_t sequence;
+	int held_after = 0;
+	int bit;
+
+	//An ACK older than the last one, or for messages never sent
+	if( (uint16_t)( expected - arq->send_base ) > (uint16_t)( arq->send_next - arq->send_base ) )
+		return 0;
+
+	while( arq->send_base != expected )
+	{
+		slot = &arq->sending[arq->send_base % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->transmissions == 1 && slot->held == FALSE )
+			measure( arq, now - slot->sent_ns );
+
+		slot->used = FALSE;
+		arq->send_base++;
+	}//End ----- while( acknowledged ) ------------------------------
+
+	for( bit = 0; bit < 32; bit++ )
+	{
+		sequence = expected + 1 + bit;
+
+		if( !( held & ( 1UL << bit ) ) || !before( sequence, arq->send_next ) )
+			continue;
+
+		slot = &arq->sending[sequence % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->held == FALSE && slot->transmissions == 1 )
+			measure( arq, now - slot->sent_ns );
+
+		slot->held = TRUE;
+	}//End ----- for( bit < 32 ) ------------------------------------
+
+	//Newest first, so held_after counts the held messages after each one
+	for( sequence = arq->send_next; sequence != arq->send_base; )
+	{
+		slot = &arq->sending[--sequence % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->held )
+		{
+			held_after++;
+		}
+		else if( held_after >= XBEE_ARQ_SACK_THRESHOLD && slot->fast_retransmitted == FALSE )
+		{
+			if( transmit( arq, sequence ) != 0 )
+				return 1;
+
+			slot->fast_retransmitted = TRUE;
+			slot->transmissions++;
+			slot->expires_ns = now + arq->rto_ns;
+			arq->fast_retransmissions++;
+		}//End ----- if( held ) -----------------------------------------
+	}//End ----- for( messages in flight ) --------------------------
+
+	if( (uint16_t)( limit - arq->send_base ) <= XBEE_ARQ_MAX_WINDOW )
+		arq->send_limit = limit;
+
+	//A closed window is probed once an RTO passes without an ACK
+	arq->probe_ns = now + arq->rto_ns;
+
+	return 0;
+}//----- End ----- handle_ack( struct xbee_arq *, const uint8_t * )-----
+
+
+/* @breif Keeps a message received within the window and acknowledges it
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const uint8_t * packet: The DATA or COMPRESSED packet
+ * @param int length: Bytes in packet
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+static int handle_data( struct xbee_arq * arq, const uint8_t * packet, int length )
+{
+	uint16_t sequence = get_u16( packet + 1 );
+	struct xbee_arq_slot * slot = &arq->receiving[sequence % XBEE_ARQ_MAX_WINDOW];
+
+	if( (uint16_t)( sequence - arq->receive_base ) < arq->window )
+	{
+		if( slot->used == FALSE )
+		{
+			slot->length = length - XBEE_ARQ_DATA_HEADER;
+			slot->compressed = ( packet[0] == XBEE_ARQ_COMPRESSED );
+			memcpy( slot->data, packet + XBEE_ARQ_DATA_HEADER, slot->length );
+			slot->used = TRUE;
+		}
+		else
+		{
+			arq->duplicates++;
+		}//End ----- if( slot->used == FALSE ) --------------------------
+	}
+	else if( before( sequence, arq->receive_base ) )
+	{
+		arq->duplicates++;		//Our ACK was lost, the peer needs another
+	}//End ----- if( within the window ) ----------------------------
+
+	return send_ack( arq );
+}//----- End ----- handle_data( struct xbee_arq *, const uint8_t *, int )--
+
+
+/* @breif Waits for one packet or timer and handles it
+ *
+ * Messages whose timeout expired are sent again and the RTO is doubled. With
+ * probing, a closed window is probed every RTO.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ * @param int probing: TRUE while a message waits for room in the peer's window
+ *
+ * @return :	   -3 - A message ran out of transmissions
+ *				   -1 - Error reading from or writing to the port
+ *					0 - The deadline passed
+ *					1 - Something was handled, the caller checks again
+ */
+static int service( struct xbee_arq * arq, const struct timespec * deadline, int probing )
+{
+	struct xbee_arq_slot * slot;
+	struct timespec wake;
+	uint64_t now = xbee_stats_clock( );
+	uint64_t until = deadline->tv_sec * 1000000000ULL + deadline->tv_nsec;
+	uint16_t sequence;
+	int expired = FALSE;
+	int length;
+
+	if( arq->failed )
+		return -3;
+
+	for( sequence = arq->send_base; sequence != arq->send_next; sequence++ )
+	{
+		slot = &arq->sending[sequence % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->held == FALSE && slot->expires_ns <= now )
+			expired = TRUE;
+	}//End ----- for( messages in flight ) --------------------------
+
+	if( expired )
+	{
+		//Back off once for every message that timed out together
+		arq->rto_ns *= 2;
+
+		if( arq->rto_ns > XBEE_ARQ_MAX_RTO_MS * NS_PER_MS )
+			arq->rto_ns = XBEE_ARQ_MAX_RTO_MS * NS_PER_MS;
+
+		for( sequence = arq->send_base; sequence != arq->send_next; sequence++ )
+		{
+			slot = &arq->sending[sequence % XBEE_ARQ_MAX_WINDOW];
+
+			if( slot->held || slot->expires_ns > now )
+				continue;
+
+			if( slot->transmissions >= XBEE_ARQ_TRANSMISSIONS )
+			{
+				arq->failed = TRUE;
+				return -3;
+			}//End ----- if( out of transmissions ) -------------------------
+
+			if( transmit( arq, sequence ) != 0 )
+				return -1;
+
+			slot->transmissions++;
+			slot->expires_ns = now + arq->rto_ns;
+			arq->retransmissions++;
+		}//End ----- for( messages in flight ) --------------------------
+	}//End ----- if( expired ) --------------------------------------
+
+	if( probing && arq->send_base == arq->send_limit && arq->probe_ns <= now )
+	{
+		uint8_t probe = XBEE_ARQ_PROBE;
+
+		if( xbee_link_send( &arq->link, &probe, 1 ) != 0 )
+			return -1;
+
+		arq->probe_ns = now + arq->rto_ns;
+		arq->probes++;
+	}//End ----- if( the peer's window is closed ) ------------------
+
+	//Sleep until the first timer or the deadline
+	for( sequence = arq->send_base; sequence != arq->send_next; sequence++ )
+	{
+		slot = &arq->sending[sequence % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->held == FALSE && slot->expires_ns < until )
+			until = slot->expires_ns;
+	}//End ----- for( messages in flight ) --------------------------
+
+	if( probing && arq->send_base == arq->send_limit && arq->probe_ns < until )
+		until = arq->probe_ns;
+
+	deadline_from_ns( &wake, until );
+	length = xbee_link_receive( &arq->link, &wake );
+
+	if( length < 0 )
+		return -1;
+
+	if( length == 0 )
+		return ( xbee_stats_clock( ) >= deadline->tv_sec * 1000000000ULL + deadline->tv_nsec ) ? 0 : 1;
+
+	if( ( arq->link.packet[0] == XBEE_ARQ_DATA || arq->link.packet[0] == XBEE_ARQ_COMPRESSED ) &&
+		length > XBEE_ARQ_DATA_HEADER &&
+		length <= XBEE_ARQ_DATA_HEADER + XBEE_ARQ_MAX_MESSAGE )
+	{
+		if( handle_data( arq, arq->link.packet, length ) != 0 )
+			return -1;
+	}
+	else if( arq->link.packet[0] == XBEE_ARQ_ACK && length == XBEE_ARQ_ACK_LENGTH )
+	{
+		if( handle_ack( arq, arq->link.packet ) != 0 )
+			return -1;
+	}
+	else if( arq->link.packet[0] == XBEE_ARQ_PROBE )
+	{
+		if( send_ack( arq ) != 0 )
+			return -1;
+	}//End ----- if( packet type ) ----------------------------------
+
+	return 1;
+}//----- End ----- service( struct xbee_arq *, const struct timespec *, int )--
+
+
+/* @breif Compresses the messages sent from now on
+ *
+ * Compressed messages are decompressed with the dictionary of the receiving
+ * end, so both ends should call it with the same dictionary before any
+ * message is sent.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const struct xbee_compress * compress: The dictionary, kept until
+ *												 xbee_arq_close, NULL to stop
+ *												 compressing
+ */
+void xbee_arq_compress( struct xbee_arq * arq, const struct xbee_compress * compress )
+{
+	arq->compress = compress;
+}//----- End ----- xbee_arq_compress( struct xbee_arq *, const struct xbee_compress * )--
+
+
+/* @breif Sends a message
+ *
+ * Returns once the message is in flight. While the window is full it waits,
+ * receiving and retransmitting, until a message is acknowledged or the
+ * deadline passes.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const void * data: The message
+ * @param int length: Bytes in the message, from 1 to XBEE_ARQ_MAX_MESSAGE
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - The message is empty or too long
+ *					2 - The window stayed full until the deadline
+ *					3 - The peer stopped acknowledging, the layer is unusable
+ *					4 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_arq_send( struct xbee_arq * arq, const void * data, int length, const struct timespec * deadline )
+{
+	struct xbee_stats * stats = get_xbee_stats( arq->link.xbee );
+	struct xbee_arq_slot * slot;
+	uint64_t start;
+	int result;
+
+	if( length < 1 || length > XBEE_ARQ_MAX_MESSAGE )
+		return 1;
+
+	if( arq->failed )
+		return 3;
+
+	//Wait for room in our window and in the peer's
+	while( (uint16_t)( arq->send_next - arq->send_base ) >= arq->window ||
+		   !before( arq->send_next, arq->send_limit ) )
+	{
+		result = service( arq, deadline, TRUE );
+
+		if( result == 0 )
+			return 2;
+
+		if( result < 0 )
+			return ( result == -3 ) ? 3 : 4;
+	}//End ----- while( no room ) -----------------------------------
+
+	slot = &arq->sending[arq->send_next % XBEE_ARQ_MAX_WINDOW];
+	slot->length = 0;
+
+	if( arq->compress != NULL )
+	{
+		start = xbee_stats_clock( );
+		slot->length = xbee_compress_encode( arq->compress, data, length, slot->data, XBEE_ARQ_MAX_MESSAGE );
+		xbee_stats_record( stats, XBEE_HISTOGRAM_COMPRESS, xbee_stats_clock( ) - start );
+		xbee_stats_count( stats, XBEE_STAT_COMPRESS_IN, length );
+		xbee_stats_count( stats, XBEE_STAT_COMPRESS_OUT, slot->length ? slot->length : length );
+
+		if( slot->length == 0 )
+			xbee_stats_count( stats, XBEE_STAT_COMPRESS_RAW, 1 );
+	}//End ----- if( compressing ) ----------------------------------
+
+	slot->compressed = ( slot->length > 0 );
+
+	if( slot->compressed == FALSE )
+	{
+		memcpy( slot->data, data, length );
+		slot->length = length;
+	}//End ----- if( sent raw ) -------------------------------------
+
+	slot->used = TRUE;
+	slot->held = FALSE;
+	slot->fast_retransmitted = FALSE;
+	slot->transmissions = 1;
+	slot->sent_ns = xbee_stats_clock( );
+	slot->expires_ns = slot->sent_ns + arq->rto_ns;
+
+	if( transmit( arq, arq->send_next ) != 0 )
+		return 4;
+
+	arq->send_next++;
+	arq->sent++;
+
+	return 0;
+}//----- End ----- xbee_arq_send( struct xbee_arq *, const void *, int, const struct timespec * )--
+
+
+/* @breif Receives the next message in order
+ *
+ * Acknowledges and retransmits while it waits.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param void * buffer: The message is stored here
+ * @param int size: Size of buffer, a longer message is cut
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -3 - The peer stopped acknowledging, the layer is unusable
+ *				   -2 - A message could not be decompressed, the dictionaries
+ *						differ, it is dropped
+ *				   -1 - Error reading from or writing to the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Bytes of the message
+ */
+int xbee_arq_receive( struct xbee_arq * arq, void * buffer, int size, const struct timespec * deadline )
+{
+	uint8_t message[XBEE_ARQ_MAX_MESSAGE];
+	struct xbee_arq_slot * slot;
+	uint64_t start;
+	int length;
+	int result;
+	int used = 0;
+	int index;
+
+	for( ;; )
+	{
+		slot = &arq->receiving[arq->receive_base % XBEE_ARQ_MAX_WINDOW];
+
+		if( slot->used )
+			break;
+
+		result = service( arq, deadline, FALSE );
+
+		if( result <= 0 )
+			return result;
+	}//End ----- for( ;; ) ------------------------------------------
+
+	if( slot->compressed )
+	{
+		start = xbee_stats_clock( );
+		length = xbee_compress_decode( arq->compress, slot->data, slot->length, message, sizeof(message) );
+		xbee_stats_record( get_xbee_stats( arq->link.xbee ), XBEE_HISTOGRAM_DECOMPRESS, xbee_stats_clock( ) - start );
+
+		if( length > size )
+			length = size;
+
+		if( length > 0 )
+			memcpy( buffer, message, length );
+	}
+	else
+	{
+		length = ( slot->length < size ) ? slot->length : size;
+		memcpy( buffer, slot->data, length );
+	}//End ----- if( slot->compressed ) -----------------------------
+
+	for( index = 0; index < XBEE_ARQ_MAX_WINDOW; index++ )
+		used += arq->receiving[index].used;
+
+	slot->used = FALSE;
+	arq->receive_base++;
+	arq->delivered++;
+
+	//The peer may be waiting for the window to open
+	if( used == arq->window && send_ack( arq ) != 0 )
+		return -1;
+
+	return ( length < 0 ) ? -2 : length;
+}//----- End ----- xbee_arq_receive( struct xbee_arq *, void *, int, const struct timespec * )--
+
+
+/* @breif Waits until every message sent has been acknowledged
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					2 - Messages were still in flight at the deadline
+ *					3 - The peer stopped acknowledging, the layer is unusable
+ *					4 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_arq_flush( struct xbee_arq * arq, const struct timespec * deadline )
+{
+	int result;
+
+	while( arq->send_base != arq->send_next )
+	{
+		result = service( arq, deadline, FALSE );
+
+		if( result == 0 )
+			return 2;
+
+		if( result < 0 )
+			return ( result == -3 ) ? 3 : 4;
+	}//End ----- while( messages in flight ) ------------------------
+
+	return 0;
+}//----- End ----- xbee_arq_flush( struct xbee_arq *, const struct timespec * )--
@@ -0,0 +1,235 @@
+/** @file xbee_arq.h
+ ** @brief Reliable, ordered messages over a transparent link
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes an optional message layer that delivers
+ *				every message exactly once and in order between two xbees in
+ *				transparent mode, with a sliding window of messages in flight.
+ *				Both ends run an xbee_arq and either can send.
+ *
+ *				Every message gets a 16 bit sequence number. The receiver
+ *				answers each DATA packet with an ACK holding the sequence
+ *				number it expects next(cumulative), a bitmap of the 32
+ *				messages after that it already holds(selective) and the end
+ *				of its window. A message the ACKs skip while
+ *				XBEE_ARQ_SACK_THRESHOLD later ones are held is sent again at
+ *				once, any other is sent again when its retransmission timeout
+ *				expires.
+ *
+ *				The timeout follows the measured round trip time(RFC 6298):
+ *				SRTT and RTTVAR are updated from every message acknowledged
+ *				on its first transmission, RTO = SRTT + 4 * RTTVAR, and each
+ *				timeout doubles the RTO until the next measurement.
+ *
+ *				The receiver only accepts messages within its window and holds
+ *				them until xbee_arq_receive hands them out, so a slow reader
+ *				slows the sender down instead of losing messages. While the
+ *				receiver's window is closed the sender probes it every RTO.
+ *
+ *				The packets travel as described in xbee_link.h, numbers are
+ *				sent most significant byte first:
+ *
+ *					DATA		'M' | sequence(2) | message
+ *					COMPRESSED	'Z' | sequence(2) | message compressed(see xbee_compress.h)
+ *					ACK			'S' | sequence expected next(2) | held(4) | window end(2)
+ *					PROBE		'P'
+ *
+ *				Both ends must start from sequence number 0, so they are
+ *				started together and restarted together. Both should use the
+ *				same window.
+ *
+ *				With xbee_arq_compress every message is compressed before it
+ *				is sent, and sent as COMPRESSED instead of DATA when that made
+ *				it shorter. Messages are kept compressed until they are handed
+ *				out, so retransmissions cost the compressed length. The
+ *				compressor's counters and times go to the xbee's statistics.
+ *
+ *				An xbee_arq must be used by one thread at a time.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_ARQ_H
+#define XBEE_ARQ_H
+
+#include <stdint.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_link.h"
+#include "xbee_compress.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Packet types
+#define XBEE_ARQ_DATA 'M'
+#define XBEE_ARQ_COMPRESSED 'Z'
+#define XBEE_ARQ_ACK 'S'
+#define XBEE_ARQ_PROBE 'P'
+
+//Bytes of a DATA or COMPRESSED packet in front of the message, and of an ACK
+#define XBEE_ARQ_DATA_HEADER 3
+#define XBEE_ARQ_ACK_LENGTH 9
+
+//Largest message
+#define XBEE_ARQ_MAX_MESSAGE 1400
+
+//Messages in flight, the window may not be larger than the ACK's bitmap
+#define XBEE_ARQ_DEFAULT_WINDOW 8
+#define XBEE_ARQ_MAX_WINDOW 32
+
+//Retransmission timeout before the first measurement, and its limits
+#define XBEE_ARQ_INITIAL_RTO_MS 1000
+#define XBEE_ARQ_MIN_RTO_MS 200
+#define XBEE_ARQ_MAX_RTO_MS 60000
+
+//Later messages held before a missing one is sent again without waiting
+#define XBEE_ARQ_SACK_THRESHOLD 3
+
+//Transmissions of one message before the link is given up
+#define XBEE_ARQ_TRANSMISSIONS 8
+
+//A message in flight or waiting to be handed out
+struct xbee_arq_slot
+{
+	uint8_t * data;					//XBEE_ARQ_MAX_MESSAGE bytes
+	int length;
+	int compressed;					//TRUE when data is compressed
+	int used;						//TRUE while the slot holds a message
+	int held;						//TRUE once the peer reported holding it
+	int transmissions;
+	int fast_retransmitted;			//TRUE once it was sent again for the SACKs
+	uint64_t sent_ns;				//When it was first sent, for the RTT
+	uint64_t expires_ns;			//When it is sent again
+};
+
+struct xbee_arq
+{
+	struct xbee_link link;
+	int window;
+	int failed;						//TRUE once a message ran out of transmissions
+	uint8_t * buffers;				//Data of every slot
+	const struct xbee_compress * compress;	//NULL to send every message raw
+
+	//Sending, slots indexed by sequence number % XBEE_ARQ_MAX_WINDOW
+	struct xbee_arq_slot sending[XBEE_ARQ_MAX_WINDOW];
+	uint16_t send_base;				//Oldest message not acknowledged
+	uint16_t send_next;				//Sequence number of the next message
+	uint16_t send_limit;			//End of the peer's window
+	uint64_t probe_ns;				//When the closed window is probed next
+
+	//Receiving
+	struct xbee_arq_slot receiving[XBEE_ARQ_MAX_WINDOW];
+	uint16_t receive_base;			//Next message to hand out
+
+	//Round trip time, in nanoseconds
+	uint64_t srtt_ns;
+	uint64_t rttvar_ns;
+	uint64_t rto_ns;
+	int measured;					//TRUE once SRTT holds a measurement
+
+	//Counters
+	unsigned long sent;				//Messages sent, not counting retransmissions
+	unsigned long retransmissions;	//Messages sent again after their timeout
+	unsigned long fast_retransmissions;	//Messages sent again for the SACKs
+	unsigned long delivered;		//Messages handed out by xbee_arq_receive
+	unsigned long duplicates;		//Messages received that were already held or handed out
+	unsigned long probes;			//PROBEs sent to a closed window
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Prepares a message layer on an xbee
+ *
+ * @param struct xbee_arq * arq: The layer to initialize
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param int window: Messages in flight, 0 for XBEE_ARQ_DEFAULT_WINDOW
+ *
+ * @return :		0 - Success
+ *					1 - The window is larger than XBEE_ARQ_MAX_WINDOW
+ *					2 - Out of memory
+ *			 Not Zero - Error
+ */
+int xbee_arq_init( struct xbee_arq *, struct xbee *, int );
+
+/* @breif Frees what xbee_arq_init allocated
+ *
+ * @param struct xbee_arq * arq: The layer
+ */
+void xbee_arq_close( struct xbee_arq * );
+
+/* @breif Compresses the messages sent from now on
+ *
+ * Compressed messages are decompressed with the dictionary of the receiving
+ * end, so both ends should call it with the same dictionary before any
+ * message is sent.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const struct xbee_compress * compress: The dictionary, kept until
+ *												 xbee_arq_close, NULL to stop
+ *												 compressing
+ */
+void xbee_arq_compress( struct xbee_arq *, const struct xbee_compress * );
+
+/* @breif Sends a message
+ *
+ * Returns once the message is in flight. While the window is full it waits,
+ * receiving and retransmitting, until a message is acknowledged or the
+ * deadline passes.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const void * data: The message
+ * @param int length: Bytes in the message, from 1 to XBEE_ARQ_MAX_MESSAGE
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					1 - The message is empty or too long
+ *					2 - The window stayed full until the deadline
+ *					3 - The peer stopped acknowledging, the layer is unusable
+ *					4 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_arq_send( struct xbee_arq *, const void *, int, const struct timespec * );
+
+/* @breif Receives the next message in order
+ *
+ * Acknowledges and retransmits while it waits.
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param void * buffer: The message is stored here
+ * @param int size: Size of buffer, a longer message is cut
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -3 - The peer stopped acknowledging, the layer is unusable
+ *				   -2 - A message could not be decompressed, the dictionaries
+ *						differ, it is dropped
+ *				   -1 - Error reading from or writing to the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Bytes of the message
+ */
+int xbee_arq_receive( struct xbee_arq *, void *, int, const struct timespec * );
+
+/* @breif Waits until every message sent has been acknowledged
+ *
+ * @param struct xbee_arq * arq: The layer
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Success
+ *					2 - Messages were still in flight at the deadline
+ *					3 - The peer stopped acknowledging, the layer is unusable
+ *					4 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_arq_flush( struct xbee_arq *, const struct timespec * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
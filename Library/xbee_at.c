@@ -0,0 +1,480 @@
+/** @file xbee_at.c
+ ** @brief Implementation of the xbee_at.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_at.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <string.h>
+#include "xbee_at.h"
+
+#define XBEE_AT_ENTRY( name, mnemonic, type, access, maximum ) \
+	[XBEE_AT_##name] = { mnemonic, type, access, maximum },
+
+const struct xbee_at_command xbee_at_commands[XBEE_AT_COUNT] = {
+	XBEE_AT_COMMANDS( XBEE_AT_ENTRY )
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+
+/* @breif Tells whether an identifier names a command of the table
+ *
+ * @param int id: XBEE_AT_*
+ *
+ * @return :		TRUE or FALSE
+ */
+static int known_command( int id )
+{
+	return id >= 0 && id < XBEE_AT_COUNT;
+}//----- End ----- known_command( int )-----------------------------------
+
+
+/* @breif Gives the largest value a number command takes
+ *
+ * @param int id: XBEE_AT_*, a command of the table
+ *
+ * @return :		The largest value, 0 when the command has no number
+ */
+static uint64_t largest_value( int id )
+{
+	const struct xbee_at_command * command = &xbee_at_commands[id];
+
+	if( command->maximum != 0 )
+		return command->maximum;
+
+	switch( command->type )
+	{
+		case XBEE_AT_TYPE_U16:
+			return 0xFFFF;
+
+		case XBEE_AT_TYPE_U32:
+		case XBEE_AT_TYPE_IP:
+			return 0xFFFFFFFFULL;
+
+		case XBEE_AT_TYPE_U64:
+			return 0xFFFFFFFFFFFFFFFFULL;
+
+		default:
+			return 0;
+	}//End ----- switch( command->type ) -----------------------------
+}//----- End ----- largest_value( int )-----------------------------------
+
+
+/* @breif Tells whether a command holds a number
+ *
+ * @param int id: XBEE_AT_*, a command of the table
+ *
+ * @return :		TRUE or FALSE
+ */
+static int has_number( int id )
+{
+	return xbee_at_commands[id].type != XBEE_AT_TYPE_NONE &&
+		   xbee_at_commands[id].type != XBEE_AT_TYPE_STRING;
+}//----- End ----- has_number( int )--------------------------------------
+
+
+/* @breif Finds a command in the table by its mnemonic
+ *
+ * @param const char * mnemonic: e.g. "MY", either case
+ *
+ * @return :	   -1 - The command is not in the table
+ *			 Not Negative - Its XBEE_AT_* identifier
+ */
+int xbee_at_lookup( const char * mnemonic )
+{
+	char upper[2];
+	int index;
+
+	if( mnemonic[0] == '\0' || mnemonic[1] == '\0' || mnemonic[2] != '\0' )
+		return -1;
+
+	for( index = 0; index < 2; index++ )
+	{
+		upper[index] = mnemonic[index];
+
+		if( upper[index] >= 'a' && upper[index] <= 'z' )
+			upper[index] -= 'a' - 'A';
+	}//End ----- for( index < 2 ) -----------------------------------
+
+	for( index = 0; index < XBEE_AT_COUNT; index++ )
+	{
+		if( xbee_at_commands[index].mnemonic[0] == upper[0] &&
+			xbee_at_commands[index].mnemonic[1] == upper[1] )
+		{
+			return index;
+		}//End ----- if( mnemonic matches ) -----------------------------
+	}//End ----- for( index < XBEE_AT_COUNT ) -----------------------
+
+	return -1;
+}//----- End ----- xbee_at_lookup( const char * )-------------------------
+
+
+/* @breif Parses a value as the xbee writes it in transparent mode
+ *
+ * Hex numbers are parsed digit by digit, addresses octet by octet, nothing is
+ * copied.
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param const char * text: The value, e.g. "3E8" or "192.168.1.10"
+ * @param int length: Characters in text
+ * @param uint64_t * value: The number is stored here
+ *
+ * @return :		0 - Success
+ *					1 - text is not a value of the command's type
+ *			 Not Zero - Error
+ */
+int xbee_at_parse( int id, const char * text, int length, uint64_t * value )
+{
+	uint64_t number = 0;
+	uint32_t octet = 0;
+	int octets = 0;
+	int digits = 0;
+	int index;
+	char c;
+
+	if( !known_command( id ) || !has_number( id ) )
+		return 1;
+
+	//The answer may still end with the xbee's carriage return
+	while( length > 0 && ( text[length - 1] == '\r' || text[length - 1] == '\n' ) )
+		length--;
+
+	if( xbee_at_commands[id].type == XBEE_AT_TYPE_IP )
+	{
+		for( index = 0; index <= length; index++ )
+		{
+			if( index == length || text[index] == '.' )
+			{
+				if( digits == 0 || octet > 0xFF || octets == 4 )
+					return 1;
+
+				number = ( number << 8 ) | octet;
+				octets++;
+				octet = 0;
+				digits = 0;
+			}
+			else if( text[index] >= '0' && text[index] <= '9' && digits < 3 )
+			{
+				octet = octet * 10 + ( text[index] - '0' );
+				digits++;
+			}
+			else
+			{
+				return 1;
+			}//End ----- if( end of octet ) ---------------------------------
+		}//End ----- for( index <= length ) -----------------------------
+
+		if( octets != 4 )
+			return 1;
+
+		*value = number;
+		return 0;
+	}//End ----- if( address ) -------------------------------------
+
+	for( index = 0; index < length; index++ )
+	{
+		c = text[index];
+
+		if( c >= '0' && c <= '9' )
+			c -= '0';
+		else if( c >= 'A' && c <= 'F' )
+			c -= 'A' - 10;
+		else if( c >= 'a' && c <= 'f' )
+			c -= 'a' - 10;
+		else
+			return 1;
+
+		//Leading zeros do not count toward the 16 digits a uint64_t holds
+		if( number != 0 || c != 0 )
+			digits++;
+
+		if( digits > 16 )
+			return 1;
+
+		number = ( number << 4 ) | c;
+	}//End ----- for( index < length ) ------------------------------
+
+	if( length == 0 )
+		return 1;
+
+	*value = number;
+	return 0;
+}//----- End ----- xbee_at_parse( int, const char *, int, uint64_t * )--
+
+
+/* @breif Writes a value the way the xbee expects it in transparent mode
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param uint64_t value: The number, an address as 0xC0A8010A for 192.168.1.10
+ * @param char * text: The value is stored here as a string, must hold
+ *					   XBEE_AT_MAX_TEXT characters
+ *
+ * @return :		Number of characters stored, without the '\0'
+ */
+int xbee_at_format( int id, uint64_t value, char * text )
+{
+	unsigned int octet;
+	int length = 0;
+	int shift;
+
+	if( known_command( id ) && xbee_at_commands[id].type == XBEE_AT_TYPE_IP )
+	{
+		for( shift = 24; shift >= 0; shift -= 8 )
+		{
+			octet = ( value >> shift ) & 0xFF;
+
+			if( octet >= 100 )
+				text[length++] = '0' + octet / 100;
+
+			if( octet >= 10 )
+				text[length++] = '0' + octet / 10 % 10;
+
+			text[length++] = '0' + octet % 10;
+
+			if( shift > 0 )
+				text[length++] = '.';
+		}//End ----- for( shift >= 0 ) ----------------------------------
+
+		text[length] = '\0';
+		return length;
+	}//End ----- if( address ) -------------------------------------
+
+	//Hex without leading zeros, at least one digit
+	for( shift = 60; shift > 0 && ( value >> shift ) == 0; shift -= 4 );
+
+	for( ; shift >= 0; shift -= 4 )
+		text[length++] = hex_digits[( value >> shift ) & 0x0F];
+
+	text[length] = '\0';
+	return length;
+}//----- End ----- xbee_at_format( int, uint64_t, char * )---------------
+
+
+/* @breif Reads a value from the bytes of an API AT command response
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param const uint8_t * data: The value, most significant byte first
+ * @param int length: Bytes in data
+ * @param uint64_t * value: The number is stored here
+ *
+ * @return :		0 - Success
+ *					1 - The command has no number or data is too long
+ *			 Not Zero - Error
+ */
+int xbee_at_decode( int id, const uint8_t * data, int length, uint64_t * value )
+{
+	uint64_t number = 0;
+	int index;
+
+	if( !known_command( id ) || !has_number( id ) || length < 1 || length > 8 )
+		return 1;
+
+	for( index = 0; index < length; index++ )
+		number = ( number << 8 ) | data[index];
+
+	*value = number;
+	return 0;
+}//----- End ----- xbee_at_decode( int, const uint8_t *, int, uint64_t * )--
+
+
+/* @breif Writes a value as the parameter of an API AT command frame
+ *
+ * Numbers take as few bytes as they need, at least one. Addresses always
+ * take four.
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param uint64_t value: The number
+ * @param uint8_t * data: The bytes are stored here, must hold 8
+ *
+ * @return :		Number of bytes stored
+ */
+int xbee_at_encode( int id, uint64_t value, uint8_t * data )
+{
+	int length = 1;
+	int index;
+
+	if( known_command( id ) && xbee_at_commands[id].type == XBEE_AT_TYPE_IP )
+		length = 4;
+	else
+		while( length < 8 && ( value >> ( length * 8 ) ) != 0 )
+			length++;
+
+	for( index = 0; index < length; index++ )
+		data[index] = value >> ( ( length - 1 - index ) * 8 );
+
+	return length;
+}//----- End ----- xbee_at_encode( int, uint64_t, uint8_t * )-----------
+
+
+/* @breif Reads a number or an address from the xbee
+ *
+ * @AT Command: AT<mnemonic> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a readable command that is not a string
+ * @param uint64_t * value: The value is stored here
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be read as a number
+ *				   -9 - The answer was not a value of the command's type
+ *			 Not Zero - The error returned by get_at
+ */
+int xbee_at_get_number( struct xbee * xbee, int id, uint64_t * value )
+{
+	char answer[MAX_BUFFER_SIZE];
+	char mnemonic[3];
+	int result;
+
+	if( !known_command( id ) || !has_number( id ) || !( xbee_at_commands[id].access & XBEE_AT_READ ) )
+		return -7;
+
+	memcpy( mnemonic, xbee_at_commands[id].mnemonic, sizeof(mnemonic) );
+	result = get_at( xbee, mnemonic, answer, 0 );
+
+	if( result != 0 )
+		return result;
+
+	if( xbee_at_parse( id, answer, strlen( answer ), value ) != 0 )
+		return -9;
+
+	return 0;
+}//----- End ----- xbee_at_get_number( struct xbee *, int, uint64_t * )--
+
+
+/* @breif Sets a number or an address
+ *
+ * @AT Command: AT<mnemonic><value>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a writable command that is not a string
+ * @param uint64_t value: The new value
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be set to a number
+ *				   -8 - The value is larger than the command takes
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_set_number( struct xbee * xbee, int id, uint64_t value )
+{
+	char text[XBEE_AT_MAX_TEXT];
+	char mnemonic[3];
+
+	if( !known_command( id ) || !has_number( id ) || !( xbee_at_commands[id].access & XBEE_AT_WRITE ) )
+		return -7;
+
+	if( value > largest_value( id ) )
+		return -8;
+
+	xbee_at_format( id, value, text );
+	memcpy( mnemonic, xbee_at_commands[id].mnemonic, sizeof(mnemonic) );
+
+	return set_at( xbee, mnemonic, text );
+}//----- End ----- xbee_at_set_number( struct xbee *, int, uint64_t )----
+
+
+/* @breif Reads a string parameter
+ *
+ * @AT Command: AT<mnemonic> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a readable string command
+ * @param char * text: The value is stored here, must hold MAX_BUFFER_SIZE
+ *					   characters
+ *
+ * @return :		0 - Success
+ *				   -7 - The command is not a readable string
+ *			 Not Zero - The error returned by get_at
+ */
+int xbee_at_get_string( struct xbee * xbee, int id, char * text )
+{
+	char mnemonic[3];
+
+	if( !known_command( id ) || xbee_at_commands[id].type != XBEE_AT_TYPE_STRING ||
+		!( xbee_at_commands[id].access & XBEE_AT_READ ) )
+	{
+		return -7;
+	}//End ----- if( not a readable string ) ------------------------
+
+	memcpy( mnemonic, xbee_at_commands[id].mnemonic, sizeof(mnemonic) );
+
+	return get_at( xbee, mnemonic, text, 0 );
+}//----- End ----- xbee_at_get_string( struct xbee *, int, char * )------
+
+
+/* @breif Sets a string parameter
+ *
+ * @AT Command: AT<mnemonic><text>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a writable string command
+ * @param const char * text: The new value
+ *
+ * @return :		0 - Success
+ *				   -7 - The command is not a writable string
+ *				   -8 - The text is longer than the command takes
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_set_string( struct xbee * xbee, int id, const char * text )
+{
+	char value[MAX_BUFFER_SIZE];
+	char mnemonic[3];
+	size_t length;
+
+	if( !known_command( id ) || xbee_at_commands[id].type != XBEE_AT_TYPE_STRING ||
+		!( xbee_at_commands[id].access & XBEE_AT_WRITE ) )
+	{
+		return -7;
+	}//End ----- if( not a writable string ) ------------------------
+
+	length = strlen( text );
+
+	if( length > xbee_at_commands[id].maximum || length >= sizeof(value) )
+		return -8;
+
+	//set_at takes a modifiable string, the caller's is not
+	memcpy( value, text, length + 1 );
+	memcpy( mnemonic, xbee_at_commands[id].mnemonic, sizeof(mnemonic) );
+
+	return set_at( xbee, mnemonic, value );
+}//----- End ----- xbee_at_set_string( struct xbee *, int, const char * )--
+
+
+/* @breif Runs a command that takes no value, e.g. XBEE_AT_WR
+ *
+ * XBEE_AT_CN closes the command mode session so the library knows the xbee
+ * left command mode. After XBEE_AT_FR the xbee restarts in transparent mode,
+ * so the session is dropped and every cached value with it.
+ *
+ * @AT Command: AT<mnemonic>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, an executable command
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be executed
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_execute( struct xbee * xbee, int id )
+{
+	char mnemonic[3];
+
+	if( !known_command( id ) || !( xbee_at_commands[id].access & XBEE_AT_EXECUTE ) )
+		return -7;
+
+	if( id == XBEE_AT_CN )
+		return at_session_close( xbee );
+
+	memcpy( mnemonic, xbee_at_commands[id].mnemonic, sizeof(mnemonic) );
+
+	return set_at( xbee, mnemonic, "" );
+}//----- End ----- xbee_at_execute( struct xbee *, int )-----------------
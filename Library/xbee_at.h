@@ -0,0 +1,274 @@
+/** @file xbee_at.h
+ ** @brief Table of the xbee's AT commands with typed get and set
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes every AT command the library knows in one
+ *				table, XBEE_AT_COMMANDS. Each entry names the command, the type
+ *				of its value, whether it can be read, written or executed, and
+ *				the largest value it takes. The preprocessor expands the table
+ *				into the XBEE_AT_* identifiers and into xbee_at_commands, so
+ *				adding a command is one line and nothing has to be kept in step
+ *				by hand.
+ *
+ *				xbee_at_get_number and xbee_at_set_number move numbers and
+ *				addresses in and out of the xbee without a getter per command.
+ *				Answers are parsed straight from the line read into an integer
+ *				and values are formatted into a small buffer on the stack, no
+ *				memory is allocated and no printf family function is called.
+ *				xbee_at_decode and xbee_at_encode do the same for the binary
+ *				values of API frames(see xbee_pipeline.h).
+ *
+ *				Values are checked against the table before anything is sent,
+ *				a value out of range never reaches the xbee.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_AT_H
+#define XBEE_AT_H
+
+#include <stdint.h>
+#include "libxbee.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Types of values
+#define XBEE_AT_TYPE_NONE 0			//Executed, takes no value, e.g. ATWR
+#define XBEE_AT_TYPE_U16 1			//Hex number of up to 16 bits
+#define XBEE_AT_TYPE_U32 2			//Hex number of up to 32 bits
+#define XBEE_AT_TYPE_U64 3			//Hex number of up to 64 bits
+#define XBEE_AT_TYPE_ENUM 4			//Hex code from 0 to the entry's maximum
+#define XBEE_AT_TYPE_IP 5			//IPv4 address, dotted in transparent mode
+#define XBEE_AT_TYPE_STRING 6		//Text of up to the entry's maximum characters
+
+//Access modes
+#define XBEE_AT_READ 0x01
+#define XBEE_AT_WRITE 0x02
+#define XBEE_AT_RW ( XBEE_AT_READ | XBEE_AT_WRITE )
+#define XBEE_AT_EXECUTE 0x04
+
+//The commands: identifier, mnemonic, type, access and maximum. The maximum of a
+//number is the largest value accepted by xbee_at_set_number, 0 for the type's
+//whole range, and the most characters of a string.
+#define XBEE_AT_COMMANDS( X ) \
+	/* Addressing */ \
+	X( MY, "MY", XBEE_AT_TYPE_IP, XBEE_AT_RW, 0 )				/* IP address */ \
+	X( MK, "MK", XBEE_AT_TYPE_IP, XBEE_AT_RW, 0 )				/* Subnet mask */ \
+	X( GW, "GW", XBEE_AT_TYPE_IP, XBEE_AT_RW, 0 )				/* Gateway */ \
+	X( NS, "NS", XBEE_AT_TYPE_IP, XBEE_AT_RW, 0 )				/* DNS server */ \
+	X( DL, "DL", XBEE_AT_TYPE_IP, XBEE_AT_RW, 0 )				/* Destination address */ \
+	X( DE, "DE", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0 )				/* Destination port */ \
+	X( C0, "C0", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0 )				/* Source port */ \
+	X( SH, "SH", XBEE_AT_TYPE_U32, XBEE_AT_READ, 0 )			/* Serial number, high */ \
+	X( SL, "SL", XBEE_AT_TYPE_U32, XBEE_AT_READ, 0 )			/* Serial number, low */ \
+	/* Network */ \
+	X( ID, "ID", XBEE_AT_TYPE_STRING, XBEE_AT_RW, 31 )			/* SSID */ \
+	X( AH, "AH", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 2 )				/* Network type */ \
+	X( IP, "IP", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 1 )				/* UDP or TCP */ \
+	X( EE, "EE", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 3 )				/* Encryption */ \
+	X( PL, "PL", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 4 )				/* Power level */ \
+	/* Serial interface */ \
+	X( BD, "BD", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 8 )				/* Baud rate code */ \
+	X( NB, "NB", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 2 )				/* Parity */ \
+	X( SB, "SB", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 1 )				/* Stop bits */ \
+	X( RO, "RO", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0xFF )			/* Packetization timeout */ \
+	X( AP, "AP", XBEE_AT_TYPE_ENUM, XBEE_AT_RW, 2 )				/* API mode */ \
+	X( NP, "NP", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )			/* Largest payload */ \
+	/* Command mode */ \
+	X( CT, "CT", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0x1770 )			/* Timeout, 100 ms units */ \
+	X( GT, "GT", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0x0CE4 )			/* Guard time, ms */ \
+	X( CC, "CC", XBEE_AT_TYPE_U16, XBEE_AT_RW, 0xFF )			/* Command character */ \
+	/* Diagnostics */ \
+	X( AI, "AI", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )			/* Association indication */ \
+	X( DB, "DB", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )			/* Signal strength */ \
+	X( TP, "TP", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )			/* Temperature */ \
+	X( SUPPLY, "%V", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )		/* Supply voltage */ \
+	X( VR, "VR", XBEE_AT_TYPE_U32, XBEE_AT_READ, 0 )			/* Firmware version */ \
+	X( HV, "HV", XBEE_AT_TYPE_U16, XBEE_AT_READ, 0 )			/* Hardware version */ \
+	/* Execution */ \
+	X( AC, "AC", XBEE_AT_TYPE_NONE, XBEE_AT_EXECUTE, 0 )		/* Apply changes */ \
+	X( WR, "WR", XBEE_AT_TYPE_NONE, XBEE_AT_EXECUTE, 0 )		/* Write to flash */ \
+	X( RE, "RE", XBEE_AT_TYPE_NONE, XBEE_AT_EXECUTE, 0 )		/* Restore defaults */ \
+	X( FR, "FR", XBEE_AT_TYPE_NONE, XBEE_AT_EXECUTE, 0 )		/* Software reset */ \
+	X( CN, "CN", XBEE_AT_TYPE_NONE, XBEE_AT_EXECUTE, 0 )		/* Leave command mode */
+
+//XBEE_AT_MY, XBEE_AT_MK, ... in the order of the table, then XBEE_AT_COUNT
+#define XBEE_AT_IDENTIFIER( name, mnemonic, type, access, maximum ) XBEE_AT_##name,
+
+enum xbee_at_identifier
+{
+	XBEE_AT_COMMANDS( XBEE_AT_IDENTIFIER )
+	XBEE_AT_COUNT
+};
+
+//One entry of the table
+struct xbee_at_command
+{
+	char mnemonic[3];
+	uint8_t type;					//XBEE_AT_TYPE_*
+	uint8_t access;					//XBEE_AT_READ, WRITE and/or EXECUTE
+	uint64_t maximum;				//Largest value or longest string
+};
+
+//The table, indexed by XBEE_AT_*
+extern const struct xbee_at_command xbee_at_commands[XBEE_AT_COUNT];
+
+//Longest value xbee_at_format writes: 16 hex digits or a dotted address, and '\0'
+#define XBEE_AT_MAX_TEXT 17
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Finds a command in the table by its mnemonic
+ *
+ * @param const char * mnemonic: e.g. "MY", either case
+ *
+ * @return :	   -1 - The command is not in the table
+ *			 Not Negative - Its XBEE_AT_* identifier
+ */
+int xbee_at_lookup( const char * );
+
+/* @breif Parses a value as the xbee writes it in transparent mode
+ *
+ * Hex numbers are parsed digit by digit, addresses octet by octet, nothing is
+ * copied.
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param const char * text: The value, e.g. "3E8" or "192.168.1.10"
+ * @param int length: Characters in text
+ * @param uint64_t * value: The number is stored here
+ *
+ * @return :		0 - Success
+ *					1 - text is not a value of the command's type
+ *			 Not Zero - Error
+ */
+int xbee_at_parse( int, const char *, int, uint64_t * );
+
+/* @breif Writes a value the way the xbee expects it in transparent mode
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param uint64_t value: The number, an address as 0xC0A8010A for 192.168.1.10
+ * @param char * text: The value is stored here as a string, must hold
+ *					   XBEE_AT_MAX_TEXT characters
+ *
+ * @return :		Number of characters stored, without the '\0'
+ */
+int xbee_at_format( int, uint64_t, char * );
+
+/* @breif Reads a value from the bytes of an API AT command response
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param const uint8_t * data: The value, most significant byte first
+ * @param int length: Bytes in data
+ * @param uint64_t * value: The number is stored here
+ *
+ * @return :		0 - Success
+ *					1 - The command has no number or data is too long
+ *			 Not Zero - Error
+ */
+int xbee_at_decode( int, const uint8_t *, int, uint64_t * );
+
+/* @breif Writes a value as the parameter of an API AT command frame
+ *
+ * Numbers take as few bytes as they need, at least one. Addresses always
+ * take four.
+ *
+ * @param int id: XBEE_AT_*, gives the type of the value
+ * @param uint64_t value: The number
+ * @param uint8_t * data: The bytes are stored here, must hold 8
+ *
+ * @return :		Number of bytes stored
+ */
+int xbee_at_encode( int, uint64_t, uint8_t * );
+
+/* @breif Reads a number or an address from the xbee
+ *
+ * Goes through get_at, so fresh values come from the AT cache and the command
+ * mode session is shared with other AT operations.
+ *
+ * @AT Command: AT<mnemonic> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a readable command that is not a string
+ * @param uint64_t * value: The value is stored here
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be read as a number
+ *				   -9 - The answer was not a value of the command's type
+ *			 Not Zero - The error returned by get_at
+ */
+int xbee_at_get_number( struct xbee *, int, uint64_t * );
+
+/* @breif Sets a number or an address
+ *
+ * @AT Command: AT<mnemonic><value>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a writable command that is not a string
+ * @param uint64_t value: The new value
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be set to a number
+ *				   -8 - The value is larger than the command takes
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_set_number( struct xbee *, int, uint64_t );
+
+/* @breif Reads a string parameter
+ *
+ * @AT Command: AT<mnemonic> (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a readable string command
+ * @param char * text: The value is stored here, must hold MAX_BUFFER_SIZE
+ *					   characters
+ *
+ * @return :		0 - Success
+ *				   -7 - The command is not a readable string
+ *			 Not Zero - The error returned by get_at
+ */
+int xbee_at_get_string( struct xbee *, int, char * );
+
+/* @breif Sets a string parameter
+ *
+ * @AT Command: AT<mnemonic><text>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, a writable string command
+ * @param const char * text: The new value
+ *
+ * @return :		0 - Success
+ *				   -7 - The command is not a writable string
+ *				   -8 - The text is longer than the command takes
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_set_string( struct xbee *, int, const char * );
+
+/* @breif Runs a command that takes no value, e.g. XBEE_AT_WR
+ *
+ * XBEE_AT_CN closes the command mode session so the library knows the xbee
+ * left command mode. After XBEE_AT_FR the xbee restarts in transparent mode,
+ * so the session is dropped and every cached value with it.
+ *
+ * @AT Command: AT<mnemonic>
+ *
+ * @param struct xbee * xbee: The xbee to use
+ * @param int id: XBEE_AT_*, an executable command
+ *
+ * @return :		0 - Success
+ *				   -7 - The command can not be executed
+ *			 Not Zero - The error returned by set_at
+ */
+int xbee_at_execute( struct xbee *, int );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,417 @@
+/** @file xbee_coalesce.c
+ ** @brief Implementation of the xbee_coalesce.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_coalesce.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "xbee_coalesce.h"
+#include "xbee_at.h"
+#include "xbee_stats.h"
+#include "xbee_frame.h"
+
+
+/* @breif Counts the bytes data takes on the wire, escaped bytes twice
+ *
+ * @param const uint8_t * data: The bytes
+ * @param int length: Bytes in data
+ *
+ * @return : Bytes of data once escaped
+ */
+static int escaped_length( const uint8_t * data, int length )
+{
+	int size = length;
+	int index;
+
+	for( index = 0; index < length; index++ )
+	{
+		if( data[index] == XBEE_FRAME_DELIMITER || data[index] == XBEE_FRAME_ESCAPE ||
+			data[index] == XBEE_FRAME_XON || data[index] == XBEE_FRAME_XOFF )
+		{
+			size++;
+		}//End ----- if( the byte is escaped ) --------------------------
+	}//End ----- for( index < length ) ------------------------------
+
+	return size;
+}//----- End ----- escaped_length( const uint8_t *, int )----------------
+
+
+/* @breif Writes the packet gathered so far, the lock must be held
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer
+ *
+ * @return :		0 - Success
+ *					2 - Writing to the port failed, now or before
+ */
+static int write_packet( struct xbee_coalesce * coalesce )
+{
+	if( coalesce->length > 0 && coalesce->failed == FALSE )
+	{
+		if( xbee_link_send( &coalesce->link, coalesce->packet, coalesce->length ) != 0 )
+			coalesce->failed = TRUE;
+		else
+			coalesce->packets++;
+	}//End ----- if( something to write ) ---------------------------
+
+	coalesce->length = 0;
+	coalesce->encoded = 0;
+
+	return coalesce->failed ? 2 : 0;
+}//----- End ----- write_packet( struct xbee_coalesce * )----------------
+
+
+/* @breif Writes each packet whose oldest message waited for the delay
+ *
+ * Sleeps without a timeout while nothing is gathered, a new packet wakes it.
+ * Can only be cancelled while it does not hold the lock.
+ *
+ * @param void * arg: The struct xbee_coalesce
+ */
+static void * write_late( void * arg )
+{
+	struct xbee_coalesce * coalesce = arg;
+	struct pollfd descriptors[2];
+	uint64_t signal;
+	uint64_t now;
+	uint64_t due;
+	int timeout;
+	int state;
+
+	descriptors[0].fd = coalesce->wake_descriptor;
+	descriptors[0].events = POLLIN;
+	descriptors[1].fd = coalesce->stop_descriptor;
+	descriptors[1].events = POLLIN;
+
+	for( ;; )
+	{
+		timeout = -1;
+
+		pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &state );
+		pthread_mutex_lock( &coalesce->lock );
+
+		if( coalesce->length > 0 )
+		{
+			now = xbee_stats_clock( );
+			due = coalesce->oldest_ns + coalesce->delay_ms * 1000000ULL;
+
+			if( now >= due )
+			{
+				write_packet( coalesce );
+				coalesce->delay_flushes++;
+			}
+			else
+			{
+				timeout = ( due - now + 999999 ) / 1000000;
+			}//End ----- if( now >= due ) -----------------------------------
+		}//End ----- if( a packet is gathered ) -------------------------
+
+		pthread_mutex_unlock( &coalesce->lock );
+		pthread_setcancelstate( state, NULL );
+
+		if( poll( descriptors, 2, timeout ) < 0 && errno != EINTR )
+			break;
+
+		if( descriptors[1].revents & POLLIN )
+			break;
+
+		if( ( descriptors[0].revents & POLLIN ) &&
+			read( coalesce->wake_descriptor, &signal, sizeof(signal) ) < 0 )
+		{
+			continue;	//EAGAIN, nothing was left to clear
+		}//End ----- if( woken ) ----------------------------------------
+	}//End ----- for( ;; ) ------------------------------------------
+
+	return NULL;
+}//----- End ----- write_late( void * )----------------------------------
+
+
+/* @breif Starts coalescing the messages written to an xbee
+ *
+ * @AT Command: ATNP, ATRO (only for a threshold or delay of 0, when the cached
+ *				value is missing or expired)
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer to start
+ * @param struct xbee * xbee: The xbee to write to, in transparent mode
+ * @param int delay_ms: Longest wait of a message, 0 to follow ATRO
+ * @param int threshold: Escaped bytes of packet that make it go at once, 0 to
+ *						 follow ATNP, at most XBEE_LINK_MAX_PACKET
+ *
+ * @return :		0 - Success
+ *					1 - Bad delay or threshold
+ *					2 - Failed to create the eventfds
+ *					3 - Failed to start the thread
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_start( struct xbee_coalesce * coalesce, struct xbee * xbee, int delay_ms, int threshold )
+{
+	uint64_t value;
+
+	if( delay_ms < 0 || threshold < 0 || threshold > XBEE_LINK_MAX_PACKET ||
+		( threshold > 0 && threshold < XBEE_COALESCE_MIN_THRESHOLD ) )
+	{
+		return 1;
+	}//End ----- if( bad delay or threshold ) -----------------------
+
+	//The packet and its frame make one RF packet
+	if( threshold == 0 )
+	{
+		threshold = XBEE_COALESCE_DEFAULT_THRESHOLD;
+
+		if( xbee_at_get_number( xbee, XBEE_AT_NP, &value ) == 0 )
+		{
+			if( value > XBEE_LINK_MAX_PACKET + XBEE_COALESCE_FRAMING )
+				threshold = XBEE_LINK_MAX_PACKET;
+			else if( value < XBEE_COALESCE_MIN_THRESHOLD + XBEE_COALESCE_FRAMING )
+				threshold = XBEE_COALESCE_MIN_THRESHOLD;
+			else
+				threshold = value - XBEE_COALESCE_FRAMING;
+		}//End ----- if( ATNP was read ) --------------------------------
+	}//End ----- if( threshold == 0 ) -------------------------------
+
+	//ATRO is in character times, 10 bits each
+	if( delay_ms == 0 )
+	{
+		delay_ms = XBEE_COALESCE_DEFAULT_DELAY_MS;
+
+		if( xbee_at_get_number( xbee, XBEE_AT_RO, &value ) == 0 )
+			delay_ms = ( value * 10 * 1000 + get_port_baud_rate( xbee ) - 1 ) / get_port_baud_rate( xbee );
+
+		if( delay_ms < 1 )
+			delay_ms = 1;
+	}//End ----- if( delay_ms == 0 ) --------------------------------
+
+	memset( coalesce, 0, sizeof(*coalesce) );
+	pthread_mutex_init( &coalesce->lock, NULL );
+	xbee_link_init( &coalesce->link, xbee );
+	coalesce->threshold = threshold;
+	coalesce->delay_ms = delay_ms;
+
+	coalesce->wake_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	coalesce->stop_descriptor = eventfd( 0, EFD_CLOEXEC );
+
+	if( coalesce->wake_descriptor < 0 || coalesce->stop_descriptor < 0 )
+	{
+		printf( "\nCreating the coalescing thread's eventfds failed with error[%d].\n",
+				errno );
+
+		if( coalesce->wake_descriptor >= 0 )
+			close( coalesce->wake_descriptor );
+
+		if( coalesce->stop_descriptor >= 0 )
+			close( coalesce->stop_descriptor );
+
+		pthread_mutex_destroy( &coalesce->lock );
+		return 2;
+	}//End ----- if( eventfd failed ) -------------------------------
+
+	if( pthread_create( &coalesce->thread, NULL, write_late, coalesce ) != 0 )
+	{
+		close( coalesce->wake_descriptor );
+		close( coalesce->stop_descriptor );
+		pthread_mutex_destroy( &coalesce->lock );
+		return 3;
+	}//End ----- if( pthread_create != 0 ) --------------------------
+
+	return 0;
+}//----- End ----- xbee_coalesce_start( struct xbee_coalesce *, struct xbee *, int, int )--
+
+
+/* @breif Adds a message to the packet being gathered, safe to call from any thread
+ *
+ * Writes the packet first when the message does not fit in it, and after
+ * when the message brings it to the threshold.
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer
+ * @param const void * data: The message
+ * @param int length: Bytes in the message, from 1 to XBEE_COALESCE_MAX_MESSAGE,
+ *					  escaped it and its length byte must fit in the
+ *					  threshold less 1
+ *
+ * @return :		0 - Success
+ *					1 - The message is empty or too long
+ *					2 - Writing to the port failed, now or before
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_send( struct xbee_coalesce * coalesce, const void * data, int length )
+{
+	uint64_t signal = 1;
+	uint8_t prefix = length;
+	int started = FALSE;
+	int result = 0;
+	int encoded;
+
+	if( length < 1 || length > XBEE_COALESCE_MAX_MESSAGE )
+		return 1;
+
+	//The message and its length byte as they go on the wire
+	encoded = escaped_length( &prefix, 1 ) + escaped_length( data, length );
+
+	if( 1 + encoded > coalesce->threshold )
+		return 1;
+
+	pthread_mutex_lock( &coalesce->lock );
+
+	if( coalesce->encoded + encoded > coalesce->threshold )
+		result = write_packet( coalesce );
+
+	if( result == 0 && coalesce->failed == FALSE )
+	{
+		if( coalesce->length == 0 )
+		{
+			coalesce->packet[coalesce->length++] = XBEE_COALESCE_PACKET;
+			coalesce->encoded = 1;
+			coalesce->oldest_ns = xbee_stats_clock( );
+			started = TRUE;
+		}//End ----- if( a new packet ) ---------------------------------
+
+		coalesce->packet[coalesce->length++] = length;
+		memcpy( coalesce->packet + coalesce->length, data, length );
+		coalesce->length += length;
+		coalesce->encoded += encoded;
+		coalesce->messages++;
+
+		if( coalesce->encoded >= coalesce->threshold )
+			result = write_packet( coalesce );
+	}
+	else
+	{
+		result = 2;
+	}//End ----- if( the port works ) -------------------------------
+
+	pthread_mutex_unlock( &coalesce->lock );
+
+	//The thread sleeps for ever until a packet is started. EAGAIN means it has
+	//not read its earlier wake ups yet, otherwise the packet can not wait for it.
+	if( started &&
+		write( coalesce->wake_descriptor, &signal, sizeof(signal) ) < 0 && errno != EAGAIN )
+	{
+		result = xbee_coalesce_flush( coalesce );
+	}//End ----- if( the thread could not be woken ) ----------------
+
+	return result;
+}//----- End ----- xbee_coalesce_send( struct xbee_coalesce *, const void *, int )--
+
+
+/* @breif Writes the packet being gathered without waiting for the delay
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer
+ *
+ * @return :		0 - Success
+ *					2 - Writing to the port failed, now or before
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_flush( struct xbee_coalesce * coalesce )
+{
+	int result;
+
+	pthread_mutex_lock( &coalesce->lock );
+	result = write_packet( coalesce );
+	pthread_mutex_unlock( &coalesce->lock );
+
+	return result;
+}//----- End ----- xbee_coalesce_flush( struct xbee_coalesce * )---------
+
+
+/* @breif Writes what is still gathered and stops the thread
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer to stop
+ */
+void xbee_coalesce_stop( struct xbee_coalesce * coalesce )
+{
+	uint64_t signal = 1;
+
+	while( write( coalesce->stop_descriptor, &signal, sizeof(signal) ) < 0 )
+	{
+		if( errno == EINTR )
+			continue;
+
+		//Without the signal the thread never returns, it is cancelled in poll instead
+		printf( "\nStopping the coalescing thread failed with error[%d].\n", errno );
+		pthread_cancel( coalesce->thread );
+		break;
+	}//End ----- while( write < 0 ) ---------------------------------
+
+	pthread_join( coalesce->thread, NULL );
+
+	xbee_coalesce_flush( coalesce );
+
+	close( coalesce->wake_descriptor );
+	close( coalesce->stop_descriptor );
+	pthread_mutex_destroy( &coalesce->lock );
+}//----- End ----- xbee_coalesce_stop( struct xbee_coalesce * )----------
+
+
+/* @breif Prepares to read coalesced messages
+ *
+ * @param struct xbee_coalesce_reader * reader: The reader to initialize
+ * @param struct xbee * xbee: The xbee to read from, in transparent mode
+ */
+void xbee_coalesce_reader_init( struct xbee_coalesce_reader * reader, struct xbee * xbee )
+{
+	xbee_link_init( &reader->link, xbee );
+	reader->position = 0;
+}//----- End ----- xbee_coalesce_reader_init( struct xbee_coalesce_reader *, struct xbee * )--
+
+
+/* @breif Reads the next message, the rest of its packet is kept for the next calls
+ *
+ * @param struct xbee_coalesce_reader * reader: The reader
+ * @param void * buffer: The message is stored here
+ * @param int size: Size of buffer, a longer message is cut
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error reading from the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Bytes of the message
+ */
+int xbee_coalesce_read( struct xbee_coalesce_reader * reader, void * buffer, int size,
+						const struct timespec * deadline )
+{
+	const uint8_t * packet = reader->link.packet;
+	int length;
+	int result;
+
+	for( ;; )
+	{
+		if( reader->position > 0 && reader->position < reader->link.length )
+		{
+			length = packet[reader->position];
+
+			//A length running past the packet leaves nothing to trust after it
+			if( length > 0 && reader->position + 1 + length <= reader->link.length )
+			{
+				memcpy( buffer, packet + reader->position + 1, ( length < size ) ? length : size );
+				reader->position += 1 + length;
+
+				return ( length < size ) ? length : size;
+			}//End ----- if( the message is whole ) -------------------------
+		}//End ----- if( messages left in the packet ) ------------------
+
+		reader->position = 0;
+		result = xbee_link_receive( &reader->link, deadline );
+
+		if( result <= 0 )
+			return result;
+
+		if( packet[0] == XBEE_COALESCE_PACKET )
+			reader->position = 1;
+	}//End ----- for( ;; ) ------------------------------------------
+}//----- End ----- xbee_coalesce_read( struct xbee_coalesce_reader *, void *, int, const struct timespec * )--
@@ -0,0 +1,178 @@
+/** @file xbee_coalesce.h
+ ** @brief Coalescing of small messages into full RF packets
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a transmit mode for many small messages
+ *				over a transparent link. Instead of writing each message to
+ *				the port, where the xbee sends it as an RF packet of its own,
+ *				xbee_coalesce_send gathers the messages and writes them out
+ *				together as one packet(see xbee_link.h):
+ *
+ *					'C' | length(1) | message | length(1) | message ...
+ *
+ *				The packet is written once it reaches the byte threshold, or
+ *				once its oldest message has waited for the delay, whichever
+ *				comes first, like Nagle's algorithm. A thread of its own writes
+ *				the packets the delay flushes. The threshold counts the packet
+ *				as it goes on the wire, escaped bytes(see xbee_frame.h) twice.
+ *				By default it is the xbee's largest RF payload(ATNP) less the
+ *				framing with its length and checksum escaped too, and the delay
+ *				is the xbee's packetization timeout(ATRO), so a packet leaves
+ *				the xbee as one RF packet, no later than the xbee would send
+ *				the first message on its own.
+ *
+ *				At the other end xbee_coalesce_read splits the packets back
+ *				into messages. A packet damaged on the air is dropped whole.
+ *
+ *				Once a port has a coalescer all of its writes should go
+ *				through it, otherwise their bytes may be interleaved.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_COALESCE_H
+#define XBEE_COALESCE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "libxbee.h"
+#include "xbee_link.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Packet type
+#define XBEE_COALESCE_PACKET 'C'
+
+//Largest message, its length must fit its one byte prefix
+#define XBEE_COALESCE_MAX_MESSAGE 255
+
+//Most bytes of a frame around the packet: delimiter, and length and checksum
+//with every byte escaped
+#define XBEE_COALESCE_FRAMING 7
+
+//Threshold when ATNP can not be read, and the smallest one
+#define XBEE_COALESCE_DEFAULT_THRESHOLD 256
+#define XBEE_COALESCE_MIN_THRESHOLD 16
+
+//Delay when ATRO can not be read
+#define XBEE_COALESCE_DEFAULT_DELAY_MS 10
+
+struct xbee_coalesce
+{
+	pthread_mutex_t lock;			//Protects everything below but the descriptors
+	struct xbee_link link;			//Writes the packets
+	int wake_descriptor;			//eventfd that tells the thread a packet was started
+	int stop_descriptor;			//eventfd that tells the thread to stop
+	pthread_t thread;
+	int threshold;					//Escaped bytes of packet that make it go at once
+	int delay_ms;					//Longest wait of a message
+	uint8_t packet[XBEE_LINK_MAX_PACKET];
+	int length;						//Bytes in packet, 0 when nothing waits
+	int encoded;					//Bytes of packet once escaped
+	uint64_t oldest_ns;				//When the first message of packet came
+	int failed;						//TRUE once writing to the port failed
+
+	//Counters
+	unsigned long messages;			//Messages written
+	unsigned long packets;			//Packets they were written in
+	unsigned long delay_flushes;	//Packets written because the delay passed
+};
+
+//Splits packets back into messages
+struct xbee_coalesce_reader
+{
+	struct xbee_link link;
+	int position;					//Next message in link.packet, 0 when none is left
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Starts coalescing the messages written to an xbee
+ *
+ * @AT Command: ATNP, ATRO (only for a threshold or delay of 0, when the cached
+ *				value is missing or expired)
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer to start
+ * @param struct xbee * xbee: The xbee to write to, in transparent mode
+ * @param int delay_ms: Longest wait of a message, 0 to follow ATRO
+ * @param int threshold: Escaped bytes of packet that make it go at once, 0 to
+ *						 follow ATNP, at most XBEE_LINK_MAX_PACKET
+ *
+ * @return :		0 - Success
+ *					1 - Bad delay or threshold
+ *					2 - Failed to create the eventfds
+ *					3 - Failed to start the thread
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_start( struct xbee_coalesce *, struct xbee *, int, int );
+
+/* @breif Adds a message to the packet being gathered, safe to call from any thread
+ *
+ * Writes the packet first when the message does not fit in it, and after
+ * when the message brings it to the threshold.
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer
+ * @param const void * data: The message
+ * @param int length: Bytes in the message, from 1 to XBEE_COALESCE_MAX_MESSAGE,
+ *					  escaped it and its length byte must fit in the
+ *					  threshold less 1
+ *
+ * @return :		0 - Success
+ *					1 - The message is empty or too long
+ *					2 - Writing to the port failed, now or before
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_send( struct xbee_coalesce *, const void *, int );
+
+/* @breif Writes the packet being gathered without waiting for the delay
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer
+ *
+ * @return :		0 - Success
+ *					2 - Writing to the port failed, now or before
+ *			 Not Zero - Error
+ */
+int xbee_coalesce_flush( struct xbee_coalesce * );
+
+/* @breif Writes what is still gathered and stops the thread
+ *
+ * @param struct xbee_coalesce * coalesce: The coalescer to stop
+ */
+void xbee_coalesce_stop( struct xbee_coalesce * );
+
+/* @breif Prepares to read coalesced messages
+ *
+ * @param struct xbee_coalesce_reader * reader: The reader to initialize
+ * @param struct xbee * xbee: The xbee to read from, in transparent mode
+ */
+void xbee_coalesce_reader_init( struct xbee_coalesce_reader *, struct xbee * );
+
+/* @breif Reads the next message, the rest of its packet is kept for the next calls
+ *
+ * @param struct xbee_coalesce_reader * reader: The reader
+ * @param void * buffer: The message is stored here
+ * @param int size: Size of buffer, a longer message is cut
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error reading from the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Bytes of the message
+ */
+int xbee_coalesce_read( struct xbee_coalesce_reader *, void *, int, const struct timespec * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
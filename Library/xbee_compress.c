@@ -0,0 +1,411 @@
+/** @file xbee_compress.c
+ ** @brief Implementation of the xbee_compress.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_compress.h file.
+ *
+ *				The encoder lays the dictionary and the message out one after
+ *				the other and finds matches with hash chains over three byte
+ *				strings. The dictionary's chains are built by xbee_compress_init
+ *				and copied for every message, so a message only hashes itself.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "xbee_compress.h"
+
+//The trainer scores pieces of XBEE_COMPRESS_TRAIN_SEGMENT bytes by how many
+//samples hold each of their XBEE_COMPRESS_TRAIN_GRAM byte strings
+#define XBEE_COMPRESS_TRAIN_GRAM 6
+#define XBEE_COMPRESS_TRAIN_SEGMENT 32
+#define XBEE_COMPRESS_TRAIN_STEP 3
+#define XBEE_COMPRESS_TRAIN_HASH_BITS 16
+
+
+/* @breif Hashes the XBEE_COMPRESS_MIN_MATCH bytes at data
+ */
+static unsigned int hash( const uint8_t * data )
+{
+	uint32_t value = ( (uint32_t)data[0] << 16 ) | ( data[1] << 8 ) | data[2];
+
+	return ( value * 2654435761U ) >> ( 32 - XBEE_COMPRESS_HASH_BITS );
+}//----- End ----- hash( const uint8_t * )-------------------------------
+
+
+/* @breif Hashes the XBEE_COMPRESS_TRAIN_GRAM bytes at data(FNV-1a)
+ */
+static unsigned int gram_hash( const uint8_t * data )
+{
+	uint32_t value = 2166136261U;
+	int index;
+
+	for( index = 0; index < XBEE_COMPRESS_TRAIN_GRAM; index++ )
+		value = ( value ^ data[index] ) * 16777619U;
+
+	return value >> ( 32 - XBEE_COMPRESS_TRAIN_HASH_BITS );
+}//----- End ----- gram_hash( const uint8_t * )--------------------------
+
+
+/* @breif Prepares a dictionary
+ *
+ * Only the last XBEE_COMPRESS_MAX_DICTIONARY bytes of a longer dictionary are
+ * kept, the rest would be out of reach.
+ *
+ * @param struct xbee_compress * compress: The context to initialize
+ * @param const void * dictionary: The pre-shared bytes, may be NULL
+ * @param int length: Bytes in dictionary, 0 for none
+ */
+void xbee_compress_init( struct xbee_compress * compress, const void * dictionary, int length )
+{
+	unsigned int bucket;
+	int position;
+
+	if( dictionary == NULL || length < 0 )
+		length = 0;
+
+	if( length > XBEE_COMPRESS_MAX_DICTIONARY )
+	{
+		dictionary = (const uint8_t *)dictionary + length - XBEE_COMPRESS_MAX_DICTIONARY;
+		length = XBEE_COMPRESS_MAX_DICTIONARY;
+	}//End ----- if( too long ) -------------------------------------
+
+	if( length > 0 )
+		memcpy( compress->dictionary, dictionary, length );
+
+	compress->dictionary_length = length;
+	memset( compress->head, 0, sizeof(compress->head) );
+
+	for( position = 0; position + XBEE_COMPRESS_MIN_MATCH <= length; position++ )
+	{
+		bucket = hash( compress->dictionary + position );
+		compress->previous[position] = compress->head[bucket];
+		compress->head[bucket] = position + 1;
+	}//End ----- for( every string of the dictionary ) --------------
+}//----- End ----- xbee_compress_init( struct xbee_compress *, const void *, int )--
+
+
+/* @breif Builds a dictionary from sample messages
+ *
+ * Picks the pieces of the samples whose strings occur in the most samples,
+ * and puts the best ones last, where they are closest to every message.
+ *
+ * @param const uint8_t * const * samples: The sample messages
+ * @param const int * lengths: Bytes in each sample
+ * @param int count: Number of samples
+ * @param uint8_t * dictionary: The dictionary is stored here
+ * @param int size: Size of dictionary, at most XBEE_COMPRESS_MAX_DICTIONARY is used
+ *
+ * @return :	   -1 - Out of memory
+ *			 Not Zero - Bytes of dictionary, 0 when nothing occurs twice
+ */
+int xbee_compress_train( const uint8_t * const * samples, const int * lengths, int count,
+						 uint8_t * dictionary, int size )
+{
+	int buckets = 1 << XBEE_COMPRESS_TRAIN_HASH_BITS;
+	uint32_t * occurrences = calloc( buckets, sizeof(uint32_t) );
+	int * last_sample = malloc( buckets * sizeof(int) );
+	unsigned long score;
+	unsigned long best_score;
+	const uint8_t * best = NULL;
+	int best_length = 0;
+	int filled = 0;
+	int sample;
+	int start;
+	int length;
+	int index;
+	int piece;
+
+	if( occurrences == NULL || last_sample == NULL )
+	{
+		free( occurrences );
+		free( last_sample );
+		return -1;
+	}//End ----- if( out of memory ) --------------------------------
+
+	if( size > XBEE_COMPRESS_MAX_DICTIONARY )
+		size = XBEE_COMPRESS_MAX_DICTIONARY;
+
+	memset( last_sample, 0xFF, buckets * sizeof(int) );
+
+	//Count every string once per sample that holds it
+	for( sample = 0; sample < count; sample++ )
+	{
+		for( index = 0; index + XBEE_COMPRESS_TRAIN_GRAM <= lengths[sample]; index++ )
+		{
+			unsigned int bucket = gram_hash( samples[sample] + index );
+
+			if( last_sample[bucket] != sample )
+			{
+				occurrences[bucket]++;
+				last_sample[bucket] = sample;
+			}//End ----- if( first time in this sample ) --------------------
+		}//End ----- for( every string of the sample ) ------------------
+	}//End ----- for( sample < count ) ------------------------------
+
+	//A string only one sample holds will not help the next message
+	for( index = 0; index < buckets; index++ )
+	{
+		if( occurrences[index] < 2 )
+			occurrences[index] = 0;
+	}//End ----- for( index < buckets ) -----------------------------
+
+	//Fill the dictionary from its end, best piece first
+	while( filled < size )
+	{
+		best_score = 0;
+
+		for( sample = 0; sample < count; sample++ )
+		{
+			for( start = 0; start + XBEE_COMPRESS_TRAIN_GRAM <= lengths[sample]; start += XBEE_COMPRESS_TRAIN_STEP )
+			{
+				length = lengths[sample] - start;
+
+				if( length > XBEE_COMPRESS_TRAIN_SEGMENT )
+					length = XBEE_COMPRESS_TRAIN_SEGMENT;
+
+				score = 0;
+
+				for( index = 0; index + XBEE_COMPRESS_TRAIN_GRAM <= length; index++ )
+					score += occurrences[gram_hash( samples[sample] + start + index )];
+
+				if( score > best_score )
+				{
+					best_score = score;
+					best = samples[sample] + start;
+					best_length = length;
+				}//End ----- if( score > best_score ) ---------------------------
+			}//End ----- for( every piece of the sample ) -------------------
+		}//End ----- for( sample < count ) ------------------------------
+
+		if( best_score == 0 )
+			break;
+
+		piece = ( best_length < size - filled ) ? best_length : size - filled;
+		filled += piece;
+		memcpy( dictionary + size - filled, best, piece );
+
+		//What the dictionary holds scores nothing for the next pieces
+		for( index = 0; index + XBEE_COMPRESS_TRAIN_GRAM <= best_length; index++ )
+			occurrences[gram_hash( best + index )] = 0;
+	}//End ----- while( filled < size ) -----------------------------
+
+	memmove( dictionary, dictionary + size - filled, filled );
+
+	free( occurrences );
+	free( last_sample );
+
+	return filled;
+}//----- End ----- xbee_compress_train( const uint8_t * const *, const int *, int, uint8_t *, int )--
+
+
+/* @breif Compresses a message
+ *
+ * @param const struct xbee_compress * compress: The dictionary, NULL for none
+ * @param const uint8_t * input: The message
+ * @param int length: Bytes in input, at most XBEE_COMPRESS_MAX_INPUT
+ * @param uint8_t * output: The compressed message is stored here
+ * @param int size: Size of output
+ *
+ * @return :		0 - The message does not get shorter or does not fit,
+ *						send it as it is
+ *			 Not Zero - Bytes of compressed data in output, less than length
+ */
+int xbee_compress_encode( const struct xbee_compress * compress, const uint8_t * input, int length,
+						  uint8_t * output, int size )
+{
+	uint8_t window[XBEE_COMPRESS_MAX_DICTIONARY + XBEE_COMPRESS_MAX_INPUT];
+	uint16_t head[XBEE_COMPRESS_HASH_SIZE];
+	uint16_t previous[XBEE_COMPRESS_MAX_DICTIONARY + XBEE_COMPRESS_MAX_INPUT];
+	unsigned int bucket;
+	int start = 0;
+	int end;
+	int position;
+	int candidate;
+	int chain;
+	int match;
+	int limit;
+	int best_length;
+	int best_distance = 0;
+	int flags = 0;
+	int items = 0;
+	int written = 0;
+
+	if( length < 1 || length > XBEE_COMPRESS_MAX_INPUT )
+		return 0;
+
+	//Nothing can be saved once the output is as long as the message
+	if( size > length - 1 )
+		size = length - 1;
+
+	if( compress != NULL )
+	{
+		start = compress->dictionary_length;
+		memcpy( window, compress->dictionary, start );
+		memcpy( head, compress->head, sizeof(head) );
+		memcpy( previous, compress->previous, start * sizeof(uint16_t) );
+	}
+	else
+	{
+		memset( head, 0, sizeof(head) );
+	}//End ----- if( compress != NULL ) -----------------------------
+
+	memcpy( window + start, input, length );
+	end = start + length;
+	position = start;
+
+	while( position < end )
+	{
+		if( items % 8 == 0 )
+		{
+			if( written >= size )
+				return 0;
+
+			flags = written++;
+			output[flags] = 0;
+		}//End ----- if( a new group ) ----------------------------------
+
+		best_length = 0;
+		limit = end - position;
+
+		if( limit > XBEE_COMPRESS_MAX_MATCH )
+			limit = XBEE_COMPRESS_MAX_MATCH;
+
+		if( limit >= XBEE_COMPRESS_MIN_MATCH )
+		{
+			candidate = head[hash( window + position )];
+
+			for( chain = 0; candidate != 0 && chain < XBEE_COMPRESS_CHAIN; chain++ )
+			{
+				candidate--;
+
+				if( position - candidate > XBEE_COMPRESS_WINDOW )
+					break;
+
+				for( match = 0; match < limit && window[candidate + match] == window[position + match]; match++ );
+
+				if( match > best_length )
+				{
+					best_length = match;
+					best_distance = position - candidate;
+
+					if( match == limit )
+						break;
+				}//End ----- if( match > best_length ) --------------------------
+
+				candidate = previous[candidate];
+			}//End ----- for( chain < XBEE_COMPRESS_CHAIN ) -----------------
+		}//End ----- if( long enough for a match ) ----------------------
+
+		if( best_length >= XBEE_COMPRESS_MIN_MATCH )
+		{
+			if( written + 2 > size )
+				return 0;
+
+			output[flags] |= 1 << ( items % 8 );
+			output[written++] = ( best_distance - 1 ) >> 4;
+			output[written++] = ( ( best_distance - 1 ) << 4 ) | ( best_length - XBEE_COMPRESS_MIN_MATCH );
+		}
+		else
+		{
+			if( written + 1 > size )
+				return 0;
+
+			best_length = 1;
+			output[written++] = window[position];
+		}//End ----- if( a match ) --------------------------------------
+
+		items++;
+
+		//Every position covered is a candidate for later matches
+		for( ; best_length > 0; best_length--, position++ )
+		{
+			if( position + XBEE_COMPRESS_MIN_MATCH <= end )
+			{
+				bucket = hash( window + position );
+				previous[position] = head[bucket];
+				head[bucket] = position + 1;
+			}//End ----- if( a whole string is left ) -----------------------
+		}//End ----- for( best_length > 0 ) -----------------------------
+	}//End ----- while( position < end ) ----------------------------
+
+	return written;
+}//----- End ----- xbee_compress_encode( const struct xbee_compress *, const uint8_t *, int, uint8_t *, int )--
+
+
+/* @breif Decompresses a message
+ *
+ * @param const struct xbee_compress * compress: The dictionary it was
+ *												 compressed with, NULL for none
+ * @param const uint8_t * input: The compressed data
+ * @param int length: Bytes in input
+ * @param uint8_t * output: The message is stored here
+ * @param int size: Size of output
+ *
+ * @return :	   -1 - The data is damaged, was compressed with another
+ *						dictionary or does not fit in output
+ *			 Not Zero - Bytes of the message in output
+ */
+int xbee_compress_decode( const struct xbee_compress * compress, const uint8_t * input, int length,
+						  uint8_t * output, int size )
+{
+	const uint8_t * dictionary = NULL;
+	int dictionary_length = 0;
+	int position = 0;
+	int written = 0;
+	int distance;
+	int match;
+	int source;
+	int flags;
+	int item;
+
+	if( compress != NULL )
+	{
+		dictionary = compress->dictionary;
+		dictionary_length = compress->dictionary_length;
+	}//End ----- if( compress != NULL ) -----------------------------
+
+	while( position < length )
+	{
+		flags = input[position++];
+
+		for( item = 0; item < 8 && position < length; item++ )
+		{
+			if( !( flags & ( 1 << item ) ) )
+			{
+				if( written >= size )
+					return -1;
+
+				output[written++] = input[position++];
+				continue;
+			}//End ----- if( a literal ) ------------------------------------
+
+			if( position + 2 > length )
+				return -1;
+
+			distance = ( ( input[position] << 4 ) | ( input[position + 1] >> 4 ) ) + 1;
+			match = ( input[position + 1] & 0x0F ) + XBEE_COMPRESS_MIN_MATCH;
+			position += 2;
+
+			if( distance > written + dictionary_length || written + match > size )
+				return -1;
+
+			//Byte by byte, a match may overlap the bytes it produces
+			for( source = written - distance; match > 0; match--, source++ )
+			{
+				output[written++] = ( source < 0 ) ? dictionary[dictionary_length + source]
+												   : output[source];
+			}//End ----- for( match > 0 ) -----------------------------------
+		}//End ----- for( item < 8 ) ------------------------------------
+	}//End ----- while( position < length ) -------------------------
+
+	return written;
+}//----- End ----- xbee_compress_decode( const struct xbee_compress *, const uint8_t *, int, uint8_t *, int )--
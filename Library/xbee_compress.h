@@ -0,0 +1,132 @@
+/** @file xbee_compress.h
+ ** @brief Compression of short messages with a pre-shared dictionary
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes an LZSS codec small enough for every
+ *				message on a slow link. It needs no memory besides the stack
+ *				and a struct xbee_compress, and decoding is a single pass
+ *				without tables.
+ *
+ *				The compressed data is a list of groups: a flag byte followed
+ *				by up to eight items, bit 0 of the flags for the first one. A
+ *				clear bit is a literal byte, a set bit a back reference of two
+ *				bytes:
+ *
+ *					distance - 1(12 bits) | length - 3(4 bits)
+ *
+ *				that copies length bytes starting distance bytes back.
+ *
+ *				Short messages have little history to refer to, so both ends
+ *				may share a dictionary: bytes that are taken to come just
+ *				before every message. A dictionary trained on messages like
+ *				the ones that will be sent(see xbee_compress_train) lets even
+ *				the first bytes of a message be back references. Both ends
+ *				must use the same dictionary, byte for byte.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_COMPRESS_H
+#define XBEE_COMPRESS_H
+
+#include <stdint.h>
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Shortest and longest back reference
+#define XBEE_COMPRESS_MIN_MATCH 3
+#define XBEE_COMPRESS_MAX_MATCH 18
+
+//Farthest back reference, and so the largest useful dictionary
+#define XBEE_COMPRESS_WINDOW 4096
+#define XBEE_COMPRESS_MAX_DICTIONARY XBEE_COMPRESS_WINDOW
+
+//Largest message xbee_compress_encode takes
+#define XBEE_COMPRESS_MAX_INPUT 2048
+
+//Hash table of the match finder, and the candidates it tries per byte
+#define XBEE_COMPRESS_HASH_BITS 12
+#define XBEE_COMPRESS_HASH_SIZE ( 1 << XBEE_COMPRESS_HASH_BITS )
+#define XBEE_COMPRESS_CHAIN 32
+
+//A dictionary, prepared once for every message compressed with it
+struct xbee_compress
+{
+	uint8_t dictionary[XBEE_COMPRESS_MAX_DICTIONARY];
+	int dictionary_length;
+
+	//Hash chains of the dictionary: positions + 1, 0 ends a chain
+	uint16_t head[XBEE_COMPRESS_HASH_SIZE];
+	uint16_t previous[XBEE_COMPRESS_MAX_DICTIONARY];
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Prepares a dictionary
+ *
+ * Only the last XBEE_COMPRESS_MAX_DICTIONARY bytes of a longer dictionary are
+ * kept, the rest would be out of reach.
+ *
+ * @param struct xbee_compress * compress: The context to initialize
+ * @param const void * dictionary: The pre-shared bytes, may be NULL
+ * @param int length: Bytes in dictionary, 0 for none
+ */
+void xbee_compress_init( struct xbee_compress *, const void *, int );
+
+/* @breif Builds a dictionary from sample messages
+ *
+ * Picks the pieces of the samples whose strings occur in the most samples,
+ * and puts the best ones last, where they are closest to every message.
+ *
+ * @param const uint8_t * const * samples: The sample messages
+ * @param const int * lengths: Bytes in each sample
+ * @param int count: Number of samples
+ * @param uint8_t * dictionary: The dictionary is stored here
+ * @param int size: Size of dictionary, at most XBEE_COMPRESS_MAX_DICTIONARY is used
+ *
+ * @return :	   -1 - Out of memory
+ *			 Not Zero - Bytes of dictionary, 0 when nothing occurs twice
+ */
+int xbee_compress_train( const uint8_t * const *, const int *, int, uint8_t *, int );
+
+/* @breif Compresses a message
+ *
+ * @param const struct xbee_compress * compress: The dictionary, NULL for none
+ * @param const uint8_t * input: The message
+ * @param int length: Bytes in input, at most XBEE_COMPRESS_MAX_INPUT
+ * @param uint8_t * output: The compressed message is stored here
+ * @param int size: Size of output
+ *
+ * @return :		0 - The message does not get shorter or does not fit,
+ *						send it as it is
+ *			 Not Zero - Bytes of compressed data in output, less than length
+ */
+int xbee_compress_encode( const struct xbee_compress *, const uint8_t *, int, uint8_t *, int );
+
+/* @breif Decompresses a message
+ *
+ * @param const struct xbee_compress * compress: The dictionary it was
+ *												 compressed with, NULL for none
+ * @param const uint8_t * input: The compressed data
+ * @param int length: Bytes in input
+ * @param uint8_t * output: The message is stored here
+ * @param int size: Size of output
+ *
+ * @return :	   -1 - The data is damaged, was compressed with another
+ *						dictionary or does not fit in output
+ *			 Not Zero - Bytes of the message in output
+ */
+int xbee_compress_decode( const struct xbee_compress *, const uint8_t *, int, uint8_t *, int );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
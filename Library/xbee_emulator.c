@@ -0,0 +1,1154 @@
+/** @file xbee_emulator.c
+ ** @brief Implementation of the xbee_emulator.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_emulator.h file.
+ *
+ *				Everything the port sends is handled by the emulator thread.
+ *				Only writing to the pseudo terminal is shared with
+ *				xbee_emulator_inject and done under output_lock.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#define _GNU_SOURCE			//ptsname_r, cfmakeraw
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include "xbee_emulator.h"
+
+//Factory settings of the emulated xbee, restored by ATRE
+static const struct xbee_emulator_parameter parameter_defaults[XBEE_EMULATOR_PARAMETERS] =
+{
+	{ "MY", XBEE_EMULATOR_IP, "192.168.1.100" },
+	{ "MK", XBEE_EMULATOR_IP, "255.255.255.0" },
+	{ "GW", XBEE_EMULATOR_IP, "192.168.1.1" },
+	{ "DL", XBEE_EMULATOR_IP, "255.255.255.255" },
+	{ "ID", XBEE_EMULATOR_TEXT, "xbee" },
+	{ "CT", XBEE_EMULATOR_HEX, "64" },		//Command mode timeout, 100 ms units
+	{ "GT", XBEE_EMULATOR_HEX, "3E8" },		//Guard time, ms
+	{ "CC", XBEE_EMULATOR_HEX, "2B" },		//Command character, '+'
+	{ "BD", XBEE_EMULATOR_HEX, "3" },		//9600 baud
+	{ "AP", XBEE_EMULATOR_HEX, "0" },		//Transparent mode
+	{ "NP", XBEE_EMULATOR_HEX, "5DC" },		//Largest payload
+	{ "RO", XBEE_EMULATOR_HEX, "3" },		//Packetization timeout, character times
+	{ "DE", XBEE_EMULATOR_HEX, "2616" },	//Destination port
+	{ "C0", XBEE_EMULATOR_HEX, "2616" },	//Source port
+	{ "VR", XBEE_EMULATOR_HEX, "202F" }		//Firmware version
+};
+
+//Baud rates indexed by their ATBD code
+static const struct
+{
+	int bits_per_second;
+	speed_t speed;
+} baud_rates[BAUD_RATE_COUNT] =
+{
+	{ 1200, B1200 }, { 2400, B2400 }, { 4800, B4800 }, { 9600, B9600 },
+	{ 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 },
+	{ 115200, B115200 }, { 230400, B230400 }
+};
+
+//Most bytes the emulator thread reads at once
+#define INPUT_CHUNK 4096
+
+//Longest idle time a throttled UART catches up on in one read
+#define INPUT_BURST_MS 10
+
+//Where data injected in API mode seems to come from
+static const uint8_t peer_address[4] = { 192, 168, 1, 1 };
+
+
+/* @breif Milliseconds left until a deadline, rounded up
+ *
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC deadline
+ *
+ * @return :		0 - The deadline has passed
+ *			 Not Zero - Milliseconds left
+ */
+static int milliseconds_left( const struct timespec * deadline )
+{
+	struct timespec now;
+	long long left;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	left = ( deadline->tv_sec - now.tv_sec ) * 1000000000LL + ( deadline->tv_nsec - now.tv_nsec );
+
+	if( left <= 0 )
+		return 0;
+
+	return ( left + 999999 ) / 1000000;
+}//----- End ----- milliseconds_left( const struct timespec * )----------
+
+
+/* @breif Milliseconds since a point in time
+ *
+ * @param const struct timespec * then: CLOCK_MONOTONIC time in the past
+ *
+ * @return :		The milliseconds passed, rounded down
+ */
+static long long milliseconds_since( const struct timespec * then )
+{
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return ( now.tv_sec - then->tv_sec ) * 1000LL + ( now.tv_nsec - then->tv_nsec ) / 1000000;
+}//----- End ----- milliseconds_since( const struct timespec * )---------
+
+
+/* @breif Sleeps as long as the UART would take to send some bytes
+ *
+ * Each byte takes 10 bits on the wire, start and stop bit included. The time
+ * is added to a running clock, so many small transfers add up like one big one.
+ *
+ * @param struct timespec * next: When the UART is free again, updated
+ * @param size_t bytes: Number of bytes sent
+ * @param int baud_rate: Bits per second
+ */
+static void throttle( struct timespec * next, size_t bytes, int baud_rate )
+{
+	struct timespec now;
+	long long nanoseconds = bytes * 10 * 1000000000LL / baud_rate;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	if( next->tv_sec < now.tv_sec || ( next->tv_sec == now.tv_sec && next->tv_nsec < now.tv_nsec ) )
+		*next = now;
+
+	next->tv_sec += nanoseconds / 1000000000LL;
+	next->tv_nsec += nanoseconds % 1000000000LL;
+
+	if( next->tv_nsec >= 1000000000L )
+	{
+		next->tv_sec++;
+		next->tv_nsec -= 1000000000L;
+	}//End ----- if( next->tv_nsec >= 1000000000L ) -----------------
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL ) == EINTR );
+}//----- End ----- throttle( struct timespec *, size_t, int )-------------
+
+
+/* @breif Number of bytes the UART has received since the emulator last read
+ *
+ * Input is not slept on like output is, so an echo can go out while more
+ * input comes in, like on a real full duplex UART. At most INPUT_BURST_MS of
+ * idle time is counted.
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ *
+ * @return :		0 - Not even one byte yet
+ *			 Not Zero - Bytes that may be read, at most INPUT_CHUNK
+ */
+static int input_allowance( struct xbee_emulator * emulator )
+{
+	struct timespec now;
+	long long nanoseconds;
+	long long bytes;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	nanoseconds = ( now.tv_sec - emulator->input_free.tv_sec ) * 1000000000LL +
+				  ( now.tv_nsec - emulator->input_free.tv_nsec );
+
+	if( nanoseconds > INPUT_BURST_MS * 1000000LL )
+	{
+		nanoseconds = INPUT_BURST_MS * 1000000LL;
+		emulator->input_free = now;
+		emulator->input_free.tv_nsec -= nanoseconds;
+
+		if( emulator->input_free.tv_nsec < 0 )
+		{
+			emulator->input_free.tv_sec--;
+			emulator->input_free.tv_nsec += 1000000000L;
+		}//End ----- if( emulator->input_free.tv_nsec < 0 ) -------------
+	}//End ----- if( idle for long ) --------------------------------
+
+	if( nanoseconds <= 0 )
+		return 0;
+
+	bytes = nanoseconds * atomic_load( &emulator->applied_baud ) / 10 / 1000000000LL;
+
+	return ( bytes > INPUT_CHUNK ) ? INPUT_CHUNK : bytes;
+}//----- End ----- input_allowance( struct xbee_emulator * )-------------
+
+
+/* @breif Moves the input clock past bytes that have been read
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param size_t bytes: Number of bytes read
+ */
+static void input_used( struct xbee_emulator * emulator, size_t bytes )
+{
+	long long nanoseconds = bytes * 10 * 1000000000LL / atomic_load( &emulator->applied_baud );
+
+	emulator->input_free.tv_sec += nanoseconds / 1000000000LL;
+	emulator->input_free.tv_nsec += nanoseconds % 1000000000LL;
+
+	if( emulator->input_free.tv_nsec >= 1000000000L )
+	{
+		emulator->input_free.tv_sec++;
+		emulator->input_free.tv_nsec -= 1000000000L;
+	}//End ----- if( emulator->input_free.tv_nsec >= 1000000000L ) --
+}//----- End ----- input_used( struct xbee_emulator *, size_t )----------
+
+
+/* @breif Sends bytes to the port
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const void * data: The bytes
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - Success
+ *					1 - Writing to the pseudo terminal failed
+ */
+static int emit( struct xbee_emulator * emulator, const void * data, size_t length )
+{
+	const uint8_t * next = data;
+	size_t left = length;
+	struct pollfd watched[2];
+	ssize_t written;
+	int result = 0;
+
+	watched[0].fd = emulator->master_descriptor;
+	watched[0].events = POLLOUT;
+	watched[1].fd = emulator->stop_descriptor;
+	watched[1].events = POLLIN;
+
+	pthread_mutex_lock( &emulator->output_lock );
+
+	while( left > 0 )
+	{
+		written = write( emulator->master_descriptor, next, left );
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			//The program is not reading the port, wait for it unless the emulator stops
+			if( errno == EAGAIN &&
+				poll( watched, 2, -1 ) > 0 &&
+				!( watched[1].revents & POLLIN ) )
+				continue;
+
+			result = 1;
+			break;
+		}//End ----- if( written < 0 ) ----------------------------------
+
+		next += written;
+		left -= written;
+	}//End ----- while( left > 0 ) ----------------------------------
+
+	atomic_fetch_add( &emulator->bytes_sent, length - left );
+
+	if( emulator->options & XBEE_EMULATOR_THROTTLE )
+		throttle( &emulator->output_free, length - left, atomic_load( &emulator->applied_baud ) );
+
+	pthread_mutex_unlock( &emulator->output_lock );
+
+	return result;
+}//----- End ----- emit( struct xbee_emulator *, const void *, size_t )---
+
+
+/* @breif Encodes frame data in the current API mode and sends it to the port
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ *
+ * @return :		0 - Success
+ *					1 - The frame could not be encoded or written
+ */
+static int emit_frame( struct xbee_emulator * emulator, const uint8_t * data, int length )
+{
+	uint8_t frame[XBEE_FRAME_MAX_ENCODED];
+	int size = xbee_frame_encode( data, length, atomic_load( &emulator->api_mode ), frame, sizeof(frame) );
+
+	if( size < 0 )
+		return 1;
+
+	return emit( emulator, frame, size );
+}//----- End ----- emit_frame( struct xbee_emulator *, const uint8_t *, int )
+
+
+/* @breif Finds a parameter by its two letter command
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const char * command: The command, in any case
+ *
+ * @return :		 NULL - The emulator does not know the parameter
+ *			 Not NULL - The parameter
+ */
+static struct xbee_emulator_parameter * find_parameter( struct xbee_emulator * emulator,
+														const char * command )
+{
+	int index;
+
+	for( index = 0; index < XBEE_EMULATOR_PARAMETERS; index++ )
+	{
+		if( strncasecmp( emulator->parameters[index].command, command, 2 ) == 0 )
+			return &emulator->parameters[index];
+	}//End ----- for( index < XBEE_EMULATOR_PARAMETERS ) ------------
+
+	return NULL;
+}//----- End ----- find_parameter( struct xbee_emulator *, const char * )
+
+
+/* @breif Reads a hex parameter as a number
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const char * command: The parameter, e.g. "GT"
+ *
+ * @return :		The value
+ */
+static long parameter_number( struct xbee_emulator * emulator, const char * command )
+{
+	return strtol( find_parameter( emulator, command )->value, NULL, 16 );
+}//----- End ----- parameter_number( struct xbee_emulator *, const char * )
+
+
+/* @breif Stores a new value for a parameter after checking it
+ *
+ * @param struct xbee_emulator_parameter * parameter: The parameter
+ * @param const char * value: The value as text
+ *
+ * @return :		0 - Success
+ *					1 - The value is not valid for the parameter
+ */
+static int set_parameter( struct xbee_emulator_parameter * parameter, const char * value )
+{
+	struct in_addr address;
+	const char * digit;
+	long number;
+
+	if( parameter->type == XBEE_EMULATOR_HEX )
+	{
+		if( *value == '\0' || strlen( value ) > 8 )
+			return 1;
+
+		for( digit = value; *digit != '\0'; digit++ )
+		{
+			if( !isxdigit( (unsigned char) *digit ) )
+				return 1;
+		}//End ----- for( each digit ) ----------------------------------
+
+		number = strtol( value, NULL, 16 );
+
+		if( strcmp( parameter->command, "BD" ) == 0 && number >= BAUD_RATE_COUNT )
+			return 1;
+
+		if( strcmp( parameter->command, "AP" ) == 0 && number > XBEE_API_ESCAPED_MODE )
+			return 1;
+
+		snprintf( parameter->value, MAX_BUFFER_SIZE, "%lX", number );
+		return 0;
+	}//End ----- if( parameter->type == XBEE_EMULATOR_HEX ) ---------
+
+	if( parameter->type == XBEE_EMULATOR_IP && inet_pton( AF_INET, value, &address ) != 1 )
+		return 1;
+
+	snprintf( parameter->value, MAX_BUFFER_SIZE, "%s", value );
+
+	return 0;
+}//----- End ----- set_parameter( struct xbee_emulator_parameter *, const char * )
+
+
+/* @breif Makes ATAP and ATBD take effect, as ATAC and ATCN do
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ */
+static void apply_changes( struct xbee_emulator * emulator )
+{
+	int api_mode = parameter_number( emulator, "AP" );
+
+	if( api_mode != atomic_load( &emulator->api_mode ) )
+	{
+		atomic_store( &emulator->api_mode, api_mode );
+
+		if( api_mode != XBEE_TRANSPARENT_MODE )
+			xbee_frame_decoder_init( &emulator->decoder, api_mode );
+	}//End ----- if( the API mode changed ) -------------------------
+
+	atomic_store( &emulator->applied_baud,
+				  baud_rates[parameter_number( emulator, "BD" )].bits_per_second );
+}//----- End ----- apply_changes( struct xbee_emulator * )---------------
+
+
+/* @breif Restarts the command mode timeout, ATCT from now
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ */
+static void restart_command_timeout( struct xbee_emulator * emulator )
+{
+	deadline_after( &emulator->command_expires, parameter_number( emulator, "CT" ) * 100 );
+}//----- End ----- restart_command_timeout( struct xbee_emulator * )-----
+
+
+/* @breif Carries out one AT command of a command line
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param char * command: The command without "AT", e.g. "MY" or "ID mynet"
+ * @param char * answer: The answer is stored here, must hold MAX_BUFFER_SIZE
+ * @param int * after: Set to 'C' for ATCN and 'A' for ATAC, which take effect
+ *					   once the answer has been sent
+ */
+static void run_command( struct xbee_emulator * emulator, char * command, char * answer, int * after )
+{
+	struct xbee_emulator_parameter * parameter;
+	char * value;
+
+	atomic_fetch_add( &emulator->commands, 1 );
+
+	while( *command == ' ' )
+		command++;
+
+	strcpy( answer, "ERROR" );
+
+	if( strlen( command ) < 2 )
+		return;
+
+	value = command + 2;
+
+	while( *value == ' ' )
+		value++;
+
+	if( strncasecmp( command, "CN", 2 ) == 0 || strncasecmp( command, "AC", 2 ) == 0 )
+	{
+		*after = toupper( (unsigned char) command[0] );
+		strcpy( answer, "OK" );
+		return;
+	}//End ----- if( ATCN or ATAC ) ---------------------------------
+
+	if( strncasecmp( command, "WR", 2 ) == 0 )
+	{
+		memcpy( emulator->saved, emulator->parameters, sizeof(emulator->saved) );
+		strcpy( answer, "OK" );
+		return;
+	}//End ----- if( ATWR ) -----------------------------------------
+
+	if( strncasecmp( command, "RE", 2 ) == 0 )
+	{
+		memcpy( emulator->parameters, parameter_defaults, sizeof(emulator->parameters) );
+		strcpy( answer, "OK" );
+		return;
+	}//End ----- if( ATRE ) -----------------------------------------
+
+	parameter = find_parameter( emulator, command );
+
+	if( parameter == NULL )
+		return;
+
+	if( *value == '\0' )
+	{
+		strcpy( answer, parameter->value );
+		return;
+	}//End ----- if( reading the parameter ) ------------------------
+
+	if( set_parameter( parameter, value ) == 0 )
+		strcpy( answer, "OK" );
+}//----- End ----- run_command( struct xbee_emulator *, char *, char *, int * )
+
+
+/* @breif Answers a complete command line received in command mode
+ *
+ * Commands chained with commas are answered one line each, in order.
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ */
+static void run_line( struct xbee_emulator * emulator )
+{
+	char answers[MAX_BUFFER_SIZE * 2];
+	char answer[MAX_BUFFER_SIZE];
+	char * command;
+	char * next;
+	int length = 0;
+	int after = 0;
+
+	emulator->line[emulator->line_length] = '\0';
+	emulator->line_length = 0;
+
+	restart_command_timeout( emulator );
+
+	if( strncasecmp( emulator->line, "AT", 2 ) != 0 )
+	{
+		emit( emulator, "ERROR\r", 6 );
+		return;
+	}//End ----- if( the line does not start with AT ) --------------
+
+	if( emulator->line[2] == '\0' )
+	{
+		emit( emulator, "OK\r", 3 );
+		return;
+	}//End ----- if( a bare AT ) ------------------------------------
+
+	for( command = emulator->line + 2; command != NULL; command = next )
+	{
+		next = strchr( command, ',' );
+
+		if( next != NULL )
+			*next++ = '\0';
+
+		run_command( emulator, command, answer, &after );
+
+		//Answers are sent together, like the xbee does once the line is done
+		if( length + strlen( answer ) + 1 < sizeof(answers) )
+			length += sprintf( answers + length, "%s\r", answer );
+	}//End ----- for( each chained command ) ------------------------
+
+	emit( emulator, answers, length );
+
+	//Once more, so a new ATCT counts at once
+	restart_command_timeout( emulator );
+
+	if( after == 'A' )
+		apply_changes( emulator );
+
+	if( after == 'C' )
+	{
+		emulator->command_mode = FALSE;
+		apply_changes( emulator );
+	}//End ----- if( ATCN ) -----------------------------------------
+}//----- End ----- run_line( struct xbee_emulator * )--------------------
+
+
+/* @breif Handles data the port asked the xbee to send over the air
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const uint8_t * data: The payload
+ * @param size_t length: Number of bytes
+ */
+static void transmit( struct xbee_emulator * emulator, const uint8_t * data, size_t length )
+{
+	if( length > 0 && ( emulator->options & XBEE_EMULATOR_LOOPBACK ) )
+		emit( emulator, data, length );
+}//----- End ----- transmit( struct xbee_emulator *, const uint8_t *, size_t )
+
+
+/* @breif Turns a parameter's value into the bytes of an API response
+ *
+ * Numbers are sent big endian in as few bytes as they need, addresses as four
+ * bytes and text as it is.
+ *
+ * @param struct xbee_emulator_parameter * parameter: The parameter
+ * @param uint8_t * bytes: The value is stored here, must hold MAX_BUFFER_SIZE
+ *
+ * @return :		Number of bytes stored
+ */
+static int value_to_bytes( struct xbee_emulator_parameter * parameter, uint8_t * bytes )
+{
+	unsigned long number;
+	int length = 0;
+	int shift;
+
+	if( parameter->type == XBEE_EMULATOR_TEXT )
+	{
+		length = strlen( parameter->value );
+		memcpy( bytes, parameter->value, length );
+		return length;
+	}//End ----- if( parameter->type == XBEE_EMULATOR_TEXT ) --------
+
+	if( parameter->type == XBEE_EMULATOR_IP )
+	{
+		inet_pton( AF_INET, parameter->value, bytes );
+		return 4;
+	}//End ----- if( parameter->type == XBEE_EMULATOR_IP ) ----------
+
+	number = strtoul( parameter->value, NULL, 16 );
+
+	for( shift = 24; shift > 0 && ( number >> shift ) == 0; shift -= 8 );
+
+	for( ; shift >= 0; shift -= 8 )
+		bytes[length++] = number >> shift;
+
+	return length;
+}//----- End ----- value_to_bytes( struct xbee_emulator_parameter *, uint8_t * )
+
+
+/* @breif Turns the bytes of an API AT command into a parameter's text value
+ *
+ * @param struct xbee_emulator_parameter * parameter: The parameter
+ * @param const uint8_t * bytes: The value from the frame
+ * @param int length: Number of bytes
+ * @param char * value: The text is stored here, must hold MAX_BUFFER_SIZE
+ *
+ * @return :		0 - Success
+ *					1 - The bytes do not fit the parameter
+ */
+static int bytes_to_value( struct xbee_emulator_parameter * parameter,
+						   const uint8_t * bytes,
+						   int length,
+						   char * value )
+{
+	unsigned long number = 0;
+	int index;
+
+	if( parameter->type == XBEE_EMULATOR_TEXT )
+	{
+		if( length >= MAX_BUFFER_SIZE )
+			return 1;
+
+		memcpy( value, bytes, length );
+		value[length] = '\0';
+		return 0;
+	}//End ----- if( parameter->type == XBEE_EMULATOR_TEXT ) --------
+
+	if( parameter->type == XBEE_EMULATOR_IP )
+	{
+		if( length != 4 )
+			return 1;
+
+		sprintf( value, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3] );
+		return 0;
+	}//End ----- if( parameter->type == XBEE_EMULATOR_IP ) ----------
+
+	if( length > 4 )
+		return 1;
+
+	for( index = 0; index < length; index++ )
+		number = ( number << 8 ) | bytes[index];
+
+	sprintf( value, "%lX", number );
+
+	return 0;
+}//----- End ----- bytes_to_value( struct xbee_emulator_parameter *, ... )
+
+
+/* @breif Answers an API AT command frame(0x08 or 0x09)
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data, at least 4
+ */
+static void at_frame( struct xbee_emulator * emulator, const uint8_t * data, int length )
+{
+	struct xbee_emulator_parameter * parameter;
+	uint8_t response[4 + MAX_BUFFER_SIZE];
+	char command[3] = { data[2], data[3], '\0' };
+	char value[MAX_BUFFER_SIZE];
+	int size = 5;
+	int apply = ( data[0] == XBEE_API_AT_COMMAND );
+
+	atomic_fetch_add( &emulator->commands, 1 );
+
+	response[0] = XBEE_API_AT_RESPONSE;
+	response[1] = data[1];
+	response[2] = data[2];
+	response[3] = data[3];
+	response[4] = XBEE_AT_STATUS_OK;
+
+	parameter = find_parameter( emulator, command );
+
+	if( strcasecmp( command, "AC" ) == 0 || strcasecmp( command, "CN" ) == 0 )
+	{
+		apply = TRUE;
+	}
+	else if( strcasecmp( command, "WR" ) == 0 )
+	{
+		memcpy( emulator->saved, emulator->parameters, sizeof(emulator->saved) );
+	}
+	else if( strcasecmp( command, "RE" ) == 0 )
+	{
+		memcpy( emulator->parameters, parameter_defaults, sizeof(emulator->parameters) );
+	}
+	else if( parameter == NULL )
+	{
+		response[4] = XBEE_AT_STATUS_INVALID_COMMAND;
+	}
+	else if( length == 4 )
+	{
+		size += value_to_bytes( parameter, response + 5 );
+	}
+	else if( bytes_to_value( parameter, data + 4, length - 4, value ) != 0 ||
+			 set_parameter( parameter, value ) != 0 )
+	{
+		response[4] = XBEE_AT_STATUS_INVALID_PARAMETER;
+	}//End ----- if( which command ) --------------------------------
+
+	//The answer goes out in the mode the command came in
+	if( data[1] != 0 )
+		emit_frame( emulator, response, size );
+
+	if( apply == TRUE )
+		apply_changes( emulator );
+}//----- End ----- at_frame( struct xbee_emulator *, const uint8_t *, int )
+
+
+/* @breif Frame decoder callback, handles one frame sent by the port
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param void * arg: The emulator
+ */
+static void frame_received( const uint8_t * data, int length, void * arg )
+{
+	struct xbee_emulator * emulator = arg;
+	uint8_t reply[XBEE_FRAME_MAX_DATA];
+
+	switch( data[0] )
+	{
+		case XBEE_API_AT_COMMAND:
+		case XBEE_API_AT_QUEUE:
+			if( length >= 4 )
+				at_frame( emulator, data, length );
+			break;
+
+		case XBEE_API_TX_REQUEST:
+			//id, 64 bit address, 16 bit address, radius, options, payload
+			if( length < 14 )
+				break;
+
+			if( data[1] != 0 )
+			{
+				reply[0] = XBEE_API_TX_STATUS;
+				reply[1] = data[1];
+				reply[2] = 0xFF;		//16 bit address unknown
+				reply[3] = 0xFE;
+				reply[4] = 0;			//No retries
+				reply[5] = 0;			//Delivered
+				reply[6] = 0;			//No discovery needed
+				emit_frame( emulator, reply, 7 );
+			}//End ----- if( a status was asked for ) -----------------------
+
+			if( ( emulator->options & XBEE_EMULATOR_LOOPBACK ) && length > 14 )
+			{
+				reply[0] = XBEE_API_RX_PACKET;
+				memcpy( reply + 1, data + 2, 8 );	//The peer answers from the address sent to
+				reply[9] = 0xFF;
+				reply[10] = 0xFE;
+				reply[11] = 0x01;					//Acknowledged
+				memcpy( reply + 12, data + 14, length - 14 );
+				emit_frame( emulator, reply, length - 2 );
+			}//End ----- if( loopback ) -------------------------------------
+			break;
+
+		case XBEE_API_TX_IPV4:
+			//id, address, destination port, source port, protocol, options, payload
+			if( length < 12 )
+				break;
+
+			if( data[1] != 0 )
+			{
+				reply[0] = XBEE_API_TX_STATUS_IPV4;
+				reply[1] = data[1];
+				reply[2] = 0;			//Success
+				emit_frame( emulator, reply, 3 );
+			}//End ----- if( a status was asked for ) -----------------------
+
+			if( ( emulator->options & XBEE_EMULATOR_LOOPBACK ) && length > 12 )
+			{
+				reply[0] = XBEE_API_RX_IPV4;
+				memcpy( reply + 1, data + 2, 4 );	//Source address
+				memcpy( reply + 5, data + 8, 2 );	//Sent to the port it came from
+				memcpy( reply + 7, data + 6, 2 );	//Sent from the port it went to
+				reply[9] = data[10];				//Protocol
+				reply[10] = 0;						//Status
+				memcpy( reply + 11, data + 12, length - 12 );
+				emit_frame( emulator, reply, length - 1 );
+			}//End ----- if( loopback ) -------------------------------------
+			break;
+	}//End ----- switch( data[0] ) ----------------------------------
+}//----- End ----- frame_received( const uint8_t *, int, void * )--------
+
+
+/* @breif Handles bytes the port sent while the xbee is in transparent mode
+ *
+ * Command characters are held back until it is clear whether they form a
+ * "+++" with guard times of silence around it. Everything else is data.
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const uint8_t * bytes: The bytes
+ * @param int count: Number of bytes
+ */
+static void transparent_input( struct xbee_emulator * emulator, const uint8_t * bytes, int count )
+{
+	uint8_t data[4096 + 3];
+	long long guard_ms = parameter_number( emulator, "GT" );
+	uint8_t command_character = parameter_number( emulator, "CC" );
+	long long silence = milliseconds_since( &emulator->last_input );
+	size_t length = 0;
+	int index;
+
+	for( index = 0; index < count; index++ )
+	{
+		//Only the first byte of a read can follow a silence
+		if( index > 0 )
+			silence = 0;
+
+		//A byte within the guard time after "+++", or a broken "+++", makes it data
+		if( emulator->pluses == 3 ||
+			( emulator->pluses > 0 && ( bytes[index] != command_character || silence >= guard_ms ) ) )
+		{
+			memset( data + length, command_character, emulator->pluses );
+			length += emulator->pluses;
+			emulator->pluses = 0;
+		}//End ----- if( not a "+++" after all ) ------------------------
+
+		if( bytes[index] == command_character &&
+			( emulator->pluses > 0 || silence >= guard_ms ) )
+		{
+			emulator->pluses++;
+
+			if( emulator->pluses == 3 )
+				deadline_after( &emulator->plus_expires, guard_ms );
+
+			continue;
+		}//End ----- if( part of a "+++" ) ------------------------------
+
+		data[length++] = bytes[index];
+	}//End ----- for( index < count ) -------------------------------
+
+	transmit( emulator, data, length );
+}//----- End ----- transparent_input( struct xbee_emulator *, ... )-----
+
+
+/* @breif Handles bytes the port sent
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const uint8_t * bytes: The bytes
+ * @param int count: Number of bytes
+ */
+static void input( struct xbee_emulator * emulator, const uint8_t * bytes, int count )
+{
+	int index;
+
+	if( emulator->command_mode == TRUE )
+	{
+		for( index = 0; index < count; index++ )
+		{
+			if( bytes[index] == '\n' )
+				continue;
+
+			if( bytes[index] != '\r' )
+			{
+				if( emulator->line_length < MAX_BUFFER_SIZE - 1 )
+					emulator->line[emulator->line_length++] = bytes[index];
+
+				continue;
+			}//End ----- if( not the end of the command ) -------------------
+
+			run_line( emulator );
+
+			//Bytes sent after ATCN are data again
+			if( emulator->command_mode == FALSE )
+			{
+				input( emulator, bytes + index + 1, count - index - 1 );
+				return;
+			}//End ----- if( left command mode ) ----------------------------
+		}//End ----- for( index < count ) -------------------------------
+	}
+	else if( atomic_load( &emulator->api_mode ) != XBEE_TRANSPARENT_MODE )
+	{
+		xbee_frame_decode( &emulator->decoder, bytes, count, frame_received, emulator );
+	}
+	else
+	{
+		transparent_input( emulator, bytes, count );
+	}//End ----- if( emulator->command_mode == TRUE ) ---------------
+}//----- End ----- input( struct xbee_emulator *, const uint8_t *, int )-
+
+
+/* @breif Checks that the port runs at the emulated xbee's baud rate
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ *
+ * @return :	 TRUE - The rates match, or throttling is off
+ *			   FALSE - The bytes would arrive garbled
+ */
+static int rates_match( struct xbee_emulator * emulator )
+{
+	struct termios settings;
+	int baud_rate = atomic_load( &emulator->applied_baud );
+	int code;
+
+	if( !( emulator->options & XBEE_EMULATOR_THROTTLE ) ||
+		tcgetattr( emulator->slave_descriptor, &settings ) != 0 )
+		return TRUE;
+
+	for( code = 0; code < BAUD_RATE_COUNT; code++ )
+	{
+		if( baud_rates[code].bits_per_second == baud_rate )
+			return cfgetispeed( &settings ) == baud_rates[code].speed;
+	}//End ----- for( code < BAUD_RATE_COUNT ) ----------------------
+
+	return TRUE;
+}//----- End ----- rates_match( struct xbee_emulator * )-----------------
+
+
+/* @breif Body of the emulator thread
+ *
+ * Sleeps in poll until the port sends something, the stop eventfd is
+ * signalled or a guard time or command mode timeout runs out.
+ *
+ * @param void * arg: The emulator
+ *
+ * @return :		NULL
+ */
+static void * run_emulator( void * arg )
+{
+	struct xbee_emulator * emulator = arg;
+	struct pollfd watched[2];
+	struct timespec arrived;
+	uint8_t buffer[INPUT_CHUNK];
+	ssize_t count;
+	int allowance = INPUT_CHUNK;
+	int wait_ms;
+
+	watched[0].fd = emulator->master_descriptor;
+	watched[1].fd = emulator->stop_descriptor;
+	watched[1].events = POLLIN;
+
+	while( 1 )
+	{
+		wait_ms = -1;
+
+		if( emulator->pluses == 3 )
+			wait_ms = milliseconds_left( &emulator->plus_expires );
+		else if( emulator->command_mode == TRUE )
+			wait_ms = milliseconds_left( &emulator->command_expires );
+
+		//A throttled UART that has not received a byte yet is not worth reading
+		if( emulator->options & XBEE_EMULATOR_THROTTLE )
+		{
+			allowance = input_allowance( emulator );
+
+			if( allowance == 0 && ( wait_ms < 0 || wait_ms > 1 ) )
+				wait_ms = 1;
+		}//End ----- if( throttled ) ------------------------------------
+
+		watched[0].events = ( allowance > 0 ) ? POLLIN : 0;
+		watched[0].revents = 0;
+		watched[1].revents = 0;
+
+		if( wait_ms != 0 && poll( watched, 2, wait_ms ) < 0 && errno != EINTR )
+			break;
+
+		if( watched[1].revents & POLLIN )
+			break;
+
+		//Silence after "+++" for the guard time enters command mode
+		if( emulator->pluses == 3 && milliseconds_left( &emulator->plus_expires ) == 0 )
+		{
+			emulator->pluses = 0;
+			emulator->command_mode = TRUE;
+			emulator->line_length = 0;
+			restart_command_timeout( emulator );
+			emit( emulator, "OK\r", 3 );
+		}//End ----- if( "+++" completed ) ------------------------------
+
+		//ATCT of silence ends command mode
+		if( emulator->command_mode == TRUE && milliseconds_left( &emulator->command_expires ) == 0 )
+		{
+			emulator->command_mode = FALSE;
+			apply_changes( emulator );
+		}//End ----- if( command mode timed out ) -----------------------
+
+		if( !( watched[0].revents & ( POLLIN | POLLHUP ) ) )
+			continue;
+
+		count = read( emulator->master_descriptor, buffer, allowance );
+
+		if( count <= 0 )
+		{
+			if( count < 0 && ( errno == EAGAIN || errno == EINTR ) )
+				continue;
+
+			break;
+		}//End ----- if( count <= 0 ) -----------------------------------
+
+		clock_gettime( CLOCK_MONOTONIC, &arrived );
+		atomic_fetch_add( &emulator->bytes_received, count );
+
+		if( emulator->options & XBEE_EMULATOR_THROTTLE )
+			input_used( emulator, count );
+
+		if( rates_match( emulator ) == TRUE )
+			input( emulator, buffer, count );
+		else
+			emulator->pluses = 0;		//The xbee only sees noise
+
+		//Answers may have taken a while to send, silence is counted from the input
+		emulator->last_input = arrived;
+	}//End ----- while( 1 ) -----------------------------------------
+
+	return NULL;
+}//----- End ----- run_emulator( void * )--------------------------------
+
+
+/* @breif Creates the pseudo terminal and starts the emulated xbee
+ *
+ * The xbee starts in transparent mode with factory defaults at 9600 baud.
+ *
+ * Header files needed: stdlib.h(posix_openpt)
+ *						pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_emulator * emulator: The emulator to start
+ * @param int guard_time_ms: ATGT in milliseconds, XBEE_EMULATOR_DEFAULT_GUARD
+ *							 keeps the xbee's one second
+ * @param int options: XBEE_EMULATOR_LOOPBACK and/or XBEE_EMULATOR_THROTTLE
+ *
+ * @return :		0 - Success
+ *					1 - Failed to create the pseudo terminal
+ *					2 - Failed to create the eventfd
+ *					3 - Failed to start the thread
+ *			 Not Zero - Error
+ */
+int xbee_emulator_start( struct xbee_emulator * emulator, int guard_time_ms, int options )
+{
+	struct termios settings;
+	char guard[16];
+
+	memset( emulator, 0, sizeof(*emulator) );
+
+	emulator->options = options;
+	emulator->slave_descriptor = -1;
+	emulator->stop_descriptor = -1;
+	memcpy( emulator->parameters, parameter_defaults, sizeof(emulator->parameters) );
+	memcpy( emulator->saved, parameter_defaults, sizeof(emulator->saved) );
+
+	if( guard_time_ms != XBEE_EMULATOR_DEFAULT_GUARD )
+	{
+		sprintf( guard, "%X", guard_time_ms );
+		set_parameter( find_parameter( emulator, "GT" ), guard );
+	}//End ----- if( a guard time was given ) -----------------------
+
+	atomic_init( &emulator->api_mode, XBEE_TRANSPARENT_MODE );
+	atomic_init( &emulator->applied_baud, DEFAULT_BAUD_RATE );
+	pthread_mutex_init( &emulator->output_lock, NULL );
+
+	emulator->master_descriptor = posix_openpt( O_RDWR | O_NOCTTY | O_CLOEXEC );
+
+	if( emulator->master_descriptor < 0 ||
+		fcntl( emulator->master_descriptor, F_SETFL, O_NONBLOCK ) != 0 ||
+		grantpt( emulator->master_descriptor ) != 0 ||
+		unlockpt( emulator->master_descriptor ) != 0 ||
+		ptsname_r( emulator->master_descriptor, emulator->port_name, MAX_BUFFER_SIZE ) != 0 )
+	{
+		printf( "\nCreating the emulator's pseudo terminal failed with error[%d].\n",
+				errno );
+
+		xbee_emulator_stop( emulator );
+		return 1;
+	}//End ----- if( posix_openpt failed ) --------------------------
+
+	//Holding the slave open keeps reads from failing while no program has the port open.
+	//It also starts raw, a real serial port does not echo or translate either.
+	emulator->slave_descriptor = open( emulator->port_name, O_RDWR | O_NOCTTY | O_CLOEXEC );
+
+	if( emulator->slave_descriptor < 0 || tcgetattr( emulator->slave_descriptor, &settings ) != 0 )
+	{
+		printf( "\nOpening the emulator's pseudo terminal[%s] failed with error[%d].\n",
+				emulator->port_name,
+				errno );
+
+		xbee_emulator_stop( emulator );
+		return 1;
+	}//End ----- if( opening the slave failed ) ---------------------
+
+	cfmakeraw( &settings );
+	cfsetspeed( &settings, B9600 );
+	tcsetattr( emulator->slave_descriptor, TCSANOW, &settings );
+
+	emulator->stop_descriptor = eventfd( 0, EFD_CLOEXEC );
+
+	if( emulator->stop_descriptor < 0 )
+	{
+		xbee_emulator_stop( emulator );
+		return 2;
+	}//End ----- if( emulator->stop_descriptor < 0 ) ----------------
+
+	if( pthread_create( &emulator->thread, NULL, run_emulator, emulator ) != 0 )
+	{
+		close( emulator->stop_descriptor );
+		emulator->stop_descriptor = -1;
+		xbee_emulator_stop( emulator );
+		return 3;
+	}//End ----- if( pthread_create != 0 ) --------------------------
+
+	return 0;
+}//----- End ----- xbee_emulator_start( struct xbee_emulator *, int, int )
+
+
+/* @breif Makes data arrive from the air, safe to call from any thread
+ *
+ * In transparent mode the bytes are sent to the port as they are, in API mode
+ * they are wrapped in a receive frame.
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const void * data: The received bytes
+ * @param size_t length: Number of bytes, at most XBEE_FRAME_MAX_DATA - 16 in API mode
+ *
+ * @return :		0 - Success
+ *					1 - Writing to the pseudo terminal failed
+ *			 Not Zero - Error
+ */
+int xbee_emulator_inject( struct xbee_emulator * emulator, const void * data, size_t length )
+{
+	uint8_t frame[XBEE_FRAME_MAX_DATA];
+
+	if( atomic_load( &emulator->api_mode ) == XBEE_TRANSPARENT_MODE )
+		return emit( emulator, data, length );
+
+	if( length > XBEE_FRAME_MAX_DATA - 16 )
+		return 1;
+
+	frame[0] = XBEE_API_RX_IPV4;
+	memcpy( frame + 1, peer_address, 4 );
+	frame[5] = 0x26;		//Both ports 0x2616, the xbee's default
+	frame[6] = 0x16;
+	frame[7] = 0x26;
+	frame[8] = 0x16;
+	frame[9] = 0;			//UDP
+	frame[10] = 0;
+	memcpy( frame + 11, data, length );
+
+	return emit_frame( emulator, frame, length + 11 );
+}//----- End ----- xbee_emulator_inject( struct xbee_emulator *, const void *, size_t )
+
+
+/* @breif Stops the emulator and closes the pseudo terminal
+ *
+ * @param struct xbee_emulator * emulator: The emulator to stop
+ */
+void xbee_emulator_stop( struct xbee_emulator * emulator )
+{
+	uint64_t signal = 1;
+
+	if( emulator->stop_descriptor >= 0 )
+	{
+		if( write( emulator->stop_descriptor, &signal, sizeof(signal) ) == sizeof(signal) )
+			pthread_join( emulator->thread, NULL );
+
+		close( emulator->stop_descriptor );
+	}//End ----- if( emulator->stop_descriptor >= 0 ) ---------------
+
+	if( emulator->slave_descriptor >= 0 )
+		close( emulator->slave_descriptor );
+
+	if( emulator->master_descriptor >= 0 )
+		close( emulator->master_descriptor );
+
+	emulator->stop_descriptor = -1;
+	emulator->slave_descriptor = -1;
+	emulator->master_descriptor = -1;
+
+	pthread_mutex_destroy( &emulator->output_lock );
+}//----- End ----- xbee_emulator_stop( struct xbee_emulator * )----------
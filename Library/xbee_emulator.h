@@ -0,0 +1,154 @@
+/** @file xbee_emulator.h
+ ** @brief Emulated xbee module behind a pseudo terminal
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes an xbee emulator for testing and benchmarking
+ *				without a radio. It creates a pseudo terminal and answers on it
+ *				the way an xbee answers on its serial port. The library, the
+ *				proof of concept or any other program opens port_name as if it
+ *				were /dev/ttyUSB0.
+ *
+ *				The emulator runs in a thread of its own and understands:
+ *					+++				Command mode, with guard times of silence
+ *									before and after, ATGT long
+ *					AT<cmd>[<value>]Reading and setting the parameters in
+ *									parameter_defaults, chained with commas
+ *					ATCN, ATAC		Leaving command mode and applying changes
+ *					ATWR, ATRE		Saving the parameters and restoring defaults
+ *					API frames		With ATAP 1 or 2: AT commands(0x08, 0x09)
+ *									and transmit requests(0x10, 0x20)
+ *				Command mode ends on its own after ATCT of silence.
+ *
+ *				Data sent in transparent mode, or in transmit requests, is
+ *				either dropped or sent back as if a peer echoed it. Bytes can
+ *				also be made to arrive from the air with xbee_emulator_inject.
+ *				With XBEE_EMULATOR_THROTTLE the emulator only moves ATBD bytes
+ *				per second each way and ignores a port set to another rate.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_EMULATOR_H
+#define XBEE_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_frame.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Options of xbee_emulator_start
+#define XBEE_EMULATOR_LOOPBACK 0x01		//Echo data sent to the air back to the port
+#define XBEE_EMULATOR_THROTTLE 0x02		//Move data no faster than ATBD allows
+
+//Guard time that keeps the emulated xbee's ATGT
+#define XBEE_EMULATOR_DEFAULT_GUARD -1
+
+//Number of parameters the emulator knows, see parameter_defaults in xbee_emulator.c
+#define XBEE_EMULATOR_PARAMETERS 15
+
+//Kinds of parameter values
+#define XBEE_EMULATOR_HEX 0				//A number written in hex, e.g. "3E8"
+#define XBEE_EMULATOR_IP 1				//A dotted IPv4 address
+#define XBEE_EMULATOR_TEXT 2			//Any string, e.g. the SSID in ID
+
+struct xbee_emulator_parameter
+{
+	char command[3];
+	int type;							//XBEE_EMULATOR_HEX, IP or TEXT
+	char value[MAX_BUFFER_SIZE];
+};
+
+struct xbee_emulator
+{
+	char port_name[MAX_BUFFER_SIZE];	//The pseudo terminal to open
+	int master_descriptor;				//The emulator's end of the pseudo terminal
+	int slave_descriptor;				//Kept open so the port never hangs up
+	int stop_descriptor;				//eventfd that tells the thread to stop
+	int options;						//XBEE_EMULATOR_LOOPBACK and THROTTLE
+	pthread_t thread;
+
+	//Only used by the emulator thread
+	struct xbee_emulator_parameter parameters[XBEE_EMULATOR_PARAMETERS];
+	struct xbee_emulator_parameter saved[XBEE_EMULATOR_PARAMETERS];	//Written by ATWR
+	int command_mode;					//TRUE between +++ and ATCN or ATCT of silence
+	struct timespec command_expires;
+	int pluses;							//Command characters seen of a possible +++
+	struct timespec last_input;			//When the last byte arrived
+	struct timespec plus_expires;		//When a complete +++ turns into command mode
+	char line[MAX_BUFFER_SIZE];			//Command being received
+	int line_length;
+	atomic_int api_mode;				//ATAP as applied, also read by xbee_emulator_inject
+	atomic_int applied_baud;			//ATBD as applied in bits per second, also read by xbee_emulator_inject
+	struct xbee_frame_decoder decoder;
+	struct timespec input_free;			//When the throttled UART had received all bytes read so far
+
+	//Shared with xbee_emulator_inject
+	pthread_mutex_t output_lock;
+	struct timespec output_free;		//When a throttled output byte may be sent
+
+	atomic_ulong bytes_received;		//Bytes the port sent to the emulator
+	atomic_ulong bytes_sent;			//Bytes the emulator sent to the port
+	atomic_ulong commands;				//AT commands answered, in either mode
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Creates the pseudo terminal and starts the emulated xbee
+ *
+ * The xbee starts in transparent mode with factory defaults at 9600 baud.
+ *
+ * Header files needed: stdlib.h(posix_openpt)
+ *						pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_emulator * emulator: The emulator to start
+ * @param int guard_time_ms: ATGT in milliseconds, XBEE_EMULATOR_DEFAULT_GUARD
+ *							 keeps the xbee's one second
+ * @param int options: XBEE_EMULATOR_LOOPBACK and/or XBEE_EMULATOR_THROTTLE
+ *
+ * @return :		0 - Success
+ *					1 - Failed to create the pseudo terminal
+ *					2 - Failed to create the eventfd
+ *					3 - Failed to start the thread
+ *			 Not Zero - Error
+ */
+int xbee_emulator_start( struct xbee_emulator *, int, int );
+
+/* @breif Makes data arrive from the air, safe to call from any thread
+ *
+ * In transparent mode the bytes are sent to the port as they are, in API mode
+ * they are wrapped in a receive frame.
+ *
+ * @param struct xbee_emulator * emulator: The emulator
+ * @param const void * data: The received bytes
+ * @param size_t length: Number of bytes, at most XBEE_FRAME_MAX_DATA - 16 in API mode
+ *
+ * @return :		0 - Success
+ *					1 - Writing to the pseudo terminal failed
+ *			 Not Zero - Error
+ */
+int xbee_emulator_inject( struct xbee_emulator *, const void *, size_t );
+
+/* @breif Stops the emulator and closes the pseudo terminal
+ *
+ * @param struct xbee_emulator * emulator: The emulator to stop
+ */
+void xbee_emulator_stop( struct xbee_emulator * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,343 @@
+/** @file xbee_frame.c
+ ** @brief Implementation of the xbee_frame.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_frame.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <string.h>
+#include "xbee_frame.h"
+
+//Parts of a frame the decoder can be waiting for
+#define STATE_DELIMITER 0
+#define STATE_LENGTH_MSB 1
+#define STATE_LENGTH_LSB 2
+#define STATE_DATA 3
+#define STATE_CHECKSUM 4
+
+
+/* @breif Tells whether a byte has to be escaped in XBEE_API_ESCAPED_MODE
+ *
+ * @param uint8_t byte: The byte to check
+ *
+ * @return :		0 - The byte is sent as is
+ *					1 - The byte must be escaped
+ */
+static int needs_escape( uint8_t byte )
+{
+	return ( byte == XBEE_FRAME_DELIMITER ||
+			 byte == XBEE_FRAME_ESCAPE ||
+			 byte == XBEE_FRAME_XON ||
+			 byte == XBEE_FRAME_XOFF );
+}//----- End ----- needs_escape( uint8_t )--------------------------------
+
+
+/* @breif Stores one byte of an encoded frame, escaping it when needed
+ *
+ * @param uint8_t byte: The byte to store
+ * @param int mode: XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ * @param uint8_t * frame: The encoded frame
+ * @param int * used: Bytes of frame used so far, updated
+ * @param int size: Size of frame
+ *
+ * @return :		0 - Success
+ *					1 - frame is full
+ */
+static int put_byte( uint8_t byte, int mode, uint8_t * frame, int * used, int size )
+{
+	if( mode == XBEE_API_ESCAPED_MODE && needs_escape( byte ) )
+	{
+		if( *used + 2 > size )
+			return 1;
+
+		frame[(*used)++] = XBEE_FRAME_ESCAPE;
+		frame[(*used)++] = byte ^ XBEE_FRAME_ESCAPE_XOR;
+	}
+	else
+	{
+		if( *used + 1 > size )
+			return 1;
+
+		frame[(*used)++] = byte;
+	}//End ----- if( byte must be escaped ) -------------------------
+
+	return 0;
+}//----- End ----- put_byte( uint8_t, int, uint8_t *, int *, int )-------
+
+
+/* @breif Encodes frame data into a frame ready to be written to the port
+ *
+ * @param const uint8_t * data: The frame data, data[0] is the API identifier
+ * @param int length: Number of bytes in data, at most XBEE_FRAME_MAX_DATA
+ * @param int mode: XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ * @param uint8_t * frame: The encoded frame is stored here
+ * @param int size: Size of frame, XBEE_FRAME_MAX_ENCODED is always enough
+ *
+ * @return :	   -1 - The data is too long or frame is too small
+ *			 Not Negative - Number of bytes stored in frame
+ */
+int xbee_frame_encode( const uint8_t * data, int length, int mode, uint8_t * frame, int size )
+{
+	uint8_t checksum = 0;
+	int used = 0;
+	int index;
+
+	if( length < 1 || length > XBEE_FRAME_MAX_DATA || size < 1 )
+		return -1;
+
+	frame[used++] = XBEE_FRAME_DELIMITER;	//The delimiter itself is never escaped
+
+	if( put_byte( length >> 8, mode, frame, &used, size ) != 0 ||
+		put_byte( length & 0xFF, mode, frame, &used, size ) != 0 )
+	{
+		return -1;
+	}//End ----- if( put_byte != 0 ) --------------------------------
+
+	if( mode != XBEE_API_ESCAPED_MODE )
+	{
+		//Nothing to escape, copy the data in one go
+		if( used + length + 1 > size )
+			return -1;
+
+		memcpy( frame + used, data, length );
+		used += length;
+
+		for( index = 0; index < length; index++ )
+			checksum += data[index];
+	}
+	else
+	{
+		for( index = 0; index < length; index++ )
+		{
+			if( put_byte( data[index], mode, frame, &used, size ) != 0 )
+				return -1;
+
+			checksum += data[index];
+		}//End ----- for( index < length ) ------------------------------
+	}//End ----- if( mode != XBEE_API_ESCAPED_MODE ) ----------------
+
+	if( put_byte( 0xFF - checksum, mode, frame, &used, size ) != 0 )
+		return -1;
+
+	return used;
+}//----- End ----- xbee_frame_encode( const uint8_t *, int, ... )--------
+
+
+/* @breif Prepares a decoder to receive frames
+ *
+ * @param struct xbee_frame_decoder * decoder: The decoder to initialize
+ * @param int mode: XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ */
+void xbee_frame_decoder_init( struct xbee_frame_decoder * decoder, int mode )
+{
+	decoder->mode = mode;
+	decoder->state = STATE_DELIMITER;
+	decoder->escaped = 0;
+	decoder->length = 0;
+	decoder->index = 0;
+	decoder->checksum = 0;
+	decoder->bad_frames = 0;
+}//----- End ----- xbee_frame_decoder_init( struct xbee_frame_decoder *, int )
+
+
+/* @breif Feeds received bytes to a decoder
+ *
+ * Bytes before a delimiter are skipped. Frames with a bad checksum are
+ * dropped and counted in bad_frames. In XBEE_API_ESCAPED_MODE an unescaped
+ * delimiter always starts a new frame, so the decoder resynchronizes after
+ * lost bytes.
+ *
+ * @param struct xbee_frame_decoder * decoder: The decoder
+ * @param const uint8_t * bytes: Bytes read from the port
+ * @param int count: Number of bytes
+ * @param xbee_frame_callback callback: Called for every complete frame
+ * @param void * arg: Passed to callback
+ *
+ * @return :		The number of complete frames passed to callback
+ */
+int xbee_frame_decode( struct xbee_frame_decoder * decoder,
+					   const uint8_t * bytes,
+					   int count,
+					   xbee_frame_callback callback,
+					   void * arg )
+{
+	int frames = 0;
+	int position;
+	int chunk;
+	uint8_t byte;
+
+	for( position = 0; position < count; position++ )
+	{
+		byte = bytes[position];
+
+		if( decoder->mode == XBEE_API_ESCAPED_MODE )
+		{
+			if( byte == XBEE_FRAME_DELIMITER )
+			{
+				if( decoder->state != STATE_DELIMITER )
+					decoder->bad_frames++;		//The previous frame was cut short
+
+				decoder->state = STATE_LENGTH_MSB;
+				decoder->escaped = 0;
+				continue;
+			}//End ----- if( byte == XBEE_FRAME_DELIMITER ) -----------------
+
+			if( decoder->state == STATE_DELIMITER )
+				continue;
+
+			if( byte == XBEE_FRAME_ESCAPE )
+			{
+				decoder->escaped = 1;
+				continue;
+			}//End ----- if( byte == XBEE_FRAME_ESCAPE ) --------------------
+
+			if( decoder->escaped )
+			{
+				byte ^= XBEE_FRAME_ESCAPE_XOR;
+				decoder->escaped = 0;
+			}//End ----- if( decoder->escaped ) -----------------------------
+		}
+		else if( decoder->state == STATE_DELIMITER )
+		{
+			if( byte == XBEE_FRAME_DELIMITER )
+				decoder->state = STATE_LENGTH_MSB;
+
+			continue;
+		}//End ----- if( decoder->mode == XBEE_API_ESCAPED_MODE ) -------
+
+		switch( decoder->state )
+		{
+			case STATE_LENGTH_MSB:
+				decoder->length = byte << 8;
+				decoder->state = STATE_LENGTH_LSB;
+
+				break;
+			case STATE_LENGTH_LSB:
+				decoder->length |= byte;
+				decoder->index = 0;
+				decoder->checksum = 0;
+				decoder->state = STATE_DATA;
+
+				if( decoder->length == 0 || decoder->length > XBEE_FRAME_MAX_DATA )
+				{
+					decoder->bad_frames++;
+					decoder->state = STATE_DELIMITER;
+				}//End ----- if( bad length ) -----------------------------------
+
+				break;
+			case STATE_DATA:
+				if( decoder->mode == XBEE_API_ESCAPED_MODE )
+				{
+					decoder->data[decoder->index++] = byte;
+					decoder->checksum += byte;
+				}
+				else
+				{
+					//Nothing is escaped, take as much of the frame data as we have
+					chunk = decoder->length - decoder->index;
+
+					if( chunk > count - position )
+						chunk = count - position;
+
+					memcpy( decoder->data + decoder->index, bytes + position, chunk );
+					decoder->index += chunk;
+
+					for( ; chunk > 0; chunk--, position++ )
+						decoder->checksum += bytes[position];
+
+					position--;		//The for loop moves past the last byte taken
+				}//End ----- if( decoder->mode == XBEE_API_ESCAPED_MODE ) -------
+
+				if( decoder->index == decoder->length )
+					decoder->state = STATE_CHECKSUM;
+
+				break;
+			case STATE_CHECKSUM:
+				if( (uint8_t)( decoder->checksum + byte ) == 0xFF )
+				{
+					callback( decoder->data, decoder->length, arg );
+					frames++;
+				}
+				else
+				{
+					decoder->bad_frames++;
+				}//End ----- if( checksum is good ) -----------------------------
+
+				decoder->state = STATE_DELIMITER;
+
+				break;
+		}//End ----- switch( decoder->state ) ---------------------------
+	}//End ----- for( position < count ) ----------------------------
+
+	return frames;
+}//----- End ----- xbee_frame_decode( struct xbee_frame_decoder *, ... )-
+
+
+/* @breif Builds the frame data of a local AT command
+ *
+ * @param uint8_t frame_id: Echoed in the response, 0 asks for no response
+ * @param const char * command: The two letter command, e.g. "MY"
+ * @param const uint8_t * parameter: The value to set, NULL to read
+ * @param int parameter_length: Number of bytes in parameter
+ * @param uint8_t * data: The frame data is stored here, must hold
+ *						  4 + parameter_length bytes
+ *
+ * @return :		Number of bytes stored in data
+ */
+int xbee_frame_at_command( uint8_t frame_id,
+						   const char * command,
+						   const uint8_t * parameter,
+						   int parameter_length,
+						   uint8_t * data )
+{
+	data[0] = XBEE_API_AT_COMMAND;
+	data[1] = frame_id;
+	data[2] = command[0];
+	data[3] = command[1];
+
+	if( parameter == NULL )
+		return 4;
+
+	memcpy( data + 4, parameter, parameter_length );
+
+	return 4 + parameter_length;
+}//----- End ----- xbee_frame_at_command( uint8_t, const char *, ... )----
+
+
+/* @breif Parses the frame data of a local AT command response
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param struct xbee_at_response * response: The parsed response is stored here
+ *
+ * @return :		0 - Success
+ *					1 - The frame is not an AT command response
+ *			 Not Zero - Error
+ */
+int xbee_frame_parse_at_response( const uint8_t * data,
+								  int length,
+								  struct xbee_at_response * response )
+{
+	//API identifier, frame ID, two command letters and the status
+	if( length < 5 || data[0] != XBEE_API_AT_RESPONSE )
+		return 1;
+
+	response->frame_id = data[1];
+	response->command[0] = data[2];
+	response->command[1] = data[3];
+	response->command[2] = '\0';
+	response->status = data[4];
+	response->value = data + 5;
+	response->value_length = length - 5;
+
+	return 0;
+}//----- End ----- xbee_frame_parse_at_response( const uint8_t *, ... )--
@@ -0,0 +1,174 @@
+/** @file xbee_frame.h
+ ** @brief Encoding and decoding of xbee API frames
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes the frame layer used when the xbee runs in
+ *				API mode(ATAP=1 or ATAP=2) instead of transparent mode. Every
+ *				frame on the wire looks like:
+ *
+ *					0x7E | length(2 bytes, MSB first) | frame data | checksum
+ *
+ *				The frame data starts with the API identifier. The checksum is
+ *				0xFF minus the low byte of the sum of the frame data. With
+ *				ATAP=2 the bytes 0x7E, 0x7D, 0x11 and 0x13 after the delimiter
+ *				are sent as 0x7D followed by the byte XOR 0x20.
+ *
+ *				The decoder is incremental: bytes are fed in as they are read
+ *				and it keeps its place between calls, so a frame split across
+ *				several reads is never scanned twice.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_FRAME_H
+#define XBEE_FRAME_H
+
+#include <stdint.h>
+
+//-----------------Global Variable Definitions-------------------------------------
+
+#define XBEE_FRAME_DELIMITER 0x7E
+#define XBEE_FRAME_ESCAPE 0x7D
+#define XBEE_FRAME_XON 0x11
+#define XBEE_FRAME_XOFF 0x13
+#define XBEE_FRAME_ESCAPE_XOR 0x20
+
+//Largest frame data(API identifier included) the decoder accepts
+#define XBEE_FRAME_MAX_DATA 1600
+
+//Largest encoded frame: every data and checksum byte escaped, plus delimiter
+//and escaped length
+#define XBEE_FRAME_MAX_ENCODED ( 1 + 2 * ( 2 + XBEE_FRAME_MAX_DATA + 1 ) )
+
+//API modes, the values of ATAP
+#define XBEE_TRANSPARENT_MODE 0
+#define XBEE_API_MODE 1
+#define XBEE_API_ESCAPED_MODE 2
+
+//API identifiers
+#define XBEE_API_AT_COMMAND 0x08		//Local AT command, applied at once
+#define XBEE_API_AT_QUEUE 0x09			//Local AT command, applied by ATAC
+#define XBEE_API_TX_REQUEST 0x10
+#define XBEE_API_TX_IPV4 0x20
+#define XBEE_API_AT_RESPONSE 0x88
+#define XBEE_API_TX_STATUS_IPV4 0x89
+#define XBEE_API_MODEM_STATUS 0x8A
+#define XBEE_API_TX_STATUS 0x8B
+#define XBEE_API_RX_PACKET 0x90
+#define XBEE_API_RX_IPV4 0xB0
+
+//Status byte of an AT command response
+#define XBEE_AT_STATUS_OK 0
+#define XBEE_AT_STATUS_ERROR 1
+#define XBEE_AT_STATUS_INVALID_COMMAND 2
+#define XBEE_AT_STATUS_INVALID_PARAMETER 3
+
+/* @breif Called by the decoder for every complete frame with a good checksum
+ *
+ * @param const uint8_t * data: The frame data, data[0] is the API identifier.
+ *								Only valid during the call.
+ * @param int length: Number of bytes in data
+ * @param void * arg: The argument given to xbee_frame_decode
+ */
+typedef void (*xbee_frame_callback)( const uint8_t * data, int length, void * arg );
+
+//State of an incremental decoder
+struct xbee_frame_decoder
+{
+	int mode;						//XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+	int state;						//Which part of the frame comes next
+	int escaped;					//TRUE when the previous byte was XBEE_FRAME_ESCAPE
+	int length;						//Length of the frame data being received
+	int index;						//Bytes of frame data received so far
+	uint8_t checksum;				//Sum of the frame data received so far
+	unsigned long bad_frames;		//Frames dropped for a bad checksum or length
+	uint8_t data[XBEE_FRAME_MAX_DATA];
+};
+
+//A parsed local AT command response(XBEE_API_AT_RESPONSE)
+struct xbee_at_response
+{
+	uint8_t frame_id;
+	char command[3];				//e.g. "MY"
+	uint8_t status;					//XBEE_AT_STATUS_*
+	const uint8_t * value;			//Points into the frame data
+	int value_length;
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Encodes frame data into a frame ready to be written to the port
+ *
+ * @param const uint8_t * data: The frame data, data[0] is the API identifier
+ * @param int length: Number of bytes in data, at most XBEE_FRAME_MAX_DATA
+ * @param int mode: XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ * @param uint8_t * frame: The encoded frame is stored here
+ * @param int size: Size of frame, XBEE_FRAME_MAX_ENCODED is always enough
+ *
+ * @return :	   -1 - The data is too long or frame is too small
+ *			 Not Negative - Number of bytes stored in frame
+ */
+int xbee_frame_encode( const uint8_t *, int, int, uint8_t *, int );
+
+/* @breif Prepares a decoder to receive frames
+ *
+ * @param struct xbee_frame_decoder * decoder: The decoder to initialize
+ * @param int mode: XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ */
+void xbee_frame_decoder_init( struct xbee_frame_decoder *, int );
+
+/* @breif Feeds received bytes to a decoder
+ *
+ * Bytes before a delimiter are skipped. Frames with a bad checksum are
+ * dropped and counted in bad_frames. In XBEE_API_ESCAPED_MODE an unescaped
+ * delimiter always starts a new frame, so the decoder resynchronizes after
+ * lost bytes.
+ *
+ * @param struct xbee_frame_decoder * decoder: The decoder
+ * @param const uint8_t * bytes: Bytes read from the port
+ * @param int count: Number of bytes
+ * @param xbee_frame_callback callback: Called for every complete frame
+ * @param void * arg: Passed to callback
+ *
+ * @return :		The number of complete frames passed to callback
+ */
+int xbee_frame_decode( struct xbee_frame_decoder *, const uint8_t *, int,
+					   xbee_frame_callback, void * );
+
+/* @breif Builds the frame data of a local AT command
+ *
+ * @param uint8_t frame_id: Echoed in the response, 0 asks for no response
+ * @param const char * command: The two letter command, e.g. "MY"
+ * @param const uint8_t * parameter: The value to set, NULL to read
+ * @param int parameter_length: Number of bytes in parameter
+ * @param uint8_t * data: The frame data is stored here, must hold
+ *						  4 + parameter_length bytes
+ *
+ * @return :		Number of bytes stored in data
+ */
+int xbee_frame_at_command( uint8_t, const char *, const uint8_t *, int, uint8_t * );
+
+/* @breif Parses the frame data of a local AT command response
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param struct xbee_at_response * response: The parsed response is stored here
+ *
+ * @return :		0 - Success
+ *					1 - The frame is not an AT command response
+ *			 Not Zero - Error
+ */
+int xbee_frame_parse_at_response( const uint8_t *, int, struct xbee_at_response * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,742 @@
+/** @file xbee_gateway.c
+ ** @brief Implementation of the xbee_gateway.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_gateway.h file.
+ *
+ *				A port is only ever touched by one worker at a time. The
+ *				controlling thread never sends a command about a port while it
+ *				is moving between workers, and XBEE_GATEWAY_REMOVE is the last
+ *				command sent about a port, so the port can be freed as soon as
+ *				the worker has marked it closed.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#define _GNU_SOURCE			//pthread_setaffinity_np
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <glob.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include "xbee_gateway.h"
+#include "xbee_trace.h"
+
+
+/* @breif Queues a command for a worker and wakes it
+ *
+ * @param struct xbee_gateway_worker * worker: The worker
+ * @param int type: XBEE_GATEWAY_ADD, REMOVE or MOVE
+ * @param struct xbee_gateway_port * port: The port the command is about
+ * @param struct xbee_gateway_worker * target: Where a moved port goes, else NULL
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - The worker could not be woken, nothing was queued
+ */
+static int post_command( struct xbee_gateway_worker * worker,
+						 int type,
+						 struct xbee_gateway_port * port,
+						 struct xbee_gateway_worker * target )
+{
+	struct xbee_gateway_command * command = malloc( sizeof(*command) );
+	struct xbee_gateway_command * previous;
+	uint64_t one = 1;
+	int result = 0;
+
+	if( command == NULL )
+		return 1;
+
+	command->type = type;
+	command->port = port;
+	command->target = target;
+	command->next = NULL;
+
+	pthread_mutex_lock( &worker->lock );
+
+	previous = worker->tail;
+
+	if( previous == NULL )
+		worker->head = command;
+	else
+		previous->next = command;
+
+	worker->tail = command;
+
+	//EAGAIN only means the worker has not read its earlier wake ups yet. The
+	//lock keeps the worker from taking the command before it can be unqueued.
+	if( write( worker->command_descriptor, &one, sizeof(one) ) < 0 && errno != EAGAIN )
+	{
+		if( previous == NULL )
+			worker->head = NULL;
+		else
+			previous->next = NULL;
+
+		worker->tail = previous;
+		free( command );
+		result = 2;
+	}//End ----- if( write failed ) ---------------------------------
+
+	pthread_mutex_unlock( &worker->lock );
+
+	return result;
+}//----- End ----- post_command( struct xbee_gateway_worker *, int, ... )
+
+
+/* @breif Stops reading a port and unlinks it from the worker
+ *
+ * @param struct xbee_gateway_worker * worker: The worker owning the port
+ * @param struct xbee_gateway_port * port: The port
+ */
+static void detach_port( struct xbee_gateway_worker * worker, struct xbee_gateway_port * port )
+{
+	struct xbee_gateway_port ** link = &worker->ports;
+
+	if( port->attached == FALSE )
+		return;
+
+	xbee_loop_remove( &worker->loop, port->port_descriptor );
+
+	while( *link != NULL && *link != port )
+	{
+		link = &(*link)->worker_next;
+	}//End ----- while( *link != port ) -----------------------------
+
+	if( *link != NULL )
+		*link = port->worker_next;
+
+	port->worker_next = NULL;
+	port->attached = FALSE;
+}//----- End ----- detach_port( struct xbee_gateway_worker *, ... )-----
+
+
+/* @breif Event loop callback that reads a port and hands out complete lines
+ *
+ * @param int fd: The port descriptor
+ * @param uint32_t events: The events reported by the loop
+ * @param void * arg: The gateway port
+ */
+static void port_ready( int fd, uint32_t events, void * arg )
+{
+	struct xbee_gateway_port * port = arg;
+	struct xbee_gateway_worker * worker = port->worker_owner;
+	struct xbee_stats * stats = get_xbee_stats( port->xbee );
+	char buffer[MAX_BUFFER_SIZE];
+	ssize_t count;
+	ssize_t index;
+
+	count = read( fd, buffer, sizeof(buffer) );
+	xbee_stats_count( stats, XBEE_STAT_READS, 1 );
+
+	if( count > 0 )
+	{
+		xbee_stats_count( stats, XBEE_STAT_BYTES_IN, count );
+		xbee_trace( XBEE_TRACE_BYTES_IN, fd, count, buffer, count );
+	}
+	else
+		xbee_stats_count( stats, XBEE_STAT_EMPTY_WAKEUPS, 1 );
+
+	if( count < 0 && ( errno == EAGAIN || errno == EINTR ) )
+		return;
+
+	if( count < 0 || ( count == 0 && ( events & ( EPOLLHUP | EPOLLERR ) ) ) )
+	{
+		printf( "\nPort[%s] was lost with errno(%d).\n",
+				port->name,
+				( count < 0 ) ? errno : EIO );
+
+		//The controlling thread notices on its next scan and removes the port
+		detach_port( worker, port );
+		atomic_store( &port->lost, TRUE );
+		return;
+	}//End ----- if( read failed ) ----------------------------------
+
+	for( index = 0; index < count; index++ )
+	{
+		if( buffer[index] != '\r' && port->length < MAX_BUFFER_SIZE - 1 )
+		{
+			port->line[port->length++] = buffer[index];
+			continue;
+		}//End ----- if( not the end of the line ) ----------------------
+
+		port->line[port->length] = '\0';
+		xbee_trace( XBEE_TRACE_LINE, fd, port->length, port->line, port->length );
+		worker->gateway->callback( port->name, port->line, worker->gateway->arg );
+		port->length = 0;
+
+		if( buffer[index] != '\r' )		//A long line is split, keep the byte
+			port->line[port->length++] = buffer[index];
+	}//End ----- for( index < count ) -------------------------------
+}//----- End ----- port_ready( int, uint32_t, void * )-------------------
+
+
+/* @breif Event loop callback that carries out the commands queued for a worker
+ *
+ * @param int fd: The worker's command descriptor
+ * @param uint32_t events: Unused
+ * @param void * arg: The worker
+ */
+static void commands_ready( int fd, uint32_t events, void * arg )
+{
+	struct xbee_gateway_worker * worker = arg;
+	struct xbee_gateway_command * command;
+	struct xbee_gateway_command * next;
+	struct xbee_gateway_port * port;
+	uint64_t count;
+
+	if( read( fd, &count, sizeof(count) ) < 0 && errno != EAGAIN )
+		return;
+
+	//Take the whole queue, commands posted meanwhile wake the loop again
+	pthread_mutex_lock( &worker->lock );
+
+	command = worker->head;
+	worker->head = NULL;
+	worker->tail = NULL;
+
+	pthread_mutex_unlock( &worker->lock );
+
+	while( command != NULL )
+	{
+		next = command->next;
+		port = command->port;
+
+		switch( command->type )
+		{
+			case XBEE_GATEWAY_ADD:
+				if( atomic_load( &port->lost ) == FALSE )
+				{
+					port->worker_owner = worker;
+
+					if( xbee_loop_add( &worker->loop,
+									   port->port_descriptor,
+									   XBEE_LOOP_READ,
+									   port_ready,
+									   port ) == 0 )
+					{
+						port->attached = TRUE;
+						port->worker_next = worker->ports;
+						worker->ports = port;
+					}
+					else
+					{
+						atomic_store( &port->lost, TRUE );
+					}//End ----- if( xbee_loop_add == 0 ) ---------------------------
+				}//End ----- if( port is not lost ) -----------------------------
+
+				atomic_store( &port->moving, FALSE );
+				break;
+
+			case XBEE_GATEWAY_REMOVE:
+				detach_port( worker, port );
+				atomic_store( &port->closed, TRUE );
+				break;
+
+			case XBEE_GATEWAY_MOVE:
+				detach_port( worker, port );
+
+				if( post_command( command->target, XBEE_GATEWAY_ADD, port, NULL ) != 0 )
+				{
+					atomic_store( &port->lost, TRUE );
+					atomic_store( &port->moving, FALSE );
+				}//End ----- if( post_command != 0 ) ----------------------------
+				break;
+		}//End ----- switch( command->type ) ----------------------------
+
+		free( command );
+		command = next;
+	}//End ----- while( command != NULL ) ---------------------------
+}//----- End ----- commands_ready( int, uint32_t, void * )---------------
+
+
+/* @breif Body of a worker thread, runs the worker's loop until it is stopped
+ *
+ * @param void * arg: The worker
+ *
+ * @return :		NULL
+ */
+static void * run_worker( void * arg )
+{
+	struct xbee_gateway_worker * worker = arg;
+
+	xbee_loop_run( &worker->loop );
+
+	return NULL;
+}//----- End ----- run_worker( void * )----------------------------------
+
+
+/* @breif Event loop callback of the rescan timer
+ *
+ * @param int fd: The timer
+ * @param uint32_t events: Unused
+ * @param void * arg: The gateway
+ */
+static void scan_due( int fd, uint32_t events, void * arg )
+{
+	xbee_gateway_scan( arg );
+}//----- End ----- scan_due( int, uint32_t, void * )---------------------
+
+
+/* @breif Finds the worker with the fewest or the most ports
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ * @param int most: TRUE for the busiest worker, FALSE for the idlest
+ *
+ * @return :		The worker
+ */
+static struct xbee_gateway_worker * pick_worker( struct xbee_gateway * gateway, int most )
+{
+	struct xbee_gateway_worker * best = &gateway->workers[0];
+	int index;
+
+	for( index = 1; index < gateway->worker_count; index++ )
+	{
+		if( ( most == TRUE && gateway->workers[index].assigned > best->assigned ) ||
+			( most == FALSE && gateway->workers[index].assigned < best->assigned ) )
+			best = &gateway->workers[index];
+	}//End ----- for( index < gateway->worker_count ) ---------------
+
+	return best;
+}//----- End ----- pick_worker( struct xbee_gateway *, int )-------------
+
+
+/* @breif Opens a port that appeared and assigns it to the idlest worker
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ * @param const char * name: Path of the port
+ */
+static void open_port( struct xbee_gateway * gateway, const char * name )
+{
+	struct xbee_gateway_port * port = calloc( 1, sizeof(*port) );
+
+	if( port == NULL )
+		return;
+
+	port->xbee = xbee_create( NULL );
+
+	if( port->xbee == NULL ||
+		init_port_baud( port->xbee, (char *) name, gateway->baud_rate ) != 0 )
+	{
+		xbee_destroy( port->xbee );
+		free( port );
+		return;
+	}//End ----- if( init_port_baud != 0 ) --------------------------
+
+	strncpy( port->name, name, MAX_BUFFER_SIZE - 1 );
+	port->port_descriptor = get_port_descriptor( port->xbee );
+	port->seen = TRUE;
+	port->worker = pick_worker( gateway, FALSE );
+	atomic_init( &port->moving, TRUE );
+	atomic_init( &port->lost, FALSE );
+	atomic_init( &port->closed, FALSE );
+
+	if( post_command( port->worker, XBEE_GATEWAY_ADD, port, NULL ) != 0 )
+	{
+		xbee_destroy( port->xbee );
+		free( port );
+		return;
+	}//End ----- if( post_command != 0 ) ----------------------------
+
+	port->worker->assigned++;
+	port->next = gateway->ports;
+	gateway->ports = port;
+
+	printf( "\nPort[%s] opened on worker %d.\n",
+			port->name,
+			port->worker->index );
+}//----- End ----- open_port( struct xbee_gateway *, const char * )------
+
+
+/* @breif Moves ports from the busiest to the idlest worker until they differ by one
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+static void rebalance( struct xbee_gateway * gateway )
+{
+	struct xbee_gateway_worker * busiest;
+	struct xbee_gateway_worker * idlest;
+	struct xbee_gateway_port * port;
+
+	while( 1 )
+	{
+		busiest = pick_worker( gateway, TRUE );
+		idlest = pick_worker( gateway, FALSE );
+
+		if( busiest->assigned - idlest->assigned <= 1 )
+			return;
+
+		//Ports already on the move or on the way out stay where they are
+		for( port = gateway->ports; port != NULL; port = port->next )
+		{
+			if( port->worker == busiest &&
+				port->removing == FALSE &&
+				atomic_load( &port->moving ) == FALSE &&
+				atomic_load( &port->lost ) == FALSE )
+				break;
+		}//End ----- for( each port ) -----------------------------------
+
+		if( port == NULL )
+			return;		//Try again on the next scan
+
+		atomic_store( &port->moving, TRUE );
+
+		if( post_command( busiest, XBEE_GATEWAY_MOVE, port, idlest ) != 0 )
+		{
+			atomic_store( &port->moving, FALSE );
+			return;
+		}//End ----- if( post_command != 0 ) ----------------------------
+
+		port->worker = idlest;
+		busiest->assigned--;
+		idlest->assigned++;
+	}//End ----- while( 1 ) -----------------------------------------
+}//----- End ----- rebalance( struct xbee_gateway * )--------------------
+
+
+/* @breif Starts the workers, opens the matching ports and starts rescanning
+ *
+ * Worker i is pinned to CPU i modulo the number of CPUs.
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_gateway * gateway: The gateway to start
+ * @param struct xbee_loop * loop: Loop of the controlling thread, runs the rescan timer
+ * @param const char * pattern: glob pattern of the ports, NULL for XBEE_GATEWAY_PATTERN
+ * @param int workers: Number of worker threads, 0 for one per CPU
+ * @param int baud_rate: Bits per second the ports are opened at
+ * @param xbee_gateway_callback callback: Told about every line received
+ * @param void * arg: Passed to callback
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to set up or start a worker
+ *					3 - Failed to create the rescan timer
+ *			 Not Zero - Error
+ */
+int xbee_gateway_start( struct xbee_gateway * gateway,
+						struct xbee_loop * loop,
+						const char * pattern,
+						int workers,
+						int baud_rate,
+						xbee_gateway_callback callback,
+						void * arg )
+{
+	struct xbee_gateway_worker * worker;
+	long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+	cpu_set_t cpu;
+	int index;
+
+	memset( gateway, 0, sizeof(*gateway) );
+
+	if( cpus < 1 )
+		cpus = 1;
+
+	if( workers <= 0 )
+		workers = cpus;
+
+	if( workers > XBEE_GATEWAY_MAX_WORKERS )
+		workers = XBEE_GATEWAY_MAX_WORKERS;
+
+	strncpy( gateway->pattern,
+			 ( pattern != NULL ) ? pattern : XBEE_GATEWAY_PATTERN,
+			 MAX_BUFFER_SIZE - 1 );
+	gateway->baud_rate = baud_rate;
+	gateway->loop = loop;
+	gateway->scan_descriptor = -1;
+	gateway->callback = callback;
+	gateway->arg = arg;
+	gateway->workers = calloc( workers, sizeof(*gateway->workers) );
+
+	if( gateway->workers == NULL )
+		return 1;
+
+	for( index = 0; index < workers; index++ )
+	{
+		worker = &gateway->workers[index];
+		worker->index = index;
+		worker->gateway = gateway;
+		worker->command_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+		if( worker->command_descriptor < 0 )
+		{
+			xbee_gateway_stop( gateway );
+			return 2;
+		}//End ----- if( worker->command_descriptor < 0 ) ---------------
+
+		if( xbee_loop_init( &worker->loop ) != 0 )
+		{
+			close( worker->command_descriptor );
+			xbee_gateway_stop( gateway );
+			return 2;
+		}//End ----- if( xbee_loop_init != 0 ) --------------------------
+
+		pthread_mutex_init( &worker->lock, NULL );
+
+		//Counted before the thread starts so stopping a half started gateway cleans it up
+		gateway->worker_count++;
+
+		if( xbee_loop_add( &worker->loop,
+						   worker->command_descriptor,
+						   XBEE_LOOP_READ,
+						   commands_ready,
+						   worker ) != 0 ||
+			pthread_create( &worker->thread, NULL, run_worker, worker ) != 0 )
+		{
+			xbee_gateway_stop( gateway );
+			return 2;
+		}//End ----- if( pthread_create != 0 ) --------------------------
+
+		worker->started = TRUE;
+
+		CPU_ZERO( &cpu );
+		CPU_SET( index % cpus, &cpu );
+		pthread_setaffinity_np( worker->thread, sizeof(cpu), &cpu );
+	}//End ----- for( index < workers ) -----------------------------
+
+	xbee_gateway_scan( gateway );
+
+	gateway->scan_descriptor = xbee_loop_add_timer( loop, XBEE_GATEWAY_SCAN_MS, scan_due, gateway );
+
+	if( gateway->scan_descriptor < 0 )
+	{
+		xbee_gateway_stop( gateway );
+		return 3;
+	}//End ----- if( gateway->scan_descriptor < 0 ) -----------------
+
+	return 0;
+}//----- End ----- xbee_gateway_start( struct xbee_gateway *, ... )------
+
+
+/* @breif Opens new ports, drops vanished or failed ones and rebalances the workers
+ *
+ * Called by the rescan timer, may also be called directly from the controlling
+ * thread.
+ *
+ * Header files needed: glob.h
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_scan( struct xbee_gateway * gateway )
+{
+	struct xbee_gateway_port ** link = &gateway->ports;
+	struct xbee_gateway_port * port;
+	glob_t found;
+	size_t index;
+
+	//Free the ports the workers are done with, their names can be opened again below
+	while( *link != NULL )
+	{
+		port = *link;
+
+		if( atomic_load( &port->closed ) == FALSE )
+		{
+			port->seen = FALSE;
+			link = &port->next;
+			continue;
+		}//End ----- if( port is not closed ) ---------------------------
+
+		*link = port->next;
+		printf( "\nPort[%s] closed.\n", port->name );
+		xbee_destroy( port->xbee );
+		free( port );
+	}//End ----- while( *link != NULL ) -----------------------------
+
+	if( glob( gateway->pattern, 0, NULL, &found ) != 0 )
+		found.gl_pathc = 0;		//GLOB_NOMATCH, every port vanished
+
+	for( index = 0; index < found.gl_pathc; index++ )
+	{
+		for( port = gateway->ports; port != NULL; port = port->next )
+		{
+			if( strcmp( port->name, found.gl_pathv[index] ) == 0 )
+				break;
+		}//End ----- for( each port ) -----------------------------------
+
+		if( port != NULL )
+			port->seen = TRUE;
+		else
+			open_port( gateway, found.gl_pathv[index] );
+	}//End ----- for( index < found.gl_pathc ) ----------------------
+
+	if( found.gl_pathc > 0 )
+		globfree( &found );
+
+	//Let go of ports that vanished or failed, unless they are moving
+	for( port = gateway->ports; port != NULL; port = port->next )
+	{
+		if( port->removing == TRUE ||
+			atomic_load( &port->moving ) == TRUE ||
+			( port->seen == TRUE && atomic_load( &port->lost ) == FALSE ) )
+			continue;
+
+		if( post_command( port->worker, XBEE_GATEWAY_REMOVE, port, NULL ) != 0 )
+			continue;
+
+		port->removing = TRUE;
+		port->worker->assigned--;
+	}//End ----- for( each port ) -----------------------------------
+
+	rebalance( gateway );
+}//----- End ----- xbee_gateway_scan( struct xbee_gateway * )------------
+
+
+/* @breif Writes data to one port of the gateway
+ *
+ * Only the controlling thread may write, the workers only read.
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ * @param const char * name: The port's name, with or without its directory,
+ *							 or "*" for every port
+ * @param const void * data: The bytes to write
+ * @param size_t length: Number of bytes to write
+ *
+ * @return :		0 - Success
+ *					1 - Writing to a port failed
+ *					2 - No open port has that name
+ *			 Not Zero - Error
+ */
+int xbee_gateway_send( struct xbee_gateway * gateway,
+					   const char * name,
+					   const void * data,
+					   size_t length )
+{
+	struct xbee_gateway_port * port;
+	const char * base;
+	int matched = 0;
+	int result = 0;
+
+	for( port = gateway->ports; port != NULL; port = port->next )
+	{
+		base = strrchr( port->name, '/' );
+		base = ( base != NULL ) ? base + 1 : port->name;
+
+		if( strcmp( name, "*" ) != 0 &&
+			strcmp( name, port->name ) != 0 &&
+			strcmp( name, base ) != 0 )
+			continue;
+
+		if( port->removing == TRUE || atomic_load( &port->lost ) == TRUE )
+			continue;
+
+		matched++;
+
+		if( write_port_length( port->xbee, data, length ) != 0 )
+			result = 1;
+	}//End ----- for( each port ) -----------------------------------
+
+	if( matched == 0 )
+		return 2;
+
+	return result;
+}//----- End ----- xbee_gateway_send( struct xbee_gateway *, ... )-------
+
+
+/* @breif Prints every port and the worker it is assigned to
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_print( struct xbee_gateway * gateway )
+{
+	struct xbee_gateway_port * port;
+	int index;
+
+	for( index = 0; index < gateway->worker_count; index++ )
+	{
+		printf( "Worker %d: %d port(s)\n",
+				index,
+				gateway->workers[index].assigned );
+	}//End ----- for( index < gateway->worker_count ) ---------------
+
+	for( port = gateway->ports; port != NULL; port = port->next )
+	{
+		printf( "   %s -> worker %d%s%s\n",
+				port->name,
+				port->worker->index,
+				( atomic_load( &port->moving ) == TRUE ) ? " (moving)" : "",
+				( port->removing == TRUE ) ? " (closing)" : "" );
+	}//End ----- for( each port ) -----------------------------------
+}//----- End ----- xbee_gateway_print( struct xbee_gateway * )-----------
+
+
+/* @breif Prints the counters and latencies of every port
+ *
+ * The workers keep counting while the statistics are copied.
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_print_stats( struct xbee_gateway * gateway )
+{
+	struct xbee_stats_snapshot snapshot;
+	struct xbee_gateway_port * port;
+
+	for( port = gateway->ports; port != NULL; port = port->next )
+	{
+		xbee_stats_snapshot( get_xbee_stats( port->xbee ), &snapshot );
+		xbee_stats_print( port->name, &snapshot );
+	}//End ----- for( each port ) -----------------------------------
+}//----- End ----- xbee_gateway_print_stats( struct xbee_gateway * )-----
+
+
+/* @breif Stops the workers and closes every port
+ *
+ * @param struct xbee_gateway * gateway: The gateway to stop
+ */
+void xbee_gateway_stop( struct xbee_gateway * gateway )
+{
+	struct xbee_gateway_worker * worker;
+	struct xbee_gateway_command * command;
+	struct xbee_gateway_port * port;
+	int index;
+
+	if( gateway->scan_descriptor >= 0 )
+		xbee_loop_remove( gateway->loop, gateway->scan_descriptor );
+
+	gateway->scan_descriptor = -1;
+
+	for( index = 0; index < gateway->worker_count; index++ )
+	{
+		worker = &gateway->workers[index];
+
+		if( worker->started == TRUE )
+		{
+			xbee_loop_stop( &worker->loop );
+			pthread_join( worker->thread, NULL );
+		}//End ----- if( worker->started == TRUE ) ----------------------
+
+		//Commands the worker never got to only hold pointers to ports
+		while( worker->head != NULL )
+		{
+			command = worker->head;
+			worker->head = command->next;
+			free( command );
+		}//End ----- while( worker->head != NULL ) ----------------------
+
+		xbee_loop_close( &worker->loop );
+		close( worker->command_descriptor );
+		pthread_mutex_destroy( &worker->lock );
+	}//End ----- for( index < gateway->worker_count ) ---------------
+
+	while( gateway->ports != NULL )
+	{
+		port = gateway->ports;
+		gateway->ports = port->next;
+		xbee_destroy( port->xbee );
+		free( port );
+	}//End ----- while( gateway->ports != NULL ) --------------------
+
+	free( gateway->workers );
+	gateway->workers = NULL;
+	gateway->worker_count = 0;
+}//----- End ----- xbee_gateway_stop( struct xbee_gateway * )------------
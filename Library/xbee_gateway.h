@@ -0,0 +1,202 @@
+/** @file xbee_gateway.h
+ ** @brief Gateway serving many xbee ports from a pool of worker threads
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a gateway that opens every serial port
+ *				matching a pattern such as /dev/ttyUSB* and shares them out
+ *				between a fixed number of worker threads. Each worker runs one
+ *				event loop for all of its ports, so a hundred radios need a
+ *				handful of threads instead of a hundred.
+ *
+ *				The thread that started the gateway controls it. It rescans the
+ *				pattern on a timer of its own loop, opens ports that appeared,
+ *				closes ports that disappeared or failed and moves ports between
+ *				workers so no worker has more than one port more than another.
+ *				Workers are told about these changes through a command queue
+ *				and an eventfd registered in their loop.
+ *
+ *				Lines received on any port are handed to a callback, which is
+ *				called from the worker thread owning the port.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_GATEWAY_H
+#define XBEE_GATEWAY_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "libxbee.h"
+#include "xbee_loop.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+#define XBEE_GATEWAY_PATTERN "/dev/ttyUSB*"	//Ports opened when no pattern is given
+#define XBEE_GATEWAY_SCAN_MS 1000			//Time between two scans of the pattern
+#define XBEE_GATEWAY_MAX_WORKERS 64
+
+//Commands the controlling thread sends to a worker
+#define XBEE_GATEWAY_ADD 0			//Start reading the port
+#define XBEE_GATEWAY_REMOVE 1		//Stop reading the port, it is freed afterwards
+#define XBEE_GATEWAY_MOVE 2			//Stop reading the port and hand it to another worker
+
+struct xbee_gateway_worker;
+
+/* @breif Called for every line received by the gateway
+ *
+ * Called from the worker thread owning the port, so calls for different ports
+ * may run at the same time.
+ *
+ * @param const char * port: Name of the port the line came from
+ * @param const char * line: The line, without its '\r'
+ * @param void * arg: The argument given to xbee_gateway_start
+ */
+typedef void (*xbee_gateway_callback)( const char *, const char *, void * );
+
+struct xbee_gateway_port
+{
+	char name[MAX_BUFFER_SIZE];
+	struct xbee * xbee;
+	int port_descriptor;
+
+	//Only used by the controlling thread
+	struct xbee_gateway_worker * worker;	//Worker the port is assigned to
+	int seen;								//Found by the latest scan
+	int removing;							//XBEE_GATEWAY_REMOVE has been sent
+	struct xbee_gateway_port * next;
+
+	//Only used by the worker owning the port
+	struct xbee_gateway_worker * worker_owner;	//Worker reading the port right now
+	int attached;							//TRUE while registered with the worker's loop
+	char line[MAX_BUFFER_SIZE];				//The line being put together
+	int length;
+	struct xbee_gateway_port * worker_next;
+
+	atomic_int moving;		//Set until the new worker has taken the port over
+	atomic_int lost;		//Set by the worker when reading the port failed
+	atomic_int closed;		//Set by the worker once it will not touch the port again
+};
+
+struct xbee_gateway_command
+{
+	int type;								//XBEE_GATEWAY_ADD, REMOVE or MOVE
+	struct xbee_gateway_port * port;
+	struct xbee_gateway_worker * target;	//Where XBEE_GATEWAY_MOVE sends the port
+	struct xbee_gateway_command * next;
+};
+
+struct xbee_gateway_worker
+{
+	int index;
+	pthread_t thread;
+	int started;							//TRUE once thread runs
+	struct xbee_loop loop;
+	int command_descriptor;					//eventfd that tells the worker about commands
+	pthread_mutex_t lock;					//Protects the command queue
+	struct xbee_gateway_command * head;
+	struct xbee_gateway_command * tail;
+	struct xbee_gateway_port * ports;		//Only used by the worker thread
+	int assigned;							//Only used by the controlling thread
+	struct xbee_gateway * gateway;
+};
+
+struct xbee_gateway
+{
+	char pattern[MAX_BUFFER_SIZE];
+	int baud_rate;
+	struct xbee_loop * loop;				//The controlling thread's loop
+	int scan_descriptor;					//Timer that rescans the pattern
+	struct xbee_gateway_worker * workers;
+	int worker_count;
+	struct xbee_gateway_port * ports;		//Every port, assigned or not
+	xbee_gateway_callback callback;
+	void * arg;
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Starts the workers, opens the matching ports and starts rescanning
+ *
+ * Worker i is pinned to CPU i modulo the number of CPUs.
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_gateway * gateway: The gateway to start
+ * @param struct xbee_loop * loop: Loop of the controlling thread, runs the rescan timer
+ * @param const char * pattern: glob pattern of the ports, NULL for XBEE_GATEWAY_PATTERN
+ * @param int workers: Number of worker threads, 0 for one per CPU
+ * @param int baud_rate: Bits per second the ports are opened at
+ * @param xbee_gateway_callback callback: Told about every line received
+ * @param void * arg: Passed to callback
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to set up or start a worker
+ *					3 - Failed to create the rescan timer
+ *			 Not Zero - Error
+ */
+int xbee_gateway_start( struct xbee_gateway *, struct xbee_loop *, const char *, int, int,
+						xbee_gateway_callback, void * );
+
+/* @breif Opens new ports, drops vanished or failed ones and rebalances the workers
+ *
+ * Called by the rescan timer, may also be called directly from the controlling
+ * thread.
+ *
+ * Header files needed: glob.h
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_scan( struct xbee_gateway * );
+
+/* @breif Writes data to one port of the gateway
+ *
+ * Only the controlling thread may write, the workers only read.
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ * @param const char * name: The port's name, with or without its directory,
+ *							 or "*" for every port
+ * @param const void * data: The bytes to write
+ * @param size_t length: Number of bytes to write
+ *
+ * @return :		0 - Success
+ *					1 - Writing to a port failed
+ *					2 - No open port has that name
+ *			 Not Zero - Error
+ */
+int xbee_gateway_send( struct xbee_gateway *, const char *, const void *, size_t );
+
+/* @breif Prints every port and the worker it is assigned to
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_print( struct xbee_gateway * );
+
+/* @breif Prints the counters and latencies of every port
+ *
+ * The workers keep counting while the statistics are copied.
+ *
+ * @param struct xbee_gateway * gateway: The gateway
+ */
+void xbee_gateway_print_stats( struct xbee_gateway * );
+
+/* @breif Stops the workers and closes every port
+ *
+ * @param struct xbee_gateway * gateway: The gateway to stop
+ */
+void xbee_gateway_stop( struct xbee_gateway * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,108 @@
+/** @file xbee_link.c
+ ** @brief Implementation of the xbee_link.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_link.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <string.h>
+#include "xbee_link.h"
+
+
+/* @breif Keeps a decoded frame as the link's packet
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Bytes in data
+ * @param void * arg: The link
+ */
+static void keep_packet( const uint8_t * data, int length, void * arg )
+{
+	struct xbee_link * link = arg;
+
+	memcpy( link->packet, data, length );
+	link->length = length;
+}//----- End ----- keep_packet( const uint8_t *, int, void * )----------
+
+
+/* @breif Prepares a link for packets
+ *
+ * @param struct xbee_link * link: The link to initialize
+ * @param struct xbee * xbee: The xbee the packets go through, in transparent mode
+ */
+void xbee_link_init( struct xbee_link * link, struct xbee * xbee )
+{
+	link->xbee = xbee;
+	link->input_start = 0;
+	link->input_end = 0;
+	link->length = 0;
+	xbee_frame_decoder_init( &link->decoder, XBEE_API_ESCAPED_MODE );
+}//----- End ----- xbee_link_init( struct xbee_link *, struct xbee * )----
+
+
+/* @breif Writes one packet
+ *
+ * An open command mode session is closed first, see write_data_length.
+ *
+ * @param struct xbee_link * link: The link
+ * @param const uint8_t * packet: The packet, packet[0] is its type
+ * @param int length: Bytes in packet, at most XBEE_LINK_MAX_PACKET
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+int xbee_link_send( struct xbee_link * link, const uint8_t * packet, int length )
+{
+	int size = xbee_frame_encode( packet, length, XBEE_API_ESCAPED_MODE, link->frame, sizeof(link->frame) );
+
+	if( size < 0 )
+		return 1;
+
+	return write_data_length( link->xbee, link->frame, size );
+}//----- End ----- xbee_link_send( struct xbee_link *, const uint8_t *, int )--
+
+
+/* @breif Reads the next packet into link->packet
+ *
+ * Bytes are fed to the decoder one at a time so that a read holding several
+ * packets hands them out one per call.
+ *
+ * @param struct xbee_link * link: The link
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error reading from the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Number of bytes in link->packet
+ */
+int xbee_link_receive( struct xbee_link * link, const struct timespec * deadline )
+{
+	int count;
+
+	for( ;; )
+	{
+		while( link->input_start < link->input_end )
+		{
+			if( xbee_frame_decode( &link->decoder, &link->input[link->input_start++], 1,
+								   keep_packet, link ) > 0 )
+			{
+				return link->length;
+			}//End ----- if( a packet is complete ) -------------------------
+		}//End ----- while( input left ) --------------------------------
+
+		count = read_port_raw( link->xbee, link->input, sizeof(link->input), deadline );
+
+		if( count <= 0 )
+			return count;
+
+		link->input_start = 0;
+		link->input_end = count;
+	}//End ----- for( ;; ) ------------------------------------------
+}//----- End ----- xbee_link_receive( struct xbee_link *, const struct timespec * )--
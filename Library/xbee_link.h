@@ -0,0 +1,94 @@
+/** @file xbee_link.h
+ ** @brief Packets over a transparent link
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes how the protocols that run between two
+ *				xbees in transparent mode, xbee_transfer and xbee_arq, cut the
+ *				byte stream into packets. Every packet is sent as an escaped
+ *				API frame(see xbee_frame.h) even though the xbee itself is in
+ *				transparent mode:
+ *
+ *					0x7E | length(2) | packet | checksum
+ *
+ *				The first byte of a packet is its type, where an API frame has
+ *				its API identifier. Bytes lost on the air cost one packet, the
+ *				decoder finds the start of the next one at its delimiter.
+ *
+ *				One protocol should use a port at a time, packets of another
+ *				protocol are handed out too.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_LINK_H
+#define XBEE_LINK_H
+
+#include <stdint.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_frame.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Largest packet, type included
+#define XBEE_LINK_MAX_PACKET XBEE_FRAME_MAX_DATA
+
+struct xbee_link
+{
+	struct xbee * xbee;
+	struct xbee_frame_decoder decoder;
+	uint8_t input[MAX_BUFFER_SIZE];			//Bytes read but not decoded yet
+	int input_start;
+	int input_end;
+	uint8_t packet[XBEE_LINK_MAX_PACKET];	//The last packet received
+	int length;								//Bytes in packet
+	uint8_t frame[XBEE_FRAME_MAX_ENCODED];	//A packet being written
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Prepares a link for packets
+ *
+ * @param struct xbee_link * link: The link to initialize
+ * @param struct xbee * xbee: The xbee the packets go through, in transparent mode
+ */
+void xbee_link_init( struct xbee_link *, struct xbee * );
+
+/* @breif Writes one packet
+ *
+ * An open command mode session is closed first, see write_data_length.
+ *
+ * @param struct xbee_link * link: The link
+ * @param const uint8_t * packet: The packet, packet[0] is its type
+ * @param int length: Bytes in packet, at most XBEE_LINK_MAX_PACKET
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+int xbee_link_send( struct xbee_link *, const uint8_t *, int );
+
+/* @breif Reads the next packet into link->packet
+ *
+ * When one read brings several packets they are handed out one per call.
+ *
+ * @param struct xbee_link * link: The link
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :	   -1 - Error reading from the port
+ *					0 - The deadline passed first
+ *			 Not Zero - Number of bytes in link->packet
+ */
+int xbee_link_receive( struct xbee_link *, const struct timespec * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,420 @@
+/** @file xbee_loop.c
+ ** @brief Implementation of the xbee_loop.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_loop.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include "xbee_loop.h"
+
+
+/* @breif Finds the watch registered for a descriptor
+ *
+ * @param struct xbee_loop * loop: The loop to search
+ * @param int fd: The registered descriptor
+ * @param struct xbee_loop_watch *** link: When not NULL, set to the pointer that
+ *										   links to the watch
+ *
+ * @return :		 NULL - The descriptor is not registered
+ *			 Not NULL - The watch of the descriptor
+ */
+static struct xbee_loop_watch * find_watch( struct xbee_loop * loop,
+											int fd,
+											struct xbee_loop_watch *** link )
+{
+	struct xbee_loop_watch ** current = &loop->watches;
+
+	while( *current != NULL && (*current)->fd != fd )
+	{
+		current = &(*current)->next;
+	}//End ----- while( *current != NULL ) --------------------------
+
+	if( link != NULL )
+		*link = current;
+
+	return *current;
+}//----- End ----- find_watch( struct xbee_loop *, int, ... )------------
+
+
+/* @breif Frees the watches removed during the last pass of the loop
+ *
+ * @param struct xbee_loop * loop: The loop to clean up
+ */
+static void free_retired( struct xbee_loop * loop )
+{
+	struct xbee_loop_watch * watch;
+
+	while( loop->retired != NULL )
+	{
+		watch = loop->retired;
+		loop->retired = watch->next;
+		free( watch );
+	}//End ----- while( loop->retired != NULL ) ---------------------
+}//----- End ----- free_retired( struct xbee_loop * )--------------------
+
+
+/* @breif Clears the loop's wake descriptor once it has woken the loop
+ *
+ * @param int fd: The wake descriptor
+ * @param uint32_t events: Unused
+ * @param void * arg: Unused
+ */
+static void drain_wake( int fd, uint32_t events, void * arg )
+{
+	uint64_t count;
+
+	if( read( fd, &count, sizeof(count) ) < 0 )
+		return;
+}//----- End ----- drain_wake( int, uint32_t, void * )-------------------
+
+
+/* @breif Creates the epoll instance used by the loop
+ *
+ * Header files needed: sys/epoll.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to initialize
+ *
+ * @return :		0 - Success
+ *					1 - Failed to create the epoll instance
+ *					2 - Failed to create or register the wake descriptor
+ *			 Not Zero - Error
+ */
+int xbee_loop_init( struct xbee_loop * loop )
+{
+	memset( loop, 0, sizeof(*loop) );
+
+	loop->wake_descriptor = -1;
+	atomic_store( &loop->running, 1 );
+	loop->epoll_descriptor = epoll_create1( EPOLL_CLOEXEC );
+
+	if( loop->epoll_descriptor < 0 )
+	{
+		printf( "\nCreating the event loop failed with error[%d].\n",
+				errno );
+
+		return 1;
+	}//End ----- if( loop->epoll_descriptor < 0 ) -------------------
+
+	loop->wake_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+	if( loop->wake_descriptor < 0 ||
+		xbee_loop_add( loop, loop->wake_descriptor, XBEE_LOOP_READ, drain_wake, NULL ) != 0 )
+	{
+		printf( "\nCreating the event loop's wake descriptor failed with error[%d].\n",
+				errno );
+
+		xbee_loop_close( loop );
+		return 2;
+	}//End ----- if( loop->wake_descriptor < 0 ) --------------------
+
+	return 0;
+}//----- End ----- xbee_loop_init( struct xbee_loop * )------------------
+
+
+/* @breif Removes every descriptor from the loop and releases its resources
+ *
+ * Descriptors registered with xbee_loop_add are not closed, timers are.
+ *
+ * @param struct xbee_loop * loop: The loop to close
+ */
+void xbee_loop_close( struct xbee_loop * loop )
+{
+	while( loop->watches != NULL )
+	{
+		xbee_loop_remove( loop, loop->watches->fd );
+	}//End ----- while( loop->watches != NULL ) ---------------------
+
+	free_retired( loop );
+
+	if( loop->epoll_descriptor >= 0 )
+		close( loop->epoll_descriptor );
+
+	if( loop->wake_descriptor >= 0 )
+		close( loop->wake_descriptor );
+
+	loop->epoll_descriptor = -1;
+	loop->wake_descriptor = -1;
+}//----- End ----- xbee_loop_close( struct xbee_loop * )-----------------
+
+
+/* @breif Registers a descriptor with the loop
+ *
+ * @param struct xbee_loop * loop: The loop to register with
+ * @param int fd: The descriptor to watch
+ * @param uint32_t events: XBEE_LOOP_READ and/or XBEE_LOOP_WRITE
+ * @param xbee_loop_callback callback: Called when fd is ready
+ * @param void * arg: Passed to callback
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to add the descriptor to the epoll instance
+ *			 Not Zero - Error
+ */
+int xbee_loop_add( struct xbee_loop * loop,
+				   int fd,
+				   uint32_t events,
+				   xbee_loop_callback callback,
+				   void * arg )
+{
+	struct epoll_event event;
+	struct xbee_loop_watch * watch = calloc( 1, sizeof(*watch) );
+
+	if( watch == NULL )
+		return 1;
+
+	watch->fd = fd;
+	watch->callback = callback;
+	watch->arg = arg;
+
+	memset( &event, 0, sizeof(event) );
+	event.events = events;
+	event.data.ptr = watch;		//Lets a pass go straight from the event to its callback
+
+	if( epoll_ctl( loop->epoll_descriptor, EPOLL_CTL_ADD, fd, &event ) != 0 )
+	{
+		printf( "\nAdding descriptor[%d] to the event loop failed with error[%d].\n",
+				fd,
+				errno );
+
+		free( watch );
+		return 2;
+	}//End ----- if( epoll_ctl != 0 ) -------------------------------
+
+	watch->next = loop->watches;
+	loop->watches = watch;
+
+	return 0;
+}//----- End ----- xbee_loop_add( struct xbee_loop *, int, ... )---------
+
+
+/* @breif Changes the events a registered descriptor is watched for
+ *
+ * @param struct xbee_loop * loop: The loop the descriptor is registered with
+ * @param int fd: The registered descriptor
+ * @param uint32_t events: XBEE_LOOP_READ and/or XBEE_LOOP_WRITE
+ *
+ * @return :		0 - Success
+ *					1 - Failed to modify the descriptor
+ *			 Not Zero - Error
+ */
+int xbee_loop_modify( struct xbee_loop * loop, int fd, uint32_t events )
+{
+	struct epoll_event event;
+	struct xbee_loop_watch * watch = find_watch( loop, fd, NULL );
+
+	if( watch == NULL )
+		return 1;
+
+	memset( &event, 0, sizeof(event) );
+	event.events = events;
+	event.data.ptr = watch;
+
+	if( epoll_ctl( loop->epoll_descriptor, EPOLL_CTL_MOD, fd, &event ) != 0 )
+		return 1;
+
+	return 0;
+}//----- End ----- xbee_loop_modify( struct xbee_loop *, int, uint32_t )-
+
+
+/* @breif Stops watching a descriptor
+ *
+ * The watch is only freed after the current pass, so a callback can remove a
+ * descriptor that is still waiting to be handled in the same pass.
+ *
+ * @param struct xbee_loop * loop: The loop the descriptor is registered with
+ * @param int fd: The registered descriptor
+ *
+ * @return :		0 - Success
+ *					1 - The descriptor is not registered
+ *			 Not Zero - Error
+ */
+int xbee_loop_remove( struct xbee_loop * loop, int fd )
+{
+	struct xbee_loop_watch ** link;
+	struct xbee_loop_watch * watch = find_watch( loop, fd, &link );
+
+	if( watch == NULL )
+		return 1;
+
+	epoll_ctl( loop->epoll_descriptor, EPOLL_CTL_DEL, fd, NULL );
+
+	if( watch->is_timer )
+		close( fd );
+
+	*link = watch->next;
+
+	watch->callback = NULL;
+	watch->next = loop->retired;
+	loop->retired = watch;
+
+	return 0;
+}//----- End ----- xbee_loop_remove( struct xbee_loop *, int )-----------
+
+
+/* @breif Creates a periodic timer and registers it with the loop
+ *
+ * Header files needed: sys/timerfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to register with
+ * @param int interval_ms: Milliseconds between calls of callback
+ * @param xbee_loop_callback callback: Called each time the timer expires
+ * @param void * arg: Passed to callback
+ *
+ * @return :	   -1 - Failed to create the timer
+ *			 Not Negative - The descriptor of the timer, used to remove it
+ */
+int xbee_loop_add_timer( struct xbee_loop * loop,
+						 int interval_ms,
+						 xbee_loop_callback callback,
+						 void * arg )
+{
+	struct itimerspec period;
+	int fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+
+	if( fd < 0 )
+	{
+		printf( "\nCreating a timer failed with error[%d].\n",
+				errno );
+
+		return -1;
+	}//End ----- if( fd < 0 ) ---------------------------------------
+
+	period.it_interval.tv_sec = interval_ms / 1000;
+	period.it_interval.tv_nsec = ( interval_ms % 1000 ) * 1000000L;
+	period.it_value = period.it_interval;
+
+	if( timerfd_settime( fd, 0, &period, NULL ) != 0 ||
+		xbee_loop_add( loop, fd, XBEE_LOOP_READ, callback, arg ) != 0 )
+	{
+		close( fd );
+		return -1;
+	}//End ----- if( timerfd_settime != 0 ) -------------------------
+
+	loop->watches->is_timer = 1;
+
+	return fd;
+}//----- End ----- xbee_loop_add_timer( struct xbee_loop *, int, ... )---
+
+
+/* @breif Waits for ready descriptors and calls their callbacks once
+ *
+ * @param struct xbee_loop * loop: The loop to run
+ * @param int timeout_ms: Longest time to wait in milliseconds, -1 waits forever
+ *
+ * @return :	   -1 - Error while waiting
+ *					0 - The timeout expired without any descriptor being ready
+ *			 Not Zero - The number of ready descriptors handled
+ */
+int xbee_loop_run_once( struct xbee_loop * loop, int timeout_ms )
+{
+	struct epoll_event events[XBEE_LOOP_MAX_EVENTS];
+	struct xbee_loop_watch * watch;
+	uint64_t expirations;
+	int count;
+	int index;
+
+	count = epoll_wait( loop->epoll_descriptor, events, XBEE_LOOP_MAX_EVENTS, timeout_ms );
+
+	if( count < 0 )
+		return ( errno == EINTR ) ? 0 : -1;
+
+	for( index = 0; index < count; index++ )
+	{
+		watch = events[index].data.ptr;
+
+		if( watch->callback == NULL ) //Removed by an earlier callback in this pass
+			continue;
+
+		if( watch->is_timer )
+		{
+			//Acknowledge the expirations so the timer stops being ready
+			if( read( watch->fd, &expirations, sizeof(expirations) ) < 0 )
+				continue;
+		}//End ----- if( watch->is_timer ) ------------------------------
+
+		watch->callback( watch->fd, events[index].events, watch->arg );
+	}//End ----- for( index < count ) -------------------------------
+
+	free_retired( loop );
+
+	return count;
+}//----- End ----- xbee_loop_run_once( struct xbee_loop *, int )---------
+
+
+/* @breif Runs the loop until xbee_loop_stop is called
+ *
+ * @param struct xbee_loop * loop: The loop to run
+ *
+ * @return :		0 - Stopped with xbee_loop_stop
+ *					1 - Error while waiting
+ *			 Not Zero - Error
+ */
+int xbee_loop_run( struct xbee_loop * loop )
+{
+	//Not set here, a stop from another thread may already have come
+	while( atomic_load( &loop->running ) )
+	{
+		if( xbee_loop_run_once( loop, -1 ) < 0 )
+		{
+			printf( "\nWaiting in the event loop failed with error[%d].\n",
+					errno );
+
+			return 1;
+		}//End ----- if( xbee_loop_run_once < 0 ) -----------------------
+	}//End ----- while( loop->running ) -----------------------------
+
+	return 0;
+}//----- End ----- xbee_loop_run( struct xbee_loop * )------------------
+
+
+/* @breif Makes xbee_loop_run return after the current pass
+ *
+ * Safe to call from any thread. A loop sleeping in another thread is woken.
+ * The stop is kept, so a loop stopped before its thread reaches xbee_loop_run
+ * returns from it at once.
+ *
+ * @param struct xbee_loop * loop: The loop to stop
+ */
+void xbee_loop_stop( struct xbee_loop * loop )
+{
+	atomic_store( &loop->running, 0 );
+
+	xbee_loop_wake( loop );
+}//----- End ----- xbee_loop_stop( struct xbee_loop * )------------------
+
+
+/* @breif Makes the current or next pass of the loop return at once
+ *
+ * Safe to call from any thread. Used to get the loop's thread to look at work
+ * handed to it by another thread.
+ *
+ * Header files needed: sys/eventfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to wake
+ */
+void xbee_loop_wake( struct xbee_loop * loop )
+{
+	uint64_t one = 1;
+
+	if( write( loop->wake_descriptor, &one, sizeof(one) ) < 0 )
+		return;		//EAGAIN, the counter is already far from zero
+}//----- End ----- xbee_loop_wake( struct xbee_loop * )------------------
@@ -0,0 +1,198 @@
+/** @file xbee_loop.h
+ ** @brief Event loop for xbee ports and other descriptors
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes an event loop built on epoll. Descriptors
+ *				(serial ports, stdin, timers or any other file descriptor) are
+ *				registered with the loop once together with a callback. Each
+ *				pass of the loop sleeps in the kernel until at least one of
+ *				them is ready and then calls the callback of every ready
+ *				descriptor with the events that occured.
+ *
+ *				Unlike select, the set of descriptors is not rebuilt on every
+ *				call and the cost of a pass does not depend on how many
+ *				descriptors are registered.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_LOOP_H
+#define XBEE_LOOP_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Events a descriptor can be watched for
+#define XBEE_LOOP_READ EPOLLIN		//Data is ready to be read
+#define XBEE_LOOP_WRITE EPOLLOUT	//Data can be written without blocking
+
+//Maximum number of ready descriptors handled by one pass of the loop
+#define XBEE_LOOP_MAX_EVENTS 64
+
+/* @breif Called when a registered descriptor is ready
+ *
+ * @param int fd: The descriptor that is ready
+ * @param uint32_t events: XBEE_LOOP_READ and/or XBEE_LOOP_WRITE, plus EPOLLERR or
+ *						   EPOLLHUP when the descriptor failed or was closed
+ * @param void * arg: The argument given when the descriptor was registered
+ */
+typedef void (*xbee_loop_callback)( int fd, uint32_t events, void * arg );
+
+//One registered descriptor
+struct xbee_loop_watch
+{
+	int fd;
+	int is_timer;					//The loop owns fd and reads its expirations
+	xbee_loop_callback callback;	//NULL once the watch has been removed
+	void * arg;
+	struct xbee_loop_watch * next;
+};
+
+struct xbee_loop
+{
+	int epoll_descriptor;
+	int wake_descriptor;			//eventfd that interrupts epoll_wait from other threads
+	atomic_int running;				//Set by xbee_loop_init, cleared by xbee_loop_stop
+	struct xbee_loop_watch * watches;
+	struct xbee_loop_watch * retired;	//Removed watches, freed after the current pass
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Creates the epoll instance used by the loop
+ *
+ * Header files needed: sys/epoll.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to initialize
+ *
+ * @return :		0 - Success
+ *					1 - Failed to create the epoll instance
+ *					2 - Failed to create or register the wake descriptor
+ *			 Not Zero - Error
+ */
+int xbee_loop_init( struct xbee_loop * );
+
+/* @breif Removes every descriptor from the loop and releases its resources
+ *
+ * Descriptors registered with xbee_loop_add are not closed, timers are.
+ *
+ * @param struct xbee_loop * loop: The loop to close
+ */
+void xbee_loop_close( struct xbee_loop * );
+
+/* @breif Registers a descriptor with the loop
+ *
+ * @param struct xbee_loop * loop: The loop to register with
+ * @param int fd: The descriptor to watch
+ * @param uint32_t events: XBEE_LOOP_READ and/or XBEE_LOOP_WRITE
+ * @param xbee_loop_callback callback: Called when fd is ready
+ * @param void * arg: Passed to callback
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to add the descriptor to the epoll instance
+ *			 Not Zero - Error
+ */
+int xbee_loop_add( struct xbee_loop *, int, uint32_t, xbee_loop_callback, void * );
+
+/* @breif Changes the events a registered descriptor is watched for
+ *
+ * Used to start or stop watching for write-readiness, for example only while
+ * there is data waiting to be written.
+ *
+ * @param struct xbee_loop * loop: The loop the descriptor is registered with
+ * @param int fd: The registered descriptor
+ * @param uint32_t events: XBEE_LOOP_READ and/or XBEE_LOOP_WRITE
+ *
+ * @return :		0 - Success
+ *					1 - Failed to modify the descriptor
+ *			 Not Zero - Error
+ */
+int xbee_loop_modify( struct xbee_loop *, int, uint32_t );
+
+/* @breif Stops watching a descriptor
+ *
+ * It is safe to call this from inside a callback, including for a descriptor
+ * that is ready in the same pass; its callback will not be called.
+ *
+ * @param struct xbee_loop * loop: The loop the descriptor is registered with
+ * @param int fd: The registered descriptor
+ *
+ * @return :		0 - Success
+ *					1 - The descriptor is not registered
+ *			 Not Zero - Error
+ */
+int xbee_loop_remove( struct xbee_loop *, int );
+
+/* @breif Creates a periodic timer and registers it with the loop
+ *
+ * Header files needed: sys/timerfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to register with
+ * @param int interval_ms: Milliseconds between calls of callback
+ * @param xbee_loop_callback callback: Called each time the timer expires
+ * @param void * arg: Passed to callback
+ *
+ * @return :	   -1 - Failed to create the timer
+ *			 Not Negative - The descriptor of the timer, used to remove it
+ */
+int xbee_loop_add_timer( struct xbee_loop *, int, xbee_loop_callback, void * );
+
+/* @breif Waits for ready descriptors and calls their callbacks once
+ *
+ * @param struct xbee_loop * loop: The loop to run
+ * @param int timeout_ms: Longest time to wait in milliseconds, -1 waits forever
+ *
+ * @return :	   -1 - Error while waiting
+ *					0 - The timeout expired without any descriptor being ready
+ *			 Not Zero - The number of ready descriptors handled
+ */
+int xbee_loop_run_once( struct xbee_loop *, int );
+
+/* @breif Runs the loop until xbee_loop_stop is called
+ *
+ * @param struct xbee_loop * loop: The loop to run
+ *
+ * @return :		0 - Stopped with xbee_loop_stop
+ *					1 - Error while waiting
+ *			 Not Zero - Error
+ */
+int xbee_loop_run( struct xbee_loop * );
+
+/* @breif Makes xbee_loop_run return after the current pass
+ *
+ * Safe to call from any thread. A loop sleeping in another thread is woken.
+ * The stop is kept, so a loop stopped before its thread reaches xbee_loop_run
+ * returns from it at once.
+ *
+ * @param struct xbee_loop * loop: The loop to stop
+ */
+void xbee_loop_stop( struct xbee_loop * );
+
+/* @breif Makes the current or next pass of the loop return at once
+ *
+ * Safe to call from any thread. Used to get the loop's thread to look at work
+ * handed to it by another thread.
+ *
+ * Header files needed: sys/eventfd.h
+ *
+ * @param struct xbee_loop * loop: The loop to wake
+ */
+void xbee_loop_wake( struct xbee_loop * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,309 @@
+/** @file xbee_pipeline.c
+ ** @brief Implementation of the xbee_pipeline.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_pipeline.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <string.h>
+#include "libxbee.h"
+#include "xbee_pipeline.h"
+
+
+/* @breif Tells whether a frame ID can be handed to a new request
+ *
+ * @param const struct xbee_at_request * request: The slot of the frame ID
+ * @param uint64_t now: xbee_stats_clock of the submit
+ *
+ * @return :		TRUE - The slot is free, or was cancelled long enough ago
+ *				   FALSE - The slot is in use or still kept from reuse
+ */
+static int slot_usable( const struct xbee_at_request * request, uint64_t now )
+{
+	if( request->state == XBEE_REQUEST_CANCELLED )
+		return now - request->sent_ns >= XBEE_PIPELINE_QUARANTINE_MS * 1000000ULL;
+
+	return request->state == XBEE_REQUEST_FREE;
+}//----- End ----- slot_usable( const struct xbee_at_request *, uint64_t )
+
+
+/* @breif Frame callback that completes the request a response belongs to
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param void * arg: The pipeline
+ */
+static void dispatch_frame( const uint8_t * data, int length, void * arg )
+{
+	struct xbee_pipeline * pipeline = arg;
+	struct xbee_at_response response;
+	struct xbee_at_request * request;
+
+	if( xbee_frame_parse_at_response( data, length, &response ) != 0 )
+	{
+		if( pipeline->unmatched != NULL )
+			pipeline->unmatched( data, length, pipeline->unmatched_arg );
+
+		return;
+	}//End ----- if( not an AT response ) ---------------------------
+
+	request = &pipeline->requests[response.frame_id];
+
+	//The late answer of a cancelled request frees its frame ID
+	if( response.frame_id != 0 && request->state == XBEE_REQUEST_CANCELLED )
+	{
+		request->state = XBEE_REQUEST_FREE;
+		return;
+	}//End ----- if( request was cancelled ) ------------------------
+
+	//Answers to released requests, or to someone else's frame ID 0, are dropped
+	if( response.frame_id == 0 || request->state != XBEE_REQUEST_PENDING )
+		return;
+
+	if( response.value_length > XBEE_AT_MAX_VALUE )
+		response.value_length = XBEE_AT_MAX_VALUE;
+
+	xbee_stats_record( get_xbee_stats( pipeline->xbee ), XBEE_HISTOGRAM_AT_ROUND_TRIP,
+					   xbee_stats_clock( ) - request->sent_ns );
+
+	if( response.status != XBEE_AT_STATUS_OK )
+		xbee_stats_count( get_xbee_stats( pipeline->xbee ), XBEE_STAT_AT_ERRORS, 1 );
+
+	request->status = response.status;
+	memcpy( request->value, response.value, response.value_length );
+	request->value_length = response.value_length;
+	request->state = XBEE_REQUEST_DONE;
+	pipeline->pending--;
+
+	if( request->callback != NULL )
+	{
+		request->callback( request, request->arg );
+		request->state = XBEE_REQUEST_FREE;
+	}//End ----- if( request->callback != NULL ) --------------------
+}//----- End ----- dispatch_frame( const uint8_t *, int, void * )--------
+
+
+/* @breif Prepares an empty pipeline
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline to initialize
+ * @param struct xbee * xbee: The xbee to send the commands to
+ * @param int mode: The xbee's API mode, XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ */
+void xbee_pipeline_init( struct xbee_pipeline * pipeline, struct xbee * xbee, int mode )
+{
+	memset( pipeline, 0, sizeof(*pipeline) );
+
+	pipeline->xbee = xbee;
+	pipeline->next_id = 1;
+	xbee_frame_decoder_init( &pipeline->decoder, mode );
+}//----- End ----- xbee_pipeline_init( struct xbee_pipeline *, ... )-----
+
+
+/* @breif Sets where frames other than AT command responses are delivered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param xbee_frame_callback callback: Receives the other frames
+ * @param void * arg: Passed to callback
+ */
+void xbee_pipeline_set_unmatched( struct xbee_pipeline * pipeline,
+								  xbee_frame_callback callback,
+								  void * arg )
+{
+	pipeline->unmatched = callback;
+	pipeline->unmatched_arg = arg;
+}//----- End ----- xbee_pipeline_set_unmatched( struct xbee_pipeline *, ... )
+
+
+/* @breif Writes an AT command frame without waiting for its response
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const char * command: The two letter command, e.g. "MY"
+ * @param const uint8_t * parameter: The value to set, NULL to read
+ * @param int parameter_length: Number of bytes in parameter
+ * @param xbee_at_callback callback: Called with the response, or NULL to wait
+ *									 for it with xbee_pipeline_wait
+ * @param void * arg: Passed to callback
+ *
+ * @return :	   -1 - All 255 frame IDs are in use or kept from reuse
+ *				   -2 - Error writing the frame
+ *			 Not Negative - The frame ID of the request
+ */
+int xbee_pipeline_submit( struct xbee_pipeline * pipeline,
+						  const char * command,
+						  const uint8_t * parameter,
+						  int parameter_length,
+						  xbee_at_callback callback,
+						  void * arg )
+{
+	uint8_t data[4 + XBEE_AT_MAX_VALUE];
+	struct xbee_at_request * request;
+	uint64_t now = xbee_stats_clock( );
+	int frame_id = pipeline->next_id;
+	int tries;
+	int length;
+
+	if( parameter_length > XBEE_AT_MAX_VALUE )
+		return -2;
+
+	//Take the next free frame ID, starting after the last one handed out
+	for( tries = 1; slot_usable( &pipeline->requests[frame_id], now ) == FALSE; tries++ )
+	{
+		if( tries == XBEE_PIPELINE_SLOTS - 1 )
+			return -1;
+
+		frame_id = ( frame_id % ( XBEE_PIPELINE_SLOTS - 1 ) ) + 1;
+	}//End ----- for( frame ID in use ) -----------------------------
+
+	pipeline->next_id = ( frame_id % ( XBEE_PIPELINE_SLOTS - 1 ) ) + 1;
+
+	request = &pipeline->requests[frame_id];
+	request->command[0] = command[0];
+	request->command[1] = command[1];
+	request->command[2] = '\0';
+	request->value_length = 0;
+	request->callback = callback;
+	request->arg = arg;
+
+	length = xbee_frame_at_command( frame_id, command, parameter, parameter_length, data );
+	request->sent_ns = xbee_stats_clock( );
+
+	if( write_frame( pipeline->xbee, data, length ) != 0 )
+	{
+		xbee_stats_count( get_xbee_stats( pipeline->xbee ), XBEE_STAT_AT_ERRORS, 1 );
+		return -2;
+	}//End ----- if( write_frame != 0 ) -----------------------------
+
+	request->state = XBEE_REQUEST_PENDING;
+	pipeline->pending++;
+
+	return frame_id;
+}//----- End ----- xbee_pipeline_submit( struct xbee_pipeline *, ... )---
+
+
+/* @breif Reads the port once and completes the requests that were answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - At least one frame was received
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a frame arrived
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_poll( struct xbee_pipeline * pipeline, const struct timespec * deadline )
+{
+	return read_frames( pipeline->xbee, &pipeline->decoder, dispatch_frame, pipeline, deadline );
+}//----- End ----- xbee_pipeline_poll( struct xbee_pipeline *, ... )-----
+
+
+/* @breif Waits until one request has been answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - The request is done, see xbee_pipeline_result
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed first
+ *					4 - frame_id is not a frame ID of the pipeline
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_wait( struct xbee_pipeline * pipeline,
+						int frame_id,
+						const struct timespec * deadline )
+{
+	int result;
+
+	if( frame_id < 1 || frame_id >= XBEE_PIPELINE_SLOTS )
+		return 4;
+
+	while( pipeline->requests[frame_id].state == XBEE_REQUEST_PENDING )
+	{
+		result = xbee_pipeline_poll( pipeline, deadline );
+
+		if( result != 0 )
+			return result;
+	}//End ----- while( request is pending ) ------------------------
+
+	return 0;
+}//----- End ----- xbee_pipeline_wait( struct xbee_pipeline *, int, ... )
+
+
+/* @breif Waits until every submitted request has been answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Nothing is pending anymore
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed first
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_wait_all( struct xbee_pipeline * pipeline, const struct timespec * deadline )
+{
+	int result;
+
+	while( pipeline->pending > 0 )
+	{
+		result = xbee_pipeline_poll( pipeline, deadline );
+
+		if( result != 0 )
+			return result;
+	}//End ----- while( pipeline->pending > 0 ) ---------------------
+
+	return 0;
+}//----- End ----- xbee_pipeline_wait_all( struct xbee_pipeline *, ... )-
+
+
+/* @breif Gives access to a request submitted without a callback
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ *
+ * @return :		 NULL - The request is not done
+ *			 Not NULL - The completed request
+ */
+const struct xbee_at_request * xbee_pipeline_result( struct xbee_pipeline * pipeline, int frame_id )
+{
+	if( frame_id < 1 || frame_id >= XBEE_PIPELINE_SLOTS ||
+		pipeline->requests[frame_id].state != XBEE_REQUEST_DONE )
+	{
+		return NULL;
+	}//End ----- if( request is not done ) --------------------------
+
+	return &pipeline->requests[frame_id];
+}//----- End ----- xbee_pipeline_result( struct xbee_pipeline *, int )---
+
+
+/* @breif Frees the frame ID of a request
+ *
+ * A pending request is cancelled instead, its frame ID stays out of use until
+ * its response arrives or XBEE_PIPELINE_QUARANTINE_MS have passed.
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ */
+void xbee_pipeline_release( struct xbee_pipeline * pipeline, int frame_id )
+{
+	if( frame_id < 1 || frame_id >= XBEE_PIPELINE_SLOTS )
+		return;
+
+	if( pipeline->requests[frame_id].state == XBEE_REQUEST_PENDING )
+	{
+		pipeline->requests[frame_id].state = XBEE_REQUEST_CANCELLED;
+		pipeline->pending--;
+	}
+	else if( pipeline->requests[frame_id].state != XBEE_REQUEST_CANCELLED )
+	{
+		pipeline->requests[frame_id].state = XBEE_REQUEST_FREE;
+	}//End ----- if( request is pending ) ---------------------------
+}//----- End ----- xbee_pipeline_release( struct xbee_pipeline *, int )--
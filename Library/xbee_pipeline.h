@@ -0,0 +1,188 @@
+/** @file xbee_pipeline.h
+ ** @brief Pipelined AT commands for xbees in API mode
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a pipeline of local AT command frames. Each
+ *				request is tagged with its own frame ID and written at once,
+ *				without waiting for the answer to the previous one. Responses
+ *				are matched back to their request by frame ID in whatever order
+ *				they arrive, so reading many parameters costs about one round
+ *				trip instead of one per parameter.
+ *
+ *				A request completes either through a callback or, when no
+ *				callback is given, by waiting on its frame ID and reading the
+ *				result like a future.
+ *
+ *				The xbee must already be in API mode, see set_api_mode.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_PIPELINE_H
+#define XBEE_PIPELINE_H
+
+#include <stdint.h>
+#include <time.h>
+#include "xbee_frame.h"
+#include "libxbee.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Frame IDs run from 1 to 255, 0 would ask the xbee not to answer
+#define XBEE_PIPELINE_SLOTS 256
+
+//Largest AT response value kept for a request
+#define XBEE_AT_MAX_VALUE 255
+
+//States of a request slot
+#define XBEE_REQUEST_FREE 0
+#define XBEE_REQUEST_PENDING 1		//Written, waiting for the response
+#define XBEE_REQUEST_DONE 2			//Response received, waiting to be released
+#define XBEE_REQUEST_CANCELLED 3	//Released while pending, its response may still come
+
+//How long the frame ID of a cancelled request is kept from reuse, counted from
+//when its frame was written, so a late response can not complete a new request
+#define XBEE_PIPELINE_QUARANTINE_MS READ_TIMEOUT_MS
+
+//One AT request and, once it arrived, its response
+struct xbee_at_request
+{
+	int state;						//XBEE_REQUEST_*
+	char command[3];
+	uint8_t status;					//XBEE_AT_STATUS_* once done
+	uint8_t value[XBEE_AT_MAX_VALUE];
+	int value_length;
+	uint64_t sent_ns;				//xbee_stats_clock when the frame was written
+	void (*callback)( const struct xbee_at_request *, void * );
+	void * arg;
+};
+
+/* @breif Called when the response to a request arrives
+ *
+ * The request slot is released as soon as the callback returns.
+ *
+ * @param const struct xbee_at_request * request: The completed request
+ * @param void * arg: The argument given to xbee_pipeline_submit
+ */
+typedef void (*xbee_at_callback)( const struct xbee_at_request *, void * );
+
+struct xbee_pipeline
+{
+	struct xbee * xbee;				//The xbee the frames are written to and read from
+	int next_id;					//Frame ID tried first by the next submit
+	int pending;					//Requests still waiting for a response
+	struct xbee_frame_decoder decoder;
+	xbee_frame_callback unmatched;	//Receives frames that are not AT responses
+	void * unmatched_arg;
+	struct xbee_at_request requests[XBEE_PIPELINE_SLOTS];
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Prepares an empty pipeline
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline to initialize
+ * @param struct xbee * xbee: The xbee to send the commands to
+ * @param int mode: The xbee's API mode, XBEE_API_MODE or XBEE_API_ESCAPED_MODE
+ */
+void xbee_pipeline_init( struct xbee_pipeline *, struct xbee *, int );
+
+/* @breif Sets where frames other than AT command responses are delivered
+ *
+ * Without it those frames are dropped while the pipeline reads the port.
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param xbee_frame_callback callback: Receives the other frames
+ * @param void * arg: Passed to callback
+ */
+void xbee_pipeline_set_unmatched( struct xbee_pipeline *, xbee_frame_callback, void * );
+
+/* @breif Writes an AT command frame without waiting for its response
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const char * command: The two letter command, e.g. "MY"
+ * @param const uint8_t * parameter: The value to set, NULL to read
+ * @param int parameter_length: Number of bytes in parameter
+ * @param xbee_at_callback callback: Called with the response, or NULL to wait
+ *									 for it with xbee_pipeline_wait
+ * @param void * arg: Passed to callback
+ *
+ * @return :	   -1 - All 255 frame IDs are in use or kept from reuse
+ *				   -2 - Error writing the frame
+ *			 Not Negative - The frame ID of the request
+ */
+int xbee_pipeline_submit( struct xbee_pipeline *, const char *, const uint8_t *, int,
+						  xbee_at_callback, void * );
+
+/* @breif Reads the port once and completes the requests that were answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - At least one frame was received
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed before a frame arrived
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_poll( struct xbee_pipeline *, const struct timespec * );
+
+/* @breif Waits until one request has been answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - The request is done, see xbee_pipeline_result
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed first
+ *					4 - frame_id is not a frame ID of the pipeline
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_wait( struct xbee_pipeline *, int, const struct timespec * );
+
+/* @breif Waits until every submitted request has been answered
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up at
+ *
+ * @return :		0 - Nothing is pending anymore
+ *					1 - Error occured when reading from the port
+ *		 READ_TIMEOUT - The deadline passed first
+ *			 Not Zero - Error
+ */
+int xbee_pipeline_wait_all( struct xbee_pipeline *, const struct timespec * );
+
+/* @breif Gives access to a request submitted without a callback
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ *
+ * @return :		 NULL - The request is not done
+ *			 Not NULL - The completed request
+ */
+const struct xbee_at_request * xbee_pipeline_result( struct xbee_pipeline *, int );
+
+/* @breif Frees the frame ID of a request
+ *
+ * Must be called for requests submitted without a callback once their result
+ * has been read. Releasing a pending request cancels it: its frame ID is not
+ * handed out again until its response arrives, which is dropped, or until
+ * XBEE_PIPELINE_QUARANTINE_MS after it was written.
+ *
+ * @param struct xbee_pipeline * pipeline: The pipeline
+ * @param int frame_id: The frame ID returned by xbee_pipeline_submit
+ */
+void xbee_pipeline_release( struct xbee_pipeline *, int );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
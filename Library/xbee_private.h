@@ -0,0 +1,86 @@
+/** @file xbee_private.h
+ ** @brief Contents of the xbee context, shared by the library's modules only
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes what an xbee context holds. Applications only
+ *				see struct xbee as an opaque handle from libxbee.h and must not
+ *				include this file.
+ *
+ *				Everything the library knows about one port and the radio on it
+ *				lives here, so several radios can be driven from one process.
+ *				A context is not locked, each one must be used by one thread at
+ *				a time.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_PRIVATE_H
+#define XBEE_PRIVATE_H
+
+#include <termios.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_loop.h"
+#include "xbee_stats.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Bytes read from the port that have not been handed out by read_port yet.
+//head and tail run freely and are masked with RX_RING_SIZE - 1 on access.
+struct rx_ring
+{
+	char data[RX_RING_SIZE];
+	unsigned int head;		//Next byte to hand out
+	unsigned int tail;		//Where the next byte read from the port is stored
+};
+
+//What the library knows about the xbee's command mode. The xbee drops out of
+//command mode on its own once ATCT has passed without a command.
+struct at_session
+{
+	int active;					//TRUE while the xbee is in command mode
+	struct timespec expires;	//When the xbee's CT timer runs out
+	int command_timeout_ms;		//The xbee's ATCT value in milliseconds
+};
+
+//A recently read AT parameter, keyed by the two letter command
+struct at_cache_entry
+{
+	char command[3];			//e.g. "MY", empty when the slot is unused
+	char value[MAX_BUFFER_SIZE];
+	int valid;					//TRUE when value holds the xbee's answer
+	int ttl_ms;					//How long value is trusted, 0 disables caching
+	struct timespec expires;
+};
+
+struct xbee
+{
+	int port_descriptor;		//Used to define the port associated with the device, -1 if none
+	char port_name[MAX_BUFFER_SIZE];
+	struct termios newtio;		//Contains parameters for the serial port
+	int baud_rate;				//Bits per second the port runs at
+	int profile;				//PORT_LOW_LATENCY or PORT_THROUGHPUT
+
+	//Event loop the library waits on. The port is registered with it by init_port.
+	struct xbee_loop * loop;
+	struct xbee_loop own_loop;	//Used when no loop was given to xbee_create
+	int read_error;				//errno of the last failed read, 0 if none
+
+	int api_mode;				//The xbee's ATAP as last set by the library
+	struct rx_ring rx_ring;
+	struct at_session session;
+	struct at_cache_entry at_cache[AT_CACHE_SIZE];
+
+	//Updated with relaxed atomics, read from any thread through get_xbee_stats
+	struct xbee_stats stats;
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,400 @@
+/** @file xbee_rx.c
+ ** @brief Implementation of the xbee_rx.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_rx.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "libxbee.h"
+#include "xbee_private.h"
+#include "xbee_rx.h"
+#include "xbee_trace.h"
+
+
+/* @breif Hands a line or frame to the consumer, called by the thread only
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param const uint8_t * data: The line or frame
+ * @param int length: Number of bytes in data
+ */
+static void push( struct xbee_rx * rx, const uint8_t * data, int length )
+{
+	unsigned int tail = atomic_load_explicit( &rx->tail, memory_order_relaxed );
+	unsigned int head = atomic_load_explicit( &rx->head, memory_order_acquire );
+	uint64_t signal = 1;
+	struct xbee_rx_slot * slot;
+
+	if( tail - head == XBEE_RX_SLOTS )
+	{
+		atomic_fetch_add_explicit( &rx->dropped, 1, memory_order_relaxed );
+		return;
+	}//End ----- if( ring is full ) ---------------------------------
+
+	slot = &rx->slots[tail & ( XBEE_RX_SLOTS - 1 )];
+	memcpy( slot->data, data, length );
+	slot->length = length;
+
+	//Publish the slot, then check for a sleeping consumer. The full fence pairs
+	//with the one in xbee_rx_pop_wait so one of the two always sees the other.
+	atomic_store_explicit( &rx->tail, tail + 1, memory_order_release );
+	atomic_thread_fence( memory_order_seq_cst );
+
+	if( atomic_load_explicit( &rx->waiting, memory_order_relaxed ) &&
+		write( rx->wake_descriptor, &signal, sizeof(signal) ) < 0 )
+	{
+		return;		//EAGAIN, the consumer has not read its earlier wake ups yet
+	}//End ----- if( consumer is sleeping ) -------------------------
+}//----- End ----- push( struct xbee_rx *, const uint8_t *, int )--------
+
+
+/* @breif Frame callback that hands each decoded frame to the consumer
+ *
+ * @param const uint8_t * data: The frame data
+ * @param int length: Number of bytes in data
+ * @param void * arg: The receiver
+ */
+static void push_frame( const uint8_t * data, int length, void * arg )
+{
+	struct xbee_rx * rx = arg;
+
+	xbee_trace( XBEE_TRACE_FRAME, rx->port_descriptor, length, data, length );
+	push( rx, data, length );
+}//----- End ----- push_frame( const uint8_t *, int, void * )------------
+
+
+/* @breif Cuts received bytes into '\r' terminated lines
+ *
+ * An unfinished line is kept in partial for the next call.
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param const uint8_t * bytes: Bytes read from the port
+ * @param int count: Number of bytes
+ */
+static void split_lines( struct xbee_rx * rx, const uint8_t * bytes, int count )
+{
+	struct xbee_rx_slot * line = &rx->partial;
+	const uint8_t * end;
+	int length;
+
+	while( count > 0 )
+	{
+		end = memchr( bytes, '\r', count );
+		length = ( end != NULL ) ? end - bytes : count;
+
+		//A line longer than a slot is handed over in pieces
+		if( line->length + length > XBEE_RX_SLOT_SIZE )
+		{
+			length = XBEE_RX_SLOT_SIZE - line->length;
+			end = NULL;
+		}//End ----- if( line does not fit ) ----------------------------
+
+		memcpy( line->data + line->length, bytes, length );
+		line->length += length;
+		bytes += length;
+		count -= length;
+
+		if( end != NULL )
+		{
+			bytes++;		//Skip the '\r'
+			count--;
+		}
+		else if( line->length < XBEE_RX_SLOT_SIZE )
+		{
+			break;			//Wait for the rest of the line
+		}//End ----- if( end != NULL ) ----------------------------------
+
+		xbee_trace( XBEE_TRACE_LINE, rx->port_descriptor, line->length, line->data, line->length );
+		push( rx, line->data, line->length );
+		line->length = 0;
+	}//End ----- while( count > 0 ) ---------------------------------
+}//----- End ----- split_lines( struct xbee_rx *, const uint8_t *, int )-
+
+
+/* @breif Body of the receive thread
+ *
+ * Sleeps in poll until the port has input or stop_descriptor is signalled.
+ *
+ * @param void * arg: The receiver
+ *
+ * @return :		NULL
+ */
+static void * receive( void * arg )
+{
+	struct xbee_rx * rx = arg;
+	struct pollfd watched[2];
+	uint8_t bytes[RX_RING_SIZE];
+	uint64_t signal = 1;
+	ssize_t count;
+	int failure;
+
+	watched[0].fd = rx->port_descriptor;
+	watched[0].events = POLLIN;
+	watched[1].fd = rx->stop_descriptor;
+	watched[1].events = POLLIN;
+
+	for( ;; )
+	{
+		//In PORT_THROUGHPUT the port only polls readable once a batch is
+		//waiting, a shorter tail is picked up when the wait times out
+		xbee_stats_count( rx->stats, XBEE_STAT_WAITS, 1 );
+
+		if( poll( watched, 2, rx->wait_ms ) < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			break;
+		}//End ----- if( poll < 0 ) -------------------------------------
+
+		if( watched[1].revents != 0 )
+			return NULL;
+
+		count = read( rx->port_descriptor, bytes, sizeof(bytes) );
+		xbee_stats_count( rx->stats, XBEE_STAT_READS, 1 );
+
+		if( count > 0 )
+		{
+			xbee_stats_count( rx->stats, XBEE_STAT_BYTES_IN, count );
+			xbee_trace( XBEE_TRACE_BYTES_IN, rx->port_descriptor, count, bytes, count );
+		}
+		else
+			xbee_stats_count( rx->stats, XBEE_STAT_EMPTY_WAKEUPS, 1 );
+
+		if( count < 0 )
+		{
+			if( errno == EAGAIN || errno == EINTR )
+				continue;
+
+			break;
+		}//End ----- if( count < 0 ) ------------------------------------
+
+		if( count == 0 && ( watched[0].revents & POLLHUP ) )
+		{
+			errno = EIO;		//The other end went away
+			break;
+		}//End ----- if( port hung up ) ---------------------------------
+
+		if( rx->kind == XBEE_RX_FRAMES )
+			xbee_frame_decode( &rx->decoder, bytes, count, push_frame, rx );
+		else
+			split_lines( rx, bytes, count );
+	}//End ----- for( ;; ) ------------------------------------------
+
+	failure = errno;
+	printf( "The receive thread stopped after errno(%d)!\n", failure );
+
+	//Let a waiting consumer find out
+	atomic_store( &rx->error, failure );
+
+	if( write( rx->wake_descriptor, &signal, sizeof(signal) ) < 0 && errno != EAGAIN )
+		printf( "Waking the consumer failed with errno(%d)!\n", errno );
+
+	return NULL;
+}//----- End ----- receive( void * )-------------------------------------
+
+
+/* @breif Starts a receive thread for an open xbee
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_rx * rx: The receiver to start
+ * @param struct xbee * xbee: The xbee whose port is read
+ * @param int kind: XBEE_RX_LINES, or XBEE_RX_FRAMES when the xbee is in API mode
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to create the eventfds
+ *					3 - Failed to start the thread
+ *					4 - XBEE_RX_FRAMES was asked for in transparent mode
+ *			 Not Zero - Error
+ */
+int xbee_rx_start( struct xbee_rx * rx, struct xbee * xbee, int kind )
+{
+	if( kind == XBEE_RX_FRAMES && xbee->api_mode == XBEE_TRANSPARENT_MODE )
+		return 4;
+
+	memset( rx, 0, sizeof(*rx) );
+
+	rx->port_descriptor = xbee->port_descriptor;
+	rx->stats = &xbee->stats;
+	rx->kind = kind;
+	rx->wait_ms = ( xbee->profile == PORT_THROUGHPUT ) ? THROUGHPUT_WAIT_MS : -1;
+	xbee_frame_decoder_init( &rx->decoder, xbee->api_mode );
+
+	rx->slots = malloc( XBEE_RX_SLOTS * sizeof(*rx->slots) );
+
+	if( rx->slots == NULL )
+		return 1;
+
+	rx->stop_descriptor = eventfd( 0, EFD_CLOEXEC );
+	rx->wake_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+	if( rx->stop_descriptor < 0 || rx->wake_descriptor < 0 )
+	{
+		printf( "\nCreating the receive thread's eventfds failed with error[%d].\n",
+				errno );
+
+		if( rx->stop_descriptor >= 0 )
+			close( rx->stop_descriptor );
+
+		if( rx->wake_descriptor >= 0 )
+			close( rx->wake_descriptor );
+
+		free( rx->slots );
+		return 2;
+	}//End ----- if( eventfd failed ) -------------------------------
+
+	if( pthread_create( &rx->thread, NULL, receive, rx ) != 0 )
+	{
+		close( rx->stop_descriptor );
+		close( rx->wake_descriptor );
+		free( rx->slots );
+		return 3;
+	}//End ----- if( pthread_create != 0 ) --------------------------
+
+	return 0;
+}//----- End ----- xbee_rx_start( struct xbee_rx *, struct xbee *, int )-
+
+
+/* @breif Stops the receive thread and frees the ring
+ *
+ * @param struct xbee_rx * rx: The receiver to stop
+ */
+void xbee_rx_stop( struct xbee_rx * rx )
+{
+	uint64_t signal = 1;
+
+	while( write( rx->stop_descriptor, &signal, sizeof(signal) ) < 0 )
+	{
+		if( errno == EINTR )
+			continue;
+
+		//Without the signal the thread never returns, it is cancelled in poll instead
+		printf( "\nStopping the receive thread failed with error[%d].\n", errno );
+		pthread_cancel( rx->thread );
+		break;
+	}//End ----- while( write < 0 ) ---------------------------------
+
+	pthread_join( rx->thread, NULL );
+
+	close( rx->stop_descriptor );
+	close( rx->wake_descriptor );
+	free( rx->slots );
+	rx->slots = NULL;
+}//----- End ----- xbee_rx_stop( struct xbee_rx * )----------------------
+
+
+/* @breif Takes the oldest line or frame without waiting
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param uint8_t * buffer: The line or frame is stored here
+ * @param int size: Size of buffer, a longer line or frame is cut short
+ *
+ * @return :	   -1 - Nothing is waiting
+ *			 Not Negative - Number of bytes stored in buffer
+ */
+int xbee_rx_pop( struct xbee_rx * rx, uint8_t * buffer, int size )
+{
+	unsigned int head = atomic_load_explicit( &rx->head, memory_order_relaxed );
+	unsigned int tail = atomic_load_explicit( &rx->tail, memory_order_acquire );
+	struct xbee_rx_slot * slot;
+	int length;
+
+	if( head == tail )
+		return -1;
+
+	slot = &rx->slots[head & ( XBEE_RX_SLOTS - 1 )];
+	length = ( slot->length < size ) ? slot->length : size;
+	memcpy( buffer, slot->data, length );
+
+	//Only now may the thread reuse the slot
+	atomic_store_explicit( &rx->head, head + 1, memory_order_release );
+
+	return length;
+}//----- End ----- xbee_rx_pop( struct xbee_rx *, uint8_t *, int )-------
+
+
+/* @breif Takes the oldest line or frame, waiting for one until the deadline
+ *
+ * Header files needed: poll.h
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param uint8_t * buffer: The line or frame is stored here
+ * @param int size: Size of buffer, a longer line or frame is cut short
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up
+ *											at, NULL waits for ever
+ *
+ * @return :	   -1 - The deadline passed first
+ *				   -2 - The thread stopped after a read error, see error
+ *			 Not Negative - Number of bytes stored in buffer
+ */
+int xbee_rx_pop_wait( struct xbee_rx * rx,
+					  uint8_t * buffer,
+					  int size,
+					  const struct timespec * deadline )
+{
+	struct pollfd wake;
+	struct timespec now;
+	uint64_t signals;
+	int wait_ms = -1;
+	int length;
+
+	wake.fd = rx->wake_descriptor;
+	wake.events = POLLIN;
+
+	for( ;; )
+	{
+		length = xbee_rx_pop( rx, buffer, size );
+
+		if( length >= 0 )
+			return length;
+
+		if( atomic_load( &rx->error ) != 0 )
+			return -2;
+
+		if( deadline != NULL )
+		{
+			clock_gettime( CLOCK_MONOTONIC, &now );
+
+			wait_ms = ( deadline->tv_sec - now.tv_sec ) * 1000 +
+					  ( deadline->tv_nsec - now.tv_nsec ) / 1000000;
+
+			if( wait_ms <= 0 )
+				return -1;
+		}//End ----- if( deadline != NULL ) -----------------------------
+
+		//Say we are going to sleep, then look once more so a line pushed in
+		//between is not missed
+		atomic_store_explicit( &rx->waiting, TRUE, memory_order_relaxed );
+		atomic_thread_fence( memory_order_seq_cst );
+
+		if( atomic_load_explicit( &rx->tail, memory_order_relaxed ) ==
+			atomic_load_explicit( &rx->head, memory_order_relaxed ) )
+		{
+			poll( &wake, 1, wait_ms );
+		}//End ----- if( ring is still empty ) --------------------------
+
+		atomic_store_explicit( &rx->waiting, FALSE, memory_order_relaxed );
+
+		//EAGAIN when the ring was filled without a wake up
+		if( read( rx->wake_descriptor, &signals, sizeof(signals) ) < 0 )
+			continue;
+	}//End ----- for( ;; ) ------------------------------------------
+}//----- End ----- xbee_rx_pop_wait( struct xbee_rx *, ... )-------------
@@ -0,0 +1,140 @@
+/** @file xbee_rx.h
+ ** @brief Background receive thread handing lines or frames to a consumer
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a receive thread for one port. The thread reads
+ *				the port as soon as bytes arrive, even while the application is
+ *				busy, so bursts do not pile up in the kernel's tty buffer. It
+ *				cuts the bytes into '\r' terminated lines or into API frames and
+ *				hands them over through a ring of preallocated slots.
+ *
+ *				The ring has exactly one producer, the receive thread, and one
+ *				consumer, the thread calling xbee_rx_pop or xbee_rx_pop_wait. It
+ *				needs no lock, only the consumer blocked in xbee_rx_pop_wait is
+ *				woken through an eventfd. When the consumer falls so far behind
+ *				that the ring is full, new lines or frames are dropped and
+ *				counted instead of stalling the thread.
+ *
+ *				While the thread runs it owns the port's input. Reading the same
+ *				xbee with read_port, read_frames or the AT functions would race
+ *				with it. Writing is still allowed.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_RX_H
+#define XBEE_RX_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "libxbee.h"
+#include "xbee_frame.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Number of slots in the ring, must be a power of two
+#define XBEE_RX_SLOTS 256
+
+//Largest line or frame a slot holds, longer lines are split
+#define XBEE_RX_SLOT_SIZE XBEE_FRAME_MAX_DATA
+
+//What the receive thread hands over
+#define XBEE_RX_LINES 0				//'\r' terminated lines, without the '\r'
+#define XBEE_RX_FRAMES 1			//API frame data, checksum verified
+
+//A line or frame waiting for the consumer
+struct xbee_rx_slot
+{
+	int length;
+	uint8_t data[XBEE_RX_SLOT_SIZE];
+};
+
+struct xbee_rx
+{
+	int port_descriptor;			//The port the thread reads
+	int stop_descriptor;			//eventfd that tells the thread to stop
+	int wake_descriptor;			//eventfd that wakes a waiting consumer
+	int kind;						//XBEE_RX_LINES or XBEE_RX_FRAMES
+	int wait_ms;					//Longest sleep before reading anyway, -1 for none
+	pthread_t thread;
+	struct xbee_frame_decoder decoder;
+	struct xbee_rx_slot * slots;	//XBEE_RX_SLOTS slots, allocated once
+	struct xbee_rx_slot partial;	//The line being put together
+	struct xbee_stats * stats;		//The xbee's statistics, the thread counts its reads there
+
+	//head is only written by the consumer and tail only by the thread. Both
+	//run freely and are masked with XBEE_RX_SLOTS - 1 on access.
+	atomic_uint head;
+	atomic_uint tail;
+	atomic_int waiting;				//TRUE while the consumer sleeps on wake_descriptor
+	atomic_int error;				//errno of the failed read that stopped the thread
+	atomic_ulong dropped;			//Lines or frames lost because the ring was full
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Starts a receive thread for an open xbee
+ *
+ * Header files needed: pthread.h
+ *						sys/eventfd.h
+ *
+ * @param struct xbee_rx * rx: The receiver to start
+ * @param struct xbee * xbee: The xbee whose port is read
+ * @param int kind: XBEE_RX_LINES, or XBEE_RX_FRAMES when the xbee is in API mode
+ *
+ * @return :		0 - Success
+ *					1 - Out of memory
+ *					2 - Failed to create the eventfds
+ *					3 - Failed to start the thread
+ *					4 - XBEE_RX_FRAMES was asked for in transparent mode
+ *			 Not Zero - Error
+ */
+int xbee_rx_start( struct xbee_rx *, struct xbee *, int );
+
+/* @breif Stops the receive thread and frees the ring
+ *
+ * Lines or frames still in the ring are lost.
+ *
+ * @param struct xbee_rx * rx: The receiver to stop
+ */
+void xbee_rx_stop( struct xbee_rx * );
+
+/* @breif Takes the oldest line or frame without waiting
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param uint8_t * buffer: The line or frame is stored here
+ * @param int size: Size of buffer, a longer line or frame is cut short
+ *
+ * @return :	   -1 - Nothing is waiting
+ *			 Not Negative - Number of bytes stored in buffer
+ */
+int xbee_rx_pop( struct xbee_rx *, uint8_t *, int );
+
+/* @breif Takes the oldest line or frame, waiting for one until the deadline
+ *
+ * @param struct xbee_rx * rx: The receiver
+ * @param uint8_t * buffer: The line or frame is stored here
+ * @param int size: Size of buffer, a longer line or frame is cut short
+ * @param const struct timespec * deadline: CLOCK_MONOTONIC time to give up
+ *											at, NULL waits for ever
+ *
+ * @return :	   -1 - The deadline passed first
+ *				   -2 - The thread stopped after a read error, see error
+ *			 Not Negative - Number of bytes stored in buffer
+ */
+int xbee_rx_pop_wait( struct xbee_rx *, uint8_t *, int, const struct timespec * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
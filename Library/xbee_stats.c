@@ -0,0 +1,297 @@
+/** @file xbee_stats.c
+ ** @brief Implementation of the xbee_stats.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_stats.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "xbee_stats.h"
+
+//Names of the counters and histograms, in the order of their indexes
+static const char * counter_names[XBEE_STAT_COUNT] = {
+	"bytes_in",
+	"bytes_out",
+	"reads",
+	"writes",
+	"waits",
+	"empty_wakeups",
+	"timeouts",
+	"partial_writes",
+	"command_mode",
+	"at_errors",
+	"compress_in",
+	"compress_out",
+	"compress_raw"
+};
+
+static const char * histogram_names[XBEE_HISTOGRAM_COUNT] = {
+	"at_round_trip",
+	"command_mode",
+	"compress",
+	"decompress"
+};
+
+
+/* @breif Finds the bucket a value is counted in
+ *
+ * @param uint64_t value: The value in nanoseconds
+ *
+ * @return :		Index into the histogram's buckets
+ */
+static int bucket_index( uint64_t value )
+{
+	int top;
+
+	if( value < XBEE_HISTOGRAM_SUB_BUCKETS )
+		return value;
+
+	top = 63 - __builtin_clzll( value );	//Highest bit set, at least SUB_BITS
+
+	if( top >= XBEE_HISTOGRAM_MAX_BITS )
+		return XBEE_HISTOGRAM_BUCKETS - 1;
+
+	//The highest SUB_BITS bits of the value pick the bucket within its power of two
+	return XBEE_HISTOGRAM_SUB_BUCKETS +
+		   ( top - XBEE_HISTOGRAM_SUB_BITS ) * ( XBEE_HISTOGRAM_SUB_BUCKETS / 2 ) +
+		   ( value >> ( top - XBEE_HISTOGRAM_SUB_BITS + 1 ) ) - XBEE_HISTOGRAM_SUB_BUCKETS / 2;
+}//----- End ----- bucket_index( uint64_t )------------------------------
+
+
+/* @breif Gives the largest value a bucket holds
+ *
+ * @param int index: Index into the histogram's buckets
+ *
+ * @return :		The value in nanoseconds
+ */
+static uint64_t bucket_limit( int index )
+{
+	int group;
+	int shift;
+
+	if( index < XBEE_HISTOGRAM_SUB_BUCKETS )
+		return index;
+
+	index -= XBEE_HISTOGRAM_SUB_BUCKETS;
+	group = index / ( XBEE_HISTOGRAM_SUB_BUCKETS / 2 );
+	shift = group + 1;
+
+	return ( (uint64_t)( XBEE_HISTOGRAM_SUB_BUCKETS / 2 + index % ( XBEE_HISTOGRAM_SUB_BUCKETS / 2 ) + 1 )
+			 << shift ) - 1;
+}//----- End ----- bucket_limit( int )-----------------------------------
+
+
+/* @breif Adds to a counter, safe to call from any thread
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param int counter: XBEE_STAT_*
+ * @param unsigned long amount: What to add
+ */
+void xbee_stats_count( struct xbee_stats * stats, int counter, unsigned long amount )
+{
+	atomic_fetch_add_explicit( &stats->counters[counter], amount, memory_order_relaxed );
+}//----- End ----- xbee_stats_count( struct xbee_stats *, int, unsigned long )--
+
+
+/* @breif Records a latency in a histogram, safe to call from any thread
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param int histogram: XBEE_HISTOGRAM_*
+ * @param uint64_t nanoseconds: The latency
+ */
+void xbee_stats_record( struct xbee_stats * stats, int histogram, uint64_t nanoseconds )
+{
+	struct xbee_histogram * recorded = &stats->histograms[histogram];
+
+	atomic_fetch_add_explicit( &recorded->buckets[bucket_index( nanoseconds )], 1,
+							   memory_order_relaxed );
+	atomic_fetch_add_explicit( &recorded->total_ns, nanoseconds, memory_order_relaxed );
+}//----- End ----- xbee_stats_record( struct xbee_stats *, int, uint64_t )------
+
+
+/* @breif Reads the monotonic clock in nanoseconds, to time what is recorded
+ *
+ * Header files needed: time.h
+ *
+ * @return :		Nanoseconds since an unspecified point
+ */
+uint64_t xbee_stats_clock( void )
+{
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}//----- End ----- xbee_stats_clock( void )------------------------------
+
+
+/* @breif Copies the statistics without stopping the threads that update them
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param struct xbee_stats_snapshot * snapshot: The copy is stored here
+ */
+void xbee_stats_snapshot( struct xbee_stats * stats, struct xbee_stats_snapshot * snapshot )
+{
+	struct xbee_histogram_snapshot * copy;
+	int histogram;
+	int index;
+
+	for( index = 0; index < XBEE_STAT_COUNT; index++ )
+		snapshot->counters[index] = atomic_load_explicit( &stats->counters[index], memory_order_relaxed );
+
+	for( histogram = 0; histogram < XBEE_HISTOGRAM_COUNT; histogram++ )
+	{
+		copy = &snapshot->histograms[histogram];
+		copy->count = 0;
+		copy->total_ns = atomic_load_explicit( &stats->histograms[histogram].total_ns,
+											   memory_order_relaxed );
+
+		for( index = 0; index < XBEE_HISTOGRAM_BUCKETS; index++ )
+		{
+			copy->buckets[index] = atomic_load_explicit( &stats->histograms[histogram].buckets[index],
+														 memory_order_relaxed );
+			copy->count += copy->buckets[index];
+		}//End ----- for( index < XBEE_HISTOGRAM_BUCKETS ) ---------------
+	}//End ----- for( histogram < XBEE_HISTOGRAM_COUNT ) ------------
+}//----- End ----- xbee_stats_snapshot( struct xbee_stats *, struct xbee_stats_snapshot * )--
+
+
+/* @breif Sets every counter and histogram back to zero
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ */
+void xbee_stats_reset( struct xbee_stats * stats )
+{
+	int histogram;
+	int index;
+
+	for( index = 0; index < XBEE_STAT_COUNT; index++ )
+		atomic_store_explicit( &stats->counters[index], 0, memory_order_relaxed );
+
+	for( histogram = 0; histogram < XBEE_HISTOGRAM_COUNT; histogram++ )
+	{
+		atomic_store_explicit( &stats->histograms[histogram].total_ns, 0, memory_order_relaxed );
+
+		for( index = 0; index < XBEE_HISTOGRAM_BUCKETS; index++ )
+			atomic_store_explicit( &stats->histograms[histogram].buckets[index], 0, memory_order_relaxed );
+	}//End ----- for( histogram < XBEE_HISTOGRAM_COUNT ) ------------
+}//----- End ----- xbee_stats_reset( struct xbee_stats * )---------------
+
+
+/* @breif Gives a percentile of a histogram snapshot
+ *
+ * @param const struct xbee_histogram_snapshot * histogram: The histogram
+ * @param double percentile: From 0 to 100, e.g. 99.9
+ *
+ * @return :		0 - Nothing was recorded
+ *			 Not Zero - The largest value the bucket holding the percentile
+ *						can contain, in nanoseconds
+ */
+uint64_t xbee_stats_percentile( const struct xbee_histogram_snapshot * histogram, double percentile )
+{
+	unsigned long rank;
+	unsigned long seen = 0;
+	int index;
+
+	if( histogram->count == 0 )
+		return 0;
+
+	//Nearest rank, the smallest value with at least percentile % at or below it
+	rank = (unsigned long)( percentile / 100.0 * histogram->count + 0.999999 );
+
+	if( rank < 1 )
+		rank = 1;
+
+	for( index = 0; index < XBEE_HISTOGRAM_BUCKETS; index++ )
+	{
+		seen += histogram->buckets[index];
+
+		if( seen >= rank )
+			return bucket_limit( index );
+	}//End ----- for( index < XBEE_HISTOGRAM_BUCKETS ) ---------------
+
+	return bucket_limit( XBEE_HISTOGRAM_BUCKETS - 1 );
+}//----- End ----- xbee_stats_percentile( const struct xbee_histogram_snapshot *, double )--
+
+
+/* @breif Gives the name of a counter, e.g. "bytes_in"
+ *
+ * @param int counter: XBEE_STAT_*
+ *
+ * @return :		The name, "unknown" for a bad index
+ */
+const char * xbee_stats_counter_name( int counter )
+{
+	if( counter < 0 || counter >= XBEE_STAT_COUNT )
+		return "unknown";
+
+	return counter_names[counter];
+}//----- End ----- xbee_stats_counter_name( int )------------------------
+
+
+/* @breif Gives the name of a histogram, e.g. "at_round_trip"
+ *
+ * @param int histogram: XBEE_HISTOGRAM_*
+ *
+ * @return :		The name, "unknown" for a bad index
+ */
+const char * xbee_stats_histogram_name( int histogram )
+{
+	if( histogram < 0 || histogram >= XBEE_HISTOGRAM_COUNT )
+		return "unknown";
+
+	return histogram_names[histogram];
+}//----- End ----- xbee_stats_histogram_name( int )----------------------
+
+
+/* @breif Prints a snapshot, counters first, then the compression ratio when
+ * messages were compressed, then each histogram's count, mean and 50th, 99th
+ * and 99.9th percentile in microseconds
+ *
+ * @param const char * name: Printed in front of every line, e.g. the port
+ * @param const struct xbee_stats_snapshot * snapshot: What to print
+ */
+void xbee_stats_print( const char * name, const struct xbee_stats_snapshot * snapshot )
+{
+	const struct xbee_histogram_snapshot * histogram;
+	int index;
+
+	printf( "%s:", name );
+
+	for( index = 0; index < XBEE_STAT_COUNT; index++ )
+		printf( " %s=%lu", counter_names[index], snapshot->counters[index] );
+
+	printf( "\n" );
+
+	if( snapshot->counters[XBEE_STAT_COMPRESS_OUT] > 0 )
+	{
+		printf( "%s: compression ratio=%.2f\n",
+				name,
+				(double)snapshot->counters[XBEE_STAT_COMPRESS_IN] / snapshot->counters[XBEE_STAT_COMPRESS_OUT] );
+	}//End ----- if( messages were compressed ) ---------------------
+
+	for( index = 0; index < XBEE_HISTOGRAM_COUNT; index++ )
+	{
+		histogram = &snapshot->histograms[index];
+
+		printf( "%s: %s count=%lu mean=%.1fus p50=%.1fus p99=%.1fus p999=%.1fus\n",
+				name,
+				histogram_names[index],
+				histogram->count,
+				( histogram->count > 0 ) ? histogram->total_ns / 1000.0 / histogram->count : 0,
+				xbee_stats_percentile( histogram, 50 ) / 1000.0,
+				xbee_stats_percentile( histogram, 99 ) / 1000.0,
+				xbee_stats_percentile( histogram, 99.9 ) / 1000.0 );
+	}//End ----- for( index < XBEE_HISTOGRAM_COUNT ) -----------------
+}//----- End ----- xbee_stats_print( const char *, const struct xbee_stats_snapshot * )--
@@ -0,0 +1,188 @@
+/** @file xbee_stats.h
+ ** @brief Counters and latency histograms kept for every xbee
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes the statistics the library keeps for each port.
+ *				Every xbee context holds a struct xbee_stats, found with
+ *				get_xbee_stats. The library counts bytes, system calls, timeouts
+ *				and AT errors as it goes, and records how long AT round trips and
+ *				entering command mode take.
+ *
+ *				Counting is a relaxed atomic add, it takes no lock and orders
+ *				nothing, so it costs next to nothing on the I/O path. Any thread
+ *				may take a snapshot while the port is in use. A snapshot is not
+ *				one instant, a counter can move while the others are copied, but
+ *				every value in it was true at some point during the copy.
+ *
+ *				The histograms are HDR style: values below
+ *				XBEE_HISTOGRAM_SUB_BUCKETS nanoseconds are counted exactly, larger
+ *				ones in buckets XBEE_HISTOGRAM_SUB_BUCKETS / 2 to a power of two,
+ *				so a percentile is off by less than 1 / 32 of its value at any
+ *				magnitude, from microseconds on a pseudo terminal to seconds on
+ *				a slow radio.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_STATS_H
+#define XBEE_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Counters, indexes into counters[]
+#define XBEE_STAT_BYTES_IN 0			//Bytes read from the port
+#define XBEE_STAT_BYTES_OUT 1			//Bytes written to the port
+#define XBEE_STAT_READS 2				//read and readv calls on the port
+#define XBEE_STAT_WRITES 3				//writev calls on the port
+#define XBEE_STAT_WAITS 4				//epoll_wait and poll calls waiting for the port
+#define XBEE_STAT_EMPTY_WAKEUPS 5		//Reads that found nothing to read
+#define XBEE_STAT_TIMEOUTS 6			//Reads, writes or "+++" that gave up at their deadline
+#define XBEE_STAT_PARTIAL_WRITES 7		//writev calls that took only part of the data
+#define XBEE_STAT_COMMAND_MODE 8		//Times the xbee entered command mode
+#define XBEE_STAT_AT_ERRORS 9			//AT commands answered with an error or not at all
+#define XBEE_STAT_COMPRESS_IN 10		//Bytes of messages offered for compression
+#define XBEE_STAT_COMPRESS_OUT 11		//Bytes sent for them, compressed or raw
+#define XBEE_STAT_COMPRESS_RAW 12		//Messages sent raw because they did not get shorter
+#define XBEE_STAT_COUNT 13
+
+//Histograms, indexes into histograms[]
+#define XBEE_HISTOGRAM_AT_ROUND_TRIP 0	//From writing AT commands to their last answer
+#define XBEE_HISTOGRAM_COMMAND_MODE 1	//From writing "+++" to the xbee's "OK"
+#define XBEE_HISTOGRAM_COMPRESS 2		//Time spent compressing a message
+#define XBEE_HISTOGRAM_DECOMPRESS 3		//Time spent decompressing a message
+#define XBEE_HISTOGRAM_COUNT 4
+
+//Values below XBEE_HISTOGRAM_SUB_BUCKETS are exact, every power of two above
+//is split into XBEE_HISTOGRAM_SUB_BUCKETS / 2 buckets
+#define XBEE_HISTOGRAM_SUB_BITS 6
+#define XBEE_HISTOGRAM_SUB_BUCKETS ( 1 << XBEE_HISTOGRAM_SUB_BITS )
+
+//Largest value kept apart, about 18 minutes in nanoseconds. Larger values
+//are counted in the last bucket.
+#define XBEE_HISTOGRAM_MAX_BITS 40
+
+#define XBEE_HISTOGRAM_BUCKETS \
+	( XBEE_HISTOGRAM_SUB_BUCKETS + \
+	  ( XBEE_HISTOGRAM_MAX_BITS - XBEE_HISTOGRAM_SUB_BITS ) * ( XBEE_HISTOGRAM_SUB_BUCKETS / 2 ) )
+
+//A latency histogram as the library updates it
+struct xbee_histogram
+{
+	atomic_ulong buckets[XBEE_HISTOGRAM_BUCKETS];
+	atomic_ulong total_ns;				//Sum of every value, for the mean
+};
+
+//Everything counted for one xbee
+struct xbee_stats
+{
+	atomic_ulong counters[XBEE_STAT_COUNT];
+	struct xbee_histogram histograms[XBEE_HISTOGRAM_COUNT];
+};
+
+//A copy of a histogram that no longer changes
+struct xbee_histogram_snapshot
+{
+	unsigned long count;				//Values recorded
+	unsigned long total_ns;
+	unsigned long buckets[XBEE_HISTOGRAM_BUCKETS];
+};
+
+//A copy of struct xbee_stats that no longer changes
+struct xbee_stats_snapshot
+{
+	unsigned long counters[XBEE_STAT_COUNT];
+	struct xbee_histogram_snapshot histograms[XBEE_HISTOGRAM_COUNT];
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Adds to a counter, safe to call from any thread
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param int counter: XBEE_STAT_*
+ * @param unsigned long amount: What to add
+ */
+void xbee_stats_count( struct xbee_stats *, int, unsigned long );
+
+/* @breif Records a latency in a histogram, safe to call from any thread
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param int histogram: XBEE_HISTOGRAM_*
+ * @param uint64_t nanoseconds: The latency
+ */
+void xbee_stats_record( struct xbee_stats *, int, uint64_t );
+
+/* @breif Reads the monotonic clock in nanoseconds, to time what is recorded
+ *
+ * Header files needed: time.h
+ *
+ * @return :		Nanoseconds since an unspecified point
+ */
+uint64_t xbee_stats_clock( void );
+
+/* @breif Copies the statistics without stopping the threads that update them
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ * @param struct xbee_stats_snapshot * snapshot: The copy is stored here
+ */
+void xbee_stats_snapshot( struct xbee_stats *, struct xbee_stats_snapshot * );
+
+/* @breif Sets every counter and histogram back to zero
+ *
+ * Values counted while the reset runs may be lost or kept.
+ *
+ * @param struct xbee_stats * stats: The statistics of the xbee
+ */
+void xbee_stats_reset( struct xbee_stats * );
+
+/* @breif Gives a percentile of a histogram snapshot
+ *
+ * @param const struct xbee_histogram_snapshot * histogram: The histogram
+ * @param double percentile: From 0 to 100, e.g. 99.9
+ *
+ * @return :		0 - Nothing was recorded
+ *			 Not Zero - The largest value the bucket holding the percentile
+ *						can contain, in nanoseconds
+ */
+uint64_t xbee_stats_percentile( const struct xbee_histogram_snapshot *, double );
+
+/* @breif Gives the name of a counter, e.g. "bytes_in"
+ *
+ * @param int counter: XBEE_STAT_*
+ *
+ * @return :		The name, "unknown" for a bad index
+ */
+const char * xbee_stats_counter_name( int );
+
+/* @breif Gives the name of a histogram, e.g. "at_round_trip"
+ *
+ * @param int histogram: XBEE_HISTOGRAM_*
+ *
+ * @return :		The name, "unknown" for a bad index
+ */
+const char * xbee_stats_histogram_name( int );
+
+/* @breif Prints a snapshot, counters first, then the compression ratio when
+ * messages were compressed, then each histogram's count, mean and 50th, 99th
+ * and 99.9th percentile in microseconds
+ *
+ * @param const char * name: Printed in front of every line, e.g. the port
+ * @param const struct xbee_stats_snapshot * snapshot: What to print
+ */
+void xbee_stats_print( const char *, const struct xbee_stats_snapshot * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
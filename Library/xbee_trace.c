@@ -0,0 +1,479 @@
+/** @file xbee_trace.c
+ ** @brief Implementation of the xbee_trace.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_trace.h file.
+ *
+ *				Rings are never freed. When a thread exits its ring is handed
+ *				to the next thread that records, once the flushing thread has
+ *				emptied it, so the memory used is bounded by the number of
+ *				threads alive at the same time.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include "libxbee.h"
+#include "xbee_trace.h"
+
+//The records of one thread. tail is only written by the thread, head only by
+//the flushing thread. Both run freely and are masked with XBEE_TRACE_RECORDS - 1.
+struct trace_ring
+{
+	struct xbee_trace_record records[XBEE_TRACE_RECORDS];
+	atomic_uint head;
+	atomic_uint tail;
+	atomic_ulong dropped;			//Records lost because the ring was full
+	unsigned long reported;			//Part of dropped already written to the file
+	atomic_int owned;				//TRUE while a live thread records into the ring
+	uint16_t number;
+	struct trace_ring * next;
+};
+
+//The one trace of the process
+static struct
+{
+	atomic_int running;				//Checked first by every xbee_trace
+	int file_descriptor;
+	int stop_descriptor;			//eventfd that tells the flushing thread to stop
+	pthread_t thread;
+	pthread_mutex_t lock;			//Guards the list of rings and starting and stopping
+	struct trace_ring * rings;
+	int ring_count;
+	pthread_key_t key;				//Gives up a thread's ring when it exits
+	atomic_uint generation;			//Counts the traces started
+} tracer = { .lock = PTHREAD_MUTEX_INITIALIZER, .file_descriptor = -1, .stop_descriptor = -1 };
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread struct trace_ring * own_ring;
+static __thread unsigned int failed_generation;		//Trace a ring could not be had for
+
+static const char * event_names[XBEE_TRACE_EVENTS] = {
+	"UNKNOWN",
+	"THREAD",
+	"DROPPED",
+	"PORT_OPEN",
+	"BYTES_IN",
+	"BYTES_OUT",
+	"LINE",
+	"AT_SENT",
+	"AT_ANSWER",
+	"COMMAND_MODE",
+	"BAUD_RATE",
+	"API_MODE",
+	"TIMEOUT",
+	"FRAME"
+};
+
+
+/* @breif Reads a clock in nanoseconds
+ *
+ * @param clockid_t clock: CLOCK_MONOTONIC or CLOCK_REALTIME
+ *
+ * @return :		Nanoseconds
+ */
+static uint64_t clock_ns( clockid_t clock )
+{
+	struct timespec now;
+
+	clock_gettime( clock, &now );
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}//----- End ----- clock_ns( clockid_t )---------------------------------
+
+
+/* @breif Gives up a thread's ring when the thread exits
+ *
+ * @param void * arg: The ring
+ */
+static void release_ring( void * arg )
+{
+	struct trace_ring * ring = arg;
+
+	atomic_store( &ring->owned, FALSE );
+}//----- End ----- release_ring( void * )--------------------------------
+
+
+/* @breif Creates the key that releases rings, once per process
+ */
+static void create_key( void )
+{
+	pthread_key_create( &tracer.key, release_ring );
+}//----- End ----- create_key( void )------------------------------------
+
+
+/* @breif Writes a whole buffer to the trace file
+ *
+ * @param const void * data: The bytes
+ * @param size_t length: Number of bytes
+ *
+ * @return :		0 - Success
+ *					1 - Writing failed
+ *			 Not Zero - Error
+ */
+static int write_all( const void * data, size_t length )
+{
+	const char * next = data;
+	ssize_t written;
+
+	while( length > 0 )
+	{
+		written = write( tracer.file_descriptor, next, length );
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			return 1;
+		}//End ----- if( written < 0 ) ----------------------------------
+
+		next += written;
+		length -= written;
+	}//End ----- while( length > 0 ) --------------------------------
+
+	return 0;
+}//----- End ----- write_all( const void *, size_t )---------------------
+
+
+/* @breif Writes everything recorded so far to the trace file
+ *
+ * Only called by the flushing thread, or by xbee_trace_stop once it has ended.
+ */
+static void flush_rings( void )
+{
+	struct xbee_trace_record dropped;
+	struct trace_ring * ring;
+	unsigned long lost;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int start;
+	unsigned int count;
+	unsigned int first;
+
+	pthread_mutex_lock( &tracer.lock );
+	ring = tracer.rings;
+	pthread_mutex_unlock( &tracer.lock );
+
+	//Rings are only ever added at the front, the rest of the list never changes
+	for( ; ring != NULL; ring = ring->next )
+	{
+		head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+		tail = atomic_load_explicit( &ring->tail, memory_order_acquire );
+		count = tail - head;
+		start = head & ( XBEE_TRACE_RECORDS - 1 );
+		first = XBEE_TRACE_RECORDS - start;		//Records before the ring wraps
+
+		if( first > count )
+			first = count;
+
+		write_all( &ring->records[start], first * sizeof(struct xbee_trace_record) );
+		write_all( ring->records, ( count - first ) * sizeof(struct xbee_trace_record) );
+
+		atomic_store_explicit( &ring->head, tail, memory_order_release );
+
+		lost = atomic_load_explicit( &ring->dropped, memory_order_relaxed );
+
+		if( lost != ring->reported )
+		{
+			memset( &dropped, 0, sizeof(dropped) );
+			dropped.time_ns = clock_ns( CLOCK_MONOTONIC );
+			dropped.event = XBEE_TRACE_DROPPED;
+			dropped.thread = ring->number;
+			dropped.port = -1;
+			dropped.value = lost - ring->reported;
+
+			write_all( &dropped, sizeof(dropped) );
+			ring->reported = lost;
+		}//End ----- if( records were dropped ) -------------------------
+	}//End ----- for( each ring ) -----------------------------------
+}//----- End ----- flush_rings( void )-----------------------------------
+
+
+/* @breif Body of the flushing thread
+ *
+ * @param void * arg: Unused
+ *
+ * @return :		NULL
+ */
+static void * flush( void * arg )
+{
+	struct pollfd stop;
+
+	stop.fd = tracer.stop_descriptor;
+	stop.events = POLLIN;
+
+	for( ;; )
+	{
+		if( poll( &stop, 1, XBEE_TRACE_FLUSH_MS ) > 0 )
+			break;
+
+		flush_rings( );
+	}//End ----- for( ;; ) ------------------------------------------
+
+	return NULL;
+}//----- End ----- flush( void * )---------------------------------------
+
+
+/* @breif Finds the calling thread a ring, reusing one a dead thread left
+ *
+ * @return :		 NULL - Out of memory
+ *			 Not NULL - The thread's ring
+ */
+static struct trace_ring * claim_ring( void )
+{
+	struct trace_ring * ring;
+	int expected;
+
+	pthread_once( &key_once, create_key );
+	pthread_mutex_lock( &tracer.lock );
+
+	//A ring given up by a thread that exited can be taken once it is empty
+	for( ring = tracer.rings; ring != NULL; ring = ring->next )
+	{
+		expected = FALSE;
+
+		if( atomic_load( &ring->head ) == atomic_load( &ring->tail ) &&
+			atomic_compare_exchange_strong( &ring->owned, &expected, TRUE ) )
+		{
+			break;
+		}//End ----- if( ring is free ) ---------------------------------
+	}//End ----- for( each ring ) -----------------------------------
+
+	if( ring == NULL )
+	{
+		ring = calloc( 1, sizeof(*ring) );
+
+		if( ring != NULL )
+		{
+			atomic_store( &ring->owned, TRUE );
+			ring->number = tracer.ring_count++;
+			ring->next = tracer.rings;
+			tracer.rings = ring;
+		}//End ----- if( ring != NULL ) ---------------------------------
+	}//End ----- if( ring == NULL ) ---------------------------------
+
+	pthread_mutex_unlock( &tracer.lock );
+
+	if( ring != NULL )
+		pthread_setspecific( tracer.key, ring );
+
+	return ring;
+}//----- End ----- claim_ring( void )------------------------------------
+
+
+/* @breif Starts recording into a new trace file
+ *
+ * Header files needed: fcntl.h
+ *						pthread.h
+ *						sys/eventfd.h
+ *
+ * @param const char * path: The file to write, replaced when it exists
+ *
+ * @return :		0 - Success
+ *					1 - A trace is already running
+ *					2 - Failed to create the file
+ *					3 - Failed to create the eventfd
+ *					4 - Failed to start the flushing thread
+ *			 Not Zero - Error
+ */
+int xbee_trace_start( const char * path )
+{
+	struct xbee_trace_header header;
+	struct trace_ring * ring;
+	int result = 0;
+
+	pthread_mutex_lock( &tracer.lock );
+
+	if( atomic_load( &tracer.running ) == TRUE )
+	{
+		pthread_mutex_unlock( &tracer.lock );
+		return 1;
+	}//End ----- if( tracer.running ) -------------------------------
+
+	tracer.file_descriptor = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+	if( tracer.file_descriptor < 0 )
+	{
+		printf( "\nCreating the trace file[%s] failed with error[%d].\n", path, errno );
+		pthread_mutex_unlock( &tracer.lock );
+		return 2;
+	}//End ----- if( tracer.file_descriptor < 0 ) -------------------
+
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, XBEE_TRACE_MAGIC, sizeof(XBEE_TRACE_MAGIC) );
+	header.version = XBEE_TRACE_VERSION;
+	header.record_size = sizeof(struct xbee_trace_record);
+	header.monotonic_ns = clock_ns( CLOCK_MONOTONIC );
+	header.realtime_ns = clock_ns( CLOCK_REALTIME );
+
+	write_all( &header, sizeof(header) );
+
+	//Whatever an earlier trace left behind does not belong in this file
+	for( ring = tracer.rings; ring != NULL; ring = ring->next )
+	{
+		atomic_store( &ring->head, atomic_load( &ring->tail ) );
+		ring->reported = atomic_load( &ring->dropped );
+	}//End ----- for( each ring ) -----------------------------------
+
+	tracer.stop_descriptor = eventfd( 0, EFD_CLOEXEC );
+
+	if( tracer.stop_descriptor < 0 )
+	{
+		printf( "\nCreating the trace's eventfd failed with error[%d].\n", errno );
+		result = 3;
+	}
+	else if( pthread_create( &tracer.thread, NULL, flush, NULL ) != 0 )
+	{
+		printf( "\nStarting the trace's flushing thread failed.\n" );
+		close( tracer.stop_descriptor );
+		result = 4;
+	}//End ----- if( tracer.stop_descriptor < 0 ) -------------------
+
+	if( result != 0 )
+	{
+		close( tracer.file_descriptor );
+		tracer.file_descriptor = -1;
+		tracer.stop_descriptor = -1;
+	}
+	else
+	{
+		atomic_fetch_add( &tracer.generation, 1 );
+		atomic_store( &tracer.running, TRUE );
+	}//End ----- if( result != 0 ) ----------------------------------
+
+	pthread_mutex_unlock( &tracer.lock );
+
+	return result;
+}//----- End ----- xbee_trace_start( const char * )----------------------
+
+
+/* @breif Records an event, does nothing while no trace runs
+ *
+ * The first record of a thread claims its ring under tracer.lock. When no ring
+ * can be had the thread records nothing more until the next trace starts, so
+ * the allocation is not retried on every call.
+ *
+ * @param int event: XBEE_TRACE_*
+ * @param int port: The port descriptor, -1 when there is none
+ * @param uint32_t value: Depends on the event
+ * @param const void * data: Bytes to keep, may be NULL
+ * @param int length: Number of bytes in data, only XBEE_TRACE_DATA are kept
+ */
+void xbee_trace( int event, int port, uint32_t value, const void * data, int length )
+{
+	struct trace_ring * ring = own_ring;
+	struct xbee_trace_record * record;
+	unsigned int tail;
+
+	if( atomic_load_explicit( &tracer.running, memory_order_relaxed ) == FALSE )
+		return;
+
+	if( ring == NULL )
+	{
+		if( failed_generation == atomic_load_explicit( &tracer.generation, memory_order_relaxed ) )
+			return;
+
+		ring = own_ring = claim_ring( );
+
+		if( ring == NULL )
+		{
+			failed_generation = atomic_load_explicit( &tracer.generation, memory_order_relaxed );
+			return;
+		}//End ----- if( ring == NULL ) ---------------------------------
+
+		xbee_trace( XBEE_TRACE_THREAD, -1, syscall( SYS_gettid ), NULL, 0 );
+	}//End ----- if( ring == NULL ) ---------------------------------
+
+	tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+
+	if( tail - atomic_load_explicit( &ring->head, memory_order_acquire ) == XBEE_TRACE_RECORDS )
+	{
+		atomic_fetch_add_explicit( &ring->dropped, 1, memory_order_relaxed );
+		return;
+	}//End ----- if( ring is full ) ---------------------------------
+
+	if( data == NULL || length < 0 )
+		length = 0;
+	else if( length > XBEE_TRACE_DATA )
+		length = XBEE_TRACE_DATA;
+
+	record = &ring->records[tail & ( XBEE_TRACE_RECORDS - 1 )];
+	record->time_ns = clock_ns( CLOCK_MONOTONIC );
+	record->event = event;
+	record->thread = ring->number;
+	record->port = port;
+	record->length = length;
+	record->unused = 0;
+	record->value = value;
+
+	if( length > 0 )
+		memcpy( record->data, data, length );
+
+	atomic_store_explicit( &ring->tail, tail + 1, memory_order_release );
+}//----- End ----- xbee_trace( int, int, uint32_t, const void *, int )----
+
+
+/* @breif Writes what is still recorded and closes the trace file
+ */
+void xbee_trace_stop( void )
+{
+	uint64_t signal = 1;
+
+	pthread_mutex_lock( &tracer.lock );
+
+	if( atomic_load( &tracer.running ) == FALSE )
+	{
+		pthread_mutex_unlock( &tracer.lock );
+		return;
+	}//End ----- if( tracer.running == FALSE ) ----------------------
+
+	atomic_store( &tracer.running, FALSE );
+	pthread_mutex_unlock( &tracer.lock );
+
+	if( write( tracer.stop_descriptor, &signal, sizeof(signal) ) < 0 )
+		printf( "\nStopping the trace's flushing thread failed with error[%d].\n", errno );
+
+	pthread_join( tracer.thread, NULL );
+
+	flush_rings( );
+
+	close( tracer.stop_descriptor );
+	close( tracer.file_descriptor );
+	tracer.stop_descriptor = -1;
+	tracer.file_descriptor = -1;
+}//----- End ----- xbee_trace_stop( void )-------------------------------
+
+
+/* @breif Gives the name of an event, e.g. "BYTES_IN"
+ *
+ * @param int event: XBEE_TRACE_*
+ *
+ * @return :		The name, "UNKNOWN" for a bad event
+ */
+const char * xbee_trace_event_name( int event )
+{
+	if( event < 0 || event >= XBEE_TRACE_EVENTS )
+		return event_names[0];
+
+	return event_names[event];
+}//----- End ----- xbee_trace_event_name( int )--------------------------
@@ -0,0 +1,148 @@
+/** @file xbee_trace.h
+ ** @brief Binary trace of serial traffic and library events
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a trace recorder for timelines of what the
+ *				library did, down to the nanosecond. While a trace is running
+ *				the library records bytes read and written, completed lines, AT
+ *				commands and their answers, timeouts and changes of command
+ *				mode, baud rate and API mode. Nothing is recorded, and nearly
+ *				nothing is spent, while no trace runs.
+ *
+ *				Every thread that records gets a ring of its own. Its first
+ *				record claims the ring, which takes a lock and may allocate it,
+ *				after that recording takes no lock and never waits: it fills
+ *				one 32 byte record and publishes it with a release store. A
+ *				thread that can not get a ring records nothing until the next
+ *				trace starts. A background thread writes the rings to the
+ *				trace file every XBEE_TRACE_FLUSH_MS. When a thread records
+ *				faster than the file is written its ring fills and records are
+ *				dropped, the file then holds an XBEE_TRACE_DROPPED record
+ *				saying how many.
+ *
+ *				The file starts with a struct xbee_trace_header followed by
+ *				struct xbee_trace_record after struct xbee_trace_record, in
+ *				the byte order of the machine that wrote it. Records of one
+ *				thread are in order, records of different threads are not;
+ *				the trace_decode program sorts them by time and prints them.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_TRACE_H
+#define XBEE_TRACE_H
+
+#include <stdint.h>
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//First bytes of every trace file, and the format version this library writes
+#define XBEE_TRACE_MAGIC "XBTRACE"
+#define XBEE_TRACE_VERSION 1
+
+//Records in each thread's ring, must be a power of two
+#define XBEE_TRACE_RECORDS 4096
+
+//How often the rings are written to the file
+#define XBEE_TRACE_FLUSH_MS 100
+
+//Bytes of data kept in a record, longer data is cut
+#define XBEE_TRACE_DATA 12
+
+//Events, the meaning of a record's value depends on them
+#define XBEE_TRACE_THREAD 1				//A thread started recording, value is its thread ID
+#define XBEE_TRACE_DROPPED 2			//value records of the thread were lost
+#define XBEE_TRACE_PORT_OPEN 3			//value is the baud rate, data the end of the port's name
+#define XBEE_TRACE_BYTES_IN 4			//value bytes were read, data are the first
+#define XBEE_TRACE_BYTES_OUT 5			//value bytes were written, data are the first
+#define XBEE_TRACE_LINE 6				//A value byte line was completed, data is its start
+#define XBEE_TRACE_AT_SENT 7			//AT commands were written, data is their start
+#define XBEE_TRACE_AT_ANSWER 8			//The answer to the value'th chained command
+#define XBEE_TRACE_COMMAND_MODE 9		//value is TRUE on entering command mode, FALSE on leaving
+#define XBEE_TRACE_BAUD_RATE 10			//The port moved to value bits per second
+#define XBEE_TRACE_API_MODE 11			//The xbee was set to API mode value
+#define XBEE_TRACE_TIMEOUT 12			//A read or write gave up, value is the code returned
+#define XBEE_TRACE_FRAME 13				//An API frame of value bytes was decoded, data is its start
+#define XBEE_TRACE_EVENTS 14
+
+//Start of a trace file
+struct xbee_trace_header
+{
+	char magic[8];						//XBEE_TRACE_MAGIC
+	uint32_t version;					//XBEE_TRACE_VERSION
+	uint32_t record_size;				//sizeof(struct xbee_trace_record)
+	uint64_t monotonic_ns;				//CLOCK_MONOTONIC when the trace started
+	uint64_t realtime_ns;				//CLOCK_REALTIME at the same moment
+};
+
+//One event, 32 bytes
+struct xbee_trace_record
+{
+	uint64_t time_ns;					//CLOCK_MONOTONIC when the event happened
+	uint16_t event;						//XBEE_TRACE_*
+	uint16_t thread;					//Number of the recording thread's ring
+	int16_t port;						//Port descriptor, -1 when there is none
+	uint8_t length;						//Bytes used in data
+	uint8_t unused;
+	uint32_t value;
+	uint8_t data[XBEE_TRACE_DATA];
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Starts recording into a new trace file
+ *
+ * Header files needed: fcntl.h
+ *						pthread.h
+ *						sys/eventfd.h
+ *
+ * @param const char * path: The file to write, replaced when it exists
+ *
+ * @return :		0 - Success
+ *					1 - A trace is already running
+ *					2 - Failed to create the file
+ *					3 - Failed to create the eventfd
+ *					4 - Failed to start the flushing thread
+ *			 Not Zero - Error
+ */
+int xbee_trace_start( const char * );
+
+/* @breif Records an event, does nothing while no trace runs
+ *
+ * Safe to call from any thread. Only the first call of a thread takes a lock,
+ * to claim the thread's ring, later calls never block.
+ *
+ * @param int event: XBEE_TRACE_*
+ * @param int port: The port descriptor, -1 when there is none
+ * @param uint32_t value: Depends on the event
+ * @param const void * data: Bytes to keep, may be NULL
+ * @param int length: Number of bytes in data, only XBEE_TRACE_DATA are kept
+ */
+void xbee_trace( int, int, uint32_t, const void *, int );
+
+/* @breif Writes what is still recorded and closes the trace file
+ *
+ * Events recorded by other threads while the trace stops may be lost.
+ */
+void xbee_trace_stop( void );
+
+/* @breif Gives the name of an event, e.g. "BYTES_IN"
+ *
+ * @param int event: XBEE_TRACE_*
+ *
+ * @return :		The name, "UNKNOWN" for a bad event
+ */
+const char * xbee_trace_event_name( int );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
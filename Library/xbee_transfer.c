@@ -0,0 +1,893 @@
+/** @file xbee_transfer.c
+ ** @brief Implementation of the xbee_transfer.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_transfer.h file.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "xbee_transfer.h"
+#include "xbee_link.h"
+#include "xbee_at.h"
+
+//Bytes in front of the name of an OFFER
+#define OFFER_HEADER 16
+
+//How long xbee_transfer_receive waits at a time when it waits for ever
+#define WAIT_FOREVER_MS 60000
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+
+/* @breif Fills crc_table, called once
+ */
+static void build_crc_table( void )
+{
+	uint32_t crc;
+	int index;
+	int bit;
+
+	for( index = 0; index < 256; index++ )
+	{
+		crc = index;
+
+		for( bit = 0; bit < 8; bit++ )
+			crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0xEDB88320 : crc >> 1;
+
+		crc_table[index] = crc;
+	}//End ----- for( index < 256 ) ---------------------------------
+}//----- End ----- build_crc_table( void )-------------------------------
+
+
+/* @breif Updates a CRC32(IEEE 802.3, as used by zip and PNG)
+ *
+ * Start with crc 0, pass the result back in for the next piece of data.
+ *
+ * @param uint32_t crc: The CRC32 of the data so far
+ * @param const void * data: The next bytes
+ * @param size_t length: Number of bytes
+ *
+ * @return :		The CRC32 of the data so far and data
+ */
+uint32_t xbee_transfer_crc32( uint32_t crc, const void * data, size_t length )
+{
+	const uint8_t * bytes = data;
+	size_t index;
+
+	pthread_once( &crc_table_once, build_crc_table );
+
+	crc = ~crc;
+
+	for( index = 0; index < length; index++ )
+		crc = crc_table[( crc ^ bytes[index] ) & 0xFF] ^ ( crc >> 8 );
+
+	return ~crc;
+}//----- End ----- xbee_transfer_crc32( uint32_t, const void *, size_t )--
+
+
+/* @breif Stores a number most significant byte first
+ */
+static void put_u32( uint8_t * bytes, uint32_t value )
+{
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+}//----- End ----- put_u32( uint8_t *, uint32_t )-------------------------
+
+
+/* @breif Reads a number stored most significant byte first
+ */
+static uint32_t get_u32( const uint8_t * bytes )
+{
+	return ( (uint32_t)bytes[0] << 24 ) | ( (uint32_t)bytes[1] << 16 ) |
+		   ( (uint32_t)bytes[2] << 8 ) | bytes[3];
+}//----- End ----- get_u32( const uint8_t * )-----------------------------
+
+
+/* @breif Tells whether a name can be used as a file name in the directory
+ *
+ * @param const char * name: The name
+ * @param int length: Characters in name
+ *
+ * @return :		TRUE or FALSE
+ */
+static int usable_name( const char * name, int length )
+{
+	if( length < 1 || length > XBEE_TRANSFER_MAX_NAME )
+		return FALSE;
+
+	if( memchr( name, '/', length ) != NULL || memchr( name, '\0', length ) != NULL )
+		return FALSE;
+
+	if( ( length == 1 && name[0] == '.' ) || ( length == 2 && name[0] == '.' && name[1] == '.' ) )
+		return FALSE;
+
+	return TRUE;
+}//----- End ----- usable_name( const char *, int )-----------------------
+
+
+/* @breif Gives how long to wait for progress before sending again
+ *
+ * @param struct xbee * xbee: The xbee, its port's baud rate is used
+ * @param int chunk: Bytes per chunk
+ *
+ * @return :		Milliseconds
+ */
+static int progress_timeout( struct xbee * xbee, int chunk )
+{
+	int baud_rate = get_port_baud_rate( xbee );
+
+	if( baud_rate <= 0 )
+		baud_rate = DEFAULT_BAUD_RATE;
+
+	//Two chunks, fully escaped, at 10 bits per byte
+	return XBEE_TRANSFER_TIMEOUT_MS +
+		   (int)( 2LL * 2 * ( chunk + XBEE_TRANSFER_DATA_HEADER + 4 ) * 10 * 1000 / baud_rate );
+}//----- End ----- progress_timeout( struct xbee *, int )-----------------
+
+
+/* @breif Sends an ACCEPT or an ACK
+ *
+ * @param struct xbee_link * link: The link
+ * @param int type: XBEE_TRANSFER_ACCEPT or XBEE_TRANSFER_ACK
+ * @param uint32_t id: The transfer
+ * @param uint32_t offset: The offset the receiver expects next
+ * @param uint32_t crc: CRC32 of the bytes before offset, only sent in an ACCEPT
+ * @param int status: XBEE_TRANSFER_RUNNING, COMPLETE, CORRUPT or REFUSED
+ *
+ * @return :		0 - Success
+ *			 Not Zero - Error writing to the port
+ */
+static int send_answer( struct xbee_link * link, int type, uint32_t id, uint32_t offset,
+						uint32_t crc, int status )
+{
+	uint8_t packet[14];
+	int length = 0;
+
+	packet[length++] = type;
+	put_u32( packet + length, id );
+	length += 4;
+	put_u32( packet + length, offset );
+	length += 4;
+
+	if( type == XBEE_TRANSFER_ACCEPT )
+	{
+		put_u32( packet + length, crc );
+		length += 4;
+	}//End ----- if( ACCEPT ) ---------------------------------------
+
+	packet[length++] = status;
+
+	return xbee_link_send( link, packet, length );
+}//----- End ----- send_answer( struct xbee_link *, int, uint32_t, uint32_t, uint32_t, int )--
+
+
+/* @breif Fills in the timing of a report
+ *
+ * @param struct xbee_transfer_report * report: The report
+ * @param uint64_t start_ns: When the transfer started
+ * @param uint64_t end_ns: When the last progress was made
+ */
+static void finish_report( struct xbee_transfer_report * report, uint64_t start_ns, uint64_t end_ns )
+{
+	report->elapsed_ns = end_ns - start_ns;
+
+	if( report->elapsed_ns > 0 )
+		report->bytes_per_second = ( report->transferred - report->resumed_at ) * 1e9 / report->elapsed_ns;
+}//----- End ----- finish_report( struct xbee_transfer_report *, uint64_t )--
+
+
+/* @breif Picks the chunk size for an xbee from its largest RF payload
+ *
+ * @AT Command: ATNP (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		Bytes of data per DATA packet, XBEE_TRANSFER_DEFAULT_CHUNK
+ *					when ATNP can not be read
+ */
+int xbee_transfer_chunk_size( struct xbee * xbee )
+{
+	uint64_t payload;
+
+	if( xbee_at_get_number( xbee, XBEE_AT_NP, &payload ) != 0 )
+		return XBEE_TRANSFER_DEFAULT_CHUNK;
+
+	//The frame's delimiter, length and checksum and the DATA header share the
+	//payload with the chunk
+	if( payload > XBEE_TRANSFER_MAX_CHUNK + XBEE_TRANSFER_DATA_HEADER + 4 )
+		return XBEE_TRANSFER_MAX_CHUNK;
+
+	if( payload < XBEE_TRANSFER_MIN_CHUNK + XBEE_TRANSFER_DATA_HEADER + 4 )
+		return XBEE_TRANSFER_MIN_CHUNK;
+
+	return payload - XBEE_TRANSFER_DATA_HEADER - 4;
+}//----- End ----- xbee_transfer_chunk_size( struct xbee * )-------------
+
+
+/* @breif Offers the data until the receiver accepts it
+ *
+ * @param struct xbee_link * link: The link
+ * @param uint32_t * id: The transfer, a fresh start gets the next ID
+ * @param const uint8_t * data: The data
+ * @param uint32_t size: Bytes of data
+ * @param const char * name: Name of the data
+ * @param int chunk: Bytes per chunk
+ * @param int timeout_ms: How long to wait for each answer
+ * @param uint32_t * offset: Where the receiver wants the data from
+ * @param int * status: The status of the ACCEPT
+ *
+ * @return :		0 - Success
+ *			 Not Zero - The error xbee_transfer_send returns
+ */
+static int offer( struct xbee_link * link, uint32_t * id, const uint8_t * data, uint32_t size,
+				  const char * name, int chunk, int timeout_ms, uint32_t * offset, int * status )
+{
+	uint8_t packet[OFFER_HEADER + XBEE_TRANSFER_MAX_NAME];
+	struct timespec deadline;
+	int name_length = strlen( name );
+	int attempt;
+	int length;
+
+	packet[0] = XBEE_TRANSFER_OFFER;
+	put_u32( packet + 1, *id );
+	put_u32( packet + 5, size );
+	put_u32( packet + 9, xbee_transfer_crc32( 0, data, size ) );
+	packet[13] = chunk >> 8;
+	packet[14] = chunk;
+	packet[15] = 0;
+	memcpy( packet + OFFER_HEADER, name, name_length );
+
+	for( attempt = 0; attempt < XBEE_TRANSFER_RETRIES; attempt++ )
+	{
+		if( xbee_link_send( link, packet, OFFER_HEADER + name_length ) != 0 )
+			return 6;
+
+		deadline_after( &deadline, timeout_ms );
+
+		while( ( length = xbee_link_receive( link, &deadline ) ) > 0 )
+		{
+			if( length < 14 || link->packet[0] != XBEE_TRANSFER_ACCEPT || get_u32( link->packet + 1 ) != *id )
+				continue;
+
+			*offset = get_u32( link->packet + 5 );
+			*status = link->packet[13];
+
+			if( *status == XBEE_TRANSFER_REFUSED )
+				return 3;
+
+			if( *offset > size )
+				return 3;
+
+			//Resume only when the receiver holds the start of this very data
+			if( *offset > 0 && get_u32( link->packet + 9 ) != xbee_transfer_crc32( 0, data, *offset ) )
+			{
+				if( packet[15] & XBEE_TRANSFER_FRESH )
+					return 3;
+
+				//Under a new ID, the receiver answers a repeated OFFER as before
+				packet[15] |= XBEE_TRANSFER_FRESH;
+				put_u32( packet + 1, ++*id );
+				attempt = -1;
+				break;
+			}//End ----- if( the receiver holds other data ) ----------------
+
+			return 0;
+		}//End ----- while( packets arrive ) ----------------------------
+
+		if( length < 0 )
+			return 6;
+	}//End ----- for( attempt < XBEE_TRANSFER_RETRIES ) -------------
+
+	return 2;
+}//----- End ----- offer( struct xbee_link *, uint32_t, ... )------------------
+
+
+/* @breif Sends a blob to the receiver at the other end of the link
+ *
+ * Blocks until the receiver confirmed the whole data or the transfer failed.
+ * Calling it again with the same name and data resumes where it stopped.
+ *
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param const void * data: The bytes to send
+ * @param uint32_t size: Number of bytes
+ * @param const char * name: Name the receiver stores the data under
+ * @param int chunk: Bytes per chunk, 0 to pick one with xbee_transfer_chunk_size
+ * @param int window: Chunks in flight, 0 for XBEE_TRANSFER_DEFAULT_WINDOW
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :		0 - Success
+ *					1 - Bad name, chunk or window
+ *					2 - The receiver did not answer the OFFER
+ *					3 - The receiver refused the file
+ *					4 - The receiver stopped acknowledging, the transfer can
+ *						be resumed
+ *					5 - The receiver got every byte but the CRC32 was wrong
+ *					6 - Error writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_transfer_send( struct xbee * xbee, const void * data, uint32_t size, const char * name,
+						int chunk, int window, struct xbee_transfer_report * report )
+{
+	struct xbee_link link;
+	struct xbee_transfer_report unused;
+	uint8_t packet[XBEE_TRANSFER_DATA_HEADER + XBEE_TRANSFER_MAX_CHUNK];
+	const uint8_t * bytes = data;
+	struct timespec deadline;
+	uint32_t id = (uint32_t)xbee_stats_clock( );
+	uint32_t acked;
+	uint32_t next;
+	uint32_t sent = 0;				//End of the data sent at least once
+	uint32_t offset;
+	uint64_t start;
+	int timeout_ms;
+	int duplicates = 0;
+	int recovering = FALSE;			//Went back, ignore duplicates until progress
+	int retries = 0;
+	int status;
+	int length;
+	int result;
+
+	if( report == NULL )
+		report = &unused;
+
+	memset( report, 0, sizeof(*report) );
+
+	if( chunk == 0 )
+		chunk = xbee_transfer_chunk_size( xbee );
+
+	if( window == 0 )
+		window = XBEE_TRANSFER_DEFAULT_WINDOW;
+
+	if( !usable_name( name, strlen( name ) ) || chunk < XBEE_TRANSFER_MIN_CHUNK ||
+		chunk > XBEE_TRANSFER_MAX_CHUNK || window < 1 || window > XBEE_TRANSFER_MAX_WINDOW )
+	{
+		return 1;
+	}//End ----- if( bad arguments ) --------------------------------
+
+	strcpy( report->name, name );
+	report->size = size;
+	report->chunk = chunk;
+	timeout_ms = progress_timeout( xbee, chunk );
+	start = xbee_stats_clock( );
+
+	xbee_link_init( &link, xbee );
+
+	result = offer( &link, &id, bytes, size, name, chunk, timeout_ms, &offset, &status );
+
+	if( result != 0 || status == XBEE_TRANSFER_COMPLETE )
+	{
+		report->transferred = ( result == 0 ) ? size : 0;
+		finish_report( report, start, xbee_stats_clock( ) );
+		return result;
+	}//End ----- if( offer failed or nothing to send ) --------------
+
+	acked = next = sent = offset;
+	report->resumed_at = report->transferred = offset;
+	deadline_after( &deadline, timeout_ms );
+
+	for( ;; )
+	{
+		//Keep the window full
+		while( next < size && next - acked < (uint32_t)window * chunk )
+		{
+			length = ( size - next < (uint32_t)chunk ) ? size - next : (uint32_t)chunk;
+			packet[0] = XBEE_TRANSFER_DATA;
+			put_u32( packet + 1, id );
+			put_u32( packet + 5, next );
+			put_u32( packet + 9, xbee_transfer_crc32( 0, bytes + next, length ) );
+			memcpy( packet + XBEE_TRANSFER_DATA_HEADER, bytes + next, length );
+
+			if( xbee_link_send( &link, packet, XBEE_TRANSFER_DATA_HEADER + length ) != 0 )
+			{
+				result = 6;
+				break;
+			}//End ----- if( xbee_link_send != 0 ) --------------------------
+
+			report->chunks++;
+
+			if( next < sent )
+				report->retransmissions++;
+
+			next += length;
+
+			if( next > sent )
+				sent = next;
+		}//End ----- while( window not full ) ---------------------------
+
+		if( result != 0 )
+			break;
+
+		length = xbee_link_receive( &link, &deadline );
+
+		if( length < 0 )
+		{
+			result = 6;
+			break;
+		}//End ----- if( length < 0 ) -----------------------------------
+
+		if( length == 0 )
+		{
+			//No progress, send everything after the acknowledged offset again
+			report->timeouts++;
+
+			if( ++retries > XBEE_TRANSFER_RETRIES )
+			{
+				result = 4;
+				break;
+			}//End ----- if( too many retries ) -----------------------------
+
+			next = acked;
+			duplicates = 0;
+			recovering = TRUE;
+			deadline_after( &deadline, timeout_ms );
+			continue;
+		}//End ----- if( length == 0 ) ----------------------------------
+
+		if( length < 10 || link.packet[0] != XBEE_TRANSFER_ACK || get_u32( link.packet + 1 ) != id )
+			continue;
+
+		offset = get_u32( link.packet + 5 );
+		status = link.packet[9];
+
+		if( status == XBEE_TRANSFER_COMPLETE || status == XBEE_TRANSFER_CORRUPT ||
+			status == XBEE_TRANSFER_REFUSED )
+		{
+			result = ( status == XBEE_TRANSFER_COMPLETE ) ? 0 : ( status == XBEE_TRANSFER_CORRUPT ) ? 5 : 3;
+
+			if( status == XBEE_TRANSFER_COMPLETE )
+				acked = size;
+
+			break;
+		}//End ----- if( the receiver is done ) -------------------------
+
+		if( offset > acked && offset <= sent )
+		{
+			acked = offset;
+			retries = 0;
+			duplicates = 0;
+			recovering = FALSE;
+			deadline_after( &deadline, timeout_ms );
+
+			if( next < acked )
+				next = acked;
+		}
+		else if( offset == acked && next > acked && !recovering && ++duplicates == 2 )
+		{
+			//The chunk at acked was lost and the ones after it are arriving
+			next = acked;
+			duplicates = 0;
+			recovering = TRUE;
+		}//End ----- if( progress ) -------------------------------------
+	}//End ----- for( ;; ) ------------------------------------------
+
+	report->transferred = acked;
+	finish_report( report, start, xbee_stats_clock( ) );
+
+	return result;
+}//----- End ----- xbee_transfer_send( struct xbee *, const void *, uint32_t, const char *, ... )--
+
+
+/* @breif Sends a file, see xbee_transfer_send
+ *
+ * The receiver stores it under the file's name without its directories.
+ *
+ * Header files needed: sys/mman.h
+ *						sys/stat.h
+ *
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param const char * path: The file to send
+ * @param int chunk: Bytes per chunk, 0 to pick one with xbee_transfer_chunk_size
+ * @param int window: Chunks in flight, 0 for XBEE_TRANSFER_DEFAULT_WINDOW
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :	   -1 - The file can not be read or is larger than 4 GB
+ *			 Not Zero - The error returned by xbee_transfer_send
+ */
+int xbee_transfer_send_file( struct xbee * xbee, const char * path, int chunk, int window,
+							 struct xbee_transfer_report * report )
+{
+	const char * name = strrchr( path, '/' );
+	struct stat status;
+	void * data = NULL;
+	int descriptor;
+	int result;
+
+	name = ( name != NULL ) ? name + 1 : path;
+	descriptor = open( path, O_RDONLY );
+
+	if( descriptor < 0 )
+	{
+		printf( "Opening %s failed\n", path );
+		return -1;
+	}//End ----- if( descriptor < 0 ) -------------------------------
+
+	if( fstat( descriptor, &status ) != 0 || !S_ISREG( status.st_mode ) || status.st_size > UINT32_MAX )
+	{
+		printf( "%s is not a regular file of at most 4 GB\n", path );
+		close( descriptor );
+		return -1;
+	}//End ----- if( not a usable file ) ----------------------------
+
+	if( status.st_size > 0 )
+	{
+		data = mmap( NULL, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+
+		if( data == MAP_FAILED )
+		{
+			printf( "Mapping %s failed\n", path );
+			close( descriptor );
+			return -1;
+		}//End ----- if( data == MAP_FAILED ) ---------------------------
+	}//End ----- if( the file is not empty ) ------------------------
+
+	result = xbee_transfer_send( xbee, data, status.st_size, name, chunk, window, report );
+
+	if( data != NULL )
+		munmap( data, status.st_size );
+
+	close( descriptor );
+
+	return result;
+}//----- End ----- xbee_transfer_send_file( struct xbee *, const char *, int, int, ... )--
+
+
+/* @breif State of the receiving end of a transfer
+ */
+struct transfer_receiver
+{
+	uint32_t id;
+	uint32_t size;
+	uint32_t crc;					//CRC32 of the whole file, from the OFFER
+	int chunk;
+	uint32_t expected;				//Offset of the next chunk to write
+	uint32_t received_crc;			//CRC32 of the bytes before expected
+	int descriptor;					//The .part file
+
+	//Room for directory, '/', name and ".part" with the terminator
+	char path[MAX_BUFFER_SIZE + 1 + XBEE_TRANSFER_MAX_NAME];
+	char part[MAX_BUFFER_SIZE + 1 + XBEE_TRANSFER_MAX_NAME + sizeof(".part")];
+};
+
+
+/* @breif Opens the .part file for an OFFER and finds where to resume
+ *
+ * @param struct transfer_receiver * receiver: Where the state is kept
+ * @param const char * directory: Where the file is stored
+ * @param const uint8_t * packet: The OFFER
+ * @param int length: Bytes in packet
+ *
+ * @return :		0 - Success
+ *					1 - The OFFER is not usable
+ *					2 - The file can not be created
+ *			 Not Zero - Error
+ */
+static int accept_offer( struct transfer_receiver * receiver, const char * directory,
+						 const uint8_t * packet, int length )
+{
+	uint8_t block[4096];
+	struct stat status;
+	uint32_t offset;
+	uint32_t done;
+	int count;
+
+	if( length < OFFER_HEADER + 1 || !usable_name( (const char *)packet + OFFER_HEADER, length - OFFER_HEADER ) )
+		return 1;
+
+	receiver->id = get_u32( packet + 1 );
+	receiver->size = get_u32( packet + 5 );
+	receiver->crc = get_u32( packet + 9 );
+	receiver->chunk = ( packet[13] << 8 ) | packet[14];
+
+	if( receiver->chunk < XBEE_TRANSFER_MIN_CHUNK || receiver->chunk > XBEE_TRANSFER_MAX_CHUNK )
+		return 1;
+
+	if( strlen( directory ) >= MAX_BUFFER_SIZE )
+		return 2;
+
+	snprintf( receiver->path, sizeof(receiver->path), "%s/%.*s",
+			  directory, length - OFFER_HEADER, (const char *)packet + OFFER_HEADER );
+	snprintf( receiver->part, sizeof(receiver->part), "%s.part", receiver->path );
+
+	receiver->descriptor = open( receiver->part, O_RDWR | O_CREAT, 0644 );
+
+	if( receiver->descriptor < 0 || fstat( receiver->descriptor, &status ) != 0 )
+	{
+		printf( "Creating %s failed\n", receiver->part );
+		return 2;
+	}//End ----- if( the file can not be created ) ------------------
+
+	//Resume at the last whole chunk kept, but always receive at least one
+	offset = ( packet[15] & XBEE_TRANSFER_FRESH ) ? 0 :
+			 ( status.st_size < receiver->size ) ? status.st_size : receiver->size;
+	offset -= offset % receiver->chunk;
+
+	if( offset == receiver->size && offset > 0 )
+		offset = ( receiver->size - 1 ) / receiver->chunk * receiver->chunk;
+
+	if( ftruncate( receiver->descriptor, offset ) != 0 )
+		return 2;
+
+	receiver->received_crc = 0;
+
+	for( done = 0; done < offset; done += count )
+	{
+		count = pread( receiver->descriptor, block,
+					   ( offset - done < sizeof(block) ) ? offset - done : sizeof(block), done );
+
+		if( count <= 0 )
+			return 2;
+
+		receiver->received_crc = xbee_transfer_crc32( receiver->received_crc, block, count );
+	}//End ----- for( done < offset ) -------------------------------
+
+	receiver->expected = offset;
+
+	return 0;
+}//----- End ----- accept_offer( struct transfer_receiver *, const char *, const uint8_t *, int )--
+
+
+/* @breif Closes the .part file and renames it once it is complete and correct
+ *
+ * @param struct transfer_receiver * receiver: The receiver
+ *
+ * @return :		XBEE_TRANSFER_COMPLETE, CORRUPT or REFUSED
+ */
+static int finish_file( struct transfer_receiver * receiver )
+{
+	int status = XBEE_TRANSFER_COMPLETE;
+
+	if( receiver->received_crc != receiver->crc )
+		status = XBEE_TRANSFER_CORRUPT;
+
+	if( fsync( receiver->descriptor ) != 0 )
+		status = XBEE_TRANSFER_REFUSED;
+
+	close( receiver->descriptor );
+	receiver->descriptor = -1;
+
+	if( status == XBEE_TRANSFER_COMPLETE && rename( receiver->part, receiver->path ) != 0 )
+	{
+		printf( "Renaming %s failed\n", receiver->part );
+		status = XBEE_TRANSFER_REFUSED;
+	}//End ----- if( rename failed ) --------------------------------
+
+	//Bad data must not be resumed from
+	if( status == XBEE_TRANSFER_CORRUPT )
+		unlink( receiver->part );
+
+	return status;
+}//----- End ----- finish_file( struct transfer_receiver * )-------------
+
+
+/* @breif Receives one file into a directory
+ *
+ * Waits for an OFFER, then receives until the whole file is in, and for a
+ * while after that to answer a sender that missed the last ACK.
+ *
+ * @param struct xbee * xbee: The xbee to receive through, in transparent mode
+ * @param const char * directory: Where the file is stored
+ * @param int wait_ms: How long to wait for an OFFER, -1 for ever
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :		0 - Success
+ *					1 - No OFFER arrived within wait_ms
+ *					2 - The file can not be created
+ *					3 - The sender went silent, the .part file is kept
+ *					4 - Every byte arrived but the CRC32 was wrong
+ *					5 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_transfer_receive( struct xbee * xbee, const char * directory, int wait_ms,
+						   struct xbee_transfer_report * report )
+{
+	struct xbee_link link;
+	struct transfer_receiver receiver;
+	struct xbee_transfer_report unused;
+	struct timespec deadline;
+	uint64_t start = 0;
+	uint64_t end = 0;				//When the last chunk was written
+	uint32_t offset;
+	int status = XBEE_TRANSFER_RUNNING;
+	int timeout_ms = XBEE_TRANSFER_TIMEOUT_MS;
+	int retries = 0;
+	int result = 1;
+	int length;
+	int count;
+
+	if( report == NULL )
+		report = &unused;
+
+	memset( report, 0, sizeof(*report) );
+	receiver.id = 0;
+	receiver.descriptor = -1;
+
+	xbee_link_init( &link, xbee );
+	deadline_after( &deadline, ( wait_ms < 0 || wait_ms > WAIT_FOREVER_MS ) ? WAIT_FOREVER_MS : wait_ms );
+
+	for( ;; )
+	{
+		length = xbee_link_receive( &link, &deadline );
+
+		if( length < 0 )
+		{
+			result = 5;
+			break;
+		}//End ----- if( length < 0 ) -----------------------------------
+
+		if( length == 0 )
+		{
+			if( receiver.descriptor < 0 && status == XBEE_TRANSFER_RUNNING )
+			{
+				//Still waiting for an OFFER
+				if( wait_ms < 0 )
+				{
+					deadline_after( &deadline, WAIT_FOREVER_MS );
+					continue;
+				}//End ----- if( wait for ever ) --------------------------------
+
+				wait_ms -= WAIT_FOREVER_MS;
+
+				if( wait_ms > 0 )
+				{
+					deadline_after( &deadline, ( wait_ms > WAIT_FOREVER_MS ) ? WAIT_FOREVER_MS : wait_ms );
+					continue;
+				}//End ----- if( time left ) ------------------------------------
+
+				result = 1;
+				break;
+			}//End ----- if( no transfer yet ) ------------------------------
+
+			if( status != XBEE_TRANSFER_RUNNING )
+				break;		//The sender has not asked again, it got the last ACK
+
+			if( ++retries > XBEE_TRANSFER_RETRIES )
+			{
+				result = 3;
+				break;
+			}//End ----- if( too many retries ) -----------------------------
+
+			deadline_after( &deadline, timeout_ms );
+			continue;
+		}//End ----- if( length == 0 ) ----------------------------------
+
+		if( length < 5 )
+			continue;
+
+		if( link.packet[0] == XBEE_TRANSFER_OFFER && get_u32( link.packet + 1 ) != receiver.id &&
+			status == XBEE_TRANSFER_RUNNING )
+		{
+			//A new transfer, or the sender started over after giving up
+			if( receiver.descriptor >= 0 )
+				close( receiver.descriptor );
+
+			receiver.descriptor = -1;
+			result = accept_offer( &receiver, directory, link.packet, length );
+
+			if( result == 1 )
+			{
+				receiver.id = 0;
+				continue;
+			}//End ----- if( the OFFER is not usable ) ----------------------
+
+			if( result != 0 )
+			{
+				send_answer( &link, XBEE_TRANSFER_ACCEPT, get_u32( link.packet + 1 ), 0, 0, XBEE_TRANSFER_REFUSED );
+				break;
+			}//End ----- if( result != 0 ) ----------------------------------
+
+			memcpy( report->name, link.packet + OFFER_HEADER, length - OFFER_HEADER );
+			report->name[length - OFFER_HEADER] = '\0';
+			report->size = receiver.size;
+			report->chunk = receiver.chunk;
+			report->resumed_at = report->transferred = receiver.expected;
+			report->chunks = 0;
+			report->retransmissions = 0;
+			start = end = xbee_stats_clock( );
+			timeout_ms = progress_timeout( xbee, receiver.chunk );
+			retries = 0;
+
+			if( receiver.size == 0 )
+				status = finish_file( &receiver );
+		}
+		else if( get_u32( link.packet + 1 ) != receiver.id || receiver.id == 0 )
+		{
+			continue;		//Left over from another transfer
+		}//End ----- if( new OFFER ) ------------------------------------
+
+		if( link.packet[0] == XBEE_TRANSFER_OFFER )
+		{
+			//Answer again, the sender did not hear the ACCEPT
+			if( send_answer( &link, XBEE_TRANSFER_ACCEPT, receiver.id, receiver.expected,
+							 receiver.received_crc, status ) != 0 )
+			{
+				result = 5;
+				break;
+			}//End ----- if( send_answer != 0 ) -----------------------------
+		}
+		else if( link.packet[0] == XBEE_TRANSFER_DATA && length > XBEE_TRANSFER_DATA_HEADER )
+		{
+			offset = get_u32( link.packet + 5 );
+			count = length - XBEE_TRANSFER_DATA_HEADER;
+
+			if( xbee_transfer_crc32( 0, link.packet + XBEE_TRANSFER_DATA_HEADER, count ) !=
+				get_u32( link.packet + 9 ) )
+			{
+				continue;	//Damaged, the duplicates of the chunks after it bring it back
+			}//End ----- if( bad CRC32 ) ------------------------------------
+
+			if( status == XBEE_TRANSFER_RUNNING && offset == receiver.expected &&
+				offset + count <= receiver.size &&
+				( count == receiver.chunk || offset + count == receiver.size ) )
+			{
+				if( pwrite( receiver.descriptor, link.packet + XBEE_TRANSFER_DATA_HEADER, count, offset ) != count )
+				{
+					printf( "Writing %s failed\n", receiver.part );
+					send_answer( &link, XBEE_TRANSFER_ACK, receiver.id, receiver.expected, 0, XBEE_TRANSFER_REFUSED );
+					result = 2;
+					break;
+				}//End ----- if( pwrite failed ) --------------------------------
+
+				receiver.received_crc = xbee_transfer_crc32( receiver.received_crc,
+															 link.packet + XBEE_TRANSFER_DATA_HEADER, count );
+				receiver.expected += count;
+				report->chunks++;
+				end = xbee_stats_clock( );
+
+				if( receiver.expected == receiver.size )
+					status = finish_file( &receiver );
+			}
+			else
+			{
+				report->retransmissions++;
+			}//End ----- if( the chunk expected ) ---------------------------
+
+			if( send_answer( &link, XBEE_TRANSFER_ACK, receiver.id, receiver.expected, 0, status ) != 0 )
+			{
+				result = 5;
+				break;
+			}//End ----- if( send_answer != 0 ) -----------------------------
+		}
+		else
+		{
+			continue;
+		}//End ----- if( packet type ) ----------------------------------
+
+		retries = 0;
+		report->transferred = receiver.expected;
+		result = ( status == XBEE_TRANSFER_COMPLETE ) ? 0 : ( status == XBEE_TRANSFER_CORRUPT ) ? 4 :
+				 ( status == XBEE_TRANSFER_REFUSED ) ? 2 : 3;
+
+		//Once done linger, answering whatever the sender asks again
+		deadline_after( &deadline, ( status == XBEE_TRANSFER_RUNNING ) ? timeout_ms : 2 * timeout_ms );
+	}//End ----- for( ;; ) ------------------------------------------
+
+	if( receiver.descriptor >= 0 )
+		close( receiver.descriptor );
+
+	if( start != 0 )
+		finish_report( report, start, end );
+
+	return result;
+}//----- End ----- xbee_transfer_receive( struct xbee *, const char *, int, ... )--
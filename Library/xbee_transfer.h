@@ -0,0 +1,201 @@
+/** @file xbee_transfer.h
+ ** @brief Chunked transfer of files and blobs over a transparent link
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a bulk transfer protocol for moving files
+ *				and blobs far larger than a line between two xbees in
+ *				transparent mode, one end running xbee_transfer_send and the
+ *				other xbee_transfer_receive.
+ *
+ *				The data is cut into chunks that fit the RF packet(ATNP), each
+ *				carrying its offset and a CRC32. The sender keeps up to window
+ *				chunks in flight and the receiver acknowledges every chunk with
+ *				the offset it expects next. A lost or damaged chunk is sent
+ *				again, with every chunk after it, after two duplicate
+ *				acknowledgements or XBEE_TRANSFER_TIMEOUT_MS without progress.
+ *				Once the last byte is in the receiver checks the CRC32 of the
+ *				whole data.
+ *
+ *				The packets travel as described in xbee_link.h, numbers are
+ *				sent most significant byte first:
+ *
+ *					OFFER	'O' | id(4) | size(4) | CRC32(4) | chunk(2) | flags(1) | name
+ *					ACCEPT	'A' | id(4) | offset(4) | CRC32 of the first offset bytes(4) | status(1)
+ *					DATA	'D' | id(4) | offset(4) | CRC32 of the chunk(4) | bytes
+ *					ACK		'K' | id(4) | offset expected next(4) | status(1)
+ *
+ *				The receiver writes into <name>.part and renames it to <name>
+ *				once the CRC32 of the whole file matches. A transfer cut short
+ *				leaves the .part file behind. When the same file is offered
+ *				again the receiver accepts it from the end of the .part file;
+ *				when the first bytes differ from the file offered the sender
+ *				asks for a fresh start.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_TRANSFER_H
+#define XBEE_TRANSFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "libxbee.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Packet types
+#define XBEE_TRANSFER_OFFER 'O'
+#define XBEE_TRANSFER_ACCEPT 'A'
+#define XBEE_TRANSFER_DATA 'D'
+#define XBEE_TRANSFER_ACK 'K'
+
+//Flags of an OFFER
+#define XBEE_TRANSFER_FRESH 0x01		//Discard the .part file, start at offset 0
+
+//Status of an ACCEPT or ACK
+#define XBEE_TRANSFER_RUNNING 0			//More data is expected
+#define XBEE_TRANSFER_COMPLETE 1		//Every byte is in and the CRC32 matched
+#define XBEE_TRANSFER_CORRUPT 2			//Every byte is in but the CRC32 did not match
+#define XBEE_TRANSFER_REFUSED 3			//The receiver can not store the file
+
+//Bytes of a DATA packet in front of the chunk
+#define XBEE_TRANSFER_DATA_HEADER 13
+
+//Chunk sizes. The default is used when ATNP can not be read.
+#define XBEE_TRANSFER_MIN_CHUNK 16
+#define XBEE_TRANSFER_DEFAULT_CHUNK 256
+#define XBEE_TRANSFER_MAX_CHUNK 1400
+
+//Chunks in flight when the caller does not choose
+#define XBEE_TRANSFER_DEFAULT_WINDOW 4
+#define XBEE_TRANSFER_MAX_WINDOW 64
+
+//Time without progress before chunks are sent again, on top of the time the
+//port needs to send two chunks at its baud rate
+#define XBEE_TRANSFER_TIMEOUT_MS 1000
+
+//Timeouts in a row before a transfer is given up
+#define XBEE_TRANSFER_RETRIES 10
+
+//Longest name of a transferred file
+#define XBEE_TRANSFER_MAX_NAME 128
+
+//What a transfer did, filled in by both ends
+struct xbee_transfer_report
+{
+	char name[XBEE_TRANSFER_MAX_NAME + 1];
+	uint32_t size;						//Bytes of the whole file
+	uint32_t resumed_at;				//Offset the transfer started at, 0 unless resumed
+	uint32_t transferred;				//Offset acknowledged when the transfer ended
+	int chunk;							//Bytes per chunk
+	unsigned long chunks;				//DATA packets sent or received
+	unsigned long retransmissions;		//DATA packets sent again, or duplicates received
+	unsigned long timeouts;				//Times the sender went back for lack of progress
+	uint64_t elapsed_ns;				//From the OFFER to the last ACK
+	double bytes_per_second;			//( transferred - resumed_at ) / elapsed
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Updates a CRC32(IEEE 802.3, as used by zip and PNG)
+ *
+ * Start with crc 0, pass the result back in for the next piece of data.
+ *
+ * @param uint32_t crc: The CRC32 of the data so far
+ * @param const void * data: The next bytes
+ * @param size_t length: Number of bytes
+ *
+ * @return :		The CRC32 of the data so far and data
+ */
+uint32_t xbee_transfer_crc32( uint32_t, const void *, size_t );
+
+/* @breif Picks the chunk size for an xbee from its largest RF payload
+ *
+ * @AT Command: ATNP (only when the cached value is missing or expired)
+ *
+ * @param struct xbee * xbee: The xbee to use
+ *
+ * @return :		Bytes of data per DATA packet, XBEE_TRANSFER_DEFAULT_CHUNK
+ *					when ATNP can not be read
+ */
+int xbee_transfer_chunk_size( struct xbee * );
+
+/* @breif Sends a blob to the receiver at the other end of the link
+ *
+ * Blocks until the receiver confirmed the whole data or the transfer failed.
+ * Calling it again with the same name and data resumes where it stopped.
+ *
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param const void * data: The bytes to send
+ * @param uint32_t size: Number of bytes
+ * @param const char * name: Name the receiver stores the data under
+ * @param int chunk: Bytes per chunk, 0 to pick one with xbee_transfer_chunk_size
+ * @param int window: Chunks in flight, 0 for XBEE_TRANSFER_DEFAULT_WINDOW
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :		0 - Success
+ *					1 - Bad name, chunk or window
+ *					2 - The receiver did not answer the OFFER
+ *					3 - The receiver refused the file
+ *					4 - The receiver stopped acknowledging, the transfer can
+ *						be resumed
+ *					5 - The receiver got every byte but the CRC32 was wrong
+ *					6 - Error writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_transfer_send( struct xbee *, const void *, uint32_t, const char *, int, int,
+						struct xbee_transfer_report * );
+
+/* @breif Sends a file, see xbee_transfer_send
+ *
+ * The receiver stores it under the file's name without its directories.
+ *
+ * Header files needed: sys/mman.h
+ *						sys/stat.h
+ *
+ * @param struct xbee * xbee: The xbee to send through, in transparent mode
+ * @param const char * path: The file to send
+ * @param int chunk: Bytes per chunk, 0 to pick one with xbee_transfer_chunk_size
+ * @param int window: Chunks in flight, 0 for XBEE_TRANSFER_DEFAULT_WINDOW
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :	   -1 - The file can not be read or is larger than 4 GB
+ *			 Not Zero - The error returned by xbee_transfer_send
+ */
+int xbee_transfer_send_file( struct xbee *, const char *, int, int, struct xbee_transfer_report * );
+
+/* @breif Receives one file into a directory
+ *
+ * Waits for an OFFER, then receives until the whole file is in, and for a
+ * while after that to answer a sender that missed the last ACK.
+ *
+ * @param struct xbee * xbee: The xbee to receive through, in transparent mode
+ * @param const char * directory: Where the file is stored
+ * @param int wait_ms: How long to wait for an OFFER, -1 for ever
+ * @param struct xbee_transfer_report * report: What happened is stored here,
+ *												may be NULL
+ *
+ * @return :		0 - Success
+ *					1 - No OFFER arrived within wait_ms
+ *					2 - The file can not be created
+ *					3 - The sender went silent, the .part file is kept
+ *					4 - Every byte arrived but the CRC32 was wrong
+ *					5 - Error reading from or writing to the port
+ *			 Not Zero - Error
+ */
+int xbee_transfer_receive( struct xbee *, const char *, int, struct xbee_transfer_report * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -0,0 +1,694 @@
+/** @file xbee_txq.c
+ ** @brief Implementation of the xbee_txq.h
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file contains the implementation of functions described in the
+ *				xbee_txq.h file.
+ *
+ *				Only the loop thread removes messages and only producers add
+ *				them. The loop thread moves a batch from the classes to its
+ *				sending list under the lock but writes it with the lock
+ *				released, so producers never wait for a system call. The
+ *				classes are only consulted again once the batch is written.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include "libxbee.h"
+#include "xbee_txq.h"
+#include "xbee_stats.h"
+
+
+/* @breif Starts or stops watching the port for writability
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int watch: TRUE to start watching, FALSE to stop
+ */
+static void watch_port( struct xbee_txq * queue, int watch )
+{
+	if( queue->watching == watch )
+		return;
+
+	xbee_loop_modify( queue->loop,
+					  queue->port_descriptor,
+					  ( watch == TRUE ) ? XBEE_LOOP_WRITE : 0 );
+
+	queue->watching = watch;
+}//----- End ----- watch_port( struct xbee_txq *, int )------------------
+
+
+/* @breif Drops written bytes from the front of the queue
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param size_t written: Number of bytes the port took
+ *
+ * @return :		0 - The congestion state did not change
+ *					1 - The queue just fell below its low watermark
+ */
+static int retire( struct xbee_txq * queue, size_t written )
+{
+	struct xbee_txq_message * message;
+	size_t left;
+	int relieved = 0;
+
+	pthread_mutex_lock( &queue->lock );
+
+	queue->depth -= written;
+	queue->bytes_written += written;
+
+	while( written > 0 )
+	{
+		message = queue->sending;
+		left = message->length - message->offset;
+
+		if( written < left )
+		{
+			message->offset += written;		//The rest goes out on the next write
+			queue->classes[message->class].bytes_written += written;
+			break;
+		}//End ----- if( written < left ) -------------------------------
+
+		written -= left;
+		queue->classes[message->class].bytes_written += left;
+		queue->sending = message->next;
+		queue->messages--;
+
+		free( message );
+	}//End ----- while( written > 0 ) -------------------------------
+
+	if( queue->congested == TRUE && queue->depth <= queue->low_watermark )
+	{
+		queue->congested = FALSE;
+		relieved = 1;
+	}//End ----- if( below low watermark ) --------------------------
+
+	pthread_mutex_unlock( &queue->lock );
+
+	return relieved;
+}//----- End ----- retire( struct xbee_txq *, size_t )-------------------
+
+
+/* @breif Picks the class the next message is taken from, the lock must be held
+ *
+ * With XBEE_TXQ_WEIGHTED a class is served while its deficit covers its first
+ * message, then the round moves on and the next class gets its weight.
+ *
+ * @param struct xbee_txq * queue: The queue
+ *
+ * @return :	   -1 - Every class is empty
+ *			 Not Negative - The class
+ */
+static int pick_class( struct xbee_txq * queue )
+{
+	struct xbee_txq_class * class;
+	int index;
+
+	for( index = 0; index < XBEE_TXQ_CLASSES; index++ )
+	{
+		if( queue->classes[index].head != NULL )
+			break;
+	}//End ----- for( index < XBEE_TXQ_CLASSES ) --------------------
+
+	if( index == XBEE_TXQ_CLASSES )
+		return -1;
+
+	if( queue->scheduling == XBEE_TXQ_STRICT )
+		return index;
+
+	for( ;; )
+	{
+		class = &queue->classes[queue->next_class];
+
+		if( class->head != NULL && class->deficit >= class->head->length )
+			return queue->next_class;
+
+		//An empty class does not save up for later
+		if( class->head == NULL )
+			class->deficit = 0;
+
+		queue->next_class = ( queue->next_class + 1 ) % XBEE_TXQ_CLASSES;
+		class = &queue->classes[queue->next_class];
+
+		if( class->head != NULL )
+			class->deficit += class->weight;
+	}//End ----- for( ;; ) ------------------------------------------
+}//----- End ----- pick_class( struct xbee_txq * )-----------------------
+
+
+/* @breif Moves the next messages from the classes to the sending list, the
+ * lock must be held
+ *
+ * Takes about XBEE_TXQ_BACKLOG bytes, and at least one message, so a message
+ * of a higher class queued meanwhile does not wait long.
+ *
+ * @param struct xbee_txq * queue: The queue, its sending list empty
+ */
+static void take_batch( struct xbee_txq * queue )
+{
+	struct xbee_txq_message ** tail = &queue->sending;
+	struct xbee_txq_message * message;
+	struct xbee_txq_class * class;
+	size_t taken = 0;
+	int count = 0;
+	int index;
+
+	while( count < XBEE_TXQ_BATCH && taken < XBEE_TXQ_BACKLOG )
+	{
+		index = pick_class( queue );
+
+		if( index < 0 )
+			break;
+
+		class = &queue->classes[index];
+		message = class->head;
+		class->head = message->next;
+
+		if( class->head == NULL )
+			class->tail = NULL;
+
+		if( queue->scheduling == XBEE_TXQ_WEIGHTED )
+			class->deficit -= message->length;
+
+		message->next = NULL;
+		*tail = message;
+		tail = &message->next;
+
+		taken += message->length;
+		count++;
+	}//End ----- while( room in the batch ) -------------------------
+}//----- End ----- take_batch( struct xbee_txq * )-----------------------
+
+
+/* @breif Writes as much of the queue as the port takes
+ *
+ * Runs in the loop thread. Stops watching the port once the queue is empty
+ * and starts watching it when the port is full or already holds
+ * XBEE_TXQ_BACKLOG bytes.
+ *
+ * Header files needed: sys/ioctl.h
+ *
+ * @param struct xbee_txq * queue: The queue
+ */
+static void flush( struct xbee_txq * queue )
+{
+	struct iovec iov[XBEE_TXQ_BATCH];
+	struct xbee_txq_message * message;
+	size_t batch;
+	size_t room;
+	ssize_t written;
+	int pending;
+	int count;
+
+	while( queue->error == 0 )
+	{
+		//Only the loop thread touches the sending list, the lock guards the classes
+		if( queue->sending == NULL )
+		{
+			pthread_mutex_lock( &queue->lock );
+			take_batch( queue );
+			pthread_mutex_unlock( &queue->lock );
+		}//End ----- if( queue->sending == NULL ) -----------------------
+
+		if( queue->sending == NULL )
+		{
+			watch_port( queue, FALSE );
+			return;
+		}//End ----- if( queue is empty ) -------------------------------
+
+		//Bytes in the kernel's buffer can not be overtaken, keep them few.
+		//Descriptors that are not ttys have no such count.
+		room = XBEE_TXQ_BACKLOG;
+
+		if( ioctl( queue->port_descriptor, TIOCOUTQ, &pending ) == 0 )
+		{
+			if( pending >= XBEE_TXQ_BACKLOG )
+			{
+				watch_port( queue, TRUE );
+				return;
+			}//End ----- if( backlog is full ) ------------------------------
+
+			room = XBEE_TXQ_BACKLOG - pending;
+		}//End ----- if( ioctl == 0 ) -----------------------------------
+
+		batch = 0;
+
+		for( message = queue->sending, count = 0;
+			 message != NULL && count < XBEE_TXQ_BATCH && batch < room;
+			 message = message->next, count++ )
+		{
+			iov[count].iov_base = message->data + message->offset;
+			iov[count].iov_len = message->length - message->offset;
+
+			if( batch + iov[count].iov_len > room )
+				iov[count].iov_len = room - batch;
+
+			batch += iov[count].iov_len;
+		}//End ----- for( each message in the batch ) -------------------
+
+		written = writev( queue->port_descriptor, iov, count );
+		xbee_stats_count( queue->stats, XBEE_STAT_WRITES, 1 );
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			if( errno == EAGAIN || errno == EWOULDBLOCK )
+			{
+				watch_port( queue, TRUE );
+				return;
+			}//End ----- if( errno == EAGAIN ) ------------------------------
+
+			printf( "Writing the transmit queue failed with errno(%d)!\n",
+					errno );
+
+			queue->error = errno;
+			watch_port( queue, FALSE );
+			return;
+		}//End ----- if( written < 0 ) ----------------------------------
+
+		xbee_stats_count( queue->stats, XBEE_STAT_BYTES_OUT, written );
+
+		if( retire( queue, written ) && queue->backpressure != NULL )
+			queue->backpressure( queue, FALSE, queue->backpressure_arg );
+
+		if( (size_t)written < batch )
+		{
+			//The port is full, continue once it drains
+			xbee_stats_count( queue->stats, XBEE_STAT_PARTIAL_WRITES, 1 );
+			watch_port( queue, TRUE );
+			return;
+		}//End ----- if( written < batch ) ------------------------------
+	}//End ----- while( queue->error == 0 ) -------------------------
+}//----- End ----- flush( struct xbee_txq * )----------------------------
+
+
+/* @breif Loop callback for the eventfd producers signal new data with
+ *
+ * @param int fd: The eventfd
+ * @param uint32_t events: The events reported by the loop
+ * @param void * arg: The queue
+ */
+static void queue_woken( int fd, uint32_t events, void * arg )
+{
+	uint64_t signals;
+
+	if( read( fd, &signals, sizeof(signals) ) < 0 )
+		return;
+
+	flush( arg );
+}//----- End ----- queue_woken( int, uint32_t, void * )------------------
+
+
+/* @breif Loop callback for when the port can take more data
+ *
+ * @param int fd: The queue's duplicate of the port
+ * @param uint32_t events: The events reported by the loop
+ * @param void * arg: The queue
+ */
+static void port_writable( int fd, uint32_t events, void * arg )
+{
+	struct xbee_txq * queue = arg;
+
+	//Errors and hangups are reported even while writability is not watched
+	if( !( events & XBEE_LOOP_WRITE ) )
+	{
+		printf( "The port of the transmit queue hung up or failed!\n" );
+
+		queue->error = EIO;
+		xbee_loop_remove( queue->loop, fd );
+		return;
+	}//End ----- if( not writable ) ---------------------------------
+
+	flush( queue );
+}//----- End ----- port_writable( int, uint32_t, void * )----------------
+
+
+/* @breif Creates a transmit queue for a port and registers it with a loop
+ *
+ * The queue watches its own duplicate of the port, so the port can still be
+ * registered with the same loop for reading.
+ *
+ * Header files needed: sys/eventfd.h
+ *
+ * @param struct xbee_txq * queue: The queue to initialize
+ * @param struct xbee_loop * loop: The loop whose thread writes to the port
+ * @param struct xbee * xbee: The xbee whose port is written, its statistics
+ *							  count the writes
+ * @param size_t capacity: Most bytes the queue holds
+ *
+ * @return :		0 - Success
+ *					1 - Failed to duplicate the port or create the eventfd
+ *					2 - Failed to register with the loop
+ *			 Not Zero - Error
+ */
+int xbee_txq_init( struct xbee_txq * queue, struct xbee_loop * loop, struct xbee * xbee, size_t capacity )
+{
+	memset( queue, 0, sizeof(*queue) );
+
+	pthread_mutex_init( &queue->lock, NULL );
+	queue->loop = loop;
+	queue->capacity = capacity;
+	queue->high_watermark = capacity / 4 * 3;
+	queue->low_watermark = capacity / 4;
+	queue->scheduling = XBEE_TXQ_STRICT;
+	queue->classes[XBEE_TXQ_CONTROL].weight = XBEE_TXQ_CONTROL_WEIGHT;
+	queue->classes[XBEE_TXQ_NORMAL].weight = XBEE_TXQ_NORMAL_WEIGHT;
+	queue->classes[XBEE_TXQ_BULK].weight = XBEE_TXQ_BULK_WEIGHT;
+
+	queue->stats = get_xbee_stats( xbee );
+	queue->port_descriptor = dup( get_port_descriptor( xbee ) );
+	queue->wake_descriptor = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+	if( queue->port_descriptor < 0 || queue->wake_descriptor < 0 )
+	{
+		printf( "\nCreating the transmit queue failed with error[%d].\n",
+				errno );
+
+		xbee_txq_close( queue );
+		return 1;
+	}//End ----- if( descriptors failed ) ---------------------------
+
+	//The port stays registered and only has writability turned on and off
+	if( xbee_loop_add( loop, queue->port_descriptor, 0, port_writable, queue ) != 0 ||
+		xbee_loop_add( loop, queue->wake_descriptor, XBEE_LOOP_READ, queue_woken, queue ) != 0 )
+	{
+		xbee_txq_close( queue );
+		return 2;
+	}//End ----- if( xbee_loop_add != 0 ) ---------------------------
+
+	return 0;
+}//----- End ----- xbee_txq_init( struct xbee_txq *, ... )---------------
+
+
+/* @breif Sets the watermarks and the callback that reports backpressure
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param size_t high: Depth in bytes above which the queue is congested
+ * @param size_t low: Depth in bytes below which it is not congested anymore
+ * @param xbee_txq_callback callback: Told about changes, may be NULL
+ * @param void * arg: Passed to callback
+ */
+void xbee_txq_set_watermarks( struct xbee_txq * queue,
+							  size_t high,
+							  size_t low,
+							  xbee_txq_callback callback,
+							  void * arg )
+{
+	pthread_mutex_lock( &queue->lock );
+
+	queue->high_watermark = high;
+	queue->low_watermark = low;
+	queue->backpressure = callback;
+	queue->backpressure_arg = arg;
+
+	pthread_mutex_unlock( &queue->lock );
+}//----- End ----- xbee_txq_set_watermarks( struct xbee_txq *, ... )-----
+
+
+/* @breif Chooses how the loop thread picks between the classes
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int scheduling: XBEE_TXQ_STRICT or XBEE_TXQ_WEIGHTED
+ * @param const size_t * weights: Bytes per round of each class with
+ *								  XBEE_TXQ_WEIGHTED, NULL for the default weights
+ *
+ * @return :		0 - Success
+ *					1 - Unknown scheduling or a weight of 0
+ *			 Not Zero - Error
+ */
+int xbee_txq_set_scheduling( struct xbee_txq * queue, int scheduling, const size_t * weights )
+{
+	int index;
+
+	if( scheduling != XBEE_TXQ_STRICT && scheduling != XBEE_TXQ_WEIGHTED )
+		return 1;
+
+	for( index = 0; weights != NULL && index < XBEE_TXQ_CLASSES; index++ )
+	{
+		if( weights[index] == 0 )
+			return 1;
+	}//End ----- for( index < XBEE_TXQ_CLASSES ) --------------------
+
+	pthread_mutex_lock( &queue->lock );
+
+	queue->scheduling = scheduling;
+
+	for( index = 0; index < XBEE_TXQ_CLASSES; index++ )
+	{
+		if( weights != NULL )
+			queue->classes[index].weight = weights[index];
+
+		queue->classes[index].deficit = 0;
+	}//End ----- for( index < XBEE_TXQ_CLASSES ) --------------------
+
+	pthread_mutex_unlock( &queue->lock );
+
+	return 0;
+}//----- End ----- xbee_txq_set_scheduling( struct xbee_txq *, int, const size_t * )--
+
+
+/* @breif Copies a message into the queue as XBEE_TXQ_NORMAL, safe to call from
+ * any thread
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param const void * data: The message
+ * @param size_t length: Number of bytes in the message
+ *
+ * @return :	XBEE_TXQ_OK - The message was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for it
+ *		 XBEE_TXQ_NO_MEMORY - The copy could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ */
+int xbee_txq_enqueue( struct xbee_txq * queue, const void * data, size_t length )
+{
+	return xbee_txq_enqueue_chunks( queue, XBEE_TXQ_NORMAL, data, length, length );
+}//----- End ----- xbee_txq_enqueue( struct xbee_txq *, const void *, size_t )
+
+
+/* @breif Copies a message into the queue in a class, safe to call from any thread
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int class: XBEE_TXQ_CONTROL, XBEE_TXQ_NORMAL or XBEE_TXQ_BULK
+ * @param const void * data: The message
+ * @param size_t length: Number of bytes in the message
+ *
+ * @return :	XBEE_TXQ_OK - The message was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for it
+ *		 XBEE_TXQ_NO_MEMORY - The copy could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ *		 XBEE_TXQ_BAD_CLASS - No such class
+ */
+int xbee_txq_enqueue_class( struct xbee_txq * queue, int class, const void * data, size_t length )
+{
+	return xbee_txq_enqueue_chunks( queue, class, data, length, length );
+}//----- End ----- xbee_txq_enqueue_class( struct xbee_txq *, int, const void *, size_t )
+
+
+/* @breif Copies a large payload into the queue as messages of chunk bytes, the
+ * last one shorter, safe to call from any thread
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int class: XBEE_TXQ_CONTROL, XBEE_TXQ_NORMAL or XBEE_TXQ_BULK
+ * @param const void * data: The payload
+ * @param size_t length: Number of bytes in the payload
+ * @param size_t chunk: Bytes per chunk
+ *
+ * @return :	XBEE_TXQ_OK - The payload was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for all of it
+ *		 XBEE_TXQ_NO_MEMORY - The copies could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ *		 XBEE_TXQ_BAD_CLASS - No such class
+ *		 XBEE_TXQ_BAD_CHUNK - A chunk of 0 bytes for a payload that is not empty
+ */
+int xbee_txq_enqueue_chunks( struct xbee_txq * queue, int class, const void * data, size_t length, size_t chunk )
+{
+	struct xbee_txq_message * first = NULL;
+	struct xbee_txq_message ** tail = &first;
+	struct xbee_txq_message * message;
+	struct xbee_txq_class * queued;
+	uint64_t signal = 1;
+	size_t offset;
+	size_t size;
+	int chunks = 0;
+	int was_empty;
+	int congested = 0;
+
+	if( class < 0 || class >= XBEE_TXQ_CLASSES )
+		return XBEE_TXQ_BAD_CLASS;
+
+	if( chunk == 0 && length > 0 )
+		return XBEE_TXQ_BAD_CHUNK;
+
+	if( queue->error != 0 )
+		return XBEE_TXQ_FAILED;
+
+	if( length == 0 )
+		return XBEE_TXQ_OK;
+
+	//Copy before taking the lock so other producers are not held up
+	for( offset = 0; offset < length; offset += size )
+	{
+		size = ( length - offset < chunk ) ? length - offset : chunk;
+		message = malloc( sizeof(*message) + size );
+
+		if( message == NULL )
+		{
+			while( first != NULL )
+			{
+				message = first;
+				first = first->next;
+				free( message );
+			}//End ----- while( first != NULL ) -----------------------------
+
+			return XBEE_TXQ_NO_MEMORY;
+		}//End ----- if( message == NULL ) ------------------------------
+
+		message->next = NULL;
+		message->class = class;
+		message->length = size;
+		message->offset = 0;
+		memcpy( message->data, (const unsigned char *)data + offset, size );
+
+		*tail = message;
+		tail = &message->next;
+		chunks++;
+	}//End ----- for( offset < length ) -----------------------------
+
+	pthread_mutex_lock( &queue->lock );
+
+	if( queue->depth + length > queue->capacity )
+	{
+		pthread_mutex_unlock( &queue->lock );
+
+		while( first != NULL )
+		{
+			message = first;
+			first = first->next;
+			free( message );
+		}//End ----- while( first != NULL ) -----------------------------
+
+		return XBEE_TXQ_FULL;
+	}//End ----- if( no room ) --------------------------------------
+
+	was_empty = ( queue->depth == 0 );
+	queued = &queue->classes[class];
+
+	if( queued->head == NULL )
+		queued->head = first;
+	else
+		queued->tail->next = first;
+
+	for( message = first; message->next != NULL; message = message->next );
+
+	queued->tail = message;
+	queue->depth += length;
+	queue->messages += chunks;
+
+	if( queue->congested == FALSE && queue->depth > queue->high_watermark )
+	{
+		queue->congested = TRUE;
+		congested = 1;
+	}//End ----- if( above high watermark ) -------------------------
+
+	pthread_mutex_unlock( &queue->lock );
+
+	//A non empty queue is always being flushed or waiting for the port, so the
+	//loop only needs waking for the first message
+	if( was_empty && write( queue->wake_descriptor, &signal, sizeof(signal) ) < 0 )
+		return XBEE_TXQ_FAILED;
+
+	if( congested && queue->backpressure != NULL )
+		queue->backpressure( queue, TRUE, queue->backpressure_arg );
+
+	return XBEE_TXQ_OK;
+}//----- End ----- xbee_txq_enqueue_chunks( struct xbee_txq *, int, const void *, size_t, size_t )
+
+
+/* @breif Reads how much is waiting in the queue
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int * messages: Number of messages waiting, may be NULL
+ *
+ * @return :		Bytes waiting to be written
+ */
+size_t xbee_txq_depth( struct xbee_txq * queue, int * messages )
+{
+	size_t depth;
+
+	pthread_mutex_lock( &queue->lock );
+
+	depth = queue->depth;
+
+	if( messages != NULL )
+		*messages = queue->messages;
+
+	pthread_mutex_unlock( &queue->lock );
+
+	return depth;
+}//----- End ----- xbee_txq_depth( struct xbee_txq *, int * )------------
+
+
+/* @breif Unregisters the queue and frees the messages it still holds
+ *
+ * @param struct xbee_txq * queue: The queue to close
+ */
+void xbee_txq_close( struct xbee_txq * queue )
+{
+	struct xbee_txq_message * message;
+	int index;
+
+	if( queue->port_descriptor >= 0 )
+	{
+		xbee_loop_remove( queue->loop, queue->port_descriptor );
+		close( queue->port_descriptor );
+	}//End ----- if( queue->port_descriptor >= 0 ) ------------------
+
+	if( queue->wake_descriptor >= 0 )
+	{
+		xbee_loop_remove( queue->loop, queue->wake_descriptor );
+		close( queue->wake_descriptor );
+	}//End ----- if( queue->wake_descriptor >= 0 ) ------------------
+
+	queue->port_descriptor = -1;
+	queue->wake_descriptor = -1;
+
+	while( queue->sending != NULL )
+	{
+		message = queue->sending;
+		queue->sending = message->next;
+		free( message );
+	}//End ----- while( queue->sending != NULL ) --------------------
+
+	for( index = 0; index < XBEE_TXQ_CLASSES; index++ )
+	{
+		while( queue->classes[index].head != NULL )
+		{
+			message = queue->classes[index].head;
+			queue->classes[index].head = message->next;
+			free( message );
+		}//End ----- while( head != NULL ) ------------------------------
+
+		queue->classes[index].tail = NULL;
+	}//End ----- for( index < XBEE_TXQ_CLASSES ) --------------------
+
+	queue->depth = 0;
+	queue->messages = 0;
+
+	pthread_mutex_destroy( &queue->lock );
+}//----- End ----- xbee_txq_close( struct xbee_txq * )-------------------
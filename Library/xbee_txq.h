@@ -0,0 +1,276 @@
+/** @file xbee_txq.h
+ ** @brief Bounded transmit queue drained by an event loop
+ *
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Description: This file describes a transmit queue for one port. Application
+ *				threads enqueue messages without ever waiting on the port; the
+ *				thread running the event loop writes them out whenever the port
+ *				can take more data. Messages are written in order, several at a
+ *				time with writev, and a partial write continues where it stopped.
+ *
+ *				The queue holds at most a fixed number of bytes. Enqueueing
+ *				into a full queue fails at once instead of blocking. Producers
+ *				can also watch the queue depth: the backpressure callback is
+ *				called when the depth rises above the high watermark and again
+ *				when it falls back below the low watermark.
+ *
+ *				Every message belongs to a priority class. Between classes the
+ *				loop thread either serves the highest class that has a message
+ *				waiting(XBEE_TXQ_STRICT), or gives each class its weight in
+ *				bytes per round(XBEE_TXQ_WEIGHTED, deficit round robin) so bulk
+ *				traffic is slowed down but never starved. Messages of one class
+ *				are written in order.
+ *
+ *				A message is never interrupted once its first byte is written,
+ *				so a large payload should be queued with xbee_txq_enqueue_chunks
+ *				as chunks that each stand on their own, e.g. one packet each;
+ *				the scheduler picks again at every chunk boundary. Only about
+ *				XBEE_TXQ_BACKLOG bytes are let into the kernel's output buffer
+ *				at a time, so a control message waits for at most that backlog
+ *				and one chunk, not for a whole transfer.
+ *
+ *				Once a port has a transmit queue all of its writes should go
+ *				through the queue, otherwise their bytes may be interleaved.
+ *
+ * @bugs
+ * @date 10-16-2026
+ */
+
+#ifndef XBEE_TXQ_H
+#define XBEE_TXQ_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "libxbee.h"
+#include "xbee_loop.h"
+
+//-----------------Global Variable Definitions-------------------------------------
+
+//Most messages handed to a single writev
+#define XBEE_TXQ_BATCH 16
+
+//The tty driver's WAKEUP_CHARS: EPOLLOUT is only reported once fewer bytes
+//than this wait in the kernel's output buffer
+#define XBEE_TXQ_WAKEUP_CHARS 256
+
+//Bytes allowed in the kernel's output buffer before the queue waits for it
+//to drain. It must not be below XBEE_TXQ_WAKEUP_CHARS: the queue waits for
+//EPOLLOUT once TIOCOUTQ reaches the backlog, and a smaller backlog would be
+//woken while TIOCOUTQ is still above it, so the loop would spin until the
+//buffer drained.
+#define XBEE_TXQ_BACKLOG 256
+
+#if XBEE_TXQ_BACKLOG < XBEE_TXQ_WAKEUP_CHARS
+#error "XBEE_TXQ_BACKLOG below XBEE_TXQ_WAKEUP_CHARS makes the transmit queue spin"
+#endif
+
+//Priority classes, from the most urgent
+#define XBEE_TXQ_CONTROL 0			//Alarms and AT control
+#define XBEE_TXQ_NORMAL 1			//What xbee_txq_enqueue queues
+#define XBEE_TXQ_BULK 2				//Transfers and log uploads
+#define XBEE_TXQ_CLASSES 3
+
+//Scheduling between the classes
+#define XBEE_TXQ_STRICT 0			//The highest class with a message waiting
+#define XBEE_TXQ_WEIGHTED 1			//Each class gets its weight in bytes per round
+
+//Weights in bytes per round when the caller does not choose
+#define XBEE_TXQ_CONTROL_WEIGHT 1024
+#define XBEE_TXQ_NORMAL_WEIGHT 512
+#define XBEE_TXQ_BULK_WEIGHT 256
+
+//Results of xbee_txq_enqueue
+#define XBEE_TXQ_OK 0
+#define XBEE_TXQ_FULL 1				//Not enough room, try again later
+#define XBEE_TXQ_NO_MEMORY 2
+#define XBEE_TXQ_FAILED 3			//Writing to the port failed, see error
+#define XBEE_TXQ_BAD_CLASS 4		//No such class
+#define XBEE_TXQ_BAD_CHUNK 5		//A chunk size of 0
+
+//A message waiting in the queue
+struct xbee_txq_message
+{
+	struct xbee_txq_message * next;
+	int class;						//XBEE_TXQ_CONTROL, NORMAL or BULK
+	size_t length;
+	size_t offset;					//Bytes already written
+	unsigned char data[];
+};
+
+//The messages of one priority class
+struct xbee_txq_class
+{
+	struct xbee_txq_message * head;
+	struct xbee_txq_message * tail;
+	size_t weight;					//Bytes per round with XBEE_TXQ_WEIGHTED
+	size_t deficit;					//Bytes the class may still send this round
+	unsigned long long bytes_written;
+};
+
+struct xbee_txq;
+
+/* @breif Called when the queue becomes congested or stops being congested
+ *
+ * Called from the thread that crossed the watermark, the producer for the
+ * high watermark and the loop thread for the low watermark.
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int congested: TRUE above the high watermark, FALSE below the low one
+ * @param void * arg: The argument given to xbee_txq_set_watermarks
+ */
+typedef void (*xbee_txq_callback)( struct xbee_txq *, int, void * );
+
+struct xbee_txq
+{
+	pthread_mutex_t lock;			//Protects the list, the depth and congested
+	struct xbee_loop * loop;		//Loop that drains the queue
+	int port_descriptor;			//Duplicate of the port, watched for writability
+	struct xbee_stats * stats;		//Statistics of the xbee, updated by every write
+	int wake_descriptor;			//eventfd that tells the loop there is data
+	int watching;					//TRUE while the loop waits for port_descriptor to be writable
+	int error;						//errno of the failed write, 0 if none
+	struct xbee_txq_class classes[XBEE_TXQ_CLASSES];
+	int scheduling;					//XBEE_TXQ_STRICT or XBEE_TXQ_WEIGHTED
+	int next_class;					//Class the weighted round is at
+	struct xbee_txq_message * sending;	//Taken from the classes, being written by the loop thread
+	size_t depth;					//Bytes waiting to be written
+	int messages;					//Messages waiting to be written
+	size_t capacity;				//Most bytes the queue holds
+	size_t high_watermark;
+	size_t low_watermark;
+	int congested;
+	xbee_txq_callback backpressure;
+	void * backpressure_arg;
+	unsigned long long bytes_written;
+};
+
+//---------------End Global Variable Definitions-----------------------------------
+
+
+//-----------------Function Prototypes---------------------------------------------
+
+/* @breif Creates a transmit queue for a port and registers it with a loop
+ *
+ * The queue watches its own duplicate of the port, so the port can still be
+ * registered with the same loop for reading.
+ *
+ * Header files needed: sys/eventfd.h
+ *
+ * @param struct xbee_txq * queue: The queue to initialize
+ * @param struct xbee_loop * loop: The loop whose thread writes to the port
+ * @param struct xbee * xbee: The xbee whose port is written, its statistics
+ *							  count the writes
+ * @param size_t capacity: Most bytes the queue holds
+ *
+ * @return :		0 - Success
+ *					1 - Failed to duplicate the port or create the eventfd
+ *					2 - Failed to register with the loop
+ *			 Not Zero - Error
+ */
+int xbee_txq_init( struct xbee_txq *, struct xbee_loop *, struct xbee *, size_t );
+
+/* @breif Sets the watermarks and the callback that reports backpressure
+ *
+ * By default the high watermark is three quarters of the capacity and the low
+ * watermark one quarter, without a callback.
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param size_t high: Depth in bytes above which the queue is congested
+ * @param size_t low: Depth in bytes below which it is not congested anymore
+ * @param xbee_txq_callback callback: Told about changes, may be NULL
+ * @param void * arg: Passed to callback
+ */
+void xbee_txq_set_watermarks( struct xbee_txq *, size_t, size_t, xbee_txq_callback, void * );
+
+/* @breif Chooses how the loop thread picks between the classes
+ *
+ * By default the classes are served with XBEE_TXQ_STRICT.
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int scheduling: XBEE_TXQ_STRICT or XBEE_TXQ_WEIGHTED
+ * @param const size_t * weights: Bytes per round of each class with
+ *								  XBEE_TXQ_WEIGHTED, NULL for the default weights
+ *
+ * @return :		0 - Success
+ *					1 - Unknown scheduling or a weight of 0
+ *			 Not Zero - Error
+ */
+int xbee_txq_set_scheduling( struct xbee_txq *, int, const size_t * );
+
+/* @breif Copies a message into the queue as XBEE_TXQ_NORMAL, safe to call from
+ * any thread
+ *
+ * Never waits for the port. The message is written by the loop thread.
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param const void * data: The message
+ * @param size_t length: Number of bytes in the message
+ *
+ * @return :	XBEE_TXQ_OK - The message was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for it
+ *		 XBEE_TXQ_NO_MEMORY - The copy could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ */
+int xbee_txq_enqueue( struct xbee_txq *, const void *, size_t );
+
+/* @breif Copies a message into the queue in a class, safe to call from any thread
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int class: XBEE_TXQ_CONTROL, XBEE_TXQ_NORMAL or XBEE_TXQ_BULK
+ * @param const void * data: The message
+ * @param size_t length: Number of bytes in the message
+ *
+ * @return :	XBEE_TXQ_OK - The message was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for it
+ *		 XBEE_TXQ_NO_MEMORY - The copy could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ *		 XBEE_TXQ_BAD_CLASS - No such class
+ */
+int xbee_txq_enqueue_class( struct xbee_txq *, int, const void *, size_t );
+
+/* @breif Copies a large payload into the queue as messages of chunk bytes, the
+ * last one shorter, safe to call from any thread
+ *
+ * Messages of other classes may be written between the chunks, so each chunk
+ * must make sense on its own. The payload is queued whole or not at all.
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int class: XBEE_TXQ_CONTROL, XBEE_TXQ_NORMAL or XBEE_TXQ_BULK
+ * @param const void * data: The payload
+ * @param size_t length: Number of bytes in the payload
+ * @param size_t chunk: Bytes per chunk
+ *
+ * @return :	XBEE_TXQ_OK - The payload was queued
+ *			  XBEE_TXQ_FULL - The queue does not have room for all of it
+ *		 XBEE_TXQ_NO_MEMORY - The copies could not be allocated
+ *		    XBEE_TXQ_FAILED - An earlier write to the port failed
+ *		 XBEE_TXQ_BAD_CLASS - No such class
+ *		 XBEE_TXQ_BAD_CHUNK - A chunk of 0 bytes for a payload that is not empty
+ */
+int xbee_txq_enqueue_chunks( struct xbee_txq *, int, const void *, size_t, size_t );
+
+/* @breif Reads how much is waiting in the queue
+ *
+ * @param struct xbee_txq * queue: The queue
+ * @param int * messages: Number of messages waiting, may be NULL
+ *
+ * @return :		Bytes waiting to be written
+ */
+size_t xbee_txq_depth( struct xbee_txq *, int * );
+
+/* @breif Unregisters the queue and frees the messages it still holds
+ *
+ * Must be called from the loop thread or once the loop has stopped.
+ *
+ * @param struct xbee_txq * queue: The queue to close
+ */
+void xbee_txq_close( struct xbee_txq * );
+
+//---------------End Function Prototypes-------------------------------------------
+#endif //Include Gaurd End
@@ -80,6 +80,7 @@
  *  @param char * argv: [0] - The name of this program's executable.
  *                    : [1] - The complete serial port name to be
  *                            opened.
+ *                    : [2] - Optional baud rate, 9600 by default.
  *
  *  @return int : Should not return
  *                0 - Successful exit.
@@ -90,8 +91,8 @@ int main( int argc, char* argv[] )
 {
 	if( argc < 2 )
 	{
-		printf( "\nUsage: ./xbee_serial \"<port_name>\"\n" );
-		printf( "Example: ./xbee_serial \"/tmp/ttyS0\"\n" );
+		printf( "\nUsage: ./xbee_serial \"<port_name>\" [baud_rate]\n" );
+		printf( "Example: ./xbee_serial \"/tmp/ttyS0\" 115200\n" );
 		return EXIT_SUCCESS;
 	}
 
@@ -134,38 +135,57 @@ int main( int argc, char* argv[] )
 			//input from source 1 available
 			if( FD_ISSET(global_serial_port_descriptor, &readfs) )
 			{
-				char rx_char;
-
-				if( read( global_serial_port_descriptor, &rx_char, 1 ) )
+				//Take everything the port has in one read instead of a byte at a time
+				char rx_chunk[MAX_BUFFER_SIZE];
+				int rx_count = read( global_serial_port_descriptor,
+									 rx_chunk,
+									 sizeof(rx_chunk) );
+				int rx_offset = 0;
+
+				while( rx_offset < rx_count )
 				{
-					global_rx_buffer[in_rx_index] = rx_char;
-					in_rx_index++;
+					//XBee responses are terminated by carriage return=<cr>='\r'=13=0x0d
+					char * rx_end = memchr( rx_chunk + rx_offset, '\r', rx_count - rx_offset );
+					uint32_t length = ( rx_end != NULL ) ? rx_end - ( rx_chunk + rx_offset )
+														 : rx_count - rx_offset;
+					uint32_t room = MAX_BUFFER_SIZE - 1 - in_rx_index;
 
-					//printf( "rx_char=[%c]=%d=[%s].\n", rx_char, in_rx_index, global_rx_buffer );
+					if( length >= room ) //Message too long, hand out what fits
+					{
+						length = room;
+						rx_end = rx_chunk + rx_offset + length;
+					}
 
-					//XBee responses are terminated by carriage return=<cr>='\r'=13=0x0d
-					if( rx_char == '\r' )
+					memcpy( global_rx_buffer + in_rx_index, rx_chunk + rx_offset, length );
+					in_rx_index += length;
+					rx_offset += length;
+
+					//printf( "rx_chunk=%d=[%s].\n", in_rx_index, global_rx_buffer );
+
+					if( rx_end != NULL )
 					{
-						//stringify message and overwrite XBee's <CR>.
-						global_rx_buffer[in_rx_index-1] = '\0';
+						//stringify message, the XBee's <CR> is not copied.
+						global_rx_buffer[in_rx_index] = '\0';
 
-						command_buffer_ready = TRUE;
+						if( rx_offset < rx_count && rx_chunk[rx_offset] == '\r' )
+						{
+							rx_offset++;
+						}
 
 						in_rx_index = 0;
 
+						//Several messages can arrive in one read, so each one is
+						//processed as soon as it is complete. Leftover bytes stay
+						//in global_rx_buffer for the next read.
+						command_buffer_ready = TRUE;
+						process_buffer( global_rx_buffer );
+
 					}//END preparing end of message-----------------------------
 
 				}//END testing for serial port input--------------------------
 
 			}//finished processing input from source 1
 
-			//here we can monitor buffers to see what commands we get and
-			//and do certian things based in whats in the command buffer.
-			if( command_buffer_ready == TRUE )
-			{
-				process_buffer( global_rx_buffer );
-			}
-
 			//keyboard input: Remember, keyboard processes input only after it sees:
 			//newline cahacter='\n'=nl=10=0x0a.
 			//So, ignore the extra '\n' from the keyboard and ensure it is not added
@@ -370,6 +390,7 @@ void restore_old_port_settings(void)
  *  @param char * argv: [0] - The name of this program's executable.
  *                    : [1] - The complete serial port name to be
  *                            opened.
+ *                    : [2] - Optional baud rate, 9600 by default.
  *
  *  @return int : 0 - Success.
  *                Not Zero - Error.
@@ -382,6 +403,19 @@ int init_serial_port( int argc, char * argv[] )
 		strncpy( port_name, argv[1], MAX_BUFFER_SIZE );
 	}//else use the default one
 
+	if( argc > 2 ) //The XBee must already be set to this rate(ATBD)
+	{
+		baud_rate = atoi( argv[2] );
+	}
+
+	if( baud_rate_speed( baud_rate ) == B0 )
+	{
+		printf( "\nBaud rate[%d] is not supported by the XBee.\n",
+			baud_rate
+			);
+		return 7;
+	}
+
 	//We are ignoring SIGIO signal since we are using "select" instead
 	signal( SIGIO, SIG_IGN );
 
@@ -456,13 +490,15 @@ int init_serial_port( int argc, char * argv[] )
 
 	//set new port 8N1 settings for non-canonical input processing
 	//must be NOCTTY, set baud rate
-	newtio.c_cflag = BAUDRATE | CS8 | CLOCAL | CREAD;
-	//(ignore parity | map '\r' to '\n')
-	newtio.c_iflag = ( IGNPAR | ICRNL );
+	newtio.c_cflag = CS8 | CLOCAL | CREAD;
+	cfsetispeed( &newtio, baud_rate_speed( baud_rate ) );
+	cfsetospeed( &newtio, baud_rate_speed( baud_rate ) );
+	//ignore parity, nothing else is translated so '\r' arrives as '\r'
+	newtio.c_iflag = IGNPAR;
 	newtio.c_oflag = 0; //ONLCR converts '\n' to CR-LF pairs
-	newtio.c_lflag = ~(ICANON | ECHO | ECHOE | ISIG);
-	newtio.c_cc[VMIN] = 0;  //return as soon as there is at least 1-byte
-	newtio.c_cc[VTIME] = 1; //otherwise it returns in 0.1 s regardless.
+	newtio.c_lflag = 0; //raw: no canonical mode, echo or signal characters
+	newtio.c_cc[VMIN] = 1;  //select wakes us as soon as 1 byte arrives
+	newtio.c_cc[VTIME] = 0; //and read returns what is there at once
 
 	ret_value = tcflush( global_serial_port_descriptor, TCIFLUSH );
 	if( ret_value != 0 )
@@ -492,14 +528,42 @@ int init_serial_port( int argc, char * argv[] )
 		return 6;
 	}
 
-	printf( "\nActivating port[%s] settings successful.\n",
-		    port_name
+	printf( "\nActivating port[%s] settings at %d baud successful.\n",
+		    port_name,
+			baud_rate
 			);
 
 	return EXIT_SUCCESS;
 
 }//END init_serial_port-----------------------------------------------
 
+/** @brief Converts a baud rate to its termios speed.
+ *
+ *  Only the rates the XBee can be set to with ATBD are accepted.
+ *
+ *  @param int rate : Bits per second.
+ *
+ *  @return speed_t : B0 - The XBee does not support the rate.
+ *                    Not B0 - The termios speed.
+ *.............................................................................
+ */
+speed_t baud_rate_speed( int rate )
+{
+	switch( rate )
+	{
+		case 1200: return B1200;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		default: return B0;
+	}
+}//END baud_rate_speed------------------------------------------------
+
 //..............................END OF FILE...........................
 
 #endif //Include Guard End
@@ -57,8 +57,8 @@
 #define FALSE 0
 #define TRUE 1
 
-//#define BAUDRATE B115200
-#define BAUDRATE B9600
+//Used unless a baud rate is given on the command line
+#define DEFAULT_BAUD_RATE 9600
 
 #define MAX_BUFFER_SIZE 255
 
@@ -82,9 +82,12 @@ uint32_t STOP = FALSE;
 
 char port_name[MAX_BUFFER_SIZE] = "/dev/ttyUSB0";
 
+int baud_rate = DEFAULT_BAUD_RATE;
+
 //------------------Helper function Prototypes------------------------
 
 int init_serial_port( int argc, char * argv[] );
+speed_t baud_rate_speed( int rate );
 int process_buffer( char * buffer );
 int write_port( char * bfr );
 void restore_old_port_settings(void);